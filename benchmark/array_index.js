@@ -0,0 +1,9 @@
+// Random access to array elements - with the dense array
+// index this should be roughly constant as the array grows
+[16,64,256,1024].forEach(function(size) {
+  var a = [];
+  for (var i=0;i<size;i++) a.push(i);
+  var t = getTime(), s = 0;
+  for (i=0;i<1000;i++) s += a[(i*7)%size];
+  console.log(size+" elements: "+((getTime()-t)*1000).toFixed(1)+"ms");
+});
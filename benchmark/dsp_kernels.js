@@ -0,0 +1,24 @@
+// E.sum/E.variance/E.convolve/E.FFT on 1024 samples of vibration data.
+// The Array versions use iterators, the typed arrays use native kernels
+var n = 1024;
+var samples = [];
+for (var i=0;i<n;i++) samples.push(Math.round(Math.sin(i*0.3)*1000 + Math.sin(i*2.1)*200));
+var data = {
+  Array : function() { return samples.slice(); },
+  Float32Array : function() { return new Float32Array(samples); },
+  Int16Array : function() { return new Int16Array(samples); }
+};
+function time(name, fn) {
+  var t = getTime();
+  fn();
+  return name+" "+((getTime()-t)*1000).toFixed(1)+"ms";
+}
+for (var k in data) {
+  var a = data[k](), b = data[k]();
+  console.log(k+": "+[
+    time("sum", function() { for (var j=0;j<10;j++) E.sum(a); }),
+    time("variance", function() { for (var j=0;j<10;j++) E.variance(a, 0); }),
+    time("convolve", function() { for (var j=0;j<10;j++) E.convolve(a, b, j); }),
+    time("FFT", function() { E.FFT(a); })
+  ].join(", "));
+}
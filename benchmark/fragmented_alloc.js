@@ -0,0 +1,23 @@
+// Allocating ArrayBuffers when memory is fragmented, before and after E.defrag()
+var l = null, k = 0;
+var free = process.memory().free;
+while (free > 30) {
+  for (var i=0;i<(free-25)/5;i++) l = {n:l, v:k++, x:{}};
+  free = process.memory().free;
+}
+for (var n=l;n;n=n.n) delete n.x;
+
+function test() {
+  var flat = 0, t = getTime();
+  for (var i=0;i<100;i++) {
+    var b = new Uint8Array(2000);
+    if (E.getAddressOf(b,true)) flat++;
+    b = undefined;
+  }
+  return ((getTime()-t)*1000).toFixed(1)+"ms, "+flat+" flat";
+}
+print("Fragmented: "+test());
+var t = getTime();
+E.defrag();
+print("E.defrag(): "+((getTime()-t)*1000).toFixed(1)+"ms");
+print("Defragmented: "+test());
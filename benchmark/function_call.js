@@ -0,0 +1,7 @@
+function add(a,b) {
+  return a+b;
+}
+var s = 0;
+for (i=0;i<10000;i++) {
+  s = add(s, i);
+}
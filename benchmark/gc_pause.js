@@ -0,0 +1,18 @@
+// Longest delay of a 2ms interval while memory is nearly full and cyclic
+// garbage is being created - compare with E.setGCOptions({incremental:true})
+var fill = null, free = process.memory().free;
+while (free > 100) {
+  for (var i=0;i<(free-90)/2;i++) fill = {n:fill};
+  free = process.memory().free;
+}
+var worst = 0, last = getTime(), n = 0;
+var iv = setInterval(function() {
+  var t = getTime();
+  if (n>2 && t-last > worst) worst = t-last;
+  last = t;
+  var a = {}; a.a = a; // garbage
+  if (++n==200) {
+    clearInterval(iv);
+    console.log("Longest interval: "+(worst*1000).toFixed(2)+"ms, longest GC pause: "+process.memory().gcmax.toFixed(2)+"ms");
+  }
+}, 2);
@@ -0,0 +1,14 @@
+// Drawing into a 16bpp framebuffer (ArrayBuffers are limited to 64kB, so 160x120 rather than 320x240)
+var g = Graphics.createArrayBuffer(160,120,16);
+var img = { width:64, height:64, bpp:16, buffer:new Uint16Array(64*64).buffer };
+function time(name, fn) {
+  var t = getTime();
+  fn();
+  console.log(name+": "+((getTime()-t)*1000).toFixed(1)+"ms");
+}
+time("clear", function() { for (var i=0;i<10;i++) g.clear(); });
+time("fillRect", function() { for (var i=0;i<100;i++) { g.setColor(i*97); g.fillRect(i/2,i/3,i/2+100,i/3+80); } });
+time("hlines", function() { for (var y=0;y<120;y++) g.drawLine(0,y,159,y); });
+time("vlines", function() { for (var x=0;x<160;x++) g.drawLine(x,0,x,119); });
+time("drawImage", function() { for (var i=0;i<20;i++) g.drawImage(img,i*4,i*2); });
+time("drawString", function() { for (var i=0;i<15;i++) g.drawString("Hello World 012345",0,i*8); });
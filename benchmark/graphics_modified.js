@@ -0,0 +1,23 @@
+// Bytes that would be sent to a 160x120 16bpp display per frame, flushing
+// just the bounding box (getModified) vs just the modified tiles (getModifiedRegions)
+var g = Graphics.createArrayBuffer(160,120,16);
+g.getModified(true);
+function frame(n) {
+  // a clock in one corner and a status icon in the other
+  g.setColor(n*1234);
+  g.drawString(""+n, 2, 2);
+  g.fillRect(150,110,157,117);
+}
+var FRAMES = 50;
+var bboxBytes = 0, regionBytes = 0, t = getTime();
+for (var n=0;n<FRAMES;n++) {
+  frame(n);
+  var m = g.getModified();
+  bboxBytes += (m.x2+1-m.x1)*(m.y2+1-m.y1)*2;
+  g.getModifiedRegions(true).forEach(function(r) {
+    regionBytes += (r.x2+1-r.x1)*(r.y2+1-r.y1)*2;
+  });
+}
+console.log("getModified: "+(bboxBytes/FRAMES)+" bytes/frame");
+console.log("getModifiedRegions: "+(regionBytes/FRAMES)+" bytes/frame");
+console.log("time: "+((getTime()-t)*1000/FRAMES).toFixed(2)+"ms/frame");
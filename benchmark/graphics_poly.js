@@ -0,0 +1,24 @@
+// Vector text, gauge needles and circles on a 160x120 16bpp buffer
+var g = Graphics.createArrayBuffer(160,120,16);
+function time(name, fn) {
+  var t = getTime();
+  fn();
+  console.log(name+": "+((getTime()-t)*1000).toFixed(1)+"ms");
+}
+function gauge() {
+  for (var i=0;i<40;i++) {
+    var a = i*Math.PI/20, c = Math.cos(a), s = Math.sin(a);
+    g.fillPoly([80+c*50, 60+s*50, 80-s*4, 60+c*4, 80-c*8, 60-s*8, 80+s*4, 60-c*4]);
+  }
+}
+function text() { for (var i=0;i<5;i++) { g.setFontVector(20); g.drawString("Espruino 42",0,i*22); } }
+function circles() { for (var r=2;r<60;r+=2) g.fillCircle(80,60,r); }
+time("text", text);
+time("gauge", gauge);
+time("circles", circles);
+if (g.setAntiAlias) {
+  g.setAntiAlias(true);
+  time("text AA", text);
+  time("gauge AA", gauge);
+  time("circles AA", circles);
+}
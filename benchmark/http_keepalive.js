@@ -0,0 +1,80 @@
+// HTTP server throughput over loopback: requests/sec when every request has
+// its own connection, when requests reuse a persistent connection, and when
+// several requests are pipelined on each connection.
+// Run with: ./espruino benchmark/http_keepalive.js (wait for TIME_WAIT sockets
+// on the port to clear before running it again)
+var http = require("http");
+var net = require("net");
+var PORT = 8125;
+var CLIENTS = 4;
+var PIPELINE = 8; // requests sent at once in the pipelined test
+var DURATION = 3; // seconds per test
+var BODY = "Hello World";
+
+var server = http.createServer(function (req, res) {
+  res.writeHead(200, {"Content-Type": "text/plain"});
+  res.end(BODY);
+});
+server.listen(PORT);
+
+var requests, running;
+
+// one http.get per request - a new connection each time
+function closeClient() {
+  if (!running) return;
+  http.get("http://localhost:"+PORT+"/", function(res) {
+    res.on("close", function() { requests++; closeClient(); });
+  });
+}
+
+/* A raw socket that sends 'pipeline' requests at once and the next batch once
+ * all the responses are in. If the server closes the connection we just
+ * reconnect and carry on */
+function rawClient(pipeline) {
+  var c, pending, buf;
+  function send() {
+    var r = "";
+    for (var i=0;i<pipeline;i++) r += "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    pending = pipeline;
+    c.write(r);
+  }
+  function connect() {
+    if (!running) return;
+    buf = "";
+    c = net.connect({port: PORT}, send);
+    c.on("data", function(d) {
+      buf += d;
+      var i;
+      while ((i=buf.indexOf(BODY))>=0) {
+        buf = buf.substr(i+BODY.length);
+        requests++;
+        pending--;
+      }
+      if (!running) c.end();
+      else if (!pending) send();
+    });
+    c.on("close", connect);
+  }
+  connect();
+}
+
+var tests = [
+  ["connection per request", closeClient],
+  ["keep-alive", function() { rawClient(1); }],
+  ["pipelined x"+PIPELINE, function() { rawClient(PIPELINE); }]
+];
+function runTest(n) {
+  if (n>=tests.length) return server.close();
+  requests = 0;
+  running = true;
+  var t = getTime();
+  for (var i=0;i<CLIENTS;i++) tests[n][1]();
+  setTimeout(function() {
+    running = false;
+    t = getTime()-t;
+    console.log(tests[n][0]+": "+(requests/t).toFixed(1)+" requests/sec ("+requests+" requests, "+CLIENTS+" clients)");
+    // let outstanding requests finish before the next test
+    setTimeout(function() { runTest(n+1); }, 500);
+  }, DURATION*1000);
+}
+runTest(0);
@@ -0,0 +1,47 @@
+// HTTP load test over loopback: requests/sec with a few concurrent clients,
+// then how much CPU we use while a server sits idle waiting for connections.
+// Run with: ./espruino benchmark/http_loopback.js (wait for TIME_WAIT sockets
+// on the port to clear before running it again)
+var http = require("http");
+var fs = require("fs");
+var PORT = 8123;
+var CLIENTS = 4;
+var DURATION = 5; // seconds
+
+// user+system CPU time (in clock ticks) used by this process so far
+function cpuTicks() {
+  var f = fs.readFileSync("/proc/self/stat").toString().split(") ")[1].split(" ");
+  return parseInt(f[11]) + parseInt(f[12]);
+}
+
+var server = http.createServer(function (req, res) {
+  res.writeHead(200, {"Content-Type": "text/plain"});
+  res.end("Hello World");
+});
+server.listen(PORT);
+
+var requests = 0, errors = 0, running = true;
+var tStart = getTime(), cStart = cpuTicks();
+function request() {
+  if (!running) return;
+  var req = http.get("http://localhost:"+PORT+"/", function(res) {
+    res.on("close", function() { requests++; request(); });
+  });
+  req.on("error", function() { errors++; request(); });
+}
+for (var i=0;i<CLIENTS;i++) request();
+
+setTimeout(function() {
+  running = false;
+  var t = getTime()-tStart;
+  console.log("load: "+(requests/t).toFixed(1)+" requests/sec ("+requests+" requests, "+errors+" errors, "+CLIENTS+" clients)");
+  console.log("load: "+(cpuTicks()-cStart)+" CPU ticks in "+t.toFixed(1)+"s");
+  // let outstanding requests finish, then measure an idle server
+  setTimeout(function() {
+    var c = cpuTicks(), t = getTime();
+    setTimeout(function() {
+      console.log("idle: "+(cpuTicks()-c)+" CPU ticks in "+(getTime()-t).toFixed(1)+"s");
+      server.close();
+    }, DURATION*1000);
+  }, 1000);
+}, DURATION*1000);
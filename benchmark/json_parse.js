@@ -0,0 +1,4 @@
+var items = [];
+for (var i=0;i<40;i++) items.push({id:i, name:"Item number "+i, value:i*123.5, tags:["a","b","c"], ok:true});
+var json = JSON.stringify(items);
+for (i=0;i<20;i++) JSON.parse(json);
@@ -0,0 +1,17 @@
+// Peak memory used when sending a large object as JSON, with and without
+// building the whole JSON string first
+var data = [];
+for (var i=0;i<150;i++) data.push({id:i, name:"Item number "+i, value:i*123.5, tags:["a","b","c"]});
+var base = process.memory().usage;
+
+var str = JSON.stringify(data);
+print("JSON.stringify: "+str.length+" chars, "+(process.memory().usage-base)+" vars");
+str = undefined;
+
+var peak = 0, len = 0;
+JSON.stringifyTo(data, { write : function(d) {
+  len += d.length;
+  peak = Math.max(peak, process.memory().usage-base);
+}}, { complete : function() {
+  print("JSON.stringifyTo: "+len+" chars, "+peak+" vars");
+}});
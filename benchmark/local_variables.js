@@ -0,0 +1,22 @@
+// Time for a loop that mostly reads local, closure and global variables
+// - once found, variables shouldn't need to be searched for again
+var scale = 2;
+for (var i=0;i<20;i++) this["global"+i] = i; // globals to search over
+
+function make() {
+  var offset = 1;
+  return function(n) {
+    var a = 0, b = 1, c = 0;
+    for (var i=0;i<n;i++) {
+      c = a + b*scale + offset;
+      a = b;
+      b = c & 1023;
+    }
+    return c;
+  };
+}
+
+var f = make();
+var t = getTime();
+f(20000);
+console.log("20000 iterations: "+((getTime()-t)*1000).toFixed(1)+"ms");
@@ -0,0 +1,33 @@
+// Bulk transfer over a loopback socket: how fast can we receive data?
+// Run with: ./espruino benchmark/net_bulk.js
+var net = require("net");
+var PORT = 8124;
+var TOTAL = 4000000; // bytes to send
+var CHUNK = "";
+while (CHUNK.length<4096) CHUNK += "0123456789abcdef";
+
+var server = net.createServer(function(c) {
+  var sent = 0;
+  function send() { // called again each time the send buffer empties
+    if (sent>=TOTAL) return c.end();
+    c.write(CHUNK);
+    sent += CHUNK.length;
+  }
+  c.on("drain", send);
+  send();
+});
+server.listen(PORT);
+
+var received = 0, events = 0, t = getTime();
+var client = net.connect({port: PORT}, function() {
+  client.on("data", function(d) {
+    received += d.length;
+    events++;
+  });
+  client.on("close", function() {
+    t = getTime()-t;
+    console.log("received "+received+" bytes in "+events+" 'data' events");
+    console.log("time: "+(t*1000).toFixed(0)+"ms, "+(received/(t*1024*1024)).toFixed(2)+" MB/s");
+    server.close();
+  });
+});
@@ -0,0 +1,9 @@
+// Time for 1000 lookups in objects with increasing numbers of keys
+// - with the hash index this should stay roughly constant
+[16,64,256,1024].forEach(function(keys) {
+  var o = {};
+  for (var i=0;i<keys;i++) o["dev"+i] = i;
+  var t = getTime();
+  for (i=0;i<1000;i++) o["dev"+(i%keys)];
+  console.log(keys+" keys: "+((getTime()-t)*1000).toFixed(1)+"ms");
+});
@@ -0,0 +1,20 @@
+// Time to handle 8000 pin events with 32 watches set up on 16 pins
+// (on Linux, writes to pins without real GPIO push watch events)
+var pins = [], n = 0;
+for (var i=0;i<16;i++) pins.push(Pin(i));
+pins.forEach(function(p) {
+  setWatch(function() { n++; }, p, {repeat:true, edge:"rising"});
+  setWatch(function() { n++; }, p, {repeat:true, edge:"falling"});
+});
+var batch = 0, t = getTime();
+function toggle() {
+  // 16 pins x 2 writes = 32 events per loop - keep under the event buffer size
+  for (var j=0;j<4;j++)
+    pins.forEach(function(p) { digitalWrite(p,1); digitalWrite(p,0); });
+  if (++batch < 63) setTimeout(toggle, 0);
+  else setTimeout(function() {
+    console.log(n+" watch callbacks in "+((getTime()-t)*1000).toFixed(1)+"ms");
+    clearWatch();
+  }, 0);
+}
+toggle();
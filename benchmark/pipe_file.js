@@ -0,0 +1,50 @@
+// Piping a 1MB file to another file and to a loopback socket: how fast does
+// data move through a pipe?
+// Run with: ./espruino benchmark/pipe_file.js
+var net = require("net");
+var PORT = 8127;
+var SIZE = 1024*1024;
+var FILE = "/tmp/espruino_pipe_benchmark.bin";
+
+var chunk = "";
+while (chunk.length<1024) chunk += "0123456789abcdef";
+var f = E.openFile(FILE, "w");
+for (var i=0;i<SIZE;i+=chunk.length) f.write(chunk);
+f.close();
+
+function report(name, bytes, t) {
+  console.log(name+": "+bytes+" bytes in "+(t*1000).toFixed(0)+"ms, "+(bytes/(t*1024*1024)).toFixed(2)+" MB/s");
+}
+
+function fileToFile(next) {
+  var t = getTime();
+  E.openFile(FILE, "r").pipe(E.openFile(FILE+".copy", "w"), { complete : function() {
+    report("file -> file", SIZE, getTime()-t);
+    next();
+  }});
+}
+
+function fileToSocket(next) {
+  var t;
+  var server = net.createServer(function(c) {
+    t = getTime();
+    E.openFile(FILE, "r").pipe(c);
+  });
+  server.listen(PORT);
+  var received = 0;
+  var client = net.connect({port: PORT}, function() {
+    client.on("data", function(d) { received += d.length; });
+    client.on("close", function() {
+      report("file -> socket", received, getTime()-t);
+      server.close();
+      next();
+    });
+  });
+}
+
+fileToFile(function() {
+  fileToSocket(function() {
+    require("fs").unlink(FILE);
+    require("fs").unlink(FILE+".copy");
+  });
+});
@@ -0,0 +1,11 @@
+// Time for repeated property lookups on objects, prototypes and builtins
+// - with the inline cache these shouldn't need to search each time
+function Vec(x,y) { this.x = x; this.y = y; }
+Vec.prototype.len = function() { return Math.sqrt(this.x*this.x + this.y*this.y); };
+for (var i=0;i<20;i++) Vec.prototype["m"+i] = i; // methods to search over
+
+var v = new Vec(3,4);
+var t = getTime();
+var s = 0;
+for (var i=0;i<2000;i++) s += v.len() + Math.sin(i) + Math.cos(i);
+console.log("2000 iterations: "+((getTime()-t)*1000).toFixed(1)+"ms");
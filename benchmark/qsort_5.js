@@ -0,0 +1,20 @@
+// Built-in Array.sort on sorted, reversed and random data, with and
+// without a compare function
+var n = 500;
+var data = {sorted:[], reversed:[], random:[]};
+for (var i=0;i<n;i++) {
+  data.sorted.push(i);
+  data.reversed.push(n-i);
+  data.random.push((i*7919)%n);
+}
+["sorted","reversed","random"].forEach(function(k) {
+  var a = data[k].slice();
+  var t = getTime();
+  a.sort(function(a,b) { return a-b; });
+  var tFn = getTime()-t;
+  a = data[k].slice();
+  t = getTime();
+  a.sort();
+  var tDef = getTime()-t;
+  console.log(k+": "+(tFn*1000).toFixed(1)+"ms with compare fn, "+(tDef*1000).toFixed(1)+"ms default");
+});
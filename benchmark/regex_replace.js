@@ -0,0 +1,22 @@
+// String.replace/split with RegExps over KB-sized strings
+
+var line = "Harry Trump ;Fred Barney; Helen Rigby ; Bill Abel ;Chris Hand\n";
+var text = "";
+for (var i=0;i<32;i++) text += line; // ~2kb
+
+var t = getTime();
+var r, s;
+for (var i=0;i<5;i++) {
+  r = text.replace(/\s*;\s*/g, ",");
+  r = text.replace(/([A-Z])[a-z]+/g, "$1.");
+  s = text.split(/\s*[;\n]\s*/);
+  s = text.split(/a|e|i|o|u/);
+}
+t = getTime()-t;
+console.log("Replace/split "+text.length+" chars:",Math.round(t*1000)+"ms");
+
+// a regex that makes a backtracking matcher take exponential time
+t = getTime();
+/(a+)+b/.test("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+t = getTime()-t;
+console.log("Pathological regex:",Math.round(t*1000)+"ms");
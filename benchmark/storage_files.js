@@ -0,0 +1,38 @@
+// Storage with lots of small files: how long does it take to create, read,
+// list, overwrite and look up missing files when there are 500 of them?
+// Run with: ./espruino benchmark/storage_files.js
+var s = require("Storage");
+var FILES = 500;
+var errors = 0;
+
+function time(label, fn) {
+  var t = getTime();
+  fn();
+  t = getTime()-t;
+  console.log(label+": "+(t*1000).toFixed(0)+"ms, "+(FILES/t).toFixed(1)+" files/sec");
+}
+function check(prefix) {
+  for (var i=0;i<FILES;i++)
+    if (s.read("f"+i)!=prefix+i) errors++;
+}
+
+s.eraseAll();
+time("create", function() {
+  for (var i=0;i<FILES;i++) s.write("f"+i, "config "+i);
+});
+time("read", function() { check("config "); });
+time("list x10", function() {
+  for (var i=0;i<FILES;i+=50)
+    if (s.list().length!=FILES) errors++;
+});
+time("overwrite", function() {
+  for (var i=0;i<FILES;i++) s.write("f"+i, "changed "+i);
+});
+time("read missing", function() {
+  for (var i=0;i<FILES;i++)
+    if (s.read("x"+i)!==undefined) errors++;
+});
+time("compact", function() { s.compact(); });
+time("read after compact", function() { check("changed "); });
+s.eraseAll();
+console.log(errors+" errors");
@@ -0,0 +1,2 @@
+var s = "";
+for (i=0;i<20000;i++) s += "X";
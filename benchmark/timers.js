@@ -0,0 +1,16 @@
+// Time taken to run a 1ms interval 500 times while 10000 other timeouts are
+// waiting (which previously all had to be checked every time around the idle loop)
+var t = getTime();
+for (var i=0;i<10000;i++) setTimeout(function() {}, 100000+i);
+console.log("Adding 10000 timeouts: "+((getTime()-t)*1000).toFixed(1)+"ms");
+var n = 0;
+t = getTime();
+var iv = setInterval(function() {
+  if (++n==500) {
+    clearInterval(iv);
+    console.log("500 intervals: "+((getTime()-t)*1000).toFixed(1)+"ms");
+    t = getTime();
+    clearTimeout();
+    console.log("Clearing all timeouts: "+((getTime()-t)*1000).toFixed(1)+"ms");
+  }
+}, 1);
@@ -0,0 +1,14 @@
+// Bulk operations on a typed array of 10k sensor samples
+var a = new Int16Array(10000);
+for (var i=0;i<a.length;i++) a[i] = (i*7919)%4096 - 2048;
+var b = new Int16Array(a.length);
+function time(name, fn) {
+  var t = getTime();
+  fn();
+  console.log(name+": "+((getTime()-t)*1000).toFixed(1)+"ms");
+}
+time("set", function() { b.set(a); });
+time("sort", function() { b.sort(); });
+time("reverse", function() { b.reverse(); });
+time("indexOf", function() { b.indexOf(-2048); });
+time("fill", function() { b.fill(0); });
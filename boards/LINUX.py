@@ -32,6 +32,7 @@ info = {
    'makefile' : [
 #     'DEFINES+=-DFLASH_64BITS_ALIGNMENT=1', For testing 64 bit flash writes
      'LINUX=1',
+     'USE_BYTECODE=1',
    ]
  }
 };
@@ -47,6 +48,12 @@ chip = {
   'i2c' : 3,
   'adc' : 0,
   'dac' : 0,
+  'saved_code' : {
+    'address' : 0x10020000, # the second half of the fake flash file
+    'page_size' : 1024,
+    'pages' : 128,
+    'flash_available' : 128,
+  },
 };
 
 devices = {
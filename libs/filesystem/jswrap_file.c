@@ -400,6 +400,30 @@ really speed up writes - but then you must be sure to close
 all files you are writing before power is lost or you will
 cause damage to your SD card's filesystem.
 */
+/// Write 'length' bytes to an open file, returning how many were written
+static size_t fileWrite(JsFile *file, const char *buf, size_t length, FRESULT *res) {
+  size_t written = 0;
+#ifndef LINUX
+  *res = f_write(&file->data->handle, buf, length, &written);
+#else
+  written = fwrite(buf, 1, length, file->data->handle);
+#endif
+  if (written == 0 && length)
+    *res = FR_DISK_ERR;
+  return written;
+}
+
+/// Sync after writing - just in case there's a reset or something
+static void fileSync(JsFile *file) {
+  if (!jsfGetFlag(JSF_UNSYNC_FILES)) {
+#ifndef LINUX
+    f_sync(&file->data->handle);
+#else
+    fflush(file->data->handle);
+#endif
+  }
+}
+
 size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
   FRESULT res = 0;
   size_t bytesWritten = 0;
@@ -419,26 +443,11 @@ size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
             jsvIteratorNext(&it);
           }
           // write it out
-          size_t written = 0;
-#ifndef LINUX
-          res = f_write(&file.data->handle, &buf, n, &written);
-#else
-          written = fwrite(&buf, 1, n, file.data->handle);
-#endif
-          bytesWritten += written;
-          if(written == 0)
-            res = FR_DISK_ERR;
+          bytesWritten += fileWrite(&file, buf, n, &res);
           if (res) break;
         }
         jsvIteratorFree(&it);
-        // finally, sync - just in case there's a reset or something
-        if (!jsfGetFlag(JSF_UNSYNC_FILES)) {
-#ifndef LINUX
-          f_sync(&file.data->handle);
-#else
-          fflush(file.data->handle);
-#endif
-        }
+        fileSync(&file);
       }
     }
   }
@@ -449,6 +458,41 @@ size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
   return bytesWritten;
 }
 
+/// Write data to a File straight from a buffer (eg. for pipes). Returns the number of bytes written
+size_t jswrap_file_writeBuf(JsVar* parent, const char *buf, size_t length) {
+  FRESULT res = 0;
+  size_t bytesWritten = 0;
+  if (jsfsInit()) {
+    JsFile file;
+    if (fileGetFromVar(&file, parent) &&
+        (file.data->mode == FM_WRITE || file.data->mode == FM_READ_WRITE)) {
+      bytesWritten = fileWrite(&file, buf, length, &res);
+      fileSync(&file);
+    }
+  }
+  if (res) jsfsReportError("Unable to write file", res);
+  return bytesWritten;
+}
+
+/// Read data from a File straight into a buffer (eg. for pipes). Returns the number of bytes read, 0 at the end of the file
+size_t jswrap_file_readBuf(JsVar* parent, char *buf, size_t length) {
+  FRESULT res = 0;
+  size_t bytesRead = 0;
+  if (jsfsInit()) {
+    JsFile file;
+    if (fileGetFromVar(&file, parent) &&
+        (file.data->mode == FM_READ || file.data->mode == FM_READ_WRITE)) {
+#ifndef LINUX
+      res = f_read(&file.data->handle, buf, length, &bytesRead);
+#else
+      bytesRead = fread(buf, 1, length, file.data->handle);
+#endif
+    }
+  }
+  if (res) jsfsReportError("Unable to read file", res);
+  return bytesRead;
+}
+
 /*JSON{
   "type" : "method",
   "class" : "File",
@@ -71,6 +71,8 @@ void jswrap_E_unmountSD();
 
 size_t jswrap_file_write(JsVar* parent, JsVar* buffer);
 JsVar *jswrap_file_read(JsVar* parent, int length);
+size_t jswrap_file_writeBuf(JsVar* parent, const char *buf, size_t length);
+size_t jswrap_file_readBuf(JsVar* parent, char *buf, size_t length);
 void jswrap_file_skip_or_seek(JsVar* parent, int length, bool is_skip);
 void jswrap_file_close(JsVar* parent);
 #ifdef USE_FLASHFS
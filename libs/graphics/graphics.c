@@ -80,10 +80,7 @@ void graphicsFallbackScroll(JsGraphics *gfx, int xdir, int ydir) {
     for (y=gfx->data.height-ydir-1;y>=0;y--)
       graphicsFallbackScrollX(gfx, xdir, y, y+ydir);
   }
-  gfx->data.modMinX=0;
-  gfx->data.modMinY=0;
-  gfx->data.modMaxX=gfx->data.width-1;
-  gfx->data.modMaxY=gfx->data.height-1;
+  graphicsSetModified(gfx, 0, 0, gfx->data.width-1, gfx->data.height-1);
 }
 
 // ----------------------------------------------------------------------------------------------
@@ -158,12 +155,83 @@ void graphicsToDeviceCoordinates(const JsGraphics *gfx, short *x, short *y) {
 
 // ----------------------------------------------------------------------------------------------
 
+void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2) {
+  if (x1 < gfx->data.modMinX) gfx->data.modMinX=(short)x1;
+  if (x2 > gfx->data.modMaxX) gfx->data.modMaxX=(short)x2;
+  if (y1 < gfx->data.modMinY) gfx->data.modMinY=(short)y1;
+  if (y2 > gfx->data.modMaxY) gfx->data.modMaxY=(short)y2;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  graphicsSetModifiedTiles(gfx->data.modTiles, gfx->data.width, gfx->data.height, x1, y1, x2, y2);
+#endif
+}
+
+void graphicsClearModified(JsGraphics *gfx) {
+  gfx->data.modMaxX = -32768;
+  gfx->data.modMaxY = -32768;
+  gfx->data.modMinX = 32767;
+  gfx->data.modMinY = 32767;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  memset(gfx->data.modTiles, 0, sizeof(gfx->data.modTiles));
+#endif
+}
+
+#ifdef JSGRAPHICS_MODIFIED_TILES
+// The size of each tile - at least 1 pixel
+static void graphicsGetTileSize(int width, int height, int *tileW, int *tileH) {
+  *tileW = (width+JSGRAPHICS_MODIFIED_TILES-1) / JSGRAPHICS_MODIFIED_TILES;
+  *tileH = (height+JSGRAPHICS_MODIFIED_TILES-1) / JSGRAPHICS_MODIFIED_TILES;
+  if (*tileW<1) *tileW=1;
+  if (*tileH<1) *tileH=1;
+}
+
+// Bits for tiles tx1 to tx2 inclusive
+static unsigned short graphicsGetTileBits(int tx1, int tx2) {
+  return (unsigned short)(((2U<<tx2)-1) & ~((1U<<tx1)-1));
+}
+
+// Tile (x,y) is bit x&7 of byte tiles[y*2 + (x>>3)]
+void graphicsSetModifiedTiles(unsigned char *tiles, int width, int height, int x1, int y1, int x2, int y2) {
+  int tileW, tileH, ty;
+  graphicsGetTileSize(width, height, &tileW, &tileH);
+  unsigned short bits = graphicsGetTileBits(x1/tileW, x2/tileW);
+  for (ty=y1/tileH;ty<=y2/tileH;ty++) {
+    tiles[ty*2] |= (unsigned char)bits;
+    tiles[ty*2+1] |= (unsigned char)(bits>>8);
+  }
+}
+
+void graphicsGetModifiedTiles(unsigned char *tiles, int width, int height, bool clear, JsGraphicsRegionCallback callback, void *callbackData) {
+  int tileW, tileH, tx1, tx2, ty1, ty2;
+  graphicsGetTileSize(width, height, &tileW, &tileH);
+  unsigned short t[JSGRAPHICS_MODIFIED_TILES];
+  for (ty1=0;ty1<JSGRAPHICS_MODIFIED_TILES;ty1++)
+    t[ty1] = (unsigned short)(tiles[ty1*2] | (tiles[ty1*2+1]<<8));
+  if (clear) memset(tiles, 0, JSGRAPHICS_MODIFIED_TILES_SIZE);
+  for (ty1=0;ty1<JSGRAPHICS_MODIFIED_TILES;ty1++) {
+    while (t[ty1]) {
+      // find the first run of modified tiles in this row...
+      tx1 = 0;
+      while (!(t[ty1] & (1<<tx1))) tx1++;
+      tx2 = tx1;
+      while (tx2+1<JSGRAPHICS_MODIFIED_TILES && (t[ty1] & (1<<(tx2+1)))) tx2++;
+      unsigned short bits = graphicsGetTileBits(tx1, tx2);
+      // ...and extend it down as far as we can
+      ty2 = ty1;
+      while (ty2+1<JSGRAPHICS_MODIFIED_TILES && (t[ty2+1]&bits)==bits) ty2++;
+      int y;
+      for (y=ty1;y<=ty2;y++) t[y] &= (unsigned short)~bits;
+      int x2 = (tx2+1)*tileW, y2 = (ty2+1)*tileH;
+      if (x2>width) x2=width;
+      if (y2>height) y2=height;
+      callback(tx1*tileW, ty1*tileH, x2-1, y2-1, callbackData);
+    }
+  }
+}
+#endif
+
 static void graphicsSetPixelDevice(JsGraphics *gfx, int x, int y, unsigned int col) {
   if (x<0 || y<0 || x>=gfx->data.width || y>=gfx->data.height) return;
-  if (x < gfx->data.modMinX) gfx->data.modMinX=(short)x;
-  if (x > gfx->data.modMaxX) gfx->data.modMaxX=(short)x;
-  if (y < gfx->data.modMinY) gfx->data.modMinY=(short)y;
-  if (y > gfx->data.modMaxY) gfx->data.modMaxY=(short)y;
+  graphicsSetModified(gfx, x, y, x, y);
   gfx->setPixel(gfx,(short)x,(short)y,col & (unsigned int)((1L<<gfx->data.bpp)-1));
 }
 
@@ -189,10 +257,7 @@ static void graphicsFillRectDevice(JsGraphics *gfx, int x1, int y1, int x2, int
   if (y2>=gfx->data.height) y2 = gfx->data.height - 1;
   if (x2<x1 || y2<y1) return; // nope
 
-  if (x1 < gfx->data.modMinX) gfx->data.modMinX=(short)x1;
-  if (x2 > gfx->data.modMaxX) gfx->data.modMaxX=(short)x2;
-  if (y1 < gfx->data.modMinY) gfx->data.modMinY=(short)y1;
-  if (y2 > gfx->data.modMaxY) gfx->data.modMaxY=(short)y2;
+  graphicsSetModified(gfx, x1, y1, x2, y2);
 
   if (x1==x2 && y1==y2) {
     gfx->setPixel(gfx,(short)x1,(short)y1,gfx->data.fgColor);
@@ -271,29 +336,6 @@ void graphicsDrawCircle(JsGraphics *gfx, short posX, short posY, short rad) {
   }
 }
 
-void graphicsFillCircle(JsGraphics *gfx, short x, short y, short rad) {
-  graphicsToDeviceCoordinates(gfx, &x, &y);
-
-  int radY = 0;
-  int decisionOver2 = 1 - rad;
-
-  while (rad >= radY) {
-    graphicsFillRectDevice(gfx, rad + x, radY + y, -rad + x, -radY + y);
-    graphicsFillRectDevice(gfx, radY + x, rad + y, -radY + x, -rad + y);
-    graphicsFillRectDevice(gfx, -rad + x, radY + y, rad + x, -radY + y);
-    graphicsFillRectDevice(gfx, -radY + x, rad + y, radY + x, -rad + y);
-    radY++;
-    if (decisionOver2 <= 0){
-      // Change in decision criterion for radY -> radY+1
-      decisionOver2 += 2 * radY + 1;
-    }else{
-      rad--;
-      // Change for radY -> radY+1, rad -> rad-1
-      decisionOver2 += 2 * (radY - rad) + 1;
-    }
-  }
-}
-
 void graphicsDrawString(JsGraphics *gfx, short x1, short y1, const char *str) {
   // no need to modify coordinates as setPixel does that
   while (*str) {
@@ -306,6 +348,12 @@ void graphicsDrawLine(JsGraphics *gfx, short x1, short y1, short x2, short y2) {
   graphicsToDeviceCoordinates(gfx, &x1, &y1);
   graphicsToDeviceCoordinates(gfx, &x2, &y2);
 
+  // horizontal and vertical lines can be drawn as a rectangle in one go
+  if (x1==x2 || y1==y2) {
+    graphicsFillRectDevice(gfx, x1, y1, x2, y2);
+    return;
+  }
+
   int xl = x2-x1;
   int yl = y2-y1;
   if (xl<0) xl=-xl; else if (xl==0) xl=1;
@@ -339,72 +387,426 @@ void graphicsDrawLine(JsGraphics *gfx, short x1, short y1, short x2, short y2) {
   }
 }
 
-static inline void graphicsFillPolyCreateScanLines(JsGraphics *gfx, short *minx, short *maxx, short x1, short y1,short x2, short y2) {
-    if (y2 < y1) {
-        short t;
-        t=x1;x1=x2;x2=t;
-        t=y1;y1=y2;y2=t;
+// ----------------------------------------------------------------------------------------------
+/* Scanline rasteriser shared by fillPoly, fillCircle and vector fonts.
+ *
+ * Shapes are given in DEVICE coordinates with JSGRAPHICS_POLY_SHIFT fractional
+ * bits, with pixel centres on whole numbers. Each pixel row is sampled once
+ * (or GRAPHICS_AA_SAMPLES times when antialiasing) and the shape adds the
+ * spans it covers at each sample with graphicsRasterSpan. */
+
+#define GRAPHICS_POLY_ONE (1<<JSGRAPHICS_POLY_SHIFT)
+#define GRAPHICS_POLY_HALF (GRAPHICS_POLY_ONE>>1)
+#ifndef SAVE_ON_FLASH
+#define GRAPHICS_AA_SAMPLES 4 ///< vertical samples per pixel when antialiasing
+#endif
+
+typedef struct {
+  JsGraphics *gfx;
+  int x1, x2;      ///< pixels that the shape covers, clipped to the screen
+  int y;           ///< current pixel row
+  short *spans;    ///< non-antialiased: x1,x2 pairs for the current row
+  int spanCount, maxSpans;
+  int fillX1, fillX2, fillY; ///< non-antialiased: a single span drawn on every row from fillY to y-1, not yet filled
+#ifdef GRAPHICS_AA_SAMPLES
+  unsigned short *coverage; ///< antialiased: coverage (0..256) of each pixel from x1 to x2, or 0 if not antialiasing
+#endif
+} GraphicsRaster;
+
+// Fill the rows that have had the same single span
+static void graphicsRasterFlush(GraphicsRaster *r) {
+  if (r->fillY < r->y)
+    graphicsFillRectDevice(r->gfx, r->fillX1, r->fillY, r->fillX2, r->y-1);
+  r->fillY = r->y;
+}
+
+static void graphicsRasterInit(GraphicsRaster *r, JsGraphics *gfx, int x1, int x2, short *spans, int maxSpans) {
+  r->gfx = gfx;
+  r->x1 = (x1<0) ? 0 : x1;
+  r->x2 = (x2>=gfx->data.width) ? gfx->data.width-1 : x2;
+  r->y = 0;
+  r->spans = spans;
+  r->spanCount = 0;
+  r->maxSpans = maxSpans;
+  r->fillY = 0;
+#ifdef GRAPHICS_AA_SAMPLES
+  r->coverage = 0;
+#endif
+}
+
+/// Add the span from xa to xb (fixed point) for the current sample
+static void graphicsRasterSpan(GraphicsRaster *r, int xa, int xb) {
+#ifdef GRAPHICS_AA_SAMPLES
+  if (r->coverage) {
+    // pixel p covers ua=[p*ONE, (p+1)*ONE)
+    int ua = xa + GRAPHICS_POLY_HALF, ub = xb + GRAPHICS_POLY_HALF;
+    if (ua < r->x1*GRAPHICS_POLY_ONE) ua = r->x1*GRAPHICS_POLY_ONE;
+    if (ub > (r->x2+1)*GRAPHICS_POLY_ONE) ub = (r->x2+1)*GRAPHICS_POLY_ONE;
+    if (ua >= ub) return;
+    // each sample adds up to 256/GRAPHICS_AA_SAMPLES to a pixel's coverage
+    const int full = 256/GRAPHICS_AA_SAMPLES, unit = full/GRAPHICS_POLY_ONE;
+    unsigned short *cov = &r->coverage[-r->x1];
+    int pa = ua>>JSGRAPHICS_POLY_SHIFT, pb = ub>>JSGRAPHICS_POLY_SHIFT;
+    if (pa==pb) {
+      cov[pa] = (unsigned short)(cov[pa] + (ub-ua)*unit);
+    } else {
+      cov[pa] = (unsigned short)(cov[pa] + ((pa+1)*GRAPHICS_POLY_ONE-ua)*unit);
+      int p;
+      for (p=pa+1;p<pb;p++) cov[p] = (unsigned short)(cov[p] + full);
+      if (pb<=r->x2) cov[pb] = (unsigned short)(cov[pb] + (ub-pb*GRAPHICS_POLY_ONE)*unit);
     }
-    int xh = x1*256;
-    int yl = y2-y1;
-    if (yl==0) yl=1;
-    int stepx = (x2-x1)*256 / yl;
-    short y;
-    for (y=y1;y<=y2;y++) {
-        int x = xh>>8;
-        if (x<-32768) x=-32768;
-        if (x>32767) x=32767;
-        if (y>=0 && y<gfx->data.height) {
-            if (x<minx[y]) {
-                minx[y] = (short)x;
-            }
-            if (x>maxx[y]) {
-                maxx[y] = (short)x;
-            }
-        }
-        xh += stepx;
+    return;
+  }
+#endif
+  // round to the nearest pixel - so a span always covers at least one
+  int x1 = (xa + GRAPHICS_POLY_HALF) >> JSGRAPHICS_POLY_SHIFT;
+  int x2 = (xb + GRAPHICS_POLY_HALF) >> JSGRAPHICS_POLY_SHIFT;
+  if (x1 < r->x1) x1 = r->x1;
+  if (x2 > r->x2) x2 = r->x2;
+  if (x1>x2 || r->spanCount>=r->maxSpans) return;
+  r->spans[r->spanCount*2] = (short)x1;
+  r->spans[r->spanCount*2+1] = (short)x2;
+  r->spanCount++;
+}
+
+#ifdef GRAPHICS_AA_SAMPLES
+/// Blend colour a with b, using amt/256 of a. Only makes sense for 8 bit greyscale, 16 bit RGB565 and 24/32 bit RGB
+static unsigned int graphicsBlendColor(JsGraphics *gfx, unsigned int a, unsigned int b, unsigned int amt) {
+  unsigned int bpp = gfx->data.bpp, bits = (bpp==16) ? 6 : 8, shift, result = 0;
+  for (shift=0;shift<bpp;shift+=bits) {
+    if (bpp==16) bits = (shift==5) ? 6 : 5; // 5 bits blue, 6 green, 5 red
+    unsigned int mask = (1U<<bits)-1;
+    unsigned int ca = (a>>shift)&mask, cb = (b>>shift)&mask;
+    result |= ((ca*amt + cb*(256-amt)) >> 8) << shift;
+  }
+  return result;
+}
+#endif
+
+/// Finish the current pixel row
+static void graphicsRasterRow(GraphicsRaster *r) {
+#ifdef GRAPHICS_AA_SAMPLES
+  if (r->coverage) {
+    JsGraphics *gfx = r->gfx;
+    int x, fullX = -1;
+    for (x=r->x1;x<=r->x2+1;x++) {
+      unsigned int c = (x<=r->x2) ? r->coverage[x-r->x1] : 0;
+      if (c>=256) {
+        if (fullX<0) fullX = x;
+        continue;
+      }
+      // fill the run of fully covered pixels in one go
+      if (fullX>=0) {
+        graphicsFillRectDevice(gfx, fullX, r->y, x-1, r->y);
+        fullX = -1;
+      }
+      if (c) {
+        unsigned int col = graphicsBlendColor(gfx, gfx->data.fgColor, graphicsGetPixelDevice(gfx, (short)x, (short)r->y), c);
+        graphicsSetPixelDevice(gfx, x, r->y, col);
+      }
+    }
+    memset(r->coverage, 0, sizeof(unsigned short)*(size_t)(r->x2+1-r->x1));
+    r->y++;
+    return;
+  }
+#endif
+  short *spans = r->spans;
+  int i, j, n = r->spanCount;
+  // sort spans and merge any that overlap
+  for (i=1;i<n;i++) {
+    short a = spans[i*2], b = spans[i*2+1];
+    for (j=i;j>0 && spans[j*2-2]>a;j--) {
+      spans[j*2] = spans[j*2-2];
+      spans[j*2+1] = spans[j*2-1];
+    }
+    spans[j*2] = a;
+    spans[j*2+1] = b;
+  }
+  for (i=0,j=0;i<n;i++) {
+    if (j && spans[i*2] <= spans[j*2-1]+1) {
+      if (spans[i*2+1] > spans[j*2-1]) spans[j*2-1] = spans[i*2+1];
+    } else {
+      spans[j*2] = spans[i*2];
+      spans[j*2+1] = spans[i*2+1];
+      j++;
     }
+  }
+  n = j;
+  // Rows with the same single span are filled as one rectangle
+  if (n!=1 || spans[0]!=r->fillX1 || spans[1]!=r->fillX2)
+    graphicsRasterFlush(r);
+  if (n==1) {
+    r->fillX1 = spans[0];
+    r->fillX2 = spans[1];
+  } else {
+    for (i=0;i<n;i++)
+      graphicsFillRectDevice(r->gfx, spans[i*2], r->y, spans[i*2+1], r->y);
+    r->fillX1 = -1;
+    r->fillY = r->y+1;
+  }
+  r->spanCount = 0;
+  r->y++;
 }
 
-void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices) {
-  int i;
-  short miny = (short)(gfx->data.height-1);
-  short maxy = 0;
+static void graphicsRasterStart(GraphicsRaster *r, int y) {
+  r->y = y;
+  r->fillY = y;
+  r->fillX1 = -1;
+  r->fillX2 = -1;
+}
+
+static void graphicsRasterEnd(GraphicsRaster *r) {
+  if (r->spans) graphicsRasterFlush(r);
+}
+
+/// Should this shape be antialiased?
+static bool graphicsRasterAntiAlias(JsGraphics *gfx) {
+#ifdef GRAPHICS_AA_SAMPLES
+  return (gfx->data.flags & JSGRAPHICSFLAGS_ANTIALIAS) && gfx->data.bpp>=8;
+#else
+  NOT_USED(gfx);
+  return false;
+#endif
+}
+
+/// Get the first sample in row y, and the distance between samples
+static int graphicsRasterFirstSample(bool antiAlias, int y, int *step) {
+#ifdef GRAPHICS_AA_SAMPLES
+  if (antiAlias) {
+    *step = GRAPHICS_POLY_ONE/GRAPHICS_AA_SAMPLES;
+    return y*GRAPHICS_POLY_ONE - GRAPHICS_POLY_HALF + (*step/2);
+  }
+#endif
+  NOT_USED(antiAlias);
+  *step = GRAPHICS_POLY_ONE;
+  return y*GRAPHICS_POLY_ONE;
+}
+
+// ----------------------------------------------------------------------------------------------
+
+// Integer square root
+static unsigned int graphicsSqrt(unsigned long long v) {
+  unsigned long long r = 0, bit = 1ULL<<62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r+bit) {
+      v -= r+bit;
+      r = (r>>1) + bit;
+    } else
+      r >>= 1;
+    bit >>= 2;
+  }
+  return (unsigned int)r;
+}
+
+void graphicsFillCircle(JsGraphics *gfx, short x, short y, short rad) {
+  graphicsToDeviceCoordinates(gfx, &x, &y);
+  if (rad<0) return;
+  bool antiAlias = graphicsRasterAntiAlias(gfx);
+  int y1 = y-rad, y2 = y+rad;
+  if (y1<0) y1=0;
+  if (y2>=gfx->data.height) y2=gfx->data.height-1;
+  if (y1>y2 || x+rad<0 || x-rad>=gfx->data.width) return;
+
+  short spans[2];
+  GraphicsRaster r;
+  graphicsRasterInit(&r, gfx, x-rad, x+rad, spans, 1);
+  if (r.x1>r.x2) return;
+#ifdef GRAPHICS_AA_SAMPLES
+  unsigned short coverage[antiAlias ? (r.x2+1-r.x1) : 1];
+  if (antiAlias) {
+    memset(coverage, 0, sizeof(coverage));
+    r.coverage = coverage;
+    r.spans = 0;
+  }
+#endif
+  // Pixels are filled if their centres are within rad+0.5 of the middle
+  long long cx = x*GRAPHICS_POLY_ONE, cy = y*GRAPHICS_POLY_ONE, R = rad*GRAPHICS_POLY_ONE + GRAPHICS_POLY_HALF;
+  int step, py;
+  int yc = graphicsRasterFirstSample(antiAlias, y1, &step);
+  graphicsRasterStart(&r, y1);
+  for (py=y1;py<=y2;py++) {
+    int s;
+    for (s=0;s<GRAPHICS_POLY_ONE;s+=step,yc+=step) {
+      long long dy = yc - cy;
+      if (dy*dy > R*R) continue;
+      int hw = (int)graphicsSqrt((unsigned long long)(R*R - dy*dy));
+      if (antiAlias)
+        graphicsRasterSpan(&r, (int)(cx-hw), (int)(cx+hw));
+      else // graphicsRasterSpan rounds to the nearest pixel, but we only want pixels whose centres are inside
+        graphicsRasterSpan(&r, (int)(cx-hw)+GRAPHICS_POLY_HALF-1, (int)(cx+hw)-GRAPHICS_POLY_HALF);
+    }
+    graphicsRasterRow(&r);
+  }
+  graphicsRasterEnd(&r);
+}
+
+typedef struct {
+  int y1, y2;      ///< top and bottom of the edge (y1<y2)
+  int x1, dx, dy;  ///< X at y1, and the change in X and Y over the edge
+  int x;           ///< X at the current sample
+  int xStep, rem, remStep; ///< x += xStep each sample, plus one whenever rem reaches dy
+  signed char dir; ///< 1 if the edge goes down the screen, -1 if up
+} GraphicsPolyEdge;
+
+// a/b rounded down, where b>0
+static long long graphicsFloorDiv(long long a, long long b) {
+  long long q = a/b;
+  if ((a%b) && a<0) q--;
+  return q;
+}
+
+/// Add spans between the crossings of the edges with sample yc, using the half-open rule on each edge's ends
+static void graphicsFillPolySample(GraphicsRaster *r, GraphicsPolyEdge **active, int activeCount, int yc, bool includeTop, bool evenOdd, int *xs, signed char *dirs) {
+  int i, j, n = 0;
+  for (i=0;i<activeCount;i++) {
+    GraphicsPolyEdge *e = active[i];
+    // include the top of the edge, or the bottom - but not both, so vertices aren't counted twice
+    if (includeTop ? (e->y1<=yc && yc<e->y2) : (e->y1<yc && yc<=e->y2)) {
+      int x = e->x;
+      signed char d = e->dir;
+      for (j=n;j>0 && xs[j-1]>x;j--) {
+        xs[j] = xs[j-1];
+        dirs[j] = dirs[j-1];
+      }
+      xs[j] = x;
+      dirs[j] = d;
+      n++;
+    }
+  }
+  int wind = 0, start = 0;
+  for (i=0;i<n;i++) {
+    bool wasInside = evenOdd ? (wind&1) : (wind!=0);
+    wind += evenOdd ? 1 : dirs[i];
+    bool inside = evenOdd ? (wind&1) : (wind!=0);
+    if (inside && !wasInside) start = xs[i];
+    if (wasInside && !inside) graphicsRasterSpan(r, start, xs[i]);
+  }
+}
+
+void graphicsFillPoly(JsGraphics *gfx, int points, int *vertices, bool evenOdd) {
+  if (points<1) return;
+  int i, j;
+  int minx = 0x7FFFFFFF, maxx = -0x7FFFFFFF, miny = 0x7FFFFFFF, maxy = -0x7FFFFFFF;
   for (i=0;i<points*2;i+=2) {
     // convert into device coordinates...
-    graphicsToDeviceCoordinates(gfx, &vertices[i], &vertices[i+1]);
-    short y = vertices[i+1];
-    if (y<miny) miny=y;
-    if (y>maxy) maxy=y;
-  }
-  if (miny<0) miny=0;
-  if (maxy>=gfx->data.height) maxy=(short)(gfx->data.height-1);
-  short minx[gfx->data.height];
-  short maxx[gfx->data.height];
-  short y;
-  for (y=miny;y<=maxy;y++) {
-    minx[y] = (short)(gfx->data.width);
-    maxx[y] = -1;
-  }
-  int j = (points-1)*2;
+    if (gfx->data.flags & JSGRAPHICSFLAGS_SWAP_XY) {
+      int t = vertices[i];
+      vertices[i] = vertices[i+1];
+      vertices[i+1] = t;
+    }
+    if (gfx->data.flags & JSGRAPHICSFLAGS_INVERT_X) vertices[i] = (gfx->data.width-1)*GRAPHICS_POLY_ONE - vertices[i];
+    if (gfx->data.flags & JSGRAPHICSFLAGS_INVERT_Y) vertices[i+1] = (gfx->data.height-1)*GRAPHICS_POLY_ONE - vertices[i+1];
+    if (vertices[i]<minx) minx=vertices[i];
+    if (vertices[i]>maxx) maxx=vertices[i];
+    if (vertices[i+1]<miny) miny=vertices[i+1];
+    if (vertices[i+1]>maxy) maxy=vertices[i+1];
+  }
+  bool antiAlias = graphicsRasterAntiAlias(gfx);
+  // pixel rows to draw
+  int y1 = (int)graphicsFloorDiv(miny + (antiAlias ? GRAPHICS_POLY_HALF : GRAPHICS_POLY_ONE-1), GRAPHICS_POLY_ONE);
+  int y2 = (int)graphicsFloorDiv(maxy + (antiAlias ? GRAPHICS_POLY_HALF : 0), GRAPHICS_POLY_ONE);
+  if (y1<0) y1=0;
+  if (y2>=gfx->data.height) y2=gfx->data.height-1;
+  int px1 = (int)graphicsFloorDiv(minx + GRAPHICS_POLY_HALF, GRAPHICS_POLY_ONE);
+  int px2 = (int)graphicsFloorDiv(maxx + GRAPHICS_POLY_HALF, GRAPHICS_POLY_ONE);
+  if (y1>y2 || px2<0 || px1>=gfx->data.width) return;
+
+  // Build the edge table, sorted by the top of each edge. Horizontal edges are never crossed, so are ignored
+  GraphicsPolyEdge edges[points];
+  int edgeCount = 0;
+  j = (points-1)*2;
   for (i=0;i<points*2;i+=2) {
-    graphicsFillPolyCreateScanLines(gfx, minx, maxx, vertices[j+0], vertices[j+1], vertices[i+0], vertices[i+1]);
+    GraphicsPolyEdge e;
+    int ax = vertices[j], ay = vertices[j+1], bx = vertices[i], by = vertices[i+1];
     j = i;
+    if (ay==by) continue;
+    e.dir = 1;
+    if (ay>by) {
+      int t;
+      t=ax;ax=bx;bx=t;
+      t=ay;ay=by;by=t;
+      e.dir = -1;
+    }
+    e.x1 = ax;
+    e.y1 = ay;
+    e.y2 = by;
+    e.dx = bx-ax;
+    e.dy = by-ay;
+    int k;
+    for (k=edgeCount;k>0 && edges[k-1].y1>e.y1;k--)
+      edges[k] = edges[k-1];
+    edges[k] = e;
+    edgeCount++;
   }
-  for (y=miny;y<=maxy;y++) {
-    if (maxx[y]>=minx[y] && maxx[y]>=0 && minx[y]<gfx->data.width) {
-      // clip
-      if (minx[y]<0) minx[y]=0;
-      if (maxx[y]>=gfx->data.width) maxx[y]=(short)(gfx->data.width-1);
-      // try and expand the rect that we fill
-      short oldy = y;
-      while (y<maxy && minx[y+1]==minx[oldy] && maxx[y+1]==maxx[oldy])
-        y++;
-      // actually fill
-      graphicsFillRectDevice(gfx,minx[y],oldy,maxx[y],y);
-      if (jspIsInterrupted()) break;
+  if (!edgeCount) {
+    // all points are on one line
+    graphicsFillRectDevice(gfx, px1, y1, px2, y1);
+    return;
+  }
+
+  short spans[edgeCount*2];
+  GraphicsRaster r;
+  graphicsRasterInit(&r, gfx, px1, px2, spans, edgeCount);
+  if (r.x1>r.x2) return;
+#ifdef GRAPHICS_AA_SAMPLES
+  unsigned short coverage[antiAlias ? (r.x2+1-r.x1) : 1];
+  if (antiAlias) {
+    memset(coverage, 0, sizeof(coverage));
+    r.coverage = coverage;
+    r.spans = 0;
+  }
+#endif
+  GraphicsPolyEdge *active[edgeCount];
+  int xs[edgeCount];
+  signed char dirs[edgeCount];
+  int activeCount = 0, nextEdge = 0;
+  int step, y;
+  int yc = graphicsRasterFirstSample(antiAlias, y1, &step);
+  graphicsRasterStart(&r, y1);
+  for (y=y1;y<=y2;y++) {
+    int s;
+    for (s=0;s<GRAPHICS_POLY_ONE;s+=step,yc+=step) {
+      // add edges that have started to the active edge table
+      while (nextEdge<edgeCount && edges[nextEdge].y1<=yc) {
+        GraphicsPolyEdge *e = &edges[nextEdge++];
+        if (e->y2 < yc) continue; // already finished
+        // work out X at this sample, and how it changes for each sample after
+        long long n = (long long)(yc - e->y1)*e->dx;
+        long long q = graphicsFloorDiv(n, e->dy);
+        e->x = e->x1 + (int)q;
+        e->rem = (int)(n - q*e->dy);
+        q = graphicsFloorDiv((long long)step*e->dx, e->dy);
+        e->xStep = (int)q;
+        e->remStep = (int)((long long)step*e->dx - q*e->dy);
+        active[activeCount++] = e;
+      }
+      graphicsFillPolySample(&r, active, activeCount, yc, true, evenOdd, xs, dirs);
+      if (!antiAlias) {
+        // If a vertex is on this row, also include the bottom of edges so we fill every pixel the polygon touches
+        for (i=0;i<activeCount;i++)
+          if (active[i]->y1==yc || active[i]->y2==yc) break;
+        if (i<activeCount)
+          graphicsFillPolySample(&r, active, activeCount, yc, false, evenOdd, xs, dirs);
+      }
+      // step edges on, and remove any that have finished
+      for (i=0,j=0;i<activeCount;i++) {
+        GraphicsPolyEdge *e = active[i];
+        if (e->y2 < yc+step) continue;
+        e->x += e->xStep;
+        e->rem += e->remStep;
+        if (e->rem >= e->dy) {
+          e->rem -= e->dy;
+          e->x++;
+        }
+        active[j++] = e;
+      }
+      activeCount = j;
     }
+    graphicsRasterRow(&r);
+    if (jspIsInterrupted()) break;
   }
+  graphicsRasterEnd(&r);
 }
 
 #ifndef SAVE_ON_FLASH
@@ -423,14 +825,15 @@ unsigned int graphicsFillVectorChar(JsGraphics *gfx, short x1, short y1, short s
   VectorFontChar vector;
   vector.vertCount = READ_FLASH_UINT8(&vectorFonts[fontOffset].vertCount);
   vector.width = READ_FLASH_UINT8(&vectorFonts[fontOffset].width);
-  short verts[VECTOR_FONT_MAX_POLY_SIZE*2];
+  int verts[VECTOR_FONT_MAX_POLY_SIZE*2];
   int idx=0;
   for (i=0;i<vector.vertCount;i+=2) {
-    verts[idx+0] = (short)(x1 + (((READ_FLASH_UINT8(&vectorFontPolys[vertOffset+i+0])&0x7F)*size + (VECTOR_FONT_POLY_SIZE/2)) / VECTOR_FONT_POLY_SIZE));
-    verts[idx+1] = (short)(y1 + (((READ_FLASH_UINT8(&vectorFontPolys[vertOffset+i+1])&0x7F)*size + (VECTOR_FONT_POLY_SIZE/2)) / VECTOR_FONT_POLY_SIZE));
+    // keep the fractional part, for antialiasing
+    verts[idx+0] = x1*GRAPHICS_POLY_ONE + (((READ_FLASH_UINT8(&vectorFontPolys[vertOffset+i+0])&0x7F)*size*GRAPHICS_POLY_ONE + (VECTOR_FONT_POLY_SIZE/2)) / VECTOR_FONT_POLY_SIZE);
+    verts[idx+1] = y1*GRAPHICS_POLY_ONE + (((READ_FLASH_UINT8(&vectorFontPolys[vertOffset+i+1])&0x7F)*size*GRAPHICS_POLY_ONE + (VECTOR_FONT_POLY_SIZE/2)) / VECTOR_FONT_POLY_SIZE);
     idx+=2;
     if (READ_FLASH_UINT8(&vectorFontPolys[vertOffset+i+1]) & VECTOR_FONT_POLY_SEPARATOR) {
-      graphicsFillPoly(gfx,idx/2, verts);
+      graphicsFillPoly(gfx,idx/2, verts, false);
 
       if (jspIsInterrupted()) break;
       idx=0;
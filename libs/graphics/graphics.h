@@ -41,6 +41,8 @@ typedef enum {
   JSGRAPHICSFLAGS_COLOR_GRB = 256, //< All devices: color order is GRB
   JSGRAPHICSFLAGS_COLOR_RBG = 256+64, //< All devices: color order is RBG
   JSGRAPHICSFLAGS_COLOR_MASK = 64+128+256, //< All devices: color order is BRG
+
+  JSGRAPHICSFLAGS_ANTIALIAS = 512, //< All devices: antialias filled shapes (if bpp>=8)
 } JsGraphicsFlags;
 
 #define JSGRAPHICS_FONTSIZE_4X6 (-1) // a bitmap font
@@ -52,6 +54,16 @@ typedef enum {
 #define JSGRAPHICS_CUSTOMFONT_HEIGHT JS_HIDDEN_CHAR_STR"fnH"
 #define JSGRAPHICS_CUSTOMFONT_FIRSTCHAR JS_HIDDEN_CHAR_STR"fn1"
 
+/// Number of fractional bits used for polygon coordinates
+#define JSGRAPHICS_POLY_SHIFT 4
+
+#ifndef SAVE_ON_FLASH
+/// The screen is split into a grid of this many x this many tiles to keep track of modified regions
+#define JSGRAPHICS_MODIFIED_TILES 16
+/// Bytes needed to store one bit per tile
+#define JSGRAPHICS_MODIFIED_TILES_SIZE (JSGRAPHICS_MODIFIED_TILES*JSGRAPHICS_MODIFIED_TILES/8)
+#endif
+
 typedef struct {
   JsGraphicsType type;
   JsGraphicsFlags flags;
@@ -61,6 +73,9 @@ typedef struct {
   short fontSize; ///< See JSGRAPHICS_FONTSIZE_ constants
   short cursorX, cursorY; ///< current cursor positions
   short modMinX, modMinY, modMaxX, modMaxY; ///< area that has been modified
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  unsigned char modTiles[JSGRAPHICS_MODIFIED_TILES_SIZE]; ///< tiles that have been modified, a row at a time (see graphicsSetModifiedTiles)
+#endif
 } PACKED_FLAGS JsGraphicsData;
 
 typedef struct JsGraphics {
@@ -87,6 +102,9 @@ static inline void graphicsStructInit(JsGraphics *gfx) {
   gfx->data.modMaxY = -32768;
   gfx->data.modMinX = 32767;
   gfx->data.modMinY = 32767;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  memset(gfx->data.modTiles, 0, sizeof(gfx->data.modTiles));
+#endif
 }
 
 // ---------------------------------- these are in graphics.c
@@ -94,6 +112,19 @@ static inline void graphicsStructInit(JsGraphics *gfx) {
 bool graphicsGetFromVar(JsGraphics *gfx, JsVar *parent);
 void graphicsSetVar(JsGraphics *gfx);
 // ----------------------------------------------------------------------------------------------
+/// Mark an area (in DEVICE coordinates, already clipped) as modified
+void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2);
+/// Forget about everything that has been modified
+void graphicsClearModified(JsGraphics *gfx);
+#ifdef JSGRAPHICS_MODIFIED_TILES
+/// Called for each modified region by graphicsGetModifiedTiles
+typedef void (*JsGraphicsRegionCallback)(int x1, int y1, int x2, int y2, void *callbackData);
+/// Mark the tiles covering an area (in DEVICE coordinates, already clipped) of a width x height screen as modified
+void graphicsSetModifiedTiles(unsigned char *tiles, int width, int height, int x1, int y1, int x2, int y2);
+/** Call callback with rectangles that cover all the modified tiles, merging
+ * neighbouring tiles where possible. If clear is set, the tiles are cleared. */
+void graphicsGetModifiedTiles(unsigned char *tiles, int width, int height, bool clear, JsGraphicsRegionCallback callback, void *callbackData);
+#endif
 /// Get the memory requires for this graphics's pixels if everything was packed as densely as possible
 size_t graphicsGetMemoryRequired(const JsGraphics *gfx);
 // If graphics is flipped or rotated then the coordinates need modifying
@@ -109,7 +140,8 @@ void graphicsDrawCircle(JsGraphics *gfx, short posX, short posY, short rad);
 void graphicsFillCircle(JsGraphics *gfx, short x, short y, short rad);
 void graphicsDrawString(JsGraphics *gfx, short x1, short y1, const char *str);
 void graphicsDrawLine(JsGraphics *gfx, short x1, short y1, short x2, short y2);
-void graphicsFillPoly(JsGraphics *gfx, int points, short *vertices); // may overwrite vertices...
+/// Fill a polygon. Vertices are USER coordinates with JSGRAPHICS_POLY_SHIFT fractional bits, and may be overwritten
+void graphicsFillPoly(JsGraphics *gfx, int points, int *vertices, bool evenOdd);
 #ifndef SAVE_ON_FLASH
 unsigned int graphicsFillVectorChar(JsGraphics *gfx, short x1, short y1, short size, char ch); ///< prints character, returns width
 unsigned int graphicsVectorCharWidth(JsGraphics *gfx, short size, char ch); ///< returns the width of a character
@@ -825,31 +825,64 @@ void jswrap_graphics_moveTo(JsVar *parent, int x, int y) {
   "name" : "fillPoly",
   "generate" : "jswrap_graphics_fillPoly",
   "params" : [
-    ["poly","JsVar","An array of vertices, of the form ```[x1,y1,x2,y2,x3,y3,etc]```"]
+    ["poly","JsVar","An array of vertices, of the form ```[x1,y1,x2,y2,x3,y3,etc]```"],
+    ["evenOdd","bool","If true, use the even-odd fill rule (so areas where the polygon overlaps itself are left empty). Otherwise use the non-zero rule"]
   ]
 }
-Draw a filled polygon in the current foreground color
+Draw a filled polygon in the current foreground color. The polygon may be concave
+or cross over itself. Vertices don't have to be whole numbers, which makes a
+difference when antialiasing (see `Graphics.setAntiAlias`).
 */
-void jswrap_graphics_fillPoly(JsVar *parent, JsVar *poly) {
+void jswrap_graphics_fillPoly(JsVar *parent, JsVar *poly, bool evenOdd) {
   JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return;
   if (!jsvIsIterable(poly)) return;
   const int maxVerts = 128;
-  short verts[maxVerts];
+  int verts[maxVerts];
   int idx = 0;
   JsvIterator it;
   jsvIteratorNew(&it, poly, JSIF_EVERY_ARRAY_ELEMENT);
   while (jsvIteratorHasElement(&it) && idx<maxVerts) {
-    verts[idx++] = (short)jsvIteratorGetIntegerValue(&it);
+    JsVarFloat v = jsvIteratorGetFloatValue(&it) * (1<<JSGRAPHICS_POLY_SHIFT);
+    if (v<-0x7FFFFFF) v=-0x7FFFFFF;
+    if (v>0x7FFFFFF) v=0x7FFFFFF;
+    verts[idx++] = (int)((v<0) ? v-0.5 : v+0.5);
     jsvIteratorNext(&it);
   }
   jsvIteratorFree(&it);
   if (idx==maxVerts) {
     jsWarn("Maximum number of points (%d) exceeded for fillPoly", maxVerts/2);
   }
-  graphicsFillPoly(&gfx, idx/2, verts);
+  graphicsFillPoly(&gfx, idx/2, verts, evenOdd);
   graphicsSetVar(&gfx); // gfx data changed because modified area
 }
 
+#ifndef SAVE_ON_FLASH
+/*JSON{
+  "type" : "method",
+  "class" : "Graphics",
+  "name" : "setAntiAlias",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_graphics_setAntiAlias",
+  "params" : [
+    ["antiAlias","bool","Whether to antialias"]
+  ]
+}
+Set whether `fillPoly`, `fillCircle` and vector fonts are antialiased, so edges
+are blended smoothly into what was already drawn.
+
+This only works on Graphics with 8 bits per pixel or more. 16 bit colours are
+treated as RGB565, 24 and 32 bit as 8 bits per channel and 8 bit as greyscale.
+*/
+void jswrap_graphics_setAntiAlias(JsVar *parent, bool antiAlias) {
+  JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return;
+  if (antiAlias)
+    gfx.data.flags |= JSGRAPHICSFLAGS_ANTIALIAS;
+  else
+    gfx.data.flags &= (JsGraphicsFlags)~JSGRAPHICSFLAGS_ANTIALIAS;
+  graphicsSetVar(&gfx);
+}
+#endif
+
 /*JSON{
   "type" : "method",
   "class" : "Graphics",
@@ -928,6 +961,21 @@ void jswrap_graphics_drawImage(JsVar *parent, JsVar *image, int xPos, int yPos)
   JsVar *imageBufferString = jsvGetArrayBufferBackingString(imageBuffer);
   jsvUnLock(imageBuffer);
 
+#ifndef SAVE_ON_FLASH
+  /* If both image and ArrayBuffer are flat and store pixels the same way,
+   * copy the image data straight across. 1bpp only works like this if the
+   * colours map 0 and 1 to themselves. */
+  if (gfx.data.type==JSGRAPHICSTYPE_ARRAYBUFFER && !imageIsTransparent &&
+      jsvIsFlatString(imageBufferString) &&
+      (size_t)jsvGetLength(imageBufferString) >= ((size_t)imageWidth*(size_t)imageHeight*(size_t)imageBpp+7)>>3 &&
+      (imageBpp!=1 || ((gfx.data.fgColor&1) && !(gfx.data.bgColor&1))) &&
+      lcdDrawImage_ArrayBuffer_flat(&gfx, xPos, yPos, imageWidth, imageHeight, imageBpp,
+                                    (const unsigned char*)jsvGetFlatStringPointer(imageBufferString))) {
+    jsvUnLock(imageBufferString);
+    graphicsSetVar(&gfx); // gfx data changed because modified area
+    return;
+  }
+#endif
 
   int x=0, y=0;
   int bits=0;
@@ -975,7 +1023,7 @@ void jswrap_graphics_drawImage(JsVar *parent, JsVar *image, int xPos, int yPos)
   "return" : ["JsVar","An object {x1,y1,x2,y2} containing the modified area, or undefined if not modified"]
 }
 Return the area of the Graphics canvas that has been modified, and optionally clear
-the modified area to 0.
+the modified area to 0. Resetting also resets the regions returned by `getModifiedRegions`.
 
 For instance if `g.setPixel(10,20)` was called, this would return `{x1:10, y1:20, x2:10, y2:20}`
 */
@@ -992,15 +1040,63 @@ JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset) {
     }
   }
   if (reset) {
-    gfx.data.modMaxX = -32768;
-    gfx.data.modMaxY = -32768;
-    gfx.data.modMinX = 32767;
-    gfx.data.modMinY = 32767;
+    graphicsClearModified(&gfx);
     graphicsSetVar(&gfx);
   }
   return obj;
 }
 
+#ifdef JSGRAPHICS_MODIFIED_TILES
+static void jswrap_graphics_getModifiedRegions_cb(int x1, int y1, int x2, int y2, void *callbackData) {
+  JsVar *obj = jsvNewObject();
+  if (!obj) return;
+  jsvObjectSetChildAndUnLock(obj, "x1", jsvNewFromInteger(x1));
+  jsvObjectSetChildAndUnLock(obj, "y1", jsvNewFromInteger(y1));
+  jsvObjectSetChildAndUnLock(obj, "x2", jsvNewFromInteger(x2));
+  jsvObjectSetChildAndUnLock(obj, "y2", jsvNewFromInteger(y2));
+  jsvArrayPushAndUnLock((JsVar*)callbackData, obj);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "Graphics",
+  "name" : "getModifiedRegions",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_graphics_getModifiedRegions",
+  "params" : [
+    ["reset","bool","Whether to reset the modified area or not"]
+  ],
+  "return" : ["JsVar","An array of objects {x1,y1,x2,y2}, one for each modified region"]
+}
+Return a list of rectangles that together cover everything on the Graphics canvas that
+has been modified, and optionally clear the modified area.
+
+The canvas is split into a 16x16 grid of tiles, so unlike `getModified` a change in
+two opposite corners results in two small rectangles rather than the whole screen.
+This means that displays that are updated from an ArrayBuffer (or from your own
+buffer with `Graphics.createCallback`) only need to send the regions that have changed:
+
+```
+g.getModifiedRegions(true).forEach(function(r) {
+  sendToDisplay(r.x1, r.y1, r.x2, r.y2);
+});
+```
+
+Regions are in device coordinates, like `getModified`.
+*/
+JsVar *jswrap_graphics_getModifiedRegions(JsVar *parent, bool reset) {
+  JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return 0;
+  JsVar *arr = jsvNewEmptyArray();
+  if (!arr) return 0;
+  graphicsGetModifiedTiles(gfx.data.modTiles, gfx.data.width, gfx.data.height, false, jswrap_graphics_getModifiedRegions_cb, arr);
+  if (reset) {
+    graphicsClearModified(&gfx);
+    graphicsSetVar(&gfx);
+  }
+  return arr;
+}
+#endif
+
 /*JSON{
   "type" : "method",
   "class" : "Graphics",
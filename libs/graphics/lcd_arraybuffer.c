@@ -131,11 +131,9 @@ unsigned int lcdGetPixel_ArrayBuffer_flat(JsGraphics *gfx, short x, short y) {
   return col;
 }
 
-// set pixelCount pixels starting at x,y
-// Faster implementation for where we have a flat memory area
-void lcdSetPixels_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, short pixelCount, unsigned int col) {
+// set pixelCount pixels starting at the given bit index
+static void lcdSetPixelsAtIndex_ArrayBuffer_flat(JsGraphics *gfx, unsigned int idx, int pixelCount, unsigned int col) {
   unsigned char *ptr = (unsigned char*)gfx->backendData;
-  unsigned int idx = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,pixelCount);
   ptr += idx>>3;
 
   unsigned int whiteMask = (1U<<gfx->data.bpp)-1;
@@ -150,7 +148,7 @@ void lcdSetPixels_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, short pixe
         int wholeBytes = (gfx->data.bpp*(pixelCount+1)) >> 3;
         if (wholeBytes) {
           char c = (char)(col?0xFF:0);
-          pixelCount = (short)(pixelCount+1 - (wholeBytes*8/gfx->data.bpp));
+          pixelCount = pixelCount+1 - (wholeBytes*8/gfx->data.bpp);
           while (wholeBytes--) {
             *ptr = c;
             ptr++;
@@ -178,6 +176,50 @@ void lcdSetPixels_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, short pixe
   }
 }
 
+// set pixelCount pixels starting at x,y
+// Faster implementation for where we have a flat memory area
+void lcdSetPixels_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, short pixelCount, unsigned int col) {
+  lcdSetPixelsAtIndex_ArrayBuffer_flat(gfx, lcdGetPixelIndex_ArrayBuffer(gfx,x,y,pixelCount), pixelCount, col);
+}
+
+/* Fill pixelCount pixels starting at the given pixel number, when pixels
+ * are stored one after the other (no zigzag or vertical bytes). Whole bytes
+ * are filled with memset/memcpy rather than a pixel at a time. */
+static void lcdFillSpan_ArrayBuffer_flat(JsGraphics *gfx, unsigned int pixel, unsigned int pixelCount, unsigned int col) {
+  unsigned int bpp = gfx->data.bpp;
+  unsigned int idx = pixel*bpp;
+  unsigned char *ptr = (unsigned char*)gfx->backendData;
+  if (bpp&7) { // 1, 2 or 4 bits, so pixels never span two bytes
+    // pixels up to the first byte boundary
+    unsigned int n = ((8-(idx&7))&7) / bpp;
+    if (n>pixelCount) n = pixelCount;
+    if (n) lcdSetPixelsAtIndex_ArrayBuffer_flat(gfx, idx, (int)n, col);
+    idx += n*bpp;
+    pixelCount -= n;
+    // whole bytes - the same pattern whatever the bit order
+    unsigned int bytes = (pixelCount*bpp)>>3;
+    unsigned int pattern = col & ((1U<<bpp)-1), b;
+    for (b=bpp;b<8;b<<=1) pattern |= pattern<<b;
+    memset(&ptr[idx>>3], (int)pattern, bytes);
+    idx += bytes<<3;
+    pixelCount -= (bytes<<3)/bpp;
+    // and what's left over
+    if (pixelCount) lcdSetPixelsAtIndex_ArrayBuffer_flat(gfx, idx, (int)pixelCount, col);
+  } else {
+    unsigned int bytesPerPixel = bpp>>3, i;
+    size_t done = bytesPerPixel, total = (size_t)pixelCount*bytesPerPixel;
+    ptr += idx>>3;
+    for (i=0;i<bytesPerPixel;i++)
+      ptr[i] = (unsigned char)(col >> (i*8));
+    // now keep doubling what's been written
+    while (done < total) {
+      size_t l = (done < total-done) ? done : total-done;
+      memcpy(&ptr[done], ptr, l);
+      done += l;
+    }
+  }
+}
+
 // Faster implementation for where we have a flat memory area
 void lcdSetPixel_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, unsigned int col) {
   lcdSetPixels_ArrayBuffer_flat(gfx, x, y, 1, col);
@@ -185,9 +227,87 @@ void lcdSetPixel_ArrayBuffer_flat(JsGraphics *gfx, short x, short y, unsigned in
 
 // Faster implementation for where we have a flat memory area
 void  lcdFillRect_ArrayBuffer_flat(struct JsGraphics *gfx, short x1, short y1, short x2, short y2) {
+  unsigned int bpp = gfx->data.bpp;
+  unsigned int col = gfx->data.fgColor;
+  if (!(gfx->data.flags & (JSGRAPHICSFLAGS_ARRAYBUFFER_ZIGZAG|JSGRAPHICSFLAGS_ARRAYBUFFER_VERTICAL_BYTE)) &&
+      (bpp==1 || bpp==2 || bpp==4 || !(bpp&7))) {
+    unsigned int width = gfx->data.width;
+    if (x1==x2 && !(bpp&7)) {
+      // vertical line - just step down a row at a time
+      unsigned int bytesPerPixel = bpp>>3, stride = width*bytesPerPixel, i;
+      unsigned char *ptr = (unsigned char*)gfx->backendData + ((unsigned int)x1 + (unsigned int)y1*width)*bytesPerPixel;
+      short y;
+      for (y=y1;y<=y2;y++) {
+        for (i=0;i<bytesPerPixel;i++)
+          ptr[i] = (unsigned char)(col >> (i*8));
+        ptr += stride;
+      }
+    } else if (x1==0 && (unsigned int)x2==width-1) {
+      // the full width, so all the rows are in one block
+      lcdFillSpan_ArrayBuffer_flat(gfx, (unsigned int)y1*width, (unsigned int)(1+y2-y1)*width, col);
+    } else {
+      short y;
+      for (y=y1;y<=y2;y++)
+        lcdFillSpan_ArrayBuffer_flat(gfx, (unsigned int)x1 + (unsigned int)y*width, (unsigned int)(1+x2-x1), col);
+    }
+    return;
+  }
   short y;
   for (y=y1;y<=y2;y++)
-    lcdSetPixels_ArrayBuffer_flat(gfx, x1, y, (short)(1+x2-x1), gfx->data.fgColor);
+    lcdSetPixels_ArrayBuffer_flat(gfx, x1, y, (short)(1+x2-x1), col);
+}
+
+/* Copy image data straight into the buffer if its pixels are stored the
+ * same way (see jswrap_graphics_drawImage). Images store pixels MSB first,
+ * so multi-byte pixels have their bytes reversed. Returns false if we can't. */
+bool lcdDrawImage_ArrayBuffer_flat(JsGraphics *gfx, int xPos, int yPos, int imageWidth, int imageHeight, int imageBpp, const unsigned char *imageData) {
+  unsigned int bpp = gfx->data.bpp;
+  int width = gfx->data.width, height = gfx->data.height;
+  if (gfx->fillRect != lcdFillRect_ArrayBuffer_flat ||
+      (gfx->data.flags & (JSGRAPHICSFLAGS_ARRAYBUFFER_ZIGZAG|JSGRAPHICSFLAGS_ARRAYBUFFER_VERTICAL_BYTE|
+                          JSGRAPHICSFLAGS_SWAP_XY|JSGRAPHICSFLAGS_INVERT_X|JSGRAPHICSFLAGS_INVERT_Y)) ||
+      (unsigned int)imageBpp != bpp)
+    return false;
+  // clip
+  int x1 = (xPos<0) ? -xPos : 0, x2 = imageWidth;
+  int y1 = (yPos<0) ? -yPos : 0, y2 = imageHeight;
+  if (xPos+x2 > width) x2 = width-xPos;
+  if (yPos+y2 > height) y2 = height-yPos;
+  if (x1>=x2 || y1>=y2) return true; // nothing to draw
+  if (bpp&7) {
+    // Only if every row starts on a byte, bits are in the same order, and no columns are clipped
+    if (!(gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB) ||
+        ((unsigned int)imageWidth*bpp)&7 || ((unsigned int)width*bpp)&7 || ((unsigned int)xPos*bpp)&7 ||
+        x1!=0 || x2!=imageWidth)
+      return false;
+  }
+  unsigned char *buf = (unsigned char*)gfx->backendData;
+  size_t imageStride = ((size_t)imageWidth*bpp)>>3;
+  size_t stride = ((size_t)width*bpp)>>3;
+  int y;
+  for (y=y1;y<y2;y++) {
+    const unsigned char *src = &imageData[(size_t)y*imageStride + (((unsigned int)x1*bpp)>>3)];
+    unsigned char *dst = &buf[(size_t)(y+yPos)*stride + (((unsigned int)(x1+xPos)*bpp)>>3)];
+    size_t bytes = ((size_t)(x2-x1)*bpp)>>3;
+    if (bpp<=8) {
+      memcpy(dst, src, bytes);
+    } else if (bpp==16) {
+      size_t i;
+      for (i=0;i<bytes;i+=2) {
+        dst[i] = src[i+1];
+        dst[i+1] = src[i];
+      }
+    } else {
+      unsigned int bytesPerPixel = bpp>>3, i;
+      size_t p;
+      for (p=0;p<bytes;p+=bytesPerPixel)
+        for (i=0;i<bytesPerPixel;i++)
+          dst[p+i] = src[p+bytesPerPixel-1-i];
+    }
+  }
+  // update the modified area
+  graphicsSetModified(gfx, xPos+x1, yPos+y1, xPos+x2-1, yPos+y2-1);
+  return true;
 }
 #endif // SAVE_ON_FLASH
 
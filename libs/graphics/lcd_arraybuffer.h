@@ -15,3 +15,7 @@
 
 void lcdInit_ArrayBuffer(JsGraphics *gfx);
 void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx);
+#ifndef SAVE_ON_FLASH
+/// Copy an image's data directly into a flat ArrayBuffer if it's stored the same way. Returns false if it couldn't
+bool lcdDrawImage_ArrayBuffer_flat(JsGraphics *gfx, int xPos, int yPos, int imageWidth, int imageHeight, int imageBpp, const unsigned char *imageData);
+#endif
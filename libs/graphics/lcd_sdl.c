@@ -22,6 +22,9 @@
 
 SDL_Surface *screen = 0;
 bool needsFlip = false;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+unsigned char modTiles[JSGRAPHICS_MODIFIED_TILES_SIZE]; ///< Tiles modified since the last flip
+#endif
 
 unsigned int lcdGetPixel_SDL(JsGraphics *gfx, short x, short y) {
   if (!screen) return 0;
@@ -43,6 +46,9 @@ void lcdSetPixel_SDL(JsGraphics *gfx, short x, short y, unsigned int col) {
   *pixmem32 = col;
   if(SDL_MUSTLOCK(screen)) SDL_UnlockSurface(screen);
   needsFlip = true;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  graphicsSetModifiedTiles(modTiles, gfx->data.width, gfx->data.height, x, y, x, y);
+#endif
 }
 
 void lcdInit_SDL(JsGraphics *gfx) {
@@ -58,10 +64,21 @@ void lcdInit_SDL(JsGraphics *gfx) {
   }
 }
 
+#ifdef JSGRAPHICS_MODIFIED_TILES
+static void lcdUpdateRect_SDL(int x1, int y1, int x2, int y2, void *callbackData) {
+  SDL_UpdateRect(screen, x1, y1, (Uint32)(x2+1-x1), (Uint32)(y2+1-y1));
+}
+#endif
+
 void lcdIdle_SDL() {
   if (needsFlip) {
     needsFlip = false;
+#ifdef JSGRAPHICS_MODIFIED_TILES
+    // only update the parts of the screen that changed
+    graphicsGetModifiedTiles(modTiles, screen->w, screen->h, true, lcdUpdateRect_SDL, 0);
+#else
     SDL_Flip(screen);
+#endif
   }
 }
 
@@ -37,6 +37,10 @@ This is designed to be a cut-down version of the [node.js library](http://nodejs
   "class" : "httpSrv"
 }
 The HTTP server created by `require('http').createServer`
+
+HTTP/1.1 connections are kept open after a response so they can be used for
+another request. If no request arrives within `server.keepAliveTimeout`
+milliseconds (5000 by default, 0 to never time out) the connection is closed.
 */
 // there is a 'connect' event on httpSrv, but it's used by createServer and isn't node-compliant
 
@@ -228,6 +232,12 @@ Pipe this to a stream (an object with a 'write' method)
 Create an HTTP Server
 
 When a request to the server is made, the callback is called. In the callback you can use the methods on the response (httpSRs) to send data. You can also add `request.on('data',function() { ... })` to listen for POSTed data
+
+HTTP/1.1 connections are kept open after the response (unless the client asks
+for `Connection: close`), and the next request on them calls the callback
+again. If you don't give a `Content-Length` header, it is added for you when
+you pass all the data to `response.end`, otherwise the response is sent with
+`Transfer-Encoding: chunked`.
 */
 
 JsVar *jswrap_http_createServer(JsVar *callback) {
@@ -394,8 +404,7 @@ bool jswrap_httpSRs_write(JsVar *parent, JsVar *data) {
 See `Socket.write` for more information about the data argument
 */
 void jswrap_httpSRs_end(JsVar *parent, JsVar *data) {
-  if (!jsvIsUndefined(data)) jswrap_httpSRs_write(parent, data);
-  serverResponseEnd(parent);
+  serverResponseEnd(parent, data);
 }
 
 
@@ -28,6 +28,7 @@
   #include <sys/select.h>
   #include <arpa/inet.h>
   #include <netinet/in.h>
+  #include <netinet/tcp.h>
   #include <resolv.h>
  #endif
  #include <sys/socket.h>
@@ -42,6 +43,43 @@
 
 #define closesocket(SOCK) close(SOCK)
 
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+ #include <sys/epoll.h>
+ #include "jshardware.h"
+ #define NET_LINUX_EPOLL
+#endif
+
+#ifdef NET_LINUX_EPOLL
+/// epoll instance all our sockets are registered with (or -1 if not created yet)
+static int netEpollFd = -1;
+/// Sockets >= this number are always assumed to be ready
+#define NET_READY_SOCKETS 1024
+/// Bit set for each socket that epoll said was readable when net_linux_idle was last called
+static uint32_t netReadySockets[NET_READY_SOCKETS/32];
+
+/// Create our epoll instance if it doesn't exist. Returns false on failure
+static bool net_linux_epoll() {
+  if (netEpollFd>=0) return true;
+  netEpollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (netEpollFd<0) return false; // we'll just poll every socket
+  // wake the main loop up from jshSleep when any socket gets data
+  jshSetWakeOnFd(netEpollFd, true);
+  return true;
+}
+
+/// Add or remove a socket from the set that we watch for data
+static void net_linux_watch(int sckt, bool watch) {
+  if (netEpollFd<0) return;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = sckt;
+  epoll_ctl(netEpollFd, watch ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, sckt, &ev);
+  if (!watch && sckt<NET_READY_SOCKETS)
+    netReadySockets[sckt>>5] &= ~(1U<<(sckt&31));
+}
+#endif
+
 #if NET_DBG > 0
  #include "jsinteractive.h"
  #define DBG(format, ...) jsiConsolePrintf(format, ## __VA_ARGS__)
@@ -61,8 +99,31 @@ void net_linux_gethostbyname(JsNetwork *net, char * hostName, uint32_t* out_ip_a
 /// Called on idle. Do any checks required for this device
 void net_linux_idle(JsNetwork *net) {
   NOT_USED(net);
+#ifdef NET_LINUX_EPOLL
+  // Find out which sockets have data, so socketIdle doesn't have to ask each one
+  memset(netReadySockets, 0, sizeof(netReadySockets));
+  if (netEpollFd<0) return;
+  /* epoll is level triggered and round-robins ready sockets, so any
+   * we don't get this time will be reported next time */
+  struct epoll_event events[64];
+  int i, n = epoll_wait(netEpollFd, events, sizeof(events)/sizeof(events[0]), 0);
+  for (i=0;i<n;i++) {
+    int sckt = events[i].data.fd;
+    if (sckt>=0 && sckt<NET_READY_SOCKETS)
+      netReadySockets[sckt>>5] |= 1U<<(sckt&31);
+  }
+#endif
 }
 
+#ifdef NET_LINUX_EPOLL
+/// Return false if epoll says there's nothing to recv/accept on this socket
+bool net_linux_canRecv(JsNetwork *net, int sckt) {
+  NOT_USED(net);
+  if (sckt<0 || sckt>=NET_READY_SOCKETS) return true;
+  return (netReadySockets[sckt>>5] >> (sckt&31)) & 1;
+}
+#endif
+
 /// Call just before returning to idle loop. This checks for errors and tries to recover. Returns true if no errors.
 bool net_linux_checkError(JsNetwork *net) {
   NOT_USED(net);
@@ -96,6 +157,9 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
       int optval = 1;
       if (setsockopt(sckt,SOL_SOCKET,SO_BROADCAST,(const char *)&optval,sizeof(optval))<0)
         jsWarn("setsockopt(SO_BROADCAST) failed\n");
+#ifdef NET_LINUX_EPOLL
+      net_linux_watch(sckt, true);
+#endif
       return sckt;
     }
 
@@ -192,6 +256,9 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
   if (setsockopt(sckt,SOL_SOCKET,SO_NOSIGPIPE,(const char *)&optval,sizeof(optval))<0)
     jsWarn("setsockopt(SO_NOSIGPIPE) failed\n");
 #endif
+#ifdef NET_LINUX_EPOLL
+  net_linux_watch(sckt, true);
+#endif
 
   return sckt;
 }
@@ -199,6 +266,9 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
 /// destroys the given socket
 void net_linux_closesocket(JsNetwork *net, int sckt) {
   NOT_USED(net);
+#ifdef NET_LINUX_EPOLL
+  net_linux_watch(sckt, false);
+#endif
   closesocket(sckt);
 }
 
@@ -217,6 +287,16 @@ int net_linux_accept(JsNetwork *net, int sckt) {
   if (n>0) {
     // we have a client waiting to connect... try to connect and see what happens
     int theClient = accept(sckt,0,0);
+#ifdef TCP_NODELAY
+    /* Send responses straight away - otherwise when requests are pipelined
+     * each response after the first waits for the client's delayed ACK */
+    int optval = 1;
+    if (theClient>=0 && setsockopt(theClient,IPPROTO_TCP,TCP_NODELAY,(const char *)&optval,sizeof(optval))<0)
+      jsWarn("setsockopt(TCP_NODELAY) failed\n");
+#endif
+#ifdef NET_LINUX_EPOLL
+    if (theClient>=0) net_linux_watch(theClient, true);
+#endif
     return theClient;
   }
   return -1;
@@ -312,5 +392,9 @@ void netSetCallbacks_linux(JsNetwork *net) {
   net->gethostbyname = net_linux_gethostbyname;
   net->recv = net_linux_recv;
   net->send = net_linux_send;
-  net->chunkSize = 536;
+#ifdef NET_LINUX_EPOLL
+  if (net_linux_epoll())
+    net->canRecv = net_linux_canRecv;
+#endif
+  net->chunkSize = 4096;
 }
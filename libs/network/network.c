@@ -231,6 +231,7 @@ bool networkGetFromVar(JsNetwork *net) {
 
   // Now we know which kind of network we are working with, invoke the corresponding initialization
   // function to set the callbacks for this network tyoe.
+  net->canRecv = 0; // optional, so most drivers won't set it
   switch (net->data.type) {
 #if defined(USE_CC3000)
   case JSNETWORKTYPE_CC3000 : netSetCallbacks_cc3000(net); break;
@@ -672,7 +673,6 @@ int netCreateSocket(JsNetwork *net, SocketType socketType, uint32_t host, unsign
   if (sckt<0) return sckt;
 
 #ifdef USE_TLS
-  assert(sckt>=0 && sckt<32);
   if (socketType & ST_TLS) {
     if (ssl_newSocketData(sckt, options)) {
     } else {
@@ -700,6 +700,16 @@ void netGetHostByName(JsNetwork *net, char * hostName, uint32_t* out_ip_addr) {
   net->gethostbyname(net, hostName, out_ip_addr);
 }
 
+bool netCanRecv(JsNetwork *net, SocketType socketType, int sckt) {
+#ifdef USE_TLS
+  // mbedtls may have already read (and buffered) data from the socket
+  if (socketType & ST_TLS) return true;
+#else
+  NOT_USED(socketType);
+#endif
+  return !net->canRecv || net->canRecv(net, sckt);
+}
+
 int netRecv(JsNetwork *net, SocketType socketType, int sckt, void *buf, size_t len) {
 #ifdef USE_TLS
   if (socketType & ST_TLS) {
@@ -83,6 +83,9 @@ typedef struct JsNetwork {
   int (*recv)(struct JsNetwork *net, SocketType socketType, int sckt, void *buf, size_t len);
   /// Send data if possible. returns nBytes on success, 0 on no data, or -1 on failure
   int (*send)(struct JsNetwork *net, SocketType socketType, int sckt, const void *buf, size_t len);
+  /** Optional (may be 0). Return false if there is definitely nothing to recv/accept on this socket
+   * right now. Drivers that set this must also wake the idle loop when a socket gets data */
+  bool (*canRecv)(struct JsNetwork *net, int sckt);
 } PACKED_FLAGS JsNetwork;
 
 /// Header applied to all UDP packets when they are received
@@ -132,6 +135,12 @@ int netAccept(JsNetwork *net, int sckt);
 
 void netGetHostByName(JsNetwork *net, char * hostName, uint32_t* out_ip_addr);
 
+/** Return false if the network knows there's nothing to receive on this socket
+ * (so netRecv/netAccept can be skipped). Always true if the driver can't tell */
+bool netCanRecv(JsNetwork *net, SocketType socketType, int sckt);
+/// Return true if the network driver reports socket readiness (so we needn't poll every socket)
+#define netIsEventDriven(net) ((net)->canRecv!=0)
+
 int netRecv(JsNetwork *net, SocketType socketType, int sckt, void *buf, size_t len);
 int netSend(JsNetwork *net, SocketType socketType, int sckt, const void *buf, size_t len);
 
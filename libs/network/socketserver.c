@@ -18,13 +18,21 @@
 #include "jshardware.h"
 #include "jswrap_net.h"
 #include "jswrap_stream.h"
+#include "jswrap_interactive.h"
+#include "jswrapper.h"
 
 #define HTTP_NAME_SOCKETTYPE "type" // normal socket or HTTP
 #define HTTP_NAME_PORT "port"
 #define HTTP_NAME_SOCKET "sckt"
 #define HTTP_NAME_HAD_HEADERS "hdrs"
+#define HTTP_NAME_HEADER_SCAN "hScn"  // how far we've searched for the end of the headers
+#define HTTP_NAME_HEADERS_PENDING "hdrP" // response headers written, but not the blank line after them
 #define HTTP_NAME_RECEIVE_DATA "dRcv"
-#define HTTP_NAME_RECEIVE_COUNT "cRcv"
+#define HTTP_NAME_RECEIVE_RAW "dRaw"  // chunked data received by a client that we haven't decoded yet
+#define HTTP_NAME_BODY_LEFT "bLft"    // bytes of body still to come (if we know)
+#define HTTP_NAME_CHUNK_STATE "chRcv" // receiving a chunked body - see HTTP_CHUNK_...
+#define HTTP_NAME_KEEP_ALIVE "keep"   // boolean: don't close the connection after the response
+#define HTTP_NAME_IDLE_TIMER "tIdl"   // timer that closes a persistent connection if no request arrives
 #define HTTP_NAME_SEND_DATA "dSnd"
 #define HTTP_NAME_RESPONSE_VAR "res"
 #define HTTP_NAME_OPTIONS_VAR "opt"
@@ -42,6 +50,15 @@
 #define HTTP_ARRAY_HTTP_CLIENT_CONNECTIONS "HttpCC"
 #define HTTP_ARRAY_HTTP_SERVERS "HttpS"
 #define HTTP_ARRAY_HTTP_SERVER_CONNECTIONS "HttpSC"
+#define HTTP_RECEIVE_BUFFER "NetRB" // flat string kept in hiddenRoot for socketRecv to receive into
+
+#define HTTP_KEEP_ALIVE_TIMEOUT 5000 // ms a persistent server connection may wait for its next request (like node)
+
+// Values of HTTP_NAME_CHUNK_STATE. Positive values are the bytes left in the current chunk
+#define HTTP_CHUNK_SIZE 0     // expecting a line with the size of the next chunk
+#define HTTP_CHUNK_END (-1)   // expecting the newline after a chunk's data
+#define HTTP_CHUNK_TRAILER (-2) // had the last chunk, expecting trailers then an empty line
+#define HTTP_CHUNK_DONE (-3)
 
 #ifdef ESP8266
 // esp8266 debugging, need to remove this eventually
@@ -82,12 +99,14 @@ static void httpAppendHeaders(JsVar *string, JsVar *headerObject) {
 // httpParseHeaders(&receiveData, reqVar, true) // server
 // httpParseHeaders(&receiveData, resVar, false) // client
 bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer) {
-  // find /r/n/r/n
-  int newlineIdx = 0;
-  int strIdx = 0;
+  /* find /r/n/r/n. We're called each time more data arrives, so carry on from
+   * where we got to last time rather than searching everything again */
+  int scanState = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(objectForData, HTTP_NAME_HEADER_SCAN, 0));
+  int newlineIdx = scanState&3;
+  int strIdx = scanState>>2;
   int headerEnd = -1;
   JsvStringIterator it;
-  jsvStringIteratorNew(&it, *receiveData, 0);
+  jsvStringIteratorNew(&it, *receiveData, (size_t)strIdx);
   while (jsvStringIteratorHasChar(&it)) {
     char ch = jsvStringIteratorGetChar(&it);
     if (ch == '\r') {
@@ -105,7 +124,11 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
   }
   jsvStringIteratorFree(&it);
   // skip if we have no header
-  if (headerEnd<0) return false;
+  if (headerEnd<0) {
+    jsvObjectSetChildAndUnLock(objectForData, HTTP_NAME_HEADER_SCAN, jsvNewFromInteger((strIdx<<2) | newlineIdx));
+    return false;
+  }
+  jsvObjectRemoveChild(objectForData, HTTP_NAME_HEADER_SCAN);
   // Now parse the header
   JsVar *vHeaders = jsvNewObject();
   if (!vHeaders) return true;
@@ -119,7 +142,7 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
   int colonPos = 0;
   //jsiConsolePrintStringVar(receiveData);
   jsvStringIteratorNew(&it, *receiveData, 0);
-    while (jsvStringIteratorHasChar(&it)) {
+    while (jsvStringIteratorHasChar(&it) && strIdx<headerEnd) { // anything after may be the next request
       char ch = jsvStringIteratorGetChar(&it);
       if (ch==' ' || ch=='\r') {
         if (firstSpace<0) firstSpace = strIdx;
@@ -157,6 +180,8 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
   if (isServer) {
     jsvObjectSetChildAndUnLock(objectForData, "method", jsvNewFromStringVar(*receiveData, 0, (size_t)firstSpace));
     jsvObjectSetChildAndUnLock(objectForData, "url", jsvNewFromStringVar(*receiveData, (size_t)(firstSpace+1), (size_t)(secondSpace-(firstSpace+1))));
+    if (firstEOL > secondSpace+6) // skip 'HTTP/'
+      jsvObjectSetChildAndUnLock(objectForData, "httpVersion", jsvNewFromStringVar(*receiveData, (size_t)(secondSpace+6), (size_t)(firstEOL-(secondSpace+6))));
   } else {
     jsvObjectSetChildAndUnLock(objectForData, "httpVersion", jsvNewFromStringVar(*receiveData, 5, (size_t)firstSpace-5));
     jsvObjectSetChildAndUnLock(objectForData, "statusCode", jsvNewFromStringVar(*receiveData, (size_t)(firstSpace+1), (size_t)(secondSpace-(firstSpace+1))));
@@ -169,6 +194,172 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
   return true;
 }
 
+/// Compare a (short) string with str, ignoring case
+static bool httpStringEqualIgnoreCase(JsVar *v, const char *str) {
+  char buf[32];
+  if (!jsvIsString(v) || jsvGetStringLength(v) >= sizeof(buf)) return false;
+  jsvGetString(v, buf, sizeof(buf));
+  const char *s = buf;
+  while (*s && *str && ((*s>='A' && *s<='Z') ? *s+'a'-'A' : *s) == *str) {
+    s++;
+    str++;
+  }
+  return !*s && !*str;
+}
+
+/// Get the value of a header. Header names aren't case sensitive, so 'name' must be lowercase
+static JsVar *httpGetHeader(JsVar *headers, const char *name) {
+  if (!jsvIsObject(headers)) return 0;
+  JsVar *value = 0;
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, headers);
+  while (!value && jsvObjectIteratorHasValue(&it)) {
+    JsVar *key = jsvObjectIteratorGetKey(&it);
+    if (httpStringEqualIgnoreCase(key, name))
+      value = jsvObjectIteratorGetValue(&it);
+    jsvUnLock(key);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  return value;
+}
+
+/// Is the given header set to 'value' (which must be lowercase)?
+static bool httpHeaderIs(JsVar *headers, const char *name, const char *value) {
+  JsVar *v = httpGetHeader(headers, name);
+  bool is = httpStringEqualIgnoreCase(v, value);
+  jsvUnLock(v);
+  return is;
+}
+
+/// Does the client that sent this (parsed) request want the connection kept open afterwards?
+static bool httpWantsKeepAlive(JsVar *req) {
+  // HTTP/1.1 connections are persistent unless we're told otherwise
+  if (!jsvIsStringEqualAndUnLock(jsvObjectGetChild(req, "httpVersion", 0), "1.1"))
+    return false;
+  JsVar *headers = jsvObjectGetChild(req, "headers", 0);
+  bool keepAlive = !httpHeaderIs(headers, "connection", "close");
+  jsvUnLock(headers);
+  return keepAlive;
+}
+
+/** Once the headers in 'object' have been parsed, work out how we'll know
+ * where the body ends and set 'connection' up to receive it. If the headers
+ * don't tell us, the body carries on until the connection closes - unless
+ * 'emptyByDefault' (a request on a persistent connection). */
+static void httpReceiveBodyInit(JsVar *connection, JsVar *object, bool emptyByDefault) {
+  JsVar *headers = jsvObjectGetChild(object, "headers", 0);
+  if (httpHeaderIs(headers, "transfer-encoding", "chunked")) {
+    jsvObjectSetChildAndUnLock(connection, HTTP_NAME_CHUNK_STATE, jsvNewFromInteger(HTTP_CHUNK_SIZE));
+  } else {
+    JsVar *contentLength = httpGetHeader(headers, "content-length");
+    if (contentLength || emptyByDefault)
+      jsvObjectSetChildAndUnLock(connection, HTTP_NAME_BODY_LEFT, jsvNewFromInteger(jsvGetInteger(contentLength)));
+    jsvUnLock(contentLength);
+  }
+  jsvUnLock(headers);
+}
+
+/// Have we received all of the body? (true if we don't know how long it is)
+static bool httpReceiveBodyDone(JsVar *connection) {
+  JsVar *v = jsvObjectGetChild(connection, HTTP_NAME_CHUNK_STATE, 0);
+  if (v) return jsvGetIntegerAndUnLock(v)==HTTP_CHUNK_DONE;
+  v = jsvObjectGetChild(connection, HTTP_NAME_BODY_LEFT, 0);
+  return !v || jsvGetIntegerAndUnLock(v)<=0;
+}
+
+/** Find the end of the line starting at 'idx'. Returns the index after its '\n',
+ * or -1 if we haven't got all of it yet. Also returns the line's length (without
+ * the newline) and the value of any hex number it starts with */
+static int httpGetLine(JsVar *data, size_t idx, JsVarInt *hexValue, size_t *lineLength) {
+  int lineEnd = -1;
+  bool isHex = true;
+  *hexValue = 0;
+  *lineLength = 0;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, data, idx);
+  while (jsvStringIteratorHasChar(&it)) {
+    char ch = jsvStringIteratorGetChar(&it);
+    jsvStringIteratorNext(&it);
+    idx++;
+    if (ch=='\n') {
+      lineEnd = (int)idx;
+      break;
+    }
+    if (ch=='\r') continue;
+    int digit = chtod(ch);
+    if (digit<0 || digit>15) isHex = false; // eg. ';' before a chunk extension
+    else if (isHex) *hexValue = (*hexValue<<4) | digit;
+    (*lineLength)++;
+  }
+  jsvStringIteratorFree(&it);
+  return lineEnd;
+}
+
+/** Take the body out of data that has been received after the headers. This
+ * decodes chunked transfer encoding, and stops at the end of the body - anything
+ * after it (or that we can't decode yet) is left in *receiveData. Returns the
+ * body data, or 0 if there is none yet. */
+static JsVar *httpReceiveBody(JsVar *connection, JsVar **receiveData) {
+  if (!*receiveData) return 0;
+  size_t len = jsvGetStringLength(*receiveData);
+  size_t idx = 0; // how much of receiveData we've used
+  JsVar *body = 0;
+  JsVar *v = jsvObjectGetChild(connection, HTTP_NAME_CHUNK_STATE, 0);
+  if (v) {
+    JsVarInt state = jsvGetIntegerAndUnLock(v);
+    body = jsvNewFromEmptyString();
+    if (!body) return 0;
+    while (idx<len && state!=HTTP_CHUNK_DONE) {
+      if (state>0) { // inside a chunk
+        size_t n = len-idx;
+        if ((size_t)state < n) n = (size_t)state;
+        jsvAppendStringVar(body, *receiveData, idx, n);
+        idx += n;
+        state -= (JsVarInt)n;
+        if (!state) state = HTTP_CHUNK_END;
+      } else { // we need a whole line
+        JsVarInt size;
+        size_t lineLength;
+        int lineEnd = httpGetLine(*receiveData, idx, &size, &lineLength);
+        if (lineEnd<0) break;
+        idx = (size_t)lineEnd;
+        if (state==HTTP_CHUNK_SIZE)
+          state = (size>0) ? size : HTTP_CHUNK_TRAILER;
+        else if (state==HTTP_CHUNK_END)
+          state = HTTP_CHUNK_SIZE;
+        else if (!lineLength) // an empty line ends the trailers
+          state = HTTP_CHUNK_DONE;
+      }
+    }
+    jsvObjectSetChildAndUnLock(connection, HTTP_NAME_CHUNK_STATE, jsvNewFromInteger(state));
+  } else {
+    v = jsvObjectGetChild(connection, HTTP_NAME_BODY_LEFT, 0);
+    size_t left = v ? (size_t)jsvGetIntegerAndUnLock(v) : len; // no length - it's all body
+    if (left >= len) {
+      // all of it is body - just hand it over (this avoids a copy)
+      body = *receiveData;
+      *receiveData = 0;
+      idx = len;
+    } else if (left) {
+      body = jsvNewFromStringVar(*receiveData, 0, left);
+      idx = left;
+    }
+    if (v) jsvObjectSetChildAndUnLock(connection, HTTP_NAME_BODY_LEFT, jsvNewFromInteger((JsVarInt)(left-idx)));
+  }
+  // Leave anything we didn't use in receiveData
+  if (idx && *receiveData) {
+    JsVar *rest = (idx<len) ? jsvNewFromStringVar(*receiveData, idx, JSVAPPENDSTRINGVAR_MAXLENGTH) : 0;
+    jsvUnLock(*receiveData);
+    *receiveData = rest;
+  }
+  if (body && jsvIsEmptyString(body)) {
+    jsvUnLock(body);
+    body = 0;
+  }
+  return body;
+}
+
 size_t httpStringGet(JsVar *v, char *str, size_t len) {
   size_t l = len;
   JsvStringIterator it;
@@ -285,6 +476,61 @@ int socketSendData(JsNetwork *net, JsVar *connection, int sckt, JsVar **sendData
   return 0;
 }
 
+/** Receive data from a socket. Returns the same as netRecv, and if it's >0
+ * sets *data to a new string containing what was received. Where we can we
+ * receive straight into a flat string and hand that over, so big reads are
+ * never copied. 'buf' is only used if we don't have the memory for that. */
+static int socketRecv(JsNetwork *net, SocketType socketType, int sckt, char *buf, JsVar **data) {
+  *data = 0;
+  size_t len = (size_t)net->chunkSize;
+  // reuse the buffer left over from last time if we can
+  JsVar *flat = jsvObjectGetChild(execInfo.hiddenRoot, HTTP_RECEIVE_BUFFER, 0);
+  if (flat) {
+    jsvObjectRemoveChild(execInfo.hiddenRoot, HTTP_RECEIVE_BUFFER);
+    if (jsvGetStringLength(flat) != len) {
+      jsvUnLock(flat);
+      flat = 0;
+    }
+  }
+  if (!flat) flat = jsvNewFlatStringOfLength((unsigned int)len);
+  if (!flat) {
+    int num = netRecv(net, socketType, sckt, buf, len);
+    if (num>0) *data = jsvNewStringOfLength((unsigned int)num, buf);
+    return num;
+  }
+  char *ptr = jsvGetFlatStringPointer(flat);
+  int num = netRecv(net, socketType, sckt, ptr, len);
+  if (num > JSV_FLAT_STRING_BREAK_EVEN) {
+    // hand the buffer over, just freeing the end we didn't use
+    jsvTruncateFlatString(flat, (size_t)num);
+    *data = flat;
+    return num;
+  }
+  // Not worth giving away our buffer - copy the data out and keep it for next time
+  if (num>0) *data = jsvNewStringOfLength((unsigned int)num, ptr);
+  jsvObjectSetChildAndUnLock(execInfo.hiddenRoot, HTTP_RECEIVE_BUFFER, flat);
+  return num;
+}
+
+/** Add newly received data onto the end of receiveData (which may be 0).
+ * Unlocks both, and returns the (locked) result */
+static JsVar *socketAppendReceived(JsVar *receiveData, JsVar *data) {
+  if (!receiveData || jsvIsEmptyString(receiveData)) {
+    jsvUnLock(receiveData);
+    return data; // nothing to append to, so no need to copy
+  }
+  if (jsvIsFlatString(receiveData)) {
+    // we can't append onto a flat string - make a new one
+    JsVar *s = jsvNewFromEmptyString();
+    if (s) jsvAppendStringVarComplete(s, receiveData);
+    jsvUnLock(receiveData);
+    receiveData = s;
+  }
+  if (receiveData && data) jsvAppendStringVarComplete(receiveData, data);
+  jsvUnLock(data);
+  return receiveData;
+}
+
 void socketReceivedUDP(JsVar *connection, JsVar **receiveData) {
   // Get the header
   size_t len = jsvGetStringLength(*receiveData);
@@ -327,6 +573,7 @@ void socketInit() {
 
 void socketKill(JsNetwork *net) {
   _socketCloseAllConnections(net);
+  jsvObjectRemoveChild(execInfo.hiddenRoot, HTTP_RECEIVE_BUFFER);
 #ifdef WIN32
    // Shutdown Winsock
    WSACleanup();
@@ -354,17 +601,126 @@ static bool fireErrorEvent(int error, JsVar *obj1, JsVar *obj2) {
 
 // -----------------------------
 
+/** Create the request and response objects for an HTTP server connection on
+ * socket 'sckt', with any data we already have for it in 'receiveData'.
+ * Returns the request */
+static JsVar *httpServerConnectionNew(JsVar *server, int sckt, JsVar *receiveData) {
+  JsVar *req = jspNewObject(0, "httpSRq");
+  JsVar *res = jspNewObject(0, "httpSRs");
+  if (res && req) { // out of memory?
+    socketSetType(req, ST_HTTP);
+    JsVar *arr = socketGetArray(HTTP_ARRAY_HTTP_SERVER_CONNECTIONS, true);
+    if (arr) {
+      jsvArrayPush(arr, req);
+      jsvUnLock(arr);
+    }
+    jsvObjectSetChild(req, HTTP_NAME_RESPONSE_VAR, res);
+    jsvObjectSetChild(req, HTTP_NAME_SERVER_VAR, server);
+    jsvObjectSetChildAndUnLock(req, HTTP_NAME_SOCKET, jsvNewFromInteger(sckt+1));
+    if (receiveData) jsvObjectSetChild(req, HTTP_NAME_RECEIVE_DATA, receiveData);
+  }
+  jsvUnLock(res);
+  return req;
+}
+
+/// Called by the idle timer: close the connection if we're still waiting for a request
+static void httpServerIdleTimeout(JsVar *connection) {
+  jsvObjectRemoveChild(connection, HTTP_NAME_IDLE_TIMER); // it has already been removed from the timers
+  if (jsvGetBoolAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_HAD_HEADERS,0))) return;
+  JsVar *receiveData = jsvObjectGetChild(connection,HTTP_NAME_RECEIVE_DATA,0);
+  if (!receiveData || jsvIsEmptyString(receiveData))
+    jsvObjectSetChildAndUnLock(connection, HTTP_NAME_CLOSENOW, jsvNewFromBool(true));
+  jsvUnLock(receiveData);
+}
+
+/** Start a timer that closes the connection if no request arrives within the
+ * server's keepAliveTimeout (ms, 0 = never). A timer (rather than checking
+ * the time when idle) means we wake up even if nothing else is happening */
+static void httpServerIdleTimerStart(JsVar *connection, JsVar *server) {
+  JsVarFloat timeout = HTTP_KEEP_ALIVE_TIMEOUT;
+  JsVar *timeoutVar = jsvObjectGetChild(server, "keepAliveTimeout", 0);
+  if (jsvIsNumeric(timeoutVar)) timeout = jsvGetFloat(timeoutVar);
+  jsvUnLock(timeoutVar);
+  if (!(timeout>0)) return;
+  JsVar *fn = jsvNewNativeFunction((void (*)(void))httpServerIdleTimeout, JSWAT_VOID|JSWAT_THIS_ARG);
+  if (!fn) return;
+  jsvObjectSetChild(fn, JSPARSE_FUNCTION_THIS_NAME, connection);
+  JsVar *id = jswrap_interface_setTimeout(fn, timeout, 0);
+  if (id) {
+    // keep the timer itself, as ids get reused once a timer has gone
+    JsVar *timerArrayPtr = jsvLock(timerArray);
+    jsvObjectSetChildAndUnLock(connection, HTTP_NAME_IDLE_TIMER, jsvGetArrayItem(timerArrayPtr, jsvGetInteger(id)));
+    jsvUnLock(timerArrayPtr);
+  }
+  jsvUnLock2(id, fn);
+}
+
+/// Stop the idle timer (if there is one) - we've had a request or are closing
+static void httpServerIdleTimerClear(JsVar *connection) {
+  JsVar *timer = jsvObjectGetChild(connection, HTTP_NAME_IDLE_TIMER, 0);
+  if (!timer) return;
+  jsvObjectRemoveChild(connection, HTTP_NAME_IDLE_TIMER);
+  // it may already have gone if all timers were cleared
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsVar *timerName = jsvGetIndexOf(timerArrayPtr, timer, true);
+  if (timerName) {
+    jsiTimerRemove(timerName);
+    jsiTimersChanged();
+  }
+  jsvUnLock3(timerName, timerArrayPtr, timer);
+}
+
+/** We've sent the response on a persistent connection - hand the socket (and
+ * anything that's been received after the request, eg. a pipelined request)
+ * over to new request and response objects so the next request can be handled.
+ * If it doesn't come within the server's keepAliveTimeout, the socket is closed
+ * so idle clients can't use up all our sockets */
+static void httpServerConnectionReuse(JsVar *connection) {
+  int sckt = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_SOCKET,0))-1; // so -1 if undefined
+  if (sckt<0) return;
+  JsVar *server = jsvObjectGetChild(connection,HTTP_NAME_SERVER_VAR,0);
+  JsVar *receiveData = jsvObjectGetChild(connection,HTTP_NAME_RECEIVE_DATA,0);
+  JsVar *req = httpServerConnectionNew(server, sckt, receiveData);
+  if (req) httpServerIdleTimerStart(req, server);
+  jsvUnLock3(req, server, receiveData);
+  // the socket isn't ours any more, so don't close it
+  jsvObjectRemoveChild(connection,HTTP_NAME_SOCKET);
+}
+
+/// Handle data received by an HTTP server: parse the request's headers, then pass on its body
+static void httpServerReceived(JsVar *connection, JsVar *socket, JsVar **receiveData) {
+  if (!jsvGetBoolAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_HAD_HEADERS,0))) {
+    if (!httpParseHeaders(receiveData, connection, true)) return;
+    jsvObjectSetChildAndUnLock(connection, HTTP_NAME_HAD_HEADERS, jsvNewFromBool(true));
+    httpServerIdleTimerClear(connection);
+    bool keepAlive = httpWantsKeepAlive(connection);
+    if (keepAlive)
+      jsvObjectSetChildAndUnLock(socket, HTTP_NAME_KEEP_ALIVE, jsvNewFromBool(true));
+    httpReceiveBodyInit(connection, connection, keepAlive);
+    JsVar *server = jsvObjectGetChild(connection,HTTP_NAME_SERVER_VAR,0);
+    JsVar *args[2] = { connection, socket };
+    jsiQueueObjectCallbacks(server, HTTP_NAME_ON_CONNECT, args, 2);
+    jsvUnLock(server);
+  }
+  // execute 'data' callback or save data
+  JsVar *body = httpReceiveBody(connection, receiveData);
+  if (body) jswrap_stream_pushData(connection, body, true);
+  jsvUnLock(body);
+}
+
 bool socketServerConnectionsIdle(JsNetwork *net) {
   char *buf = alloca((size_t)net->chunkSize); // allocate on stack
 
   JsVar *arr = socketGetArray(HTTP_ARRAY_HTTP_SERVER_CONNECTIONS,false);
   if (!arr) return false;
 
+  /* If the network can tell us which sockets are ready we only report being
+   * busy when a socket actually had something to do */
   bool hadSockets = false;
   JsvObjectIterator it;
   jsvObjectIteratorNew(&it, arr);
   while (jsvObjectIteratorHasValue(&it)) {
-    hadSockets = true;
+    if (!netIsEventDriven(net)) hadSockets = true;
     // Get connection, socket, and socket type
     // For normal sockets, socket==connection, but for HTTP we split it into a request and a response
     JsVar *connection = jsvObjectIteratorGetValue(&it);
@@ -373,49 +729,30 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
 
     int sckt = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_SOCKET,0))-1; // so -1 if undefined
     bool closeConnectionNow = jsvGetBoolAndUnLock(jsvObjectGetChild(connection, HTTP_NAME_CLOSENOW, false));
+    bool keepAlive = false; // the response is done, but keep the socket open for another request
     int error = 0;
 
     if (!closeConnectionNow) {
-      int num = netRecv(net, socketType, sckt, buf, (size_t)net->chunkSize);
+      JsVar *data = 0;
+      int num = netCanRecv(net, socketType, sckt) ? socketRecv(net, socketType, sckt, buf, &data) : 0;
+      if (num) hadSockets = true;
       if (num<0) {
         // we probably disconnected so just get rid of this
         closeConnectionNow = true;
         error = num;
       } else {
-        if (num>0) {
+        bool isHttp = (socketType&ST_TYPE_MASK)==ST_HTTP;
+        /* Even if we didn't receive anything, we may still have the next
+         * request on a persistent connection waiting to be handled */
+        if (num>0 || (isHttp && !jsvGetBoolAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_HAD_HEADERS,0)))) {
           JsVar *receiveData = jsvObjectGetChild(connection,HTTP_NAME_RECEIVE_DATA,0);
           JsVar *oldReceiveData = receiveData;
-          if (!receiveData) receiveData = jsvNewFromEmptyString();
+          if (num>0) receiveData = socketAppendReceived(receiveData, data);
           if (receiveData) {
-            jsvAppendStringBuf(receiveData, buf, (size_t)num);
-            if ((socketType&ST_TYPE_MASK)==ST_UDP) {
+            if (!isHttp) {
               socketReceivedUDP(connection, &receiveData);
             } else {
-              bool hadHeaders = jsvGetBoolAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_HAD_HEADERS,0));
-              if (!hadHeaders && httpParseHeaders(&receiveData, connection, true)) {
-                hadHeaders = true;
-                jsvObjectSetChildAndUnLock(connection, HTTP_NAME_HAD_HEADERS, jsvNewFromBool(hadHeaders));
-                JsVar *server = jsvObjectGetChild(connection,HTTP_NAME_SERVER_VAR,0);
-                JsVar *args[2] = { connection, socket };
-                jsiQueueObjectCallbacks(server, HTTP_NAME_ON_CONNECT, args, ((socketType&ST_TYPE_MASK)==ST_HTTP) ? 2 : 1);
-                jsvUnLock(server);
-              }
-              if (hadHeaders && !jsvIsEmptyString(receiveData)) {
-                // Keep track of how much we received (so we can close once we have it)
-                if ((socketType&ST_TYPE_MASK)==ST_HTTP) {
-                  jsvObjectSetChildAndUnLock(connection, HTTP_NAME_RECEIVE_COUNT,
-                      jsvNewFromInteger(
-                        jsvGetIntegerAndUnLock(jsvObjectGetChild(connection, HTTP_NAME_RECEIVE_COUNT, JSV_INTEGER)) +
-                        (JsVarInt)jsvGetStringLength(receiveData)
-                      ));
-                }
-                // execute 'data' callback or save data
-                if (jswrap_stream_pushData(connection, receiveData, false)) {
-                  // clear received data
-                  jsvUnLock(receiveData);
-                  receiveData = 0;
-                }
-              }
+              httpServerReceived(connection, socket, &receiveData);
             }
             // if received data changed, update it
             if (receiveData != oldReceiveData)
@@ -428,6 +765,7 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
       // send data if possible
       JsVar *sendData = jsvObjectGetChild(socket,HTTP_NAME_SEND_DATA,0);
       if (sendData && !jsvIsEmptyString(sendData)) {
+        hadSockets = true;
         int sent = socketSendData(net, socket, sckt, &sendData);
         // FIXME? checking for errors is a bit iffy. With the esp8266 network that returns
         // varied error codes we'd want to skip SOCKET_ERR_CLOSED and let the recv side deal
@@ -445,16 +783,10 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
       if (wantClose && (!sendData || jsvIsEmptyString(sendData)) && num<=0) {
         bool reallyCloseNow = true;
         if ((socketType&ST_TYPE_MASK)==ST_HTTP) {
-          // Check if we had a Content-Length header - if so, we need to wait until we have received that amount
-          JsVar *headers = jsvObjectGetChild(connection,"headers",0);
-          if (headers) {
-            JsVarInt contentLength = jsvGetIntegerAndUnLock(jsvObjectGetChild(headers,"Content-Length",0));
-            JsVarInt contentReceived = jsvGetIntegerAndUnLock(jsvObjectGetChild(connection, HTTP_NAME_RECEIVE_COUNT, 0));
-            if (contentLength > contentReceived) {
-              reallyCloseNow = false;
-            }
-            jsvUnLock(headers);
-          }
+          // If we know how long the request's body is, wait until we have received all of it
+          reallyCloseNow = httpReceiveBodyDone(connection);
+          // On a persistent connection we're ready for the next request instead
+          keepAlive = reallyCloseNow && jsvGetBoolAndUnLock(jsvObjectGetChild(socket,HTTP_NAME_KEEP_ALIVE,0));
         }
         closeConnectionNow = reallyCloseNow;
       } else if (num > 0)
@@ -463,15 +795,7 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
     }
     if (closeConnectionNow) {
       DBG("CLOSE NOW\n");
-
-      // send out any data that we were POSTed
-      JsVar *receiveData = jsvObjectGetChild(connection,HTTP_NAME_RECEIVE_DATA,0);
-      bool hadHeaders = jsvGetBoolAndUnLock(jsvObjectGetChild(connection,HTTP_NAME_HAD_HEADERS,0));
-      if (hadHeaders && !jsvIsEmptyString(receiveData)) {
-        // execute 'data' callback or save data
-        jswrap_stream_pushData(connection, receiveData, true);
-      }
-      jsvUnLock(receiveData);
+      hadSockets = true;
 
       // fire error events
       bool hadError = fireErrorEvent(error, connection, socket);
@@ -486,7 +810,11 @@ bool socketServerConnectionsIdle(JsNetwork *net) {
       jsiQueueObjectCallbacks(socket, HTTP_NAME_ON_CLOSE, params, 1);
       jsvUnLock(params[0]);
 
-      _socketConnectionKill(net, connection);
+      httpServerIdleTimerClear(connection);
+      if (keepAlive)
+        httpServerConnectionReuse(connection);
+      else
+        _socketConnectionKill(net, connection);
       JsVar *connectionName = jsvObjectIteratorGetKey(&it);
       jsvObjectIteratorNext(&it);
       jsvRemoveChild(arr, connectionName);
@@ -514,17 +842,30 @@ void socketClientPushReceiveData(JsVar *connection, JsVar *socket, JsVar **recei
   }
 }
 
+/** If an HTTP response is using chunked transfer encoding, decode what we
+ * can of newly received body data (unlocking it). Returns the decoded data */
+static JsVar *httpClientDecodeBody(JsVar *connection, JsVar *data) {
+  JsVar *state = jsvObjectGetChild(connection, HTTP_NAME_CHUNK_STATE, 0);
+  if (!state) return data;
+  jsvUnLock(state);
+  // keep hold of anything we can't decode yet (eg. half of a chunk size)
+  JsVar *raw = socketAppendReceived(jsvObjectGetChild(connection, HTTP_NAME_RECEIVE_RAW, 0), data);
+  JsVar *body = httpReceiveBody(connection, &raw);
+  jsvObjectSetChildAndUnLock(connection, HTTP_NAME_RECEIVE_RAW, raw);
+  return body;
+}
+
 bool socketClientConnectionsIdle(JsNetwork *net) {
   char *buf = alloca((size_t)net->chunkSize); // allocate on stack
 
   JsVar *arr = socketGetArray(HTTP_ARRAY_HTTP_CLIENT_CONNECTIONS,false);
   if (!arr) return false;
 
-  bool hadSockets = false;
+  bool hadSockets = false; // or if event driven, whether any socket had something to do
   JsvObjectIterator it;
   jsvObjectIteratorNew(&it, arr);
   while (jsvObjectIteratorHasValue(&it)) {
-    hadSockets = true;
+    if (!netIsEventDriven(net)) hadSockets = true;
     // Get connection, socket, and socket type
     // For normal sockets, socket==connection, but for HTTP connection is httpCRq and socket is httpCRs
     JsVar *connection = jsvObjectIteratorGetValue(&it);
@@ -550,11 +891,15 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
        * around the idle loop (=callbacks have been executed) before we run this */
       if (hadHeaders)
         socketClientPushReceiveData(connection, socket, &receiveData);
+      if ((hadHeaders && receiveData && !jsvIsEmptyString(receiveData)) ||
+          (!alreadyConnected && !isHttp) || closeConnectionNow)
+        hadSockets = true; // data still to hand over, or not connected yet
 
       if (!closeConnectionNow) {
         JsVar *sendData = jsvObjectGetChild(connection,HTTP_NAME_SEND_DATA,0);
         // send data if possible
         if (sendData && !jsvIsEmptyString(sendData)) {
+          hadSockets = true;
           // don't try to send if we're already in error state
           int num = 0;
           if (error == 0) {
@@ -577,7 +922,9 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
         }
         // Now read data if possible (and we have space for it)
         if (!receiveData || !hadHeaders) {
-          int num = netRecv(net, socketType, sckt, buf, (size_t)net->chunkSize);
+          JsVar *data = 0;
+          int num = netCanRecv(net, socketType, sckt) ? socketRecv(net, socketType, sckt, buf, &data) : 0;
+          if (num) hadSockets = true;
           if (!alreadyConnected && num == SOCKET_ERR_NO_CONN) {
             ; // ignore... it's just telling us we're not connected yet
           } else if (num < 0) {
@@ -597,10 +944,9 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
             }
             // got data add it to our receive buffer
             if (num > 0) {
-              if (!receiveData)
-                receiveData = jsvNewFromEmptyString();
+              if (isHttp && hadHeaders) data = httpClientDecodeBody(connection, data);
+              receiveData = socketAppendReceived(receiveData, data);
               if (receiveData) { // could be out of memory
-                jsvAppendStringBuf(receiveData, buf, (size_t)num);
                 if ((socketType&ST_TYPE_MASK)==ST_UDP) {
                   socketReceivedUDP(connection, &receiveData);
                 } else {
@@ -611,6 +957,8 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
                       hadHeaders = true;
                       jsvObjectSetChildAndUnLock(connection, HTTP_NAME_HAD_HEADERS, jsvNewFromBool(hadHeaders));
                       jsiQueueObjectCallbacks(connection, HTTP_NAME_ON_CONNECT, &resVar, 1);
+                      httpReceiveBodyInit(connection, resVar, false);
+                      receiveData = httpClientDecodeBody(connection, receiveData);
                     }
                     jsvUnLock(resVar);
                   }
@@ -626,6 +974,7 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
 
     if (closeConnectionNow) {
       DBG("close now\n");
+      hadSockets = true;
 
       socketClientPushReceiveData(connection, socket, &receiveData);
       if (!receiveData) {
@@ -678,7 +1027,7 @@ bool socketIdle(JsNetwork *net) {
     JsvObjectIterator it;
     jsvObjectIteratorNew(&it, arr);
     while (jsvObjectIteratorHasValue(&it)) {
-      hadSockets = true;
+      if (!netIsEventDriven(net)) hadSockets = true;
 
 
       JsVar *server = jsvObjectIteratorGetValue(&it);
@@ -687,24 +1036,13 @@ bool socketIdle(JsNetwork *net) {
       int theClient = -1;
       if ((socketType&ST_TYPE_MASK)!=ST_UDP) {
           int sckt = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(server,HTTP_NAME_SOCKET,0))-1; // so -1 if undefined
-          theClient = netAccept(net, sckt);
+          if (netCanRecv(net, socketType, sckt))
+            theClient = netAccept(net, sckt);
       }
       if (theClient >= 0) {
+        hadSockets = true;
         if ((socketType&ST_TYPE_MASK) == ST_HTTP) {
-          JsVar *req = jspNewObject(0, "httpSRq");
-          JsVar *res = jspNewObject(0, "httpSRs");
-          if (res && req) { // out of memory?
-            socketSetType(req, ST_HTTP);
-            JsVar *arr = socketGetArray(HTTP_ARRAY_HTTP_SERVER_CONNECTIONS, true);
-            if (arr) {
-              jsvArrayPush(arr, req);
-              jsvUnLock(arr);
-            }
-            jsvObjectSetChild(req, HTTP_NAME_RESPONSE_VAR, res);
-            jsvObjectSetChild(req, HTTP_NAME_SERVER_VAR, server);
-            jsvObjectSetChildAndUnLock(req, HTTP_NAME_SOCKET, jsvNewFromInteger(theClient+1));
-          }
-          jsvUnLock2(req, res);
+          jsvUnLock(httpServerConnectionNew(server, theClient, 0));
         } else {
           // Normal sockets
           JsVar *sock = jspNewObject(0, "Socket");
@@ -735,6 +1073,18 @@ bool socketIdle(JsNetwork *net) {
   return hadSockets;
 }
 
+bool socketHasOpenSockets() {
+  const char *names[] = { HTTP_ARRAY_HTTP_SERVERS, HTTP_ARRAY_HTTP_SERVER_CONNECTIONS, HTTP_ARRAY_HTTP_CLIENT_CONNECTIONS };
+  unsigned int i;
+  for (i=0;i<sizeof(names)/sizeof(names[0]);i++) {
+    JsVar *arr = socketGetArray(names[i], false);
+    bool isOpen = arr && !jsvArrayIsEmpty(arr);
+    jsvUnLock(arr);
+    if (isOpen) return true;
+  }
+  return false;
+}
+
 // -----------------------------
 
 JsVar *serverNew(SocketType socketType, JsVar *callback) {
@@ -997,6 +1347,23 @@ void clientRequestEnd(JsNetwork *net, JsVar *httpClientReqVar) {
 }
 
 
+/** Add data to send on a socket straight from a buffer (eg. for pipes). Returns
+ * how much data is now waiting to be sent (so len=0 just checks), or -1 if the
+ * socket is closed */
+int socketWriteBuf(JsVar *socket, const char *buf, size_t len) {
+  if (!_socketConnectionOpen(socket)) return -1;
+  JsVar *sendData = jsvObjectGetChild(socket, HTTP_NAME_SEND_DATA, 0);
+  if (!sendData && len) {
+    sendData = jsvNewFromEmptyString();
+    jsvObjectSetChild(socket, HTTP_NAME_SEND_DATA, sendData);
+  }
+  if (sendData && len) jsvAppendStringBuf(sendData, buf, len);
+  int waiting = sendData ? (int)jsvGetStringLength(sendData) : 0;
+  jsvUnLock(sendData);
+  return waiting;
+}
+
+
 void serverResponseWriteHead(JsVar *httpServerResponseVar, int statusCode, JsVar *headers) {
   if (!jsvIsUndefined(headers) && !jsvIsObject(headers)) {
     jsError("Headers sent to writeHead should be an object");
@@ -1013,13 +1380,32 @@ void serverResponseWriteHead(JsVar *httpServerResponseVar, int statusCode, JsVar
 
   sendData = jsvVarPrintf("HTTP/1.1 %d OK\r\nServer: Espruino "JS_VERSION"\r\n", statusCode);
   if (headers) httpAppendHeaders(sendData, headers);
-  // finally add ending newline
-  jsvAppendString(sendData, "\r\n");
+  bool hasLength = false;
+  if (httpHeaderIs(headers, "transfer-encoding", "chunked")) {
+    // subsequent writes need to 'chunk' the data that is sent
+    jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_CHUNKED, jsvNewFromBool(true));
+    hasLength = true;
+  } else {
+    JsVar *contentLength = httpGetHeader(headers, "content-length");
+    hasLength = contentLength!=0;
+    jsvUnLock(contentLength);
+  }
+  if (httpHeaderIs(headers, "connection", "close"))
+    jsvObjectRemoveChild(httpServerResponseVar, HTTP_NAME_KEEP_ALIVE);
+  if (!hasLength && jsvGetBoolAndUnLock(jsvObjectGetChild(httpServerResponseVar, HTTP_NAME_KEEP_ALIVE, 0))) {
+    /* The client needs to know where the body ends to use the connection
+     * again. Wait until we're written to (or ended) to see which of
+     * Content-Length or chunked encoding we can use */
+    jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_HEADERS_PENDING, jsvNewFromBool(true));
+  } else {
+    // finally add ending newline
+    jsvAppendString(sendData, "\r\n");
+  }
   jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_SEND_DATA, sendData);
 }
 
-
-void serverResponseWrite(JsVar *httpServerResponseVar, JsVar *data) {
+/// Write data for the response, and if 'isEnd' finish it
+static void httpServerResponseData(JsVar *httpServerResponseVar, JsVar *data, bool isEnd) {
   if (!_socketConnectionOpen(httpServerResponseVar)) {
     jsExceptionHere(JSET_ERROR, "This socket is closed.");
     return;
@@ -1034,17 +1420,37 @@ void serverResponseWrite(JsVar *httpServerResponseVar, JsVar *data) {
     sendData = jsvObjectGetChild(httpServerResponseVar, HTTP_NAME_SEND_DATA, 0);
   }
   // check, just in case!
-  if (sendData && !jsvIsUndefined(data)) {
-    JsVar *s = jsvAsString(data, false);
-    if (s) jsvAppendStringVarComplete(sendData,s);
+  if (sendData) {
+    JsVar *s = jsvIsUndefined(data) ? 0 : jsvAsString(data, false);
+    if (jsvGetBoolAndUnLock(jsvObjectGetChild(httpServerResponseVar, HTTP_NAME_HEADERS_PENDING, 0))) {
+      jsvObjectRemoveChild(httpServerResponseVar, HTTP_NAME_HEADERS_PENDING);
+      if (isEnd) {
+        // this is all the data there'll be, so we know how long it is
+        jsvAppendPrintf(sendData, "Content-Length: %d\r\n\r\n", s ? (int)jsvGetStringLength(s) : 0);
+      } else {
+        jsvAppendString(sendData, "Transfer-Encoding: chunked\r\n\r\n");
+        jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_CHUNKED, jsvNewFromBool(true));
+      }
+    }
+    bool chunked = jsvGetBoolAndUnLock(jsvObjectGetChild(httpServerResponseVar, HTTP_NAME_CHUNKED, 0));
+    if (s && chunked) {
+      // wrap the data up, prefixed with the length (an empty chunk would end the response)
+      if (!jsvIsEmptyString(s))
+        jsvAppendPrintf(sendData, "%x\r\n%v\r\n", (int)jsvGetStringLength(s), s);
+    } else if (s)
+      jsvAppendStringVarComplete(sendData,s);
+    if (isEnd && chunked)
+      jsvAppendString(sendData, "0\r\n\r\n");
     jsvUnLock(s);
   }
   jsvUnLock(sendData);
 }
 
-void serverResponseEnd(JsVar *httpServerResponseVar) {
-  serverResponseWrite(httpServerResponseVar, 0); // force connection->sendData to be created even if data not called
-  // TODO: This should only close the connection once the received data length == contentLength header
-  jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_CLOSE, jsvNewFromBool(true));
+void serverResponseWrite(JsVar *httpServerResponseVar, JsVar *data) {
+  httpServerResponseData(httpServerResponseVar, data, false);
 }
 
+void serverResponseEnd(JsVar *httpServerResponseVar, JsVar *data) {
+  httpServerResponseData(httpServerResponseVar, data, true); // force connection->sendData to be created even if data not called
+  jsvObjectSetChildAndUnLock(httpServerResponseVar, HTTP_NAME_CLOSE, jsvNewFromBool(true));
+}
@@ -23,6 +23,8 @@
 void socketInit();
 void socketKill(JsNetwork *net);
 bool socketIdle(JsNetwork *net);
+/// Are there any servers or connections open? (even if socketIdle says there's nothing to do)
+bool socketHasOpenSockets();
 
 // -----------------------------
 JsVar *serverNew(SocketType socketType, JsVar *callback);
@@ -34,9 +36,10 @@ JsVar *clientRequestNew(SocketType socketType, JsVar *options, JsVar *callback);
 void clientRequestWrite(JsNetwork *net, JsVar *httpClientReqVar, JsVar *data, JsVar *host, unsigned short port);
 void clientRequestConnect(JsNetwork *net, JsVar *httpClientReqVar);
 void clientRequestEnd(JsNetwork *net, JsVar *httpClientReqVar);
+int socketWriteBuf(JsVar *socket, const char *buf, size_t len);
 
 void serverResponseWriteHead(JsVar *httpServerResponseVar, int statusCode, JsVar *headers);
 void serverResponseWrite(JsVar *httpServerResponseVar, JsVar *data);
-void serverResponseEnd(JsVar *httpServerResponseVar);
+void serverResponseEnd(JsVar *httpServerResponseVar, JsVar *data);
 
 #endif // SOCKETSERVER_H
@@ -70,23 +70,16 @@ void lcd_wr(int data) {
   }
 }
 
-void lcd_flip_gfx(JsGraphics *gfx) {
-  if (gfx->data.modMinX > gfx->data.modMaxX) return; // nothing to do!
+// Send the area x1,y1 -> x2,y2 of the buffer to the LCD
+static void lcd_flip_area(char *bPtr, int x1, int y1, int x2, int y2) {
+  int xcoord = x1&~7;
+  int xlen = x2+1-xcoord;
 
-  JsVar *buf = jsvObjectGetChild(gfx->graphicsVar,"buffer",0);
-  if (!buf) return;
-  JSV_GET_AS_CHAR_ARRAY(bPtr, bLen, buf);
-  if (!bPtr || bLen<128*8) return;
-
-  int xcoord = gfx->data.modMinX&~7;
-  int xlen = gfx->data.modMaxX+1-xcoord;
-
-  jshPinSetValue(LCD_SPI_CS,0);
   for (int y=0;y<8;y++) {
     // skip any lines that don't need updating
     int ycoord = y*8;
-    if (ycoord > gfx->data.modMaxY ||
-        ycoord+7 < gfx->data.modMinY) continue;
+    if (ycoord > y2 ||
+        ycoord+7 < y1) continue;
     // Send only what we need
     jshPinSetValue(LCD_SPI_DC,0);
     lcd_wr(0xB0|y/* page */);
@@ -109,13 +102,33 @@ void lcd_flip_gfx(JsGraphics *gfx) {
       if ((x&7) == 7) px++;
     }
   }
+}
+
+#ifdef JSGRAPHICS_MODIFIED_TILES
+static void lcd_flip_region(int x1, int y1, int x2, int y2, void *callbackData) {
+  lcd_flip_area((char*)callbackData, x1, y1, x2, y2);
+}
+#endif
+
+void lcd_flip_gfx(JsGraphics *gfx) {
+  if (gfx->data.modMinX > gfx->data.modMaxX) return; // nothing to do!
+
+  JsVar *buf = jsvObjectGetChild(gfx->graphicsVar,"buffer",0);
+  if (!buf) return;
+  JSV_GET_AS_CHAR_ARRAY(bPtr, bLen, buf);
+  if (!bPtr || bLen<128*8) return;
+
+  jshPinSetValue(LCD_SPI_CS,0);
+#ifdef JSGRAPHICS_MODIFIED_TILES
+  // only send the regions that have changed
+  graphicsGetModifiedTiles(gfx->data.modTiles, gfx->data.width, gfx->data.height, false, lcd_flip_region, bPtr);
+#else
+  lcd_flip_area(bPtr, gfx->data.modMinX, gfx->data.modMinY, gfx->data.modMaxX, gfx->data.modMaxY);
+#endif
   jshPinSetValue(LCD_SPI_CS,1);
   jsvUnLock(buf);
   // Reset modified-ness
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
+  graphicsClearModified(gfx);
 }
 
 
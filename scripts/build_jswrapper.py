@@ -155,31 +155,111 @@ def getCDeclaration(jsondata, name):
     s.append(toCType(param[1]));
   return toCType(result[0])+" "+name+"("+",".join(s)+")";
 
+# ------------------------------------------------------------------------------------------------------
+# Each symbol table has a minimal perfect hash, so that a symbol can be found
+# with one string comparison. 'bucket = hashIndex(hash, seed, 0, n)' picks an
+# entry in the table's symbolHash array, which is the value 'd' for which
+# 'hashIndex(hash, seed, d, n)' is the index of the symbol. The symbols are
+# stored in the order of their indices. These MUST match jswHashName/jswHashIndex.
+
+def hashName(name): # FNV-1a
+  h = 2166136261
+  for c in name:
+    h = ((h ^ ord(c)) * 16777619) & 0xFFFFFFFF
+  return h
+
+def hashIndex(h, seed, d, n):
+  h = h ^ seed ^ ((d * 0x9E3779B9) & 0xFFFFFFFF)
+  h = h ^ (h >> 16)
+  h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+  h = h ^ (h >> 13)
+  h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+  h = h ^ (h >> 16)
+  return h % n
+
+def buildPerfectHash(names):
+  """ Returns (seed, symbolHash, order) where order[index] is the index in names of the symbol at that index """
+  n = len(names)
+  if n==0: return 0, [0], []
+  hashes = [hashName(name) for name in names]
+  for seed in range(256):
+    buckets = [[] for i in range(n)]
+    for i in range(n):
+      buckets[hashIndex(hashes[i], seed, 0, n)].append(i)
+    symbolHash = [0] * n
+    order = [None] * n
+    # place the biggest buckets first, while there are still lots of free slots
+    placedAll = True
+    for bucket in sorted(range(n), key=lambda b: -len(buckets[b])):
+      if not buckets[bucket]: break
+      placed = False
+      for d in range(256):
+        indices = [hashIndex(hashes[i], seed, d, n) for i in buckets[bucket]]
+        if len(set(indices))==len(indices) and all(order[idx]==None for idx in indices):
+          placed = True
+          break
+      if not placed:
+        placedAll = False
+        break # try another seed
+      symbolHash[bucket] = d
+      for i,idx in zip(buckets[bucket], indices):
+        order[idx] = i
+    if placedAll:
+      return seed, symbolHash, order
+  sys.stderr.write("ERROR: buildPerfectHash: Unable to create hash for "+",".join(names)+"\n")
+  exit(1)
+
+def checkPerfectHash(names, seed, symbolHash):
+  """ Self-test - check that we can find every symbol in the table """
+  n = len(names)
+  for name in names:
+    h = hashName(name)
+    idx = hashIndex(h, seed, symbolHash[hashIndex(h, seed, 0, n)], n)
+    if names[idx]!=name:
+      sys.stderr.write("ERROR: checkPerfectHash: Looking up "+name+" found "+names[idx]+"\n")
+      exit(1)
+
 def codeOutSymbolTable(builtin):
   codeName = builtin["name"]
   # sort by name
   builtin["functions"] = sorted(builtin["functions"], key=lambda n: n["name"]);
-  # output tables
-  listSymbols = []
-  listChars = ""
-  strLen = 0
+  symbols = []
   for sym in builtin["functions"]:
     symName = sym["name"];
 
     if builtin["name"]=="global" and symName in libraries:
       continue # don't include libraries on global namespace
-    if "generate" in sym:
-      listSymbols.append("{"+", ".join([str(strLen), getArgumentSpecifier(sym), "(void (*)(void))"+sym["generate"]])+"}")
-      listChars = listChars + symName + "\\0";
-      strLen = strLen + len(symName) + 1
+    if symName in [s["name"] for s in symbols]:
+      print (codeName + "." + symName+" not included in Symbol Table because it is already defined")
+    elif "generate" in sym:
+      symbols.append(sym)
     else:
       print (codeName + "." + symName+" not included in Symbol Table because no 'generate'")
+  # names are stored in sorted order, so they can be enumerated by walking symbolChars
+  listChars = ""
+  strOffsets = {}
+  strLen = 0
+  for sym in symbols:
+    symName = sym["name"];
+    strOffsets[symName] = strLen
+    listChars = listChars + symName + "\\0";
+    strLen = strLen + len(symName) + 1
+  # put symbols in the order given by the hash
+  seed, symbolHash, order = buildPerfectHash([sym["name"] for sym in symbols])
+  symbols = [symbols[i] for i in order]
+  checkPerfectHash([sym["name"] for sym in symbols], seed, symbolHash)
+  # output tables
+  listSymbols = []
+  for sym in symbols:
+    listSymbols.append("{"+", ".join([str(strOffsets[sym["name"]]), getArgumentSpecifier(sym), "(void (*)(void))"+sym["generate"]])+"}")
   builtin["symbolTableChars"] = "\""+listChars+"\"";
   builtin["symbolTableCount"] = str(len(listSymbols));
+  builtin["symbolTableSeed"] = str(seed);
   codeOut("static const JswSymPtr jswSymbols_"+codeName+"[] FLASH_SECT = {\n  "+",\n  ".join(listSymbols)+"\n};");
+  codeOut("static const unsigned char jswSymbolHash_"+codeName+"[] FLASH_SECT = { "+", ".join([str(d) for d in symbolHash])+" };");
 
 def codeOutBuiltins(indent, builtin):
-  codeOut(indent+"jswBinarySearch(&jswSymbolTables["+builtin["indexName"]+"], parent, name);");
+  codeOut(indent+"jswSymbolListFind(&jswSymbolTables["+builtin["indexName"]+"], parent, name);");
 
 #================== to remove JS-definitions given by blacklist==============
 def delete_by_indices(lst, indices):
@@ -298,33 +378,39 @@ codeOut('// --------------------------------------------------------------------
 codeOut('');
 
 codeOut("""
-// Binary search coded to allow for JswSyms to be in flash on the esp8266 where they require
+// Hash of a symbol's name - this must match hashName in build_jswrapper.py
+static uint32_t jswHashName(const char *name) {
+  uint32_t h = 2166136261U;
+  while (*name) h = (h ^ (unsigned char)*(name++)) * 16777619U;
+  return h;
+}
+
+// Index of a symbol in a table of n - this must match hashIndex in build_jswrapper.py
+static unsigned int jswHashIndex(uint32_t h, unsigned char d, unsigned int n) {
+  h ^= d * 0x9E3779B9U;
+  h ^= h >> 16;
+  h *= 0x85EBCA6BU;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35U;
+  h ^= h >> 16;
+  return h % n;
+}
+
+// Perfect hash lookup coded to allow for JswSyms to be in flash on the esp8266 where they require
 // word accesses
-JsVar *jswBinarySearch(const JswSymList *symbolsPtr, JsVar *parent, const char *name) {
+JsVar *jswSymbolListFind(const JswSymList *symbolsPtr, JsVar *parent, const char *name) {
   uint8_t symbolCount = READ_FLASH_UINT8(&symbolsPtr->symbolCount);
-  int searchMin = 0;
-  int searchMax = symbolCount - 1;
-  while (searchMin <= searchMax) {
-    int idx = (searchMin+searchMax) >> 1;
-    const JswSymPtr *sym = &symbolsPtr->symbols[idx];
-    unsigned short strOffset = READ_FLASH_UINT16(&sym->strOffset);
-    int cmp = FLASH_STRCMP(name, &symbolsPtr->symbolChars[strOffset]);
-    if (cmp==0) {
-      unsigned short functionSpec = READ_FLASH_UINT16(&sym->functionSpec);
-      if ((functionSpec & JSWAT_EXECUTE_IMMEDIATELY_MASK) == JSWAT_EXECUTE_IMMEDIATELY)
-        return jsnCallFunction(sym->functionPtr, functionSpec, parent, 0, 0);
-      return jsvNewNativeFunction(sym->functionPtr, functionSpec);
-    } else {
-      if (cmp<0) {
-        // searchMin is the same
-        searchMax = idx-1;
-      } else {
-        searchMin = idx+1;
-        // searchMax is the same
-      }
-    }
-  }
-  return 0;
+  if (!symbolCount) return 0;
+  uint32_t h = jswHashName(name) ^ READ_FLASH_UINT8(&symbolsPtr->hashSeed);
+  unsigned char d = READ_FLASH_UINT8(&symbolsPtr->symbolHash[jswHashIndex(h, 0, symbolCount)]);
+  const JswSymPtr *sym = &symbolsPtr->symbols[jswHashIndex(h, d, symbolCount)];
+  unsigned short strOffset = READ_FLASH_UINT16(&sym->strOffset);
+  if (FLASH_STRCMP(name, &symbolsPtr->symbolChars[strOffset])!=0)
+    return 0;
+  unsigned short functionSpec = READ_FLASH_UINT16(&sym->functionSpec);
+  if ((functionSpec & JSWAT_EXECUTE_IMMEDIATELY_MASK) == JSWAT_EXECUTE_IMMEDIATELY)
+    return jsnCallFunction(sym->functionPtr, functionSpec, parent, 0, 0);
+  return jsvNewNativeFunction(sym->functionPtr, functionSpec);
 }
 
 """);
@@ -391,7 +477,7 @@ codeOut('');
 codeOut('const JswSymList jswSymbolTables[] FLASH_SECT = {');
 for b in builtins:
   builtin = builtins[b]
-  codeOut("  {"+", ".join(["jswSymbols_"+builtin["name"], "jswSymbols_"+builtin["name"]+"_str", builtin["symbolTableCount"]])+"},");
+  codeOut("  {"+", ".join(["jswSymbols_"+builtin["name"], "jswSymbols_"+builtin["name"]+"_str", "jswSymbolHash_"+builtin["name"], builtin["symbolTableCount"], builtin["symbolTableSeed"]])+"},");
 codeOut('};');
 
 codeOut('');
@@ -419,7 +505,7 @@ nativeCheck = "jsvIsNativeFunction(parent) && "
 codeOut('    if (jsvIsNativeFunction(parent)) {')
 codeOut('      const JswSymList *l = jswGetSymbolListForObject(parent);')
 codeOut('      if (l) {');
-codeOut('        v = jswBinarySearch(l, parent, name);')
+codeOut('        v = jswSymbolListFind(l, parent, name);')
 codeOut('        if (v) return v;');
 codeOut('      }')
 codeOut('    }')
@@ -437,7 +523,7 @@ codeOut('    if (constructor && jsvIsNativeFunction(constructor)) {')
 codeOut('      const JswSymList *l = jswGetSymbolListForConstructorProto(constructor);')
 codeOut('      jsvUnLock(constructor);')
 codeOut('      if (l) {');
-codeOut('        v = jswBinarySearch(l, parent, name);')
+codeOut('        v = jswSymbolListFind(l, parent, name);')
 codeOut('        if (v) return v;');
 codeOut('      }')
 codeOut('    } else {')
@@ -0,0 +1,1151 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2018 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Bytecode compiler and interpreter for function bodies and loops
+ * ----------------------------------------------------------------------------
+ */
+#include "jsbytecode.h"
+#include "jslex.h"
+#include "jsparse.h"
+#include "jsflags.h"
+#include "jsinteractive.h"
+
+/* The bytecode is a simple stack machine. Values on the stack are locked
+ * JsVars, and just like in the parser they may be names (so they can be
+ * assigned to) - they're only converted to values when they need to be.
+ *
+ * Jump addresses are stored as signed 16 bit offsets relative to the
+ * position of the address itself, so blocks of code can be moved around
+ * while compiling. */
+typedef enum {
+  JSB_END,          ///< end of code - return undefined
+  JSB_POS,          ///< u16 pos - position in the source code (for error reporting)
+  JSB_POP,          ///< a ->
+  JSB_UNDEFINED,    ///< -> undefined
+  JSB_NULL,         ///< -> null
+  JSB_TRUE,         ///< -> true
+  JSB_FALSE,        ///< -> false
+  JSB_INT8,         ///< s8 value -> int
+  JSB_INT32,        ///< s32 value -> int
+  JSB_FLOAT,        ///< JsVarFloat value -> float
+  JSB_STRING,       ///< u16 length, data -> string
+  JSB_THIS,         ///< -> this
+  JSB_ID,           ///< u8 slot, name\0 -> variable name (slot is JSB_NO_SLOT if it has none)
+  JSB_VAR,          ///< name\0 -> variable name (defined in the top scope)
+  JSB_FIELD,        ///< name\0 : a -> a.name
+  JSB_FIELD_KEEP,   ///< name\0 : a -> a, a.name (for method calls)
+  JSB_INDEX,        ///< a, i -> a[i]
+  JSB_INDEX_KEEP,   ///< a, i -> a, a[i] (for method calls)
+  JSB_CALL,         ///< u8 argCount : fn, args... -> result
+  JSB_CALL_METHOD,  ///< u8 argCount : this, fn, args... -> result
+  JSB_NEW,          ///< u8 argCount : fn, args... -> new object
+  JSB_ASSIGN,       ///< u8 op ('=', LEX_PLUSEQUAL, etc) : name, value -> name
+  JSB_PREINC,       ///< u8 op ('+' or '-') : name -> name
+  JSB_POSTINC,      ///< u8 op ('+' or '-') : name -> old value
+  JSB_BINARY,       ///< u8 op : a, b -> a op b
+  JSB_NOT,          ///< a -> !a
+  JSB_BITNOT,       ///< a -> ~a
+  JSB_NEGATE,       ///< a -> -a
+  JSB_TONUMBER,     ///< a -> +a
+  JSB_TYPEOF,       ///< a -> typeof a
+  JSB_JMP,          ///< s16 offset
+  JSB_JMP_FALSE,    ///< s16 offset : a -> (jump if a is false)
+  JSB_JMP_TRUE,     ///< s16 offset : a -> (jump if a is true)
+  JSB_AND,          ///< s16 offset : a -> a (and jump if false) or -> (if true)
+  JSB_OR,           ///< s16 offset : a -> a (and jump if true) or -> (if false)
+  JSB_RETURN,       ///< a -> (and return a)
+  JSB_THROW,        ///< a -> (and throw a)
+  JSB_ARRAY,        ///< -> []
+  JSB_ELEMENT,      ///< arr, value -> arr (value pushed onto arr)
+  JSB_OBJECT,       ///< -> {}
+  JSB_PROPERTY,     ///< name\0 : obj, value -> obj (with obj.name = value)
+} JsbOpCode;
+
+/// Maximum size of the iterator part of a 'for' loop (which is moved after the loop body)
+#define JSB_MAX_FOR_ITERATOR_LENGTH 128
+/// Variable names must be shorter than this to get a slot (see JspVarSlots)
+#define JSB_MAX_SLOT_NAME_LENGTH 12
+/// Slot number used for variables that don't have a slot
+#define JSB_NO_SLOT 255
+
+#define JSB_SHOULD_EXECUTE (((execInfo.execute)&EXEC_RUN_MASK)==EXEC_YES)
+
+typedef struct {
+  unsigned char *code;     ///< Where we're writing the bytecode
+  unsigned int length;     ///< Amount of bytecode written
+  int stackDepth;          ///< How many items will be on the interpreter's stack at this point
+  bool ok;                 ///< Set to false if we couldn't compile
+  bool isFunction;         ///< Are we compiling a function? (is 'return' allowed?)
+  int loopDepth;           ///< Number of loops we're inside
+  uint16_t breakChain;     ///< list of 'break' jumps that need to point to the end of the current loop
+  uint16_t continueChain;  ///< list of 'continue' jumps that need to point to the next iteration of the current loop
+  int slotCount;           ///< Number of variable names that have been given slots
+  char slotNames[JSP_MAX_VAR_SLOTS][JSB_MAX_SLOT_NAME_LENGTH]; ///< The name for each slot
+} JsbCompiler;
+
+/// The state of the compiler (there's only ever one compilation at a time)
+static JsbCompiler jsbc;
+
+// ----------------------------------------------------------------------------
+//                                                                     EMITTING
+
+static void jsbFail() {
+  jsbc.ok = false;
+}
+
+static void jsbEmit(unsigned char b) {
+  if (jsbc.length >= JSB_MAX_CODE_LENGTH) {
+    jsbFail();
+    return;
+  }
+  jsbc.code[jsbc.length++] = b;
+}
+
+static void jsbEmitData(const void *data, size_t len) {
+  const unsigned char *d = (const unsigned char*)data;
+  while (len--) jsbEmit(*(d++));
+}
+
+static void jsbEmit16(uint16_t v) {
+  jsbEmit((unsigned char)(v&255));
+  jsbEmit((unsigned char)(v>>8));
+}
+
+static uint16_t jsbRead16(const unsigned char *p) {
+  return (uint16_t)(p[0] | (p[1]<<8));
+}
+
+/// Adjust the stack depth, and fail if the interpreter's stack would overflow
+static void jsbStack(int delta) {
+  jsbc.stackDepth += delta;
+  if (jsbc.stackDepth > JSB_MAX_STACK)
+    jsbFail();
+}
+
+static void jsbEmitOp(JsbOpCode op, int stackDelta) {
+  jsbEmit((unsigned char)op);
+  jsbStack(stackDelta);
+}
+
+static void jsbEmitOpArg(JsbOpCode op, int arg, int stackDelta) {
+  jsbEmitOp(op, stackDelta);
+  jsbEmit((unsigned char)arg);
+}
+
+/// Emit an opcode followed by a zero-terminated name
+static void jsbEmitName(JsbOpCode op, const char *name, int stackDelta) {
+  jsbEmitOp(op, stackDelta);
+  jsbEmitData(name, strlen(name)+1);
+}
+
+/// Set the jump at 'addr' to point to 'target'
+static void jsbPatchJump(uint16_t addr, unsigned int target) {
+  if (!jsbc.ok) return;
+  int offset = (int)target - (int)addr;
+  jsbc.code[addr] = (unsigned char)(offset&255);
+  jsbc.code[addr+1] = (unsigned char)((offset>>8)&255);
+}
+
+/** Emit a jump, and return the address of its destination, which must later
+ * be set with jsbPatchJump */
+static uint16_t jsbEmitJump(JsbOpCode op, int stackDelta) {
+  jsbEmitOp(op, stackDelta);
+  uint16_t addr = (uint16_t)jsbc.length;
+  jsbEmit16(0);
+  return addr;
+}
+
+/// Emit a jump to the given (already known) address
+static void jsbEmitJumpTo(JsbOpCode op, unsigned int target, int stackDelta) {
+  jsbPatchJump(jsbEmitJump(op, stackDelta), target);
+}
+
+/** Emit a jump that's part of the given chain (used for break/continue).
+ * Until patched, each jump's address points to the previous jump in the chain */
+static void jsbEmitChainJump(uint16_t *chain) {
+  jsbEmitOp(JSB_JMP, 0);
+  uint16_t addr = (uint16_t)jsbc.length;
+  jsbEmit16(*chain);
+  *chain = addr;
+}
+
+/// Point all jumps in the given chain at the target address
+static void jsbPatchChain(uint16_t chain, unsigned int target) {
+  while (chain && jsbc.ok) {
+    uint16_t next = jsbRead16(&jsbc.code[chain]);
+    jsbPatchJump(chain, target);
+    chain = next;
+  }
+}
+
+static void jsbEmitPosition() {
+  if (!lex->tokenStart.it.var) return;
+  size_t pos = jsvStringIteratorGetIndex(&lex->tokenStart.it)-1;
+  if (pos>0xFFFF) return;
+  jsbEmitOp(JSB_POS, 0);
+  jsbEmit16((uint16_t)pos);
+}
+
+// ----------------------------------------------------------------------------
+//                                                                    COMPILING
+
+/// Match the given token, or fail compilation
+static bool jsbMatch(int tk) {
+  if (!jsbc.ok || lex->tk != tk) {
+    jsbFail();
+    return false;
+  }
+  jslGetNextToken();
+  return true;
+}
+
+/// Check we're not going to run out of stack while compiling
+static bool jsbCheckStack() {
+  if (jsuGetFreeStack() < 512) {
+    jsbFail();
+    return false;
+  }
+  return jsbc.ok;
+}
+
+static void jsbcAssignment();
+static void jsbcUnary();
+static void jsbcStatement();
+static void jsbcBlockOrStatement();
+
+static void jsbcExpression() {
+  jsbcAssignment();
+  while (jsbc.ok && lex->tk==',') {
+    jslGetNextToken();
+    jsbEmitOp(JSB_POP, -1);
+    jsbcAssignment();
+  }
+}
+
+static void jsbcNumber(long long v) {
+  if (v>=-128 && v<=127) {
+    jsbEmitOpArg(JSB_INT8, (int)v, 1);
+  } else if (v>=-2147483648LL && v<=2147483647LL) {
+    int32_t i = (int32_t)v;
+    jsbEmitOp(JSB_INT32, 1);
+    jsbEmitData(&i, sizeof(i));
+  } else {
+    JsVarFloat f = (JsVarFloat)v;
+    jsbEmitOp(JSB_FLOAT, 1);
+    jsbEmitData(&f, sizeof(f));
+  }
+}
+
+static void jsbcString() {
+  JsVar *str = jslGetTokenValueAsVar();
+  size_t len = jsvGetStringLength(str);
+  if (len > 0xFFFF) {
+    jsbFail();
+  } else {
+    jsbEmitOp(JSB_STRING, 1);
+    jsbEmit16((uint16_t)len);
+    JsvStringIterator it;
+    jsvStringIteratorNew(&it, str, 0);
+    while (jsvStringIteratorHasChar(&it) && jsbc.ok) {
+      jsbEmit((unsigned char)jsvStringIteratorGetChar(&it));
+      jsvStringIteratorNext(&it);
+    }
+    jsvStringIteratorFree(&it);
+  }
+  jsvUnLock(str);
+  jslGetNextToken();
+}
+
+static void jsbcArray() {
+  jslGetNextToken();
+  jsbEmitOp(JSB_ARRAY, 1);
+  while (jsbc.ok && lex->tk!=']') {
+    if (lex->tk==',') { // holes in arrays aren't handled
+      jsbFail();
+      return;
+    }
+    jsbcAssignment();
+    jsbEmitOp(JSB_ELEMENT, -1);
+    if (lex->tk!=']') jsbMatch(',');
+  }
+  jsbMatch(']');
+}
+
+static void jsbcObject() {
+  jslGetNextToken();
+  jsbEmitOp(JSB_OBJECT, 1);
+  while (jsbc.ok && lex->tk!='}') {
+    char name[JSLEX_MAX_TOKEN_LENGTH];
+    if (lex->tk==LEX_ID) {
+      strncpy(name, jslGetTokenValueAsString(), sizeof(name));
+    } else if (lex->tk==LEX_STR && !lex->tokenValue) {
+      // short strings are stored in the token buffer
+      strncpy(name, jslGetTokenValueAsString(), sizeof(name));
+      if (strlen(name) != (size_t)jslGetTokenLength()) {
+        jsbFail(); // contains a zero
+        return;
+      }
+    } else {
+      jsbFail();
+      return;
+    }
+    name[sizeof(name)-1] = 0;
+    jslGetNextToken();
+    if (!jsbMatch(':')) return;
+    jsbcAssignment();
+    jsbEmitName(JSB_PROPERTY, name, -1);
+    if (lex->tk!='}') jsbMatch(',');
+  }
+  jsbMatch('}');
+}
+
+/// Get the slot number for a variable name (or JSB_NO_SLOT), allocating a new one if needed
+static int jsbcGetSlot(const char *name) {
+  if (strlen(name) >= JSB_MAX_SLOT_NAME_LENGTH) return JSB_NO_SLOT;
+  int i;
+  for (i=0;i<jsbc.slotCount;i++)
+    if (!strcmp(jsbc.slotNames[i], name)) return i;
+  if (jsbc.slotCount >= JSP_MAX_VAR_SLOTS) return JSB_NO_SLOT;
+  strcpy(jsbc.slotNames[jsbc.slotCount], name);
+  return jsbc.slotCount++;
+}
+
+static void jsbcFactor() {
+  if (!jsbCheckStack()) return;
+  int tk = lex->tk;
+  if (tk==LEX_ID) {
+    const char *name = jslGetTokenValueAsString();
+    jsbEmitOpArg(JSB_ID, jsbcGetSlot(name), 1);
+    jsbEmitData(name, strlen(name)+1);
+    jslGetNextToken();
+    // tagged template literals and arrow functions are left to the parser
+    if (lex->tk==LEX_TEMPLATE_LITERAL || lex->tk==LEX_ARROW_FUNCTION)
+      jsbFail();
+  } else if (tk==LEX_INT) {
+    jsbcNumber(stringToInt(jslGetTokenValueAsString()));
+    jslGetNextToken();
+  } else if (tk==LEX_FLOAT) {
+    JsVarFloat f = stringToFloat(jslGetTokenValueAsString());
+    jsbEmitOp(JSB_FLOAT, 1);
+    jsbEmitData(&f, sizeof(f));
+    jslGetNextToken();
+  } else if (tk==LEX_STR) {
+    jsbcString();
+  } else if (tk=='(') {
+    jslGetNextToken();
+    jsbcExpression();
+    jsbMatch(')');
+    if (lex->tk==LEX_ARROW_FUNCTION) jsbFail();
+  } else if (tk==LEX_R_TRUE || tk==LEX_R_FALSE || tk==LEX_R_NULL ||
+             tk==LEX_R_UNDEFINED || tk==LEX_R_THIS) {
+    if (tk==LEX_R_TRUE) jsbEmitOp(JSB_TRUE, 1);
+    else if (tk==LEX_R_FALSE) jsbEmitOp(JSB_FALSE, 1);
+    else if (tk==LEX_R_NULL) jsbEmitOp(JSB_NULL, 1);
+    else if (tk==LEX_R_UNDEFINED) jsbEmitOp(JSB_UNDEFINED, 1);
+    else jsbEmitOp(JSB_THIS, 1);
+    jslGetNextToken();
+  } else if (tk=='[') {
+    jsbcArray();
+  } else if (tk=='{') {
+    jsbcObject();
+  } else if (tk==LEX_R_TYPEOF) {
+    jslGetNextToken();
+    jsbcUnary();
+    jsbEmitOp(JSB_TYPEOF, 0);
+  } else if (tk==LEX_R_VOID) {
+    jslGetNextToken();
+    jsbcUnary();
+    jsbEmitOp(JSB_POP, -1);
+    jsbEmitOp(JSB_UNDEFINED, 1);
+  } else {
+    // function definitions, classes, regex, delete, etc are left to the parser
+    jsbFail();
+  }
+}
+
+/** Compile any '.' or '[' member accesses. If the last access is followed by
+ * a '(' (and !noMethod), the parent object is left on the stack so it can be
+ * used as 'this' for a method call - in which case true is returned. */
+static bool jsbcMember(bool noMethod) {
+  bool hasParent = false;
+  while (jsbc.ok && (lex->tk=='.' || lex->tk=='[')) {
+    if (lex->tk=='.') {
+      jslGetNextToken();
+      if (lex->tk!=LEX_ID) {
+        jsbFail();
+        return false;
+      }
+      char name[JSLEX_MAX_TOKEN_LENGTH];
+      strncpy(name, jslGetTokenValueAsString(), sizeof(name));
+      name[sizeof(name)-1] = 0;
+      jslGetNextToken();
+      hasParent = !noMethod && lex->tk=='(';
+      jsbEmitName(hasParent ? JSB_FIELD_KEEP : JSB_FIELD, name, hasParent ? 1 : 0);
+    } else {
+      jslGetNextToken();
+      jsbcAssignment();
+      if (!jsbMatch(']')) return false;
+      hasParent = !noMethod && lex->tk=='(';
+      jsbEmitOp(hasParent ? JSB_INDEX_KEEP : JSB_INDEX, hasParent ? 0 : -1);
+    }
+  }
+  return hasParent;
+}
+
+/// Compile the arguments for a function call, and return how many there were
+static int jsbcArguments() {
+  int args = 0;
+  jsbMatch('(');
+  while (jsbc.ok && lex->tk!=')') {
+    jsbcAssignment();
+    args++;
+    if (lex->tk!=')') jsbMatch(',');
+  }
+  jsbMatch(')');
+  if (args>255) jsbFail();
+  return args;
+}
+
+static void jsbcFactorFunctionCall() {
+  bool isConstructor = false;
+  if (lex->tk==LEX_R_NEW) {
+    jslGetNextToken();
+    isConstructor = true;
+    if (lex->tk==LEX_R_NEW) { // nested 'new' is an error, so let the parser report it
+      jsbFail();
+      return;
+    }
+  }
+  jsbcFactor();
+  bool hasParent = jsbcMember(isConstructor);
+  if (isConstructor) {
+    int args = (lex->tk=='(') ? jsbcArguments() : 0;
+    jsbEmitOpArg(JSB_NEW, args, -args);
+    hasParent = jsbcMember(false);
+  }
+  while (jsbc.ok && lex->tk=='(') {
+    int args = jsbcArguments();
+    if (hasParent)
+      jsbEmitOpArg(JSB_CALL_METHOD, args, -(args+1));
+    else
+      jsbEmitOpArg(JSB_CALL, args, -args);
+    hasParent = jsbcMember(false);
+  }
+}
+
+static void jsbcPostfix() {
+  if (lex->tk==LEX_PLUSPLUS || lex->tk==LEX_MINUSMINUS) {
+    int op = (lex->tk==LEX_PLUSPLUS) ? '+' : '-';
+    jslGetNextToken();
+    jsbcPostfix();
+    jsbEmitOpArg(JSB_PREINC, op, 0);
+  } else
+    jsbcFactorFunctionCall();
+  while (jsbc.ok && (lex->tk==LEX_PLUSPLUS || lex->tk==LEX_MINUSMINUS)) {
+    jsbEmitOpArg(JSB_POSTINC, (lex->tk==LEX_PLUSPLUS) ? '+' : '-', 0);
+    jslGetNextToken();
+  }
+}
+
+static void jsbcUnary() {
+  int tk = lex->tk;
+  if (tk=='!' || tk=='~' || tk=='-' || tk=='+') {
+    jslGetNextToken();
+    if (!jsbCheckStack()) return;
+    jsbcUnary();
+    if (tk=='!') jsbEmitOp(JSB_NOT, 0);
+    else if (tk=='~') jsbEmitOp(JSB_BITNOT, 0);
+    else if (tk=='-') jsbEmitOp(JSB_NEGATE, 0);
+    else jsbEmitOp(JSB_TONUMBER, 0);
+  } else
+    jsbcPostfix();
+}
+
+/// Get the precedence of a binary operator - must match jspeGetBinaryExpressionPrecedence
+static unsigned int jsbGetBinaryPrecedence(int op) {
+  switch (op) {
+  case LEX_OROR: return 1;
+  case LEX_ANDAND: return 2;
+  case '|' : return 3;
+  case '^' : return 4;
+  case '&' : return 5;
+  case LEX_EQUAL:
+  case LEX_NEQUAL:
+  case LEX_TYPEEQUAL:
+  case LEX_NTYPEEQUAL: return 6;
+  case LEX_LEQUAL:
+  case LEX_GEQUAL:
+  case '<':
+  case '>':
+  case LEX_R_INSTANCEOF:
+  case LEX_R_IN: return 7;
+  case LEX_LSHIFT:
+  case LEX_RSHIFT:
+  case LEX_RSHIFTUNSIGNED: return 8;
+  case '+':
+  case '-': return 9;
+  case '*':
+  case '/':
+  case '%': return 10;
+  default: return 0;
+  }
+}
+
+/// Compile the rest of a binary expression (the first operand is already compiled)
+static void jsbcBinary(unsigned int lastPrecedence) {
+  unsigned int precedence = jsbGetBinaryPrecedence(lex->tk);
+  while (jsbc.ok && precedence && precedence>lastPrecedence) {
+    int op = lex->tk;
+    if (op==LEX_R_IN || op==LEX_R_INSTANCEOF) {
+      jsbFail();
+      return;
+    }
+    jslGetNextToken();
+    if (op==LEX_ANDAND || op==LEX_OROR) {
+      uint16_t end = jsbEmitJump((op==LEX_ANDAND) ? JSB_AND : JSB_OR, -1);
+      jsbcUnary();
+      jsbcBinary(precedence);
+      jsbPatchJump(end, jsbc.length);
+    } else {
+      jsbcUnary();
+      jsbcBinary(precedence);
+      jsbEmitOpArg(JSB_BINARY, op, -1);
+    }
+    precedence = jsbGetBinaryPrecedence(lex->tk);
+  }
+}
+
+static void jsbcConditional() {
+  jsbcUnary();
+  jsbcBinary(0);
+  if (jsbc.ok && lex->tk=='?') {
+    jslGetNextToken();
+    uint16_t elseJump = jsbEmitJump(JSB_JMP_FALSE, -1);
+    jsbcAssignment();
+    uint16_t endJump = jsbEmitJump(JSB_JMP, -1); // the 'else' branch pushes its own value
+    jsbMatch(':');
+    jsbPatchJump(elseJump, jsbc.length);
+    jsbcAssignment();
+    jsbPatchJump(endJump, jsbc.length);
+  }
+}
+
+static void jsbcAssignment() {
+  if (!jsbCheckStack()) return;
+  jsbcConditional();
+  int op = lex->tk;
+  if (jsbc.ok &&
+      (op=='=' || op==LEX_PLUSEQUAL || op==LEX_MINUSEQUAL ||
+       op==LEX_MULEQUAL || op==LEX_DIVEQUAL || op==LEX_MODEQUAL ||
+       op==LEX_ANDEQUAL || op==LEX_OREQUAL ||
+       op==LEX_XOREQUAL || op==LEX_RSHIFTEQUAL ||
+       op==LEX_LSHIFTEQUAL || op==LEX_RSHIFTUNSIGNEDEQUAL)) {
+    jslGetNextToken();
+    jsbcAssignment();
+    jsbEmitOpArg(JSB_ASSIGN, op, -1);
+  }
+}
+
+/// var/let/const - leaves nothing on the stack
+static void jsbcVar() {
+  jslGetNextToken();
+  if (lex->tk!=LEX_ID) jsbFail();
+  while (jsbc.ok && lex->tk==LEX_ID) {
+    jsbEmitName(JSB_VAR, jslGetTokenValueAsString(), 1);
+    jslGetNextToken();
+    if (lex->tk=='=') {
+      jslGetNextToken();
+      jsbcAssignment();
+      jsbEmitOpArg(JSB_ASSIGN, '=', -1);
+    }
+    jsbEmitOp(JSB_POP, -1);
+    if (lex->tk!=',') break;
+    jslGetNextToken();
+  }
+}
+
+/** Start compiling a loop body - break/continue are collected
+ * and must be patched with jsbcLoopEnd */
+static void jsbcLoopStart(uint16_t *oldBreak, uint16_t *oldContinue) {
+  *oldBreak = jsbc.breakChain;
+  *oldContinue = jsbc.continueChain;
+  jsbc.breakChain = 0;
+  jsbc.continueChain = 0;
+  jsbc.loopDepth++;
+}
+
+static void jsbcLoopEnd(uint16_t oldBreak, uint16_t oldContinue, unsigned int breakTarget, unsigned int continueTarget) {
+  jsbPatchChain(jsbc.breakChain, breakTarget);
+  jsbPatchChain(jsbc.continueChain, continueTarget);
+  jsbc.breakChain = oldBreak;
+  jsbc.continueChain = oldContinue;
+  jsbc.loopDepth--;
+}
+
+static void jsbcWhile() {
+  uint16_t oldBreak, oldContinue;
+  jslGetNextToken();
+  jsbMatch('(');
+  unsigned int condition = jsbc.length;
+  jsbcExpression();
+  jsbMatch(')');
+  uint16_t exitJump = jsbEmitJump(JSB_JMP_FALSE, -1);
+  jsbcLoopStart(&oldBreak, &oldContinue);
+  jsbcBlockOrStatement();
+  jsbEmitJumpTo(JSB_JMP, condition, 0);
+  jsbPatchJump(exitJump, jsbc.length);
+  jsbcLoopEnd(oldBreak, oldContinue, jsbc.length, condition);
+}
+
+static void jsbcDoWhile() {
+  uint16_t oldBreak, oldContinue;
+  jslGetNextToken();
+  unsigned int body = jsbc.length;
+  jsbcLoopStart(&oldBreak, &oldContinue);
+  jsbcBlockOrStatement();
+  unsigned int condition = jsbc.length;
+  jsbMatch(LEX_R_WHILE);
+  jsbMatch('(');
+  jsbcExpression();
+  jsbMatch(')');
+  jsbEmitJumpTo(JSB_JMP_TRUE, body, -1);
+  jsbcLoopEnd(oldBreak, oldContinue, jsbc.length, condition);
+}
+
+static void jsbcFor() {
+  uint16_t oldBreak, oldContinue;
+  jslGetNextToken();
+  jsbMatch('(');
+  // initialiser
+  if (lex->tk==LEX_R_VAR || lex->tk==LEX_R_LET || lex->tk==LEX_R_CONST) {
+    jsbcVar();
+  } else if (lex->tk!=';') {
+    jsbcExpression();
+    jsbEmitOp(JSB_POP, -1);
+  }
+  if (lex->tk==LEX_R_IN) jsbFail(); // for..in is left to the parser
+  jsbMatch(';');
+  // condition
+  unsigned int condition = jsbc.length;
+  uint16_t exitJump = 0;
+  if (lex->tk!=';') {
+    jsbcExpression();
+    exitJump = jsbEmitJump(JSB_JMP_FALSE, -1);
+  }
+  jsbMatch(';');
+  /* iterator - this comes before the body in the source, but we want to
+   * execute it after, so we compile it and then move it after the body.
+   * Jumps are relative so this is fine. */
+  unsigned char iterator[JSB_MAX_FOR_ITERATOR_LENGTH];
+  unsigned int iteratorStart = jsbc.length;
+  unsigned int iteratorLength = 0;
+  if (lex->tk!=')') {
+    jsbcExpression();
+    jsbEmitOp(JSB_POP, -1);
+    iteratorLength = jsbc.length - iteratorStart;
+    if (iteratorLength > sizeof(iterator)) {
+      jsbFail();
+      return;
+    }
+    if (jsbc.ok) memcpy(iterator, &jsbc.code[iteratorStart], iteratorLength);
+    jsbc.length = iteratorStart;
+  }
+  jsbMatch(')');
+  // body
+  jsbcLoopStart(&oldBreak, &oldContinue);
+  jsbcBlockOrStatement();
+  unsigned int next = jsbc.length;
+  jsbEmitData(iterator, iteratorLength);
+  jsbEmitJumpTo(JSB_JMP, condition, 0);
+  if (exitJump) jsbPatchJump(exitJump, jsbc.length);
+  jsbcLoopEnd(oldBreak, oldContinue, jsbc.length, next);
+}
+
+static void jsbcIf() {
+  jslGetNextToken();
+  jsbMatch('(');
+  jsbcExpression();
+  jsbMatch(')');
+  uint16_t elseJump = jsbEmitJump(JSB_JMP_FALSE, -1);
+  jsbcBlockOrStatement();
+  if (jsbc.ok && lex->tk==LEX_R_ELSE) {
+    jslGetNextToken();
+    uint16_t endJump = jsbEmitJump(JSB_JMP, 0);
+    jsbPatchJump(elseJump, jsbc.length);
+    jsbcBlockOrStatement();
+    jsbPatchJump(endJump, jsbc.length);
+  } else {
+    jsbPatchJump(elseJump, jsbc.length);
+  }
+}
+
+static void jsbcBlock() {
+  jsbMatch('{');
+  while (jsbc.ok && lex->tk && lex->tk!='}')
+    jsbcStatement();
+  jsbMatch('}');
+}
+
+static void jsbcBlockOrStatement() {
+  if (lex->tk=='{') {
+    jsbcBlock();
+  } else {
+    jsbcStatement();
+    if (jsbc.ok && lex->tk==';') jslGetNextToken();
+  }
+}
+
+static void jsbcStatement() {
+  if (!jsbCheckStack()) return;
+  int tk = lex->tk;
+  if (tk!='{' && tk!=';') jsbEmitPosition();
+  if (tk==LEX_ID ||
+      tk==LEX_INT ||
+      tk==LEX_FLOAT ||
+      tk==LEX_STR ||
+      tk==LEX_R_NEW ||
+      tk==LEX_R_NULL ||
+      tk==LEX_R_UNDEFINED ||
+      tk==LEX_R_TRUE ||
+      tk==LEX_R_FALSE ||
+      tk==LEX_R_THIS ||
+      tk==LEX_R_TYPEOF ||
+      tk==LEX_R_VOID ||
+      tk==LEX_PLUSPLUS ||
+      tk==LEX_MINUSMINUS ||
+      tk=='!' ||
+      tk=='-' ||
+      tk=='+' ||
+      tk=='~' ||
+      tk=='[' ||
+      tk=='(') {
+    jsbcExpression();
+    jsbEmitOp(JSB_POP, -1);
+  } else if (tk=='{') {
+    jsbcBlock();
+  } else if (tk==';') {
+    jslGetNextToken();
+  } else if (tk==LEX_R_VAR || tk==LEX_R_LET || tk==LEX_R_CONST) {
+    jsbcVar();
+  } else if (tk==LEX_R_IF) {
+    jsbcIf();
+  } else if (tk==LEX_R_WHILE) {
+    jsbcWhile();
+  } else if (tk==LEX_R_DO) {
+    jsbcDoWhile();
+  } else if (tk==LEX_R_FOR) {
+    jsbcFor();
+  } else if (tk==LEX_R_RETURN && jsbc.isFunction) {
+    jslGetNextToken();
+    if (lex->tk!=';' && lex->tk!='}' && lex->tk!=LEX_EOF)
+      jsbcExpression();
+    else
+      jsbEmitOp(JSB_UNDEFINED, 1);
+    jsbEmitOp(JSB_RETURN, -1);
+  } else if (tk==LEX_R_THROW) {
+    jslGetNextToken();
+    jsbcExpression();
+    jsbEmitOp(JSB_THROW, -1);
+  } else if ((tk==LEX_R_BREAK || tk==LEX_R_CONTINUE) && jsbc.loopDepth>0) {
+    jslGetNextToken();
+    jsbEmitChainJump((tk==LEX_R_BREAK) ? &jsbc.breakChain : &jsbc.continueChain);
+  } else {
+    // anything else (function declarations, try, switch, etc) is left to the parser
+    jsbFail();
+  }
+  // Statements should always leave the stack empty
+  if (jsbc.stackDepth!=0) jsbFail();
+}
+
+/** Set up the compiler to write into the given buffer */
+static void jsbcInit(unsigned char *code, bool isFunction) {
+  jsbc.code = code;
+  jsbc.length = 0;
+  jsbc.stackDepth = 0;
+  jsbc.ok = true;
+  jsbc.isFunction = isFunction;
+  jsbc.loopDepth = 0;
+  jsbc.breakChain = 0;
+  jsbc.continueChain = 0;
+  jsbc.slotCount = 0;
+}
+
+/** Finish compiling and copy the bytecode into a flat string. Returns 0 if
+ * compilation failed or we're out of memory */
+static JsVar *jsbcKill() {
+  jsbEmitOp(JSB_END, 0);
+  if (!jsbc.ok) return 0;
+  JsVar *bytecode = jsvNewFlatStringOfLength(jsbc.length);
+  if (bytecode)
+    memcpy(jsvGetFlatStringPointer(bytecode), jsbc.code, jsbc.length);
+  return bytecode;
+}
+
+/// Can we use bytecode at the moment?
+static bool jsbIsEnabled() {
+  if (jsfGetFlag(JSF_NO_BYTECODE)) return false;
+#ifdef USE_DEBUGGER
+  // The debugger needs to step through source code
+  if (execInfo.execute & EXEC_DEBUGGER_MASK) return false;
+#endif
+  return true;
+}
+
+/** Compile the function's code, returning 0 if it couldn't be compiled */
+static JsVar *jsbCompileFunction(JsVar *function, JsVar *functionCode) {
+  unsigned char code[JSB_MAX_CODE_LENGTH];
+  JsLex newLex;
+  JsLex *oldLex = jslSetLex(&newLex);
+  jslInit(functionCode);
+  jsbcInit(code, true);
+  if (lex->tk==LEX_STR && !strcmp(jslGetTokenValueAsString(), "nobytecode")) {
+    jsbFail();
+  } else if (jsvIsFunctionReturn(function)) {
+    // implicit return - we just need an expression (optional)
+    jsbEmitPosition();
+    if (lex->tk != ';' && lex->tk != '}' && lex->tk != LEX_EOF)
+      jsbcExpression();
+    else
+      jsbEmitOp(JSB_UNDEFINED, 1);
+    jsbEmitOp(JSB_RETURN, -1);
+  } else {
+    while (jsbc.ok && lex->tk!=LEX_EOF)
+      jsbcStatement();
+  }
+  JsVar *bytecode = jsbcKill();
+  jslKill();
+  jslSetLex(oldLex);
+  return bytecode;
+}
+
+JsVar *jsbGetFunctionBytecode(JsVar *function, JsVar *functionCode) {
+  if (!jsbIsEnabled() || !jsvIsString(functionCode)) return 0;
+  JsVar *bytecode = jsvObjectGetChild(function, JSPARSE_FUNCTION_BYTECODE_NAME, 0);
+  if (!bytecode) {
+    // not compiled yet - make sure we have enough stack to do it
+    if (jsuGetFreeStack() < JSB_MAX_CODE_LENGTH+2048) return 0;
+    bytecode = jsbCompileFunction(function, functionCode);
+    if (bytecode) {
+      jsvObjectSetChild(function, JSPARSE_FUNCTION_BYTECODE_NAME, bytecode);
+    } else if (!jsvIsMemoryFull()) {
+      // couldn't compile - remember that so we don't try again
+      jsvObjectSetChildAndUnLock(function, JSPARSE_FUNCTION_BYTECODE_NAME, jsvNewFromBool(false));
+    }
+  }
+  if (!jsvIsFlatString(bytecode)) {
+    jsvUnLock(bytecode);
+    return 0;
+  }
+  return bytecode;
+}
+
+bool jsbExecuteLoop() {
+  if (!jsbIsEnabled() || jsuGetFreeStack() < JSB_MAX_CODE_LENGTH+2048)
+    return false;
+  unsigned char code[JSB_MAX_CODE_LENGTH];
+  JslCharPos loopStart = jslCharPosClone(&lex->tokenStart);
+  jsbcInit(code, false);
+  jsbcStatement();
+  JsVar *bytecode = jsbcKill();
+  if (!bytecode) {
+    // couldn't compile it - go back so the parser can handle it
+    jslSeekToP(&loopStart);
+    jslCharPosFree(&loopStart);
+    return false;
+  }
+  jslCharPosFree(&loopStart);
+  // We don't care about the result, and the lexer is already after the loop
+  size_t tokenLastStart = lex->tokenLastStart;
+  jsvUnLock(jsbExecute(bytecode));
+  lex->tokenLastStart = tokenLastStart;
+  jsvUnLock(bytecode);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+//                                                                    EXECUTING
+
+/// Get a member of an object - as with jspeFactorMember
+static JsVar *jsbGetMember(JsVar *aVar, JsVar *nameVar, const char *name) {
+  JsVar *child = 0;
+  if (aVar) // the name is stored in the bytecode, so its address identifies the site
+    child = name ? jspGetNamedFieldAtSite(aVar, name, (size_t)name) : jspGetVarNamedField(aVar, nameVar, true);
+  if (!child) {
+    if (jsvHasChildren(aVar)) {
+      // if no child found, create a pointer to where it could be
+      // as we don't want to allocate it until it's written
+      if (name) {
+        nameVar = jsvNewFromString(name);
+        child = jsvCreateNewChild(aVar, nameVar, 0);
+        jsvUnLock(nameVar);
+      } else
+        child = jsvCreateNewChild(aVar, nameVar, 0);
+    } else {
+      if (name)
+        jsExceptionHere(JSET_ERROR, "Field or method \"%s\" does not already exist, and can't create it on %t", name, aVar);
+      else
+        jsExceptionHere(JSET_ERROR, "Field or method %q does not already exist, and can't create it on %t", nameVar, aVar);
+    }
+  }
+  return child;
+}
+
+static int16_t jsbReadOffset(const unsigned char *p) {
+  return (int16_t)jsbRead16(p);
+}
+
+JsVar *jsbExecute(JsVar *bytecode) {
+  JsVar *stack[JSB_MAX_STACK];
+  int sp = 0;
+  // Where variables have been found - the scopes don't change while we're executing
+  JspVarSlots slots;
+  jspVarSlotsReset(&slots);
+  JsVar *result = 0;
+  const unsigned char *pc = (const unsigned char *)jsvGetFlatStringPointer(bytecode);
+
+  while (JSB_SHOULD_EXECUTE) {
+    JsbOpCode op = (JsbOpCode)*(pc++);
+    switch (op) {
+    case JSB_END:
+      goto finished;
+    case JSB_POS:
+      lex->tokenLastStart = jsbRead16(pc);
+      pc += 2;
+      break;
+    case JSB_POP:
+      jsvUnLock(stack[--sp]);
+      break;
+    case JSB_UNDEFINED:
+      stack[sp++] = 0;
+      break;
+    case JSB_NULL:
+      stack[sp++] = jsvNewWithFlags(JSV_NULL);
+      break;
+    case JSB_TRUE:
+    case JSB_FALSE:
+      stack[sp++] = jsvNewFromBool(op==JSB_TRUE);
+      break;
+    case JSB_INT8:
+      stack[sp++] = jsvNewFromInteger((int8_t)*(pc++));
+      break;
+    case JSB_INT32: {
+      int32_t i;
+      memcpy(&i, pc, sizeof(i));
+      pc += sizeof(i);
+      stack[sp++] = jsvNewFromInteger(i);
+      break;
+    }
+    case JSB_FLOAT: {
+      JsVarFloat f;
+      memcpy(&f, pc, sizeof(f));
+      pc += sizeof(f);
+      stack[sp++] = jsvNewFromFloat(f);
+      break;
+    }
+    case JSB_STRING: {
+      uint16_t len = jsbRead16(pc);
+      pc += 2;
+      stack[sp++] = jsvNewStringOfLength(len, (const char*)pc);
+      pc += len;
+      break;
+    }
+    case JSB_THIS:
+      stack[sp++] = jsvLockAgain(execInfo.thisVar ? execInfo.thisVar : execInfo.root);
+      break;
+    case JSB_ID: {
+      int slot = *(pc++);
+      const char *name = (const char*)pc;
+      pc += strlen(name)+1;
+      stack[sp++] = (slot==JSB_NO_SLOT) ? jspGetNamedVariable(name) : jspGetNamedVariableInSlot(name, &slots, slot);
+      break;
+    }
+    case JSB_VAR: {
+      const char *name = (const char*)pc;
+      pc += strlen(name)+1;
+      JsVar *a = jspeiFindOnTop(name, true);
+      if (!a) jspSetError(false); // out of memory
+      stack[sp++] = a;
+      break;
+    }
+    case JSB_FIELD:
+    case JSB_FIELD_KEEP: {
+      const char *name = (const char*)pc;
+      pc += strlen(name)+1;
+      JsVar *a = stack[--sp];
+      JsVar *aVar = jsvSkipName(a);
+      JsVar *child = jsbGetMember(aVar, 0, name);
+      jsvUnLock(a);
+      if (op==JSB_FIELD_KEEP) stack[sp++] = aVar;
+      else jsvUnLock(aVar);
+      stack[sp++] = child;
+      break;
+    }
+    case JSB_INDEX:
+    case JSB_INDEX_KEEP: {
+      JsVar *index = jsvAsArrayIndexAndUnLock(jsvSkipNameAndUnLock(stack[--sp]));
+      JsVar *a = stack[--sp];
+      JsVar *aVar = jsvSkipName(a);
+      JsVar *child = jsbGetMember(aVar, index, 0);
+      jsvUnLock2(a, index);
+      if (op==JSB_INDEX_KEEP) stack[sp++] = aVar;
+      else jsvUnLock(aVar);
+      stack[sp++] = child;
+      break;
+    }
+    case JSB_CALL:
+    case JSB_CALL_METHOD:
+    case JSB_NEW: {
+      int argCount = *(pc++);
+      JsVar **args = &stack[sp-argCount];
+      int i;
+      for (i=0;i<argCount;i++)
+        args[i] = jsvSkipNameAndUnLock(args[i]);
+      JsVar *funcName = stack[sp-argCount-1];
+      JsVar *parent = (op==JSB_CALL_METHOD) ? stack[sp-argCount-2] : 0;
+      JsVar *func = jsvSkipName(funcName);
+      JsVar *r;
+      if (op==JSB_NEW)
+        r = jspeConstruct(func, funcName, false, argCount, args);
+      else
+        r = jspeFunctionCall(func, funcName, parent, false, argCount, args);
+      jsvUnLockMany((unsigned)argCount, args);
+      jsvUnLock3(func, funcName, parent);
+      sp -= argCount + ((op==JSB_CALL_METHOD) ? 2 : 1);
+      stack[sp++] = r;
+      break;
+    }
+    case JSB_ASSIGN: {
+      int assignOp = *(pc++);
+      JsVar *rhs = jsvSkipNameAndUnLock(stack[--sp]);
+      JsVar *lhs = stack[sp-1];
+      if (lhs) jspAssign(lhs, assignOp, rhs);
+      jsvUnLock(rhs);
+      break;
+    }
+    case JSB_PREINC:
+    case JSB_POSTINC: {
+      int mathsOp = *(pc++);
+      JsVar *a = stack[sp-1];
+      JsVar *one = jsvNewFromInteger(1);
+      if (op==JSB_PREINC) {
+        JsVar *res = jsvMathsOpSkipNames(a, one, mathsOp);
+        jspReplaceWith(a, res);
+        jsvUnLock(res);
+      } else {
+        JsVar *oldValue = jsvAsNumberAndUnLock(jsvSkipName(a)); // keep the old value (but convert to number)
+        JsVar *res = jsvMathsOpSkipNames(oldValue, one, mathsOp);
+        jspReplaceWith(a, res);
+        jsvUnLock2(res, a);
+        stack[sp-1] = oldValue;
+      }
+      jsvUnLock(one);
+      break;
+    }
+    case JSB_BINARY: {
+      int mathsOp = *(pc++);
+      JsVar *b = stack[--sp];
+      JsVar *a = stack[sp-1];
+      stack[sp-1] = jsvMathsOpSkipNames(a, b, mathsOp);
+      jsvUnLock2(a, b);
+      break;
+    }
+    case JSB_NOT:
+      stack[sp-1] = jsvNewFromBool(!jsvGetBoolAndUnLock(jsvSkipNameAndUnLock(stack[sp-1])));
+      break;
+    case JSB_BITNOT:
+      stack[sp-1] = jsvNewFromInteger(~jsvGetIntegerAndUnLock(jsvSkipNameAndUnLock(stack[sp-1])));
+      break;
+    case JSB_NEGATE:
+      stack[sp-1] = jsvNegateAndUnLock(stack[sp-1]);
+      break;
+    case JSB_TONUMBER: {
+      JsVar *v = jsvSkipNameAndUnLock(stack[sp-1]);
+      stack[sp-1] = jsvAsNumber(v);
+      jsvUnLock(v);
+      break;
+    }
+    case JSB_TYPEOF: {
+      JsVar *a = stack[sp-1];
+      if (!jsvIsVariableDefined(a)) {
+        // so we don't get a ReferenceError when accessing an undefined var
+        stack[sp-1] = jsvNewFromString("undefined");
+      } else {
+        a = jsvSkipNameAndUnLock(a);
+        stack[sp-1] = jsvNewFromString(jsvGetTypeOf(a));
+      }
+      jsvUnLock(a);
+      break;
+    }
+    case JSB_JMP:
+      pc += jsbReadOffset(pc);
+      break;
+    case JSB_JMP_FALSE:
+    case JSB_JMP_TRUE: {
+      bool cond = jsvGetBoolAndUnLock(jsvSkipNameAndUnLock(stack[--sp]));
+      if (cond == (op==JSB_JMP_TRUE))
+        pc += jsbReadOffset(pc);
+      else
+        pc += 2;
+      break;
+    }
+    case JSB_AND:
+    case JSB_OR: {
+      bool cond = jsvGetBoolAndUnLock(jsvSkipName(stack[sp-1]));
+      if (cond == (op==JSB_OR)) {
+        pc += jsbReadOffset(pc);
+      } else {
+        jsvUnLock(stack[--sp]);
+        pc += 2;
+      }
+      break;
+    }
+    case JSB_RETURN:
+      result = jsvSkipNameAndUnLock(stack[--sp]);
+      goto finished;
+    case JSB_THROW: {
+      JsVar *v = jsvSkipNameAndUnLock(stack[--sp]);
+      jspSetException(v);
+      jsvUnLock(v);
+      break;
+    }
+    case JSB_ARRAY:
+      stack[sp++] = jsvNewEmptyArray();
+      break;
+    case JSB_ELEMENT: {
+      JsVar *v = jsvSkipNameAndUnLock(stack[--sp]);
+      if (stack[sp-1]) jsvArrayPush(stack[sp-1], v);
+      jsvUnLock(v);
+      break;
+    }
+    case JSB_OBJECT:
+      stack[sp++] = jsvNewObject();
+      break;
+    case JSB_PROPERTY: {
+      const char *name = (const char*)pc;
+      pc += strlen(name)+1;
+      JsVar *v = jsvSkipNameAndUnLock(stack[--sp]);
+      JsVar *obj = stack[sp-1];
+      JsVar *nameVar = jsvAsArrayIndexAndUnLock(jsvNewFromString(name));
+      JsVar *child = (obj && nameVar) ? jsvFindChildFromVar(obj, nameVar, true) : 0;
+      if (child) jsvUnLock(jsvSetValueOfName(child, v));
+      jsvUnLock2(nameVar, v);
+      break;
+    }
+    default:
+      assert(0);
+      jsExceptionHere(JSET_INTERNALERROR, "Unknown bytecode %d", op);
+      break;
+    }
+  }
+finished:
+  // unlock anything left on the stack (if we returned early or had an error)
+  jsvUnLockMany((unsigned)sp, stack);
+  return result;
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2018 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Bytecode compiler and interpreter for function bodies and loops
+ *
+ * Rather than re-lexing a function's code every time it is called, the
+ * first call compiles it to a compact stack-based bytecode which is stored
+ * alongside the function (as JSPARSE_FUNCTION_BYTECODE_NAME). If the code
+ * uses anything the compiler doesn't understand, compilation fails and the
+ * function is executed with the normal recursive descent parser.
+ * ----------------------------------------------------------------------------
+ */
+#ifndef JSBYTECODE_H_
+#define JSBYTECODE_H_
+
+#include "jsutils.h"
+#include "jsvar.h"
+
+/// Maximum size in bytes of the bytecode for a single function/loop
+#ifndef JSB_MAX_CODE_LENGTH
+#define JSB_MAX_CODE_LENGTH 2048
+#endif
+/// Maximum depth of the interpreter's value stack
+#define JSB_MAX_STACK 32
+
+/** Return the bytecode for the given function, compiling it from functionCode
+ * and caching it on the function if it hasn't been compiled before. Returns 0
+ * if the function can't be compiled and should be executed by the parser. */
+JsVar *jsbGetFunctionBytecode(JsVar *function, JsVar *functionCode);
+
+/** Execute the given bytecode in the current scope, returning whatever
+ * was returned with `return` (or 0) */
+JsVar *jsbExecute(JsVar *bytecode);
+
+/** If the lexer is at the start of a `for`, `while` or `do` loop, try and
+ * compile the loop to bytecode and execute it. Returns true if the loop was
+ * executed (and the lexer is now after it), or false if the loop couldn't be
+ * compiled (in which case the lexer is unchanged) */
+bool jsbExecuteLoop();
+
+#endif /* JSBYTECODE_H_ */
@@ -39,6 +39,18 @@
   #define DECOMPRESS rle_decode
 #endif
 
+/* How many files we can keep in the in-RAM index. If there are more than this
+ * we still use the index, but have to look in flash for any file not in it. */
+#ifndef JSF_INDEX_SIZE
+#if defined(LINUX)
+#define JSF_INDEX_SIZE 1024
+#elif RAM_TOTAL>=(128*1024)
+#define JSF_INDEX_SIZE 64
+#else
+#define JSF_INDEX_SIZE 0
+#endif
+#endif
+
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------------------------------
 // ------------------------------------------------------------------------ Flash Storage Functionality
@@ -46,6 +58,30 @@
 // ------------------------------------------------------------------------------------------------
 
 static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flags, uint32_t startAddr, JsfFileHeader *returnedHeader);
+static void jsfIndexRemove(uint32_t addr);
+
+/// A live file in the index
+typedef struct {
+  JsfFileName name;
+  uint32_t addr; ///< address of data start, NOT header
+} JsfIndexEntry;
+
+typedef enum {
+  JSFI_NONE,     ///< not built yet - everything must come from flash
+  JSFI_COMPLETE, ///< every live file is in the index
+  JSFI_PARTIAL,  ///< too many files - files not in the index must be looked for in flash
+} JsfIndexState;
+
+/* Index of live files, so we don't have to walk every header in flash to find
+ * one. It's built the first time it's needed and kept up to date by
+ * jsfCreateFile/jsfEraseFileInternal. Erasing pages throws it away. */
+static JsfIndexState jsfIndexState = JSFI_NONE;
+/// Address just after the last file in flash (where a new file will usually go)
+static uint32_t jsfIndexEnd;
+#if JSF_INDEX_SIZE>0
+static JsfIndexEntry jsfIndex[JSF_INDEX_SIZE]; ///< sorted by address, like the files in flash
+static unsigned int jsfIndexCount;
+#endif
 
 /// Aligns a block, pushing it along in memory until it reaches the required alignment
 static uint32_t jsfAlignAddress(uint32_t addr) {
@@ -90,12 +126,15 @@ static bool jsfGetFileHeader(uint32_t addr, JsfFileHeader *header) {
 static bool jsfIsErased(uint32_t addr, uint32_t len) {
   uint32_t x;
   /* Read whole blocks at the alignment size and check
-   * everything (even slightly past the length) */
-  unsigned char buf[JSF_ALIGNMENT];
-  for (x=0;x<len;x+=JSF_ALIGNMENT) {
-    jshFlashRead(&buf, addr+x, JSF_ALIGNMENT);
-    int i;
-    for (i=0;i<JSF_ALIGNMENT;i++)
+   * everything (even slightly past the length). Read a few
+   * at once as each flash read can be slow (eg. external flash) */
+  unsigned char buf[JSF_ALIGNMENT*8];
+  for (x=0;x<len;x+=(uint32_t)sizeof(buf)) {
+    uint32_t l = jsfAlignAddress(len-x);
+    if (l>sizeof(buf)) l=(uint32_t)sizeof(buf);
+    jshFlashRead(&buf, addr+x, l);
+    uint32_t i;
+    for (i=0;i<l;i++)
       if (buf[i]!=0xFF) return false;
   }
   return true;
@@ -117,6 +156,7 @@ static bool jsfIsEqual(uint32_t addr, const unsigned char *data, uint32_t len) {
 /// Erase the entire contents of the memory store
 static bool jsfEraseFrom(uint32_t startAddr) {
   uint32_t addr, len;
+  jsfResetIndex();
   if (!jshFlashGetPage(startAddr, &addr, &len))
     return false;
   while (addr<JSF_END_ADDRESS) {
@@ -137,6 +177,7 @@ bool jsfEraseAll() {
 /// When a file is found in memory, erase it (by setting replacement to 0). addr=ptr to data, NOT header
 static void jsfEraseFileInternal(uint32_t addr, JsfFileHeader *header) {
   DBG("EraseFile 0x%08x\n", addr);
+  jsfIndexRemove(addr);
 
   addr -= (uint32_t)sizeof(JsfFileHeader);
   addr += (uint32_t)((char*)&header->replacement - (char*)header);
@@ -164,6 +205,9 @@ static uint32_t jsfGetAddressOfNextPage(uint32_t addr) {
 /* Get the space left for a file (including header) between the address and the next page.
  * If the next page is empty, return the space in that as well (and so on) */
 static uint32_t jsfGetSpaceLeftInPage(uint32_t addr) {
+  // nothing comes after the last file, so there's no need to look for the next one
+  if (jsfIndexState!=JSFI_NONE && addr==jsfIndexEnd)
+    return JSF_END_ADDRESS - addr;
   uint32_t pageAddr,pageLen;
   if (!jshFlashGetPage(addr, &pageAddr, &pageLen))
     return 0;
@@ -210,6 +254,89 @@ static bool jsfGetNextFileHeader(uint32_t *addr, JsfFileHeader *header, jsfGetNe
   return valid;
 }
 
+// ------------------------------------------------------------------------ File index
+
+/// Forget the index of files (it'll be rebuilt from flash next time it's needed)
+void jsfResetIndex() {
+  jsfIndexState = JSFI_NONE;
+}
+
+/// Return the data address of a file in the index, or 0 if it isn't in it
+static uint32_t jsfIndexFind(JsfFileName name) {
+#if JSF_INDEX_SIZE>0
+  unsigned int i;
+  for (i=0;i<jsfIndexCount;i++)
+    if (jsfIndex[i].name == name)
+      return jsfIndex[i].addr;
+#else
+  NOT_USED(name);
+#endif
+  return 0;
+}
+
+/// Add a newly found/created file to the index. addr=ptr to data, NOT header
+static void jsfIndexAdd(JsfFileName name, uint32_t addr, uint32_t size) {
+  uint32_t endAddr = jsfAlignAddress(addr + size);
+  if (endAddr > jsfIndexEnd) jsfIndexEnd = endAddr;
+#if JSF_INDEX_SIZE>0
+  if (jsfIndexCount >= JSF_INDEX_SIZE) {
+    jsfIndexState = JSFI_PARTIAL;
+    return;
+  }
+  unsigned int i = jsfIndexCount++;
+  while (i>0 && jsfIndex[i-1].addr > addr) {
+    jsfIndex[i] = jsfIndex[i-1];
+    i--;
+  }
+  jsfIndex[i].name = name;
+  jsfIndex[i].addr = addr;
+#else
+  NOT_USED(name);
+  jsfIndexState = JSFI_PARTIAL;
+#endif
+}
+
+/// Remove an erased file from the index. addr=ptr to data, NOT header
+static void jsfIndexRemove(uint32_t addr) {
+#if JSF_INDEX_SIZE>0
+  if (jsfIndexState == JSFI_NONE) return;
+  unsigned int i;
+  for (i=0;i<jsfIndexCount;i++) {
+    if (jsfIndex[i].addr == addr) {
+      jsfIndexCount--;
+      memmove(&jsfIndex[i], &jsfIndex[i+1], (jsfIndexCount-i)*sizeof(JsfIndexEntry));
+      return;
+    }
+  }
+#else
+  NOT_USED(addr);
+#endif
+}
+
+/// Build the index from the headers in flash if we don't have it already
+static void jsfIndexInit() {
+  if (jsfIndexState != JSFI_NONE) return;
+  DBG("Building index\n");
+  jsfIndexState = JSFI_COMPLETE;
+  jsfIndexEnd = JSF_START_ADDRESS;
+#if JSF_INDEX_SIZE>0
+  jsfIndexCount = 0;
+#endif
+  uint32_t addr = JSF_START_ADDRESS;
+  JsfFileHeader header;
+  memset(&header,0,sizeof(JsfFileHeader));
+  if (jsfGetFileHeader(addr, &header)) do {
+    uint32_t dataAddr = addr+(uint32_t)sizeof(JsfFileHeader);
+    if (header.replacement == JSF_WORD_UNSET && // if not replaced
+        !jsfIndexFind(header.name)) { // the first live file with a name is the one we use
+      jsfIndexAdd(header.name, dataAddr, jsfGetFileSize(&header));
+    } else {
+      uint32_t endAddr = jsfAlignAddress(dataAddr + jsfGetFileSize(&header));
+      if (endAddr > jsfIndexEnd) jsfIndexEnd = endAddr;
+    }
+  } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL));
+}
+
 // Get the address of the page that starts with a header (or is clear) after the current one, or 0
 static uint32_t jsfGetAddressOfNextStartPage(uint32_t addr) {
   uint32_t next = jsfGetAddressOfNextPage(addr);
@@ -353,23 +480,24 @@ static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flag
   bool compacted = false;
   uint32_t addr = 0;
   JsfFileHeader header;
+  // do we have an existing file? Erase it.
+  uint32_t existingAddr = jsfFindFile(name, &header);
+  if (existingAddr)
+    jsfEraseFileInternal(existingAddr, &header);
   while (!addr) {
-    addr = startAddr;
-    uint32_t existingAddr = 0;
-    // Find a hole that's big enough for our file
-    do {
-      if (addr!=startAddr) addr = jsfGetAddressOfNextPage(addr);
-      if (jsfGetFileHeader(addr, &header)) do {
-        // check for something with the same name
-        if (header.replacement == JSF_WORD_UNSET &&
-            header.name == name)
-          existingAddr = addr;
-      } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_EMPTY));
-    } while (addr && (jsfGetSpaceLeftInPage(addr)<requiredSize));
-    // do we have an existing file? Erase it.
-    if (existingAddr) {
-      jsfGetFileHeader(existingAddr, &header);
-      jsfEraseFileInternal(existingAddr+(uint32_t)sizeof(JsfFileHeader), &header);
+    jsfIndexInit(); // compaction throws the index away
+    // New files usually go after the last one, so try there first
+    if (jsfIndexEnd>=startAddr &&
+        jsfGetSpaceLeftInPage(jsfIndexEnd)>=requiredSize) {
+      addr = jsfIndexEnd;
+    } else {
+      addr = startAddr;
+      // Find a hole that's big enough for our file
+      do {
+        if (addr!=startAddr) addr = jsfGetAddressOfNextPage(addr);
+        if (jsfGetFileHeader(addr, &header))
+          while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_EMPTY));
+      } while (addr && (jsfGetSpaceLeftInPage(addr)<requiredSize));
     }
     // If we don't have space, compact
     if ((!addr) || (jsfGetSpaceLeftInPage(addr)<size)) {
@@ -407,13 +535,23 @@ static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flag
   DBG("CreateFile write header\n");
   jshFlashWrite(&header,addr,(uint32_t)sizeof(JsfFileHeader));
   DBG("CreateFile written header\n");
+  jsfIndexAdd(name, addr+(uint32_t)sizeof(JsfFileHeader), size);
   if (returnedHeader) *returnedHeader = header;
   return addr+(uint32_t)sizeof(JsfFileHeader);
 }
 
 /// Find a 'file' in the memory store. Return the address of data start (and header if returnedHeader!=0). Returns 0 if not found
 uint32_t jsfFindFile(JsfFileName name, JsfFileHeader *returnedHeader) {
-  uint32_t addr = JSF_START_ADDRESS;
+  jsfIndexInit();
+  uint32_t addr = jsfIndexFind(name);
+  if (addr) {
+    if (returnedHeader)
+      jsfGetFileHeader(addr-(uint32_t)sizeof(JsfFileHeader), returnedHeader);
+    return addr;
+  }
+  if (jsfIndexState == JSFI_COMPLETE)
+    return 0; // every file is in the index, so it doesn't exist
+  addr = JSF_START_ADDRESS;
   JsfFileHeader header;
   memset(&header,0,sizeof(JsfFileHeader));
   if (jsfGetFileHeader(addr, &header)) do {
@@ -566,13 +704,24 @@ JsVar *jsfListFiles() {
   if (!files) return 0;
 
   char nameBuf[sizeof(JsfFileName)+1];
+  nameBuf[sizeof(JsfFileName)]=0;
+  jsfIndexInit();
+#if JSF_INDEX_SIZE>0
+  if (jsfIndexState == JSFI_COMPLETE) {
+    unsigned int i;
+    for (i=0;i<jsfIndexCount;i++) {
+      memcpy(nameBuf, &jsfIndex[i].name, sizeof(JsfFileName));
+      jsvArrayPushAndUnLock(files, jsvNewFromString(nameBuf));
+    }
+    return files;
+  }
+#endif
   uint32_t addr = JSF_START_ADDRESS;
   JsfFileHeader header;
   memset(&header,0,sizeof(JsfFileHeader));
   if (jsfGetFileHeader(addr, &header)) do {
     if (header.replacement == JSF_WORD_UNSET) { // if not replaced
       memcpy(nameBuf, &header.name, sizeof(JsfFileName));
-      nameBuf[sizeof(JsfFileName)]=0;
       jsvArrayPushAndUnLock(files, jsvNewFromString(nameBuf));
     }
   } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL));
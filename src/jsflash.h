@@ -64,6 +64,8 @@ bool jsfCompact();
 JsVar *jsfListFiles();
 /// Output debug info for files stored in flash storage
 void jsfDebugFiles();
+/// Forget the in-RAM index of files - call this if flash storage was changed other than with these functions
+void jsfResetIndex();
 
 // ------------------------------------------------------------------------ For loading/saving code to flash
 /// Save contents of JsVars into Flash.
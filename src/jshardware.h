@@ -56,6 +56,12 @@ bool jshSleep(JsSysTime timeUntilWake);
  * where GPIO that have been exported may need unexporting, and so on. */
 void jshKill();
 
+#ifdef LINUX
+/** Make jshSleep return as soon as the given file descriptor becomes
+ * readable (or stop doing so if wake=false) */
+void jshSetWakeOnFd(int fd, bool wake);
+#endif
+
 /** Get this IC's serial number. Passed max # of chars and a pointer to write to.
  * Returns # of chars of non-null-terminated string.
  *
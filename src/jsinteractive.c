@@ -88,6 +88,317 @@ JsErrorFlags lastJsErrorFlags = 0; ///< Compare with jsErrorFlags in order to re
 void jsiDebuggerLine(JsVar *line);
 #endif
 
+/* Timers are kept in timerArray (so they can be saved, listed and found by
+ * id), and each timer's "time" is the value of jshGetSystemTime() at which it
+ * should next run. So that jsiIdle doesn't have to look at every timer, we
+ * also keep a binary min-heap of JsiTimerQueueEntry ordered by time. As there
+ * could be a lot of timers, the heap is split into pages of
+ * JSI_TIMER_QUEUE_PAGE_SIZE entries (so we don't need lots of contiguous free
+ * memory), which are flat strings referenced from timerQueuePages. The pages
+ * and each timer's name are kept locked while they're in the queue, so they are
+ * never freed by GC or moved by jsvDefragment. If a timer gets removed from
+ * timerArray without being removed from the queue, its name has no references
+ * and it is just dropped when it gets to the front of the queue. */
+
+#define JSI_TIMER_QUEUE_PAGE_SHIFT 6
+#define JSI_TIMER_QUEUE_PAGE_SIZE (1<<JSI_TIMER_QUEUE_PAGE_SHIFT)
+
+typedef struct {
+  JsSysTime time;     ///< When the timer should next run
+  unsigned int order; ///< Used to run timers with the same time in the order they were added
+  JsVarRef name;      ///< The timer's name (its id) in timerArray - locked
+} PACKED_FLAGS JsiTimerQueueEntry;
+
+static JsVar *timerQueuePages = 0; ///< Flat string of JsVarRefs to each page of the queue
+static unsigned int timerQueuePageCount = 0; ///< Number of pages allocated
+static unsigned int timerQueueCount = 0; ///< Number of timers in the queue
+static unsigned int timerQueueOrder = 0; ///< The 'order' that the next entry will be given
+
+static JsSysTime jsiTimerGetTime(JsVar *timer) {
+  return (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timer, "time", 0));
+}
+
+/// Get entry i of the queue
+static JsiTimerQueueEntry *jsiTimerQueueGet(unsigned int i) {
+  JsVarRef page = ((JsVarRef*)jsvGetFlatStringPointer(timerQueuePages))[i>>JSI_TIMER_QUEUE_PAGE_SHIFT];
+  return ((JsiTimerQueueEntry*)jsvGetFlatStringPointer(_jsvGetAddressOf(page))) + (i&(JSI_TIMER_QUEUE_PAGE_SIZE-1));
+}
+
+/// Should a run before b?
+static bool jsiTimerQueueBefore(const JsiTimerQueueEntry *a, const JsiTimerQueueEntry *b) {
+  if (a->time != b->time) return a->time < b->time;
+  return (int)(a->order - b->order) < 0;
+}
+
+/// Move the entry at i towards the top of the heap until it's in the right place
+static void jsiTimerQueueSiftUp(unsigned int i) {
+  JsiTimerQueueEntry e = *jsiTimerQueueGet(i);
+  while (i) {
+    unsigned int parent = (i-1)>>1;
+    JsiTimerQueueEntry *p = jsiTimerQueueGet(parent);
+    if (!jsiTimerQueueBefore(&e, p)) break;
+    *jsiTimerQueueGet(i) = *p;
+    i = parent;
+  }
+  *jsiTimerQueueGet(i) = e;
+}
+
+/// Move the entry at i towards the bottom of the heap until it's in the right place
+static void jsiTimerQueueSiftDown(unsigned int i) {
+  JsiTimerQueueEntry e = *jsiTimerQueueGet(i);
+  while (true) {
+    unsigned int child = i*2+1;
+    if (child >= timerQueueCount) break;
+    JsiTimerQueueEntry *c = jsiTimerQueueGet(child);
+    if (child+1 < timerQueueCount) {
+      JsiTimerQueueEntry *c2 = jsiTimerQueueGet(child+1);
+      if (jsiTimerQueueBefore(c2, c)) {
+        c = c2;
+        child++;
+      }
+    }
+    if (!jsiTimerQueueBefore(c, &e)) break;
+    *jsiTimerQueueGet(i) = *c;
+    i = child;
+  }
+  *jsiTimerQueueGet(i) = e;
+}
+
+/// Free all memory used by the queue
+static void jsiTimerQueueFree() {
+  unsigned int i;
+  for (i=0;i<timerQueueCount;i++)
+    jsvUnLock(_jsvGetAddressOf(jsiTimerQueueGet(i)->name));
+  for (i=0;i<timerQueuePageCount;i++)
+    jsvUnLock(_jsvGetAddressOf(((JsVarRef*)jsvGetFlatStringPointer(timerQueuePages))[i]));
+  jsvUnLock(timerQueuePages);
+  timerQueuePages = 0;
+  timerQueuePageCount = 0;
+  timerQueueCount = 0;
+}
+
+/// Add a timer (the name of it in timerArray) to the queue. Returns false if out of memory
+static bool jsiTimerQueueAdd(JsVar *timerName, JsSysTime time) {
+  if (timerQueueCount >= timerQueuePageCount*JSI_TIMER_QUEUE_PAGE_SIZE) {
+    // we need another page
+    unsigned int maxPages = timerQueuePages ? (unsigned int)(jsvGetCharactersInVar(timerQueuePages)/sizeof(JsVarRef)) : 0;
+    if (timerQueuePageCount >= maxPages) {
+      JsVar *pages = jsvNewFlatStringOfLength((unsigned int)(sizeof(JsVarRef)*(maxPages ? maxPages*2 : 4)));
+      if (!pages) return false;
+      if (timerQueuePages) {
+        memcpy(jsvGetFlatStringPointer(pages), jsvGetFlatStringPointer(timerQueuePages), sizeof(JsVarRef)*timerQueuePageCount);
+        jsvUnLock(timerQueuePages);
+      }
+      timerQueuePages = pages;
+    }
+    JsVar *page = jsvNewFlatStringOfLength((unsigned int)(sizeof(JsiTimerQueueEntry)*JSI_TIMER_QUEUE_PAGE_SIZE));
+    if (!page) return false;
+    ((JsVarRef*)jsvGetFlatStringPointer(timerQueuePages))[timerQueuePageCount++] = jsvGetRef(page); // keep locked
+  }
+  JsiTimerQueueEntry *e = jsiTimerQueueGet(timerQueueCount);
+  e->time = time;
+  e->order = timerQueueOrder++;
+  e->name = jsvGetRef(jsvLockAgain(timerName));
+  jsiTimerQueueSiftUp(timerQueueCount++);
+  return true;
+}
+
+/// Remove entry i from the queue
+static void jsiTimerQueueRemoveAt(unsigned int i) {
+  jsvUnLock(_jsvGetAddressOf(jsiTimerQueueGet(i)->name));
+  timerQueueCount--;
+  if (i < timerQueueCount) {
+    *jsiTimerQueueGet(i) = *jsiTimerQueueGet(timerQueueCount);
+    jsiTimerQueueSiftUp(i);
+    jsiTimerQueueSiftDown(i);
+  }
+  if (!timerQueueCount) jsiTimerQueueFree();
+}
+
+/// Find the entry in the queue for the given timer object - or -1
+static int jsiTimerQueueFind(JsVar *timer) {
+  JsVarRef ref = jsvGetRef(timer);
+  unsigned int i;
+  for (i=0;i<timerQueueCount;i++)
+    if (jsvGetFirstChild(_jsvGetAddressOf(jsiTimerQueueGet(i)->name)) == ref)
+      return (int)i;
+  return -1;
+}
+
+/** If the first timer in the queue should have run by 'time' and was added
+ * before 'order', remove it from the queue and return its name in timerArray
+ * (and the time it should have run in timerTime). Otherwise return 0. */
+static JsVar *jsiTimerQueuePop(JsSysTime time, unsigned int order, JsSysTime *timerTime) {
+  while (timerQueueCount) {
+    JsiTimerQueueEntry *e = jsiTimerQueueGet(0);
+    if (e->time > time || (int)(e->order - order) >= 0) return 0;
+    JsVar *timerName = _jsvGetAddressOf(e->name); // already locked by the queue
+    *timerTime = e->time;
+    timerQueueCount--;
+    if (timerQueueCount) {
+      *e = *jsiTimerQueueGet(timerQueueCount);
+      jsiTimerQueueSiftDown(0);
+    }
+    if (jsvGetRefs(timerName)) return timerName;
+    jsvUnLock(timerName); // removed from timerArray already
+  }
+  return 0;
+}
+
+/// How long until the first timer in the queue should run. Returns false if there are no timers
+static bool jsiTimerQueueGetTimeUntilNext(JsSysTime *timeUntilNext) {
+  if (!timerQueueCount) return false;
+  JsSysTime t = jsiTimerQueueGet(0)->time - jsiLastIdleTime;
+  *timeUntilNext = t>0 ? t : 0;
+  return true;
+}
+
+void jsiTimersRebuildQueue() {
+  jsiTimerQueueFree();
+  if (!timerArray) return;
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *timerName = jsvObjectIteratorGetKey(&it);
+    JsVar *timer = jsvSkipName(timerName);
+    if (!jsiTimerQueueAdd(timerName, jsiTimerGetTime(timer)))
+      jsError("Not enough memory to schedule timers");
+    jsvUnLock2(timer, timerName);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(timerArrayPtr);
+}
+
+void jsiTimersAdjust(JsSysTime diff) {
+  if (!timerArray) return;
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *timer = jsvObjectIteratorGetValue(&it);
+    jsvObjectSetChildAndUnLock(timer, "time", jsvNewFromLongInteger(jsiTimerGetTime(timer) + diff));
+    jsvUnLock(timer);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(timerArrayPtr);
+  // this doesn't change the order of the queue
+  unsigned int i;
+  for (i=0;i<timerQueueCount;i++)
+    jsiTimerQueueGet(i)->time += diff;
+}
+
+/* For speed, when we get a pin event we look the watches up in watchTable, a
+ * flat string of JsiWatchEntry sorted by EXTI channel, rather than searching
+ * watchArray (which is still what's used for ids, dump() and saving). It's
+ * rebuilt from watchArray the next time an event arrives after anything
+ * changes. The names and callbacks it refers to are kept locked, so when
+ * anything changes the old table is freed at the end of that idle pass - it
+ * can't be freed straight away as a watch's callback may have changed things
+ * while we're going through the table. */
+
+typedef struct {
+  JsVarRef name;     ///< The watch's name (its id) in watchArray - locked
+  JsVarRef callback; ///< The watch's callback - locked
+  JsVarInt debounce; ///< Debounce time (from jshGetTimeFromMilliseconds), or 0
+  Pin pin;
+  signed char edge;  ///< 1 = rising, -1 = falling, 0 = both
+  bool recur;
+} PACKED_FLAGS JsiWatchEntry;
+
+static JsVar *watchTable = 0; ///< Flat string of JsiWatchEntry, sorted by EXTI channel
+static uint16_t watchTableStart[EXTI_COUNT+1]; ///< Index in watchTable of the first watch for each EXTI channel
+static bool watchTableChanged = true; ///< watchArray has changed since watchTable was built
+
+/// Get the EXTI channel (0..EXTI_COUNT-1) that events for this pin will arrive on, or -1
+static int jsiGetWatchChannel(Pin pin) {
+  IOEvent event;
+  int i;
+  for (i=0;i<EXTI_COUNT;i++) {
+    event.flags = (IOEventFlags)(EV_EXTI0+i);
+    if (jshIsEventForPin(&event, pin)) return i;
+  }
+  return -1;
+}
+
+static void jsiWatchTableFree() {
+  if (watchTable) {
+    JsiWatchEntry *watches = (JsiWatchEntry*)jsvGetFlatStringPointer(watchTable);
+    unsigned int i;
+    for (i=0;i<watchTableStart[EXTI_COUNT];i++) {
+      jsvUnLock(_jsvGetAddressOf(watches[i].name));
+      if (watches[i].callback) jsvUnLock(_jsvGetAddressOf(watches[i].callback));
+    }
+    jsvUnLock(watchTable);
+    watchTable = 0;
+  }
+  memset(watchTableStart, 0, sizeof(watchTableStart));
+}
+
+static void jsiWatchTableRebuild() {
+  jsiWatchTableFree();
+  watchTableChanged = false;
+  if (!watchArray) return;
+  JsVar *watchArrayPtr = jsvLock(watchArray);
+  // count how many watches there are for each channel
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, watchArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *watchPtr = jsvObjectIteratorGetValue(&it);
+    int channel = jsiGetWatchChannel(jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0)));
+    if (channel>=0) watchTableStart[channel+1]++;
+    jsvUnLock(watchPtr);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  int i;
+  for (i=0;i<EXTI_COUNT;i++)
+    watchTableStart[i+1] = (uint16_t)(watchTableStart[i+1] + watchTableStart[i]);
+  if (watchTableStart[EXTI_COUNT]) {
+    watchTable = jsvNewFlatStringOfLength((unsigned int)(sizeof(JsiWatchEntry)*watchTableStart[EXTI_COUNT]));
+    if (!watchTable) {
+      jsError("Not enough memory to handle watches");
+      watchTableChanged = true; // try again next time
+    }
+  }
+  if (!watchTable) {
+    memset(watchTableStart, 0, sizeof(watchTableStart));
+    jsvUnLock(watchArrayPtr);
+    return;
+  }
+  // now fill in the table
+  JsiWatchEntry *watches = (JsiWatchEntry*)jsvGetFlatStringPointer(watchTable);
+  uint16_t next[EXTI_COUNT];
+  memcpy(next, watchTableStart, sizeof(next));
+  jsvObjectIteratorNew(&it, watchArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *watchName = jsvObjectIteratorGetKey(&it);
+    JsVar *watchPtr = jsvSkipName(watchName);
+    Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
+    int channel = jsiGetWatchChannel(pin);
+    if (channel>=0) {
+      JsiWatchEntry *w = &watches[next[channel]++];
+      w->name = jsvGetRef(jsvLockAgain(watchName)); // keep locked
+      JsVar *callback = jsvObjectGetChild(watchPtr, "callback", 0);
+      w->callback = callback ? jsvGetRef(callback) : 0; // keep locked
+      w->debounce = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
+      w->pin = pin;
+      w->edge = (signed char)jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "edge", 0));
+      w->recur = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr, "recur", 0));
+    }
+    jsvUnLock2(watchPtr, watchName);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(watchArrayPtr);
+}
+
+void jsiWatchesChanged() {
+  watchTableChanged = true;
+}
+
 // ----------------------------------------------------------------------------
 
 /**
@@ -459,6 +770,9 @@ void jsiSoftInit(bool hasBeenReset) {
   // when adding an interval from onInit (called below)
   jsiLastIdleTime = jshGetSystemTime();
   jsiTimeSinceCtrlC = 0xFFFFFFFF;
+  // Saved timers have times relative to when they were saved - make them absolute again
+  jsiTimersAdjust(jsiLastIdleTime);
+  jsiTimersRebuildQueue();
 
   // Set up interpreter flags and remove
   JsVar *flags = jsvObjectGetChild(execInfo.hiddenRoot, JSI_JSFLAGS_NAME, 0);
@@ -531,6 +845,7 @@ void jsiDumpJSON(vcbprintf_callback user_callback, void *user_data, JsVar *data,
     // if it doesn't, print JSON
     jsfGetJSONWithCallback(data, JSON_SOME_NEWLINES | JSON_PRETTY | JSON_SHOW_DEVICES, 0, user_callback, user_data);
   }
+  jsvUnLock(name);
 }
 
 NO_INLINE static void jsiDumpEvent(vcbprintf_callback user_callback, void *user_data, JsVar *parentName, JsVar *eventKeyName, JsVar *eventFn) {
@@ -732,9 +1047,14 @@ void jsiSoftKill() {
     events=0;
   }
   if (timerArray) {
+    // Store timer times relative to now, so they can be saved
+    jsiTimerQueueFree();
+    jsiTimersAdjust(-jsiLastIdleTime);
     jsvUnRefRef(timerArray);
     timerArray=0;
   }
+  jsiWatchTableFree();
+  watchTableChanged = true;
   if (watchArray) {
     // Check any existing watches and disable interrupts for them
     JsVar *watchArrayPtr = jsvLock(watchArray);
@@ -1862,16 +2182,18 @@ void jsiIdle() {
 #endif
     } else if (DEVICE_IS_EXTI(eventType)) { // ---------------------------------------------------------------- PIN WATCH
       // we have an event... find out what it was for...
-      // Check everything in our Watch array
+      // Check the watches in our table for this EXTI channel
+      if (watchTableChanged) jsiWatchTableRebuild();
       JsVar *watchArrayPtr = jsvLock(watchArray);
-      JsvObjectIterator it;
-      jsvObjectIteratorNew(&it, watchArrayPtr);
-      while (jsvObjectIteratorHasValue(&it)) {
-        bool hasDeletedWatch = false;
-        JsVar *watchPtr = jsvObjectIteratorGetValue(&it);
-        Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
-
-        if (jshIsEventForPin(&event, pin)) {
+      unsigned int channel = (unsigned int)(eventType - EV_EXTI0);
+      unsigned int watchIdx;
+      for (watchIdx = watchTableStart[channel]; watchTable && watchIdx < watchTableStart[channel+1]; watchIdx++) {
+        JsiWatchEntry watch = ((JsiWatchEntry*)jsvGetFlatStringPointer(watchTable))[watchIdx];
+        JsVar *watchName = _jsvGetAddressOf(watch.name); // locked by watchTable
+        JsVar *watchPtr = jsvSkipName(watchName);
+        Pin pin = watch.pin;
+
+        if (jsvGetRefs(watchName)) { // if 0, it was removed from watchArray
           /** Work out event time. Events time is only stored in 32 bits, so we need to
            * use the correct 'high' 32 bits from the current time.
            *
@@ -1890,7 +2212,7 @@ void jsiIdle() {
           bool pinIsHigh = (event.flags&EV_EXTI_IS_HIGH)!=0;
 
           bool executeNow = false;
-          JsVarInt debounce = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
+          JsVarInt debounce = watch.debounce;
           if (debounce<=0) {
             executeNow = true;
           } else { // Debouncing - use timeouts to ensure we only fire at the right time
@@ -1900,8 +2222,8 @@ void jsiIdle() {
 
             JsVar *timeout = jsvObjectGetChild(watchPtr, "timeout", 0);
             if (timeout) { // if we had a timeout, update the callback time
-              JsSysTime timeoutTime = jsiLastIdleTime + (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timeout, "time", 0));
-              jsvUnLock(jsvObjectSetChild(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce)));
+              JsSysTime timeoutTime = jsiTimerGetTime(timeout);
+              jsiTimerSetTime(timeout, eventTime + debounce);
               if (eventTime > timeoutTime) {
                 // timeout should have fired, but we didn't get around to executing it!
                 // Do it now (with the old timeout time)
@@ -1913,7 +2235,7 @@ void jsiIdle() {
               timeout = jsvNewObject();
               if (timeout) {
                 jsvObjectSetChild(timeout, "watch", watchPtr); // no unlock
-                jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce));
+                jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger(eventTime + debounce));
                 jsvObjectSetChildAndUnLock(timeout, "callback", jsvObjectGetChild(watchPtr, "callback", 0));
                 jsvObjectSetChildAndUnLock(timeout, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
                 jsvObjectSetChildAndUnLock(timeout, "pin", jsvNewFromPin(pin));
@@ -1929,9 +2251,9 @@ void jsiIdle() {
           // If we want to execute this watch right now...
           if (executeNow) {
             JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(eventTime)/1000);
-            if (jsiShouldExecuteWatch(watchPtr, pinIsHigh)) { // edge triggering
-              JsVar *watchCallback = jsvObjectGetChild(watchPtr, "callback", 0);
-              bool watchRecurring = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr,  "recur", 0));
+            if (watch.edge==0 || (pinIsHigh && watch.edge>0) || (!pinIsHigh && watch.edge<0)) { // edge triggering
+              JsVar *watchCallback = watch.callback ? jsvLockAgain(_jsvGetAddressOf(watch.callback)) : 0;
+              bool watchRecurring = watch.recur;
               JsVar *data = jsvNewObject();
               if (data) {
                 jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
@@ -1949,10 +2271,10 @@ void jsiIdle() {
                 watchRecurring = false;
               }
               jsvUnLock(data);
-              if (!watchRecurring) {
+              if (!watchRecurring && jsvGetRefs(watchName)) {
                 // free all
-                jsvObjectIteratorRemoveAndGotoNext(&it, watchArrayPtr);
-                hasDeletedWatch = true;
+                jsvRemoveChild(watchArrayPtr, watchName);
+                jsiWatchesChanged();
                 if (!jsiIsWatchingPin(pin))
                   jshPinWatch(pin, false);
               }
@@ -1963,10 +2285,7 @@ void jsiIdle() {
         }
 
         jsvUnLock(watchPtr);
-        if (!hasDeletedWatch)
-          jsvObjectIteratorNext(&it);
       }
-      jsvObjectIteratorFree(&it);
       jsvUnLock(watchArrayPtr);
     }
   }
@@ -1991,105 +2310,103 @@ void jsiIdle() {
     jsiTimeSinceCtrlC = 0xFFFFFFFF;
 
   jsiStatus = jsiStatus & ~JSIS_TIMERS_CHANGED;
-  JsVar *timerArrayPtr = jsvLock(timerArray);
-  JsvObjectIterator it;
-  jsvObjectIteratorNew(&it, timerArrayPtr);
-  while (jsvObjectIteratorHasValue(&it) && !(jsiStatus & JSIS_TIMERS_CHANGED)) {
-    bool hasDeletedTimer = false;
-    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
-    JsSysTime timerTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0));
-    JsSysTime timeUntilNext = timerTime - timePassed;
-
-    if (timeUntilNext<=0) {
-      // we're now doing work
-      jsiSetBusy(BUSY_INTERACTIVE, true);
-      wasBusy = true;
-      JsVar *timerCallback = jsvObjectGetChild(timerPtr, "callback", 0);
-      JsVar *watchPtr = jsvObjectGetChild(timerPtr, "watch", 0); // for debounce - may be undefined
-      bool exec = true;
-      JsVar *data = 0;
-      if (watchPtr) {
-        data = jsvNewObject();
-        // if we were from a watch then we were delayed by the debounce time...
-        if (data) {
-          JsVarInt delay = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
-          // Create the 'time' variable that will be passed to the user
-          JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(jsiLastIdleTime+timeUntilNext-delay)/1000);
-          // if it was a watch, set the last state up
-          bool state = jsvGetBoolAndUnLock(jsvObjectSetChild(data, "state", jsvObjectGetChild(watchPtr, "state", 0)));
-          exec = jsiShouldExecuteWatch(watchPtr, state);
-          // set up the lastTime variable of data to what was in the watch
-          jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
-          // set up the watches lastTime to this one
-          jsvObjectSetChild(watchPtr, "lastTime", timePtr); // don't unlock
-          jsvObjectSetChildAndUnLock(data, "time", timePtr);
-        }
+  /* Only run timers that were queued before we started, so an interval that
+   * is always due (or a callback adding timers) can't keep us here forever */
+  unsigned int timerOrder = timerQueueOrder;
+  JsSysTime timerTime;
+  JsVar *timerName;
+  while (!(jsiStatus & JSIS_TIMERS_CHANGED) &&
+         (timerName = jsiTimerQueuePop(time, timerOrder, &timerTime))) {
+    JsVar *timerPtr = jsvSkipName(timerName);
+    // we're now doing work
+    jsiSetBusy(BUSY_INTERACTIVE, true);
+    wasBusy = true;
+    JsVar *timerCallback = jsvObjectGetChild(timerPtr, "callback", 0);
+    JsVar *watchPtr = jsvObjectGetChild(timerPtr, "watch", 0); // for debounce - may be undefined
+    bool exec = true;
+    bool removeTimer = false;
+    JsVar *data = 0;
+    if (watchPtr) {
+      data = jsvNewObject();
+      // if we were from a watch then we were delayed by the debounce time...
+      if (data) {
+        JsVarInt delay = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
+        // Create the 'time' variable that will be passed to the user
+        JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(timerTime-delay)/1000);
+        // if it was a watch, set the last state up
+        bool state = jsvGetBoolAndUnLock(jsvObjectSetChild(data, "state", jsvObjectGetChild(watchPtr, "state", 0)));
+        exec = jsiShouldExecuteWatch(watchPtr, state);
+        // set up the lastTime variable of data to what was in the watch
+        jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
+        // set up the watches lastTime to this one
+        jsvObjectSetChild(watchPtr, "lastTime", timePtr); // don't unlock
+        jsvObjectSetChildAndUnLock(data, "time", timePtr);
       }
-      JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
-      if (exec) {
-        bool execResult;
-        if (data) {
-          execResult = jsiExecuteEventCallback(0, timerCallback, 1, &data);
-        } else {
-          JsVar *argsArray = jsvObjectGetChild(timerPtr, "args", 0);
-          execResult = jsiExecuteEventCallbackArgsArray(0, timerCallback, argsArray);
-          jsvUnLock(argsArray);
-        }
-        if (!execResult && interval) {
+    }
+    if (exec) {
+      bool execResult;
+      if (data) {
+        execResult = jsiExecuteEventCallback(0, timerCallback, 1, &data);
+      } else {
+        JsVar *argsArray = jsvObjectGetChild(timerPtr, "args", 0);
+        execResult = jsiExecuteEventCallbackArgsArray(0, timerCallback, argsArray);
+        jsvUnLock(argsArray);
+      }
+      if (!execResult) {
+        JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
+        if (interval) {
           jsError("Ctrl-C while processing interval - removing it.");
           jsErrorFlags |= JSERR_CALLBACK;
-          // by setting interval to 0, we now think we've for a Timeout,
-          // which will get removed.
-          jsvUnLock(interval);
-          interval = 0;
+          removeTimer = true;
         }
+        jsvUnLock(interval);
       }
-      jsvUnLock(data);
-      if (watchPtr) { // if we had a watch pointer, be sure to remove us from it
-        jsvObjectRemoveChild(watchPtr, "timeout");
-        // Deal with non-recurring watches
-        if (exec) {
-          bool watchRecurring = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr,  "recur", 0));
-          if (!watchRecurring) {
-            JsVar *watchArrayPtr = jsvLock(watchArray);
-            JsVar *watchNamePtr = jsvGetIndexOf(watchArrayPtr, watchPtr, true);
-            if (watchNamePtr) {
-              jsvRemoveChild(watchArrayPtr, watchNamePtr);
-              jsvUnLock(watchNamePtr);
-            }
-            jsvUnLock(watchArrayPtr);
-            Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
-            if (!jsiIsWatchingPin(pin))
-              jshPinWatch(pin, false);
+    }
+    jsvUnLock(data);
+    if (watchPtr) { // if we had a watch pointer, be sure to remove us from it
+      jsvObjectRemoveChild(watchPtr, "timeout");
+      // Deal with non-recurring watches
+      if (exec) {
+        bool watchRecurring = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr,  "recur", 0));
+        if (!watchRecurring) {
+          JsVar *watchArrayPtr = jsvLock(watchArray);
+          JsVar *watchNamePtr = jsvGetIndexOf(watchArrayPtr, watchPtr, true);
+          if (watchNamePtr) {
+            jsvRemoveChild(watchArrayPtr, watchNamePtr);
+            jsvUnLock(watchNamePtr);
+            jsiWatchesChanged();
           }
+          jsvUnLock(watchArrayPtr);
+          Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
+          if (!jsiIsWatchingPin(pin))
+            jshPinWatch(pin, false);
         }
-        jsvUnLock(watchPtr);
       }
+      jsvUnLock(watchPtr);
+    }
 
-      if (interval) {
-        timeUntilNext = timeUntilNext + jsvGetLongIntegerAndUnLock(interval);
-      } else {
+    if (jsvGetRefs(timerName)) { // Beware... may have already been removed!
+      JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
+      JsSysTime newTime = jsiTimerGetTime(timerPtr);
+      if (!removeTimer && newTime == timerTime && interval) {
+        newTime = timerTime + jsvGetLongInteger(interval);
+        jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(newTime));
+      } else if (newTime == timerTime) // a timeout that's done
+        removeTimer = true;
+      // else the callback changed the time (eg. with changeInterval)
+      if (removeTimer || !jsiTimerQueueAdd(timerName, newTime)) {
         // free
-        // Beware... may have already been removed!
-        jsvObjectIteratorRemoveAndGotoNext(&it, timerArrayPtr);
-        hasDeletedTimer = true;
-        timeUntilNext = -1;
+        JsVar *timerArrayPtr = jsvLock(timerArray);
+        jsvRemoveChild(timerArrayPtr, timerName);
+        jsvUnLock(timerArrayPtr);
       }
-      jsvUnLock(timerCallback);
-
+      jsvUnLock(interval);
     }
-    // update the time until the next timer
-    if (timeUntilNext>=0 && timeUntilNext < minTimeUntilNext)
-      minTimeUntilNext = timeUntilNext;
-    // update the timer's time
-    if (!hasDeletedTimer) {
-      jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(timeUntilNext));
-      jsvObjectIteratorNext(&it);
-    }
-    jsvUnLock(timerPtr);
+    jsvUnLock3(timerCallback, timerPtr, timerName);
   }
-  jsvObjectIteratorFree(&it);
-  jsvUnLock(timerArrayPtr);
+  // work out how long until the next timer
+  if (!jsiTimerQueueGetTimeUntilNext(&minTimeUntilNext) && timerQueuePages)
+    jsiTimerQueueFree(); // no timers left - free the queue's memory
   /* We might have left the timers loop with stuff to do because the contents of it
    * changed. It's not a big deal because it could only have changed because a timer
    * got executed - so `wasBusy` got set and we know we're going to go around the
@@ -2111,6 +2428,9 @@ void jsiIdle() {
     jsiExecuteEvents();
   }
 
+  // don't keep removed watches' callbacks locked until the next pin event
+  if (watchTableChanged) jsiWatchTableFree();
+
   // check for TODOs
   if (jsiStatus&JSIS_TODO_MASK) {
     jsiSetBusy(BUSY_INTERACTIVE, true);
@@ -2152,6 +2472,20 @@ void jsiIdle() {
     jsiSetBusy(BUSY_INTERACTIVE, false);
   }
 
+#ifndef SAVE_ON_FLASH
+  if (jsvGCIncremental) {
+    /* Incremental GC - do a small slice of it each time around the loop,
+     * and start a new collection earlier than we would otherwise so we're
+     * less likely to have to do a full one when we run out of memory */
+    if (jsvGarbageCollectInProgress() ||
+        (loopsIdling==1 && !jsvMoreFreeVariablesThan(JS_VARS_BEFORE_INCREMENTAL_GC))) {
+      jsiSetBusy(BUSY_INTERACTIVE, true);
+      if (jsvGarbageCollectSlice())
+        loopsIdling = 0; // don't sleep until we're done
+      jsiSetBusy(BUSY_INTERACTIVE, false);
+    }
+  } else
+#endif
   /* if we've been around this loop, there is nothing to do, and
    * we have a spare 10ms then let's do some Garbage Collection
    * if we think we need to */
@@ -2290,7 +2624,7 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data) {
     JsVar *timerInterval = jsvObjectGetChild(timer, "interval", 0);
     user_callback(timerInterval ? "setInterval(" : "setTimeout(", user_data);
     jsiDumpJSON(user_callback, user_data, timerCallback, 0);
-    cbprintf(user_callback, user_data, ", %f);\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timer, "time", 0))));
+    cbprintf(user_callback, user_data, ", %f);\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : (jsiTimerGetTime(timer) - jsiLastIdleTime)));
     jsvUnLock2(timerInterval, timerCallback);
     // next
     jsvUnLock(timer);
@@ -2337,10 +2671,39 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data) {
 JsVarInt jsiTimerAdd(JsVar *timerPtr) {
   JsVar *timerArrayPtr = jsvLock(timerArray);
   JsVarInt itemIndex = jsvArrayAddToEnd(timerArrayPtr, timerPtr, 1) - 1;
+  if (itemIndex >= 0) {
+    JsVar *timerName = jsvLock(jsvGetLastChild(timerArrayPtr));
+    if (!jsiTimerQueueAdd(timerName, jsiTimerGetTime(timerPtr))) {
+      jsvRemoveChild(timerArrayPtr, timerName);
+      jsExceptionHere(JSET_ERROR, "Not enough memory to add timer");
+    }
+    jsvUnLock(timerName);
+  }
   jsvUnLock(timerArrayPtr);
   return itemIndex;
 }
 
+void jsiTimerRemove(JsVar *timerName) {
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsVar *timer = jsvSkipName(timerName);
+  int i = jsiTimerQueueFind(timer);
+  jsvUnLock(timer);
+  if (i>=0) jsiTimerQueueRemoveAt((unsigned int)i);
+  jsvRemoveChild(timerArrayPtr, timerName);
+  jsvUnLock(timerArrayPtr);
+}
+
+void jsiTimerSetTime(JsVar *timer, JsSysTime time) {
+  jsvObjectSetChildAndUnLock(timer, "time", jsvNewFromLongInteger(time));
+  // If it's not in the queue it's being run right now, and jsiIdle will requeue it
+  int i = jsiTimerQueueFind(timer);
+  if (i>=0) {
+    jsiTimerQueueGet((unsigned int)i)->time = time;
+    jsiTimerQueueSiftUp((unsigned int)i);
+    jsiTimerQueueSiftDown((unsigned int)i);
+  }
+}
+
 void jsiTimersChanged() {
   jsiStatus |= JSIS_TIMERS_CHANGED;
 }
@@ -168,8 +168,13 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data);
 extern JsVarRef timerArray; // Linked List of timers to check and run
 extern JsVarRef watchArray; // Linked List of input watches to check and run
 
-extern JsVarInt jsiTimerAdd(JsVar *timerPtr);
+extern JsVarInt jsiTimerAdd(JsVar *timerPtr); ///< Add a timer (whose "time" is from jshGetSystemTime) to timerArray and the queue, return its index
+extern void jsiTimerRemove(JsVar *timerName); ///< Remove a timer (its name in timerArray)
+extern void jsiTimerSetTime(JsVar *timer, JsSysTime time); ///< Set the time at which a timer will next run
+extern void jsiTimersRebuildQueue(); ///< Rebuild the queue of timers from timerArray
+extern void jsiTimersAdjust(JsSysTime diff); ///< Add diff to the time of every timer (eg. when the system time changes)
 extern void jsiTimersChanged(); // Flag timers changed so we can skip out of the loop if needed
+extern void jsiWatchesChanged(); // Flag that watchArray has changed, so the table of watches gets rebuilt
 // end for jswrap_interactive/io.c ------------------------------------------------
 
 #ifdef USE_DEBUGGER
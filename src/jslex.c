@@ -841,6 +841,10 @@ int jslGetTokenLength() {
   return lex->tokenl;
 }
 
+size_t jslGetTokenSite() {
+  return ((size_t)jsvGetRef(lex->sourceVar) << 16) ^ jsvStringIteratorGetIndex(&lex->tokenStart.it);
+}
+
 JsVar *jslGetTokenValueAsVar() {
   if (lex->tokenValue) {
     return jsvLockAgain(lex->tokenValue);
@@ -159,6 +159,8 @@ char *jslGetTokenValueAsString();
 int jslGetTokenLength();
 JsVar *jslGetTokenValueAsVar();
 bool jslIsIDOrReservedWord();
+/// Return a number identifying where the current token is in the code (see jspGetNamedFieldAtSite)
+size_t jslGetTokenSite();
 
 // Only for more 'internal' use
 void jslGetNextToken(); ///< Get the text token from our text string
@@ -22,6 +22,9 @@
 #ifndef SAVE_ON_FLASH
 #include "jswrap_regexp.h" // for jswrap_regexp_constructor
 #endif
+#ifdef USE_BYTECODE
+#include "jsbytecode.h"
+#endif
 
 /* Info about execution when Parsing - this saves passing it on the stack
  * for each call */
@@ -805,6 +808,9 @@ NO_INLINE JsVar *jspeFunctionCall(JsVar *function, JsVar *functionName, JsVar *t
 #endif
 
 
+#ifdef USE_BYTECODE
+            JsVar *functionBytecode = jsbGetFunctionBytecode(function, functionCode);
+#endif
             JsLex newLex;
             JsLex *oldLex = jslSetLex(&newLex);
             jslInit(functionCode);
@@ -815,6 +821,13 @@ NO_INLINE JsVar *jspeFunctionCall(JsVar *function, JsVar *functionName, JsVar *t
             execInfo.execute = EXEC_YES | (execInfo.execute&(EXEC_CTRL_C_MASK|EXEC_ERROR_MASK|EXEC_DEBUGGER_NEXT_LINE));
 #else
             execInfo.execute = EXEC_YES | (execInfo.execute&(EXEC_CTRL_C_MASK|EXEC_ERROR_MASK));
+#endif
+#ifdef USE_BYTECODE
+            if (functionBytecode) {
+              // already compiled - the lexer is only used for error reporting
+              returnVar = jsbExecute(functionBytecode);
+              jsvUnLock(functionBytecode);
+            } else
 #endif
             if (jsvIsFunctionReturn(function)) {
               #ifdef USE_DEBUGGER
@@ -934,34 +947,93 @@ JsVar *jspGetNamedVariable(const char *tokenName) {
   return a;
 }
 
-/// Used by jspGetNamedField / jspGetVarNamedField
-static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName) {
+#ifndef SAVE_ON_FLASH
+void jspVarSlotsReset(JspVarSlots *slots) {
+  memset(slots->name, 0, sizeof(slots->name));
+  slots->epoch = jsvShapeEpoch;
+  /* Variables can only be added to the top scope or root while we're
+   * executing (closures' scopes belong to functions that aren't running)
+   * and only root or a scope that came from eval/require can have children
+   * removed - so if neither have changed, nothing could have been moved or
+   * hidden by a new variable. */
+  slots->topShape = execInfo.scopeCount ? jsvGetShape(execInfo.scopes[execInfo.scopeCount-1]) : 1/*root is on top*/;
+  slots->rootShape = jsvGetShape(execInfo.root);
+}
+
+JsVar *jspGetNamedVariableInSlot(const char *tokenName, JspVarSlots *slots, int slot) {
+  if (slots->epoch != jsvShapeEpoch ||
+      slots->rootShape != jsvGetShape(execInfo.root) ||
+      (execInfo.scopeCount && slots->topShape != jsvGetShape(execInfo.scopes[execInfo.scopeCount-1])))
+    jspVarSlotsReset(slots);
+  if (slots->name[slot])
+    return jsvLock(slots->name[slot]);
+  if (!slots->topShape || !JSP_SHOULD_EXECUTE)
+    return jspGetNamedVariable(tokenName);
+  JsVar *a = jspeiFindInScopes(tokenName);
+  // Built-ins and undefined variables aren't in a scope, so can't be remembered
+  if (!a) return jspGetNamedVariable(tokenName);
+  slots->name[slot] = jsvGetRef(a);
+  return a;
+}
+#endif
+
+/// Where a property was found, for jspGetNamedFieldAtSite
+typedef enum {
+  JSPIC_NONE,      ///< Not found, or found somewhere we can't cache
+  JSPIC_CHILD,     ///< A child of the object itself
+  JSPIC_PROTOTYPE, ///< A child of one of the object's prototypes
+  JSPIC_BUILTIN,   ///< A built-in function
+} PACKED_FLAGS JspInlineCacheType;
+
+/// A cached property lookup (see jspGetNamedFieldAtSite)
+typedef struct {
+  JsVarRef object; ///< The object the property was looked up on (or 0 if unused)
+  JsVarRef shape; ///< jsvGetShape(object) when it was looked up
+  void (*objectPtr)(void); ///< If object is a native function, its ptr (as it has no shape)
+  uint32_t epoch; ///< jsvShapeEpoch when it was looked up
+  JspInlineCacheType type;
+  JsVarRef child; ///< For JSPIC_CHILD/JSPIC_PROTOTYPE, the name that was found
+  JsVarDataNative native; ///< For JSPIC_BUILTIN, the function that was found
+  char name[JSP_INLINE_CACHE_NAME_LEN]; ///< The name of the property
+} JspInlineCacheEntry;
+
+/** Turn a value found in an object's prototypes into a name that references
+ * the object itself. We didn't find a child in the object itself, so if we
+ * kept the name we had, `a.b = c;` could end up setting `a.prototype.b` (bug #360).
+ * We might also have got a built-in, which wouldn't have a name anyway. */
+static JsVar *jspNewChildForValue(JsVar *object, const char *name, JsVar *child) {
+  // Get rid of existing name
+  child = jsvSkipNameAndUnLock(child);
+  // create a new name
+  JsVar *nameVar = jsvNewFromString(name);
+  JsVar *newChild = jsvCreateNewChild(object, nameVar, child);
+  jsvUnLock2(nameVar, child);
+  return newChild;
+}
+
+/// Used by jspGetNamedField / jspGetVarNamedField. If cache is set, it's filled in with where the child was found
+static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName, JspInlineCacheEntry *cache) {
   // Now look in prototypes
   JsVar * child = jspeiFindChildFromStringInParents(object, name);
+  if (child && cache) {
+    cache->type = JSPIC_PROTOTYPE;
+    cache->child = jsvGetRef(child);
+  }
 
   /* Check for builtins via separate function
    * This way we save on RAM for built-ins because everything comes out of program code */
   if (!child) {
     child = jswFindBuiltInFunction(object, name);
+    // only functions are the same every time - properties could be anything
+    if (cache && jsvIsNativeFunction(child) && !jsvGetFirstChild(child)) {
+      cache->type = JSPIC_BUILTIN;
+      cache->native = child->varData.native;
+    }
   }
 
-  /* We didn't get here if we found a child in the object itself, so
-   * if we're here then we probably have the wrong name - so for example
-   * with `a.b = c;` could end up setting `a.prototype.b` (bug #360)
-   *
-   * Also we might have got a built-in, which wouldn't have a name on it
-   * anyway - so in both cases, strip the name if it is there, and create
-   * a new name.
-   */
-  if (child && returnName) {
-    // Get rid of existing name
-    child = jsvSkipNameAndUnLock(child);
-    // create a new name
-    JsVar *nameVar = jsvNewFromString(name);
-    JsVar *newChild = jsvCreateNewChild(object, nameVar, child);
-    jsvUnLock2(nameVar, child);
-    child = newChild;
-  }
+  // We didn't get here if we found a child in the object itself, so make a new name
+  if (child && returnName)
+    child = jspNewChildForValue(object, name, child);
 
   // If not found and is the prototype, create it
   if (!child) {
@@ -991,15 +1063,20 @@ static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* nam
  * NOTE: ArrayBuffer/Strings are not handled here. We assume that if we're
  * passing a char* rather than a JsVar it's because we're looking up via
  * a symbol rather than a variable. To handle these use jspGetVarNamedField  */
-JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
+static JsVar *jspGetNamedFieldInternal(JsVar *object, const char* name, bool returnName, JspInlineCacheEntry *cache) {
 
   JsVar *child = 0;
   // if we're an object (or pretending to be one)
   if (jsvHasChildren(object))
     child = jsvFindChildFromString(object, name, false);
 
+  if (child && cache) {
+    cache->type = JSPIC_CHILD;
+    cache->child = jsvGetRef(child);
+  }
+
   if (!child) {
-    child = jspGetNamedFieldInParents(object, name, returnName);
+    child = jspGetNamedFieldInParents(object, name, returnName, cache);
 
     // If not found and is the prototype, create it
     if (!child && jsvIsFunction(object) && strcmp(name, JSPARSE_PROTOTYPE_VAR)==0) {
@@ -1013,6 +1090,105 @@ JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
   else return jsvSkipNameAndUnLock(child);
 }
 
+JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
+  return jspGetNamedFieldInternal(object, name, returnName, 0);
+}
+
+#ifndef SAVE_ON_FLASH
+/* Inline cache for property accesses.
+ *
+ * Every `a.b` in the code (the 'site') hashes to an entry in jspInlineCache,
+ * which remembers which object `b` was last looked up on, and where it was
+ * found. If it's the same object next time and nothing has changed (the
+ * object's shape is the same and jsvShapeEpoch hasn't changed because of
+ * changes to prototypes) we can use what we found last time rather than
+ * searching the object, its prototypes and then the built-in functions. */
+static JspInlineCacheEntry jspInlineCache[JSP_INLINE_CACHE_SIZE];
+
+/// Flag everything that jspeiFindChildFromStringInParents/jswFindBuiltInFunction look in as a prototype
+static void jspeiSetPrototypeShapes(JsVar *parent) {
+  // changes to the root could change what we find for built-in classes
+  jsvSetShapeIsPrototype(execInfo.root);
+  if (jsvIsObject(parent)) {
+    JsVar *inheritsFrom = jsvObjectGetChild(parent, JSPARSE_INHERITS_VAR, 0);
+    if (!inheritsFrom) {
+      JsVar *obj = jsvObjectGetChild(execInfo.root, "Object", 0);
+      if (obj) {
+        inheritsFrom = jsvObjectGetChild(obj, JSPARSE_PROTOTYPE_VAR, 0);
+        jsvUnLock(obj);
+      }
+    }
+    if (inheritsFrom && inheritsFrom!=parent) {
+      jsvSetShapeIsPrototype(inheritsFrom);
+      // jswFindBuiltInFunction uses the constructor
+      JsVar *constructor = jsvObjectGetChild(inheritsFrom, JSPARSE_CONSTRUCTOR_VAR, 0);
+      jsvSetShapeIsPrototype(constructor);
+      jsvUnLock(constructor);
+      jspeiSetPrototypeShapes(inheritsFrom);
+    }
+    jsvUnLock(inheritsFrom);
+  } else {
+    const char *objectName = jswGetBasicObjectName(parent);
+    while (objectName) {
+      JsVar *obj = jsvObjectGetChild(execInfo.root, objectName, 0);
+      if (jsvHasChildren(obj)) {
+        jsvSetShapeIsPrototype(obj);
+        JsVar *proto = jsvObjectGetChild(obj, JSPARSE_PROTOTYPE_VAR, 0);
+        jsvSetShapeIsPrototype(proto);
+        jsvUnLock(proto);
+      }
+      jsvUnLock(obj);
+      objectName = jswGetBasicObjectPrototypeName(objectName);
+    }
+  }
+}
+
+/// Is the cache entry for this object (and is it still valid)?
+static bool jspInlineCacheMatches(JspInlineCacheEntry *entry, JsVar *object, const char *name) {
+  if (entry->object != jsvGetRef(object) || entry->epoch != jsvShapeEpoch)
+    return false;
+  if (jsvIsNativeFunction(object)) {
+    if (object->varData.native.ptr != entry->objectPtr) return false;
+  } else {
+    if (jsvGetShape(object) != entry->shape) return false;
+  }
+  return strcmp(entry->name, name)==0;
+}
+
+JsVar *jspGetNamedFieldAtSite(JsVar *object, const char* name, size_t site) {
+  JspInlineCacheEntry *entry = &jspInlineCache[((uint32_t)site * 2654435761U >> 16) % JSP_INLINE_CACHE_SIZE];
+  if (jspInlineCacheMatches(entry, object, name)) {
+    if (entry->type == JSPIC_CHILD)
+      return jsvLock(entry->child);
+    JsVar *child;
+    if (entry->type == JSPIC_PROTOTYPE)
+      child = jsvLock(entry->child);
+    else
+      child = jsvNewNativeFunction(entry->native.ptr, entry->native.argTypes);
+    return jspNewChildForValue(object, name, child);
+  }
+  // It's not in the cache, so look it up properly
+  uint32_t epoch = jsvShapeEpoch;
+  bool canCache = strlen(name)<JSP_INLINE_CACHE_NAME_LEN &&
+                  (jsvGetShape(object) || jsvIsNativeFunction(object));
+  if (!canCache) return jspGetNamedField(object, name, true);
+  entry->object = 0;
+  entry->type = JSPIC_NONE;
+  JsVar *child = jspGetNamedFieldInternal(object, name, true, entry);
+  if (entry->type == JSPIC_NONE) return child;
+  if (entry->type != JSPIC_CHILD)
+    jspeiSetPrototypeShapes(object);
+  // If anything changed while we were looking (eg. a GC pass or a new prototype) we can't cache it
+  if (epoch != jsvShapeEpoch) return child;
+  entry->object = jsvGetRef(object);
+  entry->shape = jsvGetShape(object);
+  entry->objectPtr = jsvIsNativeFunction(object) ? object->varData.native.ptr : 0;
+  entry->epoch = epoch;
+  strcpy(entry->name, name);
+  return child;
+}
+#endif
+
 /// see jspGetNamedField - note that nameVar should have had jsvAsArrayIndex called on it first
 JsVar *jspGetVarNamedField(JsVar *object, JsVar *nameVar, bool returnName) {
 
@@ -1039,7 +1215,7 @@ JsVar *jspGetVarNamedField(JsVar *object, JsVar *nameVar, bool returnName) {
       char name[JSLEX_MAX_TOKEN_LENGTH];
       jsvGetString(nameVar, name, JSLEX_MAX_TOKEN_LENGTH);
       // try and find it in parents
-      child = jspGetNamedFieldInParents(object, name, returnName);
+      child = jspGetNamedFieldInParents(object, name, returnName, 0);
 
       // If not found and is the prototype, create it
       if (!child && jsvIsFunction(object) && jsvIsStringEqual(nameVar, JSPARSE_PROTOTYPE_VAR)) {
@@ -1079,7 +1255,7 @@ NO_INLINE JsVar *jspeFactorMember(JsVar *a, JsVar **parentResult) {
           JsVar *aVar = jsvSkipName(a);
           JsVar *child = 0;
           if (aVar)
-            child = jspGetNamedField(aVar, name, true);
+            child = jspGetNamedFieldAtSite(aVar, name, jslGetTokenSite());
           if (!child) {
             if (jsvHasChildren(aVar)) {
               // if no child found, create a pointer to where it could be
@@ -1142,7 +1318,7 @@ NO_INLINE JsVar *jspeFactorMember(JsVar *a, JsVar **parentResult) {
   return a;
 }
 
-NO_INLINE JsVar *jspeConstruct(JsVar *func, JsVar *funcName, bool hasArgs) {
+NO_INLINE JsVar *jspeConstruct(JsVar *func, JsVar *funcName, bool hasArgs, int argCount, JsVar **argPtr) {
   assert(JSP_SHOULD_EXECUTE);
   if (!jsvIsFunction(func)) {
     jsExceptionHere(JSET_ERROR, "Constructor should be a function, but is %t", func);
@@ -1157,7 +1333,7 @@ NO_INLINE JsVar *jspeConstruct(JsVar *func, JsVar *funcName, bool hasArgs) {
   JsVar *prototypeVar = jsvSkipName(prototypeName);
   jsvUnLock3(jsvAddNamedChild(thisObj, prototypeVar, JSPARSE_INHERITS_VAR), prototypeVar, prototypeName);
 
-  JsVar *a = jspeFunctionCall(func, funcName, thisObj, hasArgs, 0, 0);
+  JsVar *a = jspeFunctionCall(func, funcName, thisObj, hasArgs, argCount, argPtr);
 
   /* FIXME: we should ignore return values that aren't objects (bug #848), but then we need
    * to be aware of `new String()` and `new Uint8Array()`. Ideally we'd let through
@@ -1215,7 +1391,7 @@ NO_INLINE JsVar *jspeFactorFunctionCall() {
     if (isConstructor && JSP_SHOULD_EXECUTE) {
       // If we have '(' parse an argument list, otherwise don't look for any args
       bool parseArgs = lex->tk=='(';
-      a = jspeConstruct(func, funcName, parseArgs);
+      a = jspeConstruct(func, funcName, parseArgs, 0, 0);
       isConstructor = false; // don't treat subsequent brackets as constructors
     } else
       a = jspeFunctionCall(func, funcName, parent, true, 0, 0);
@@ -1952,6 +2128,52 @@ JsVar *jspeConditionalExpression() {
   return __jspeConditionalExpression(jspeBinaryExpression());
 }
 
+/** Assign rhs to the variable name lhs using the given assignment
+ * operator ('=', LEX_PLUSEQUAL, LEX_MINUSEQUAL, etc). rhs should
+ * already have had any name skipped. */
+NO_INLINE void jspAssign(JsVar *lhs, int op, JsVar *rhs) {
+  if (op=='=') {
+    /* If we're assigning to this and we don't have a parent,
+     * add it to the symbol table root */
+    if (!jsvGetRefs(lhs) && jsvIsName(lhs)) {
+      if (!jsvIsArrayBufferName(lhs) && !jsvIsNewChild(lhs))
+        jsvAddName(execInfo.root, lhs);
+    }
+    jspReplaceWith(lhs, rhs);
+  } else {
+    if (op==LEX_PLUSEQUAL) op='+';
+    else if (op==LEX_MINUSEQUAL) op='-';
+    else if (op==LEX_MULEQUAL) op='*';
+    else if (op==LEX_DIVEQUAL) op='/';
+    else if (op==LEX_MODEQUAL) op='%';
+    else if (op==LEX_ANDEQUAL) op='&';
+    else if (op==LEX_OREQUAL) op='|';
+    else if (op==LEX_XOREQUAL) op='^';
+    else if (op==LEX_RSHIFTEQUAL) op=LEX_RSHIFT;
+    else if (op==LEX_LSHIFTEQUAL) op=LEX_LSHIFT;
+    else if (op==LEX_RSHIFTUNSIGNEDEQUAL) op=LEX_RSHIFTUNSIGNED;
+    if (op=='+' && jsvIsName(lhs)) {
+      JsVar *currentValue = jsvSkipName(lhs);
+      if (jsvIsString(currentValue) && !jsvIsFlatString(currentValue) && jsvGetRefs(currentValue)==1 && rhs!=currentValue) {
+        /* A special case for string += where this is the only use of the string
+         * and we're not appending to ourselves. In this case we can do a
+         * simple append (rather than clone + append)*/
+        JsVar *str = jsvAsString(rhs, false);
+        jsvAppendStringVarComplete(currentValue, str);
+        jsvUnLock(str);
+        op = 0;
+      }
+      jsvUnLock(currentValue);
+    }
+    if (op) {
+      /* Fallback which does a proper add */
+      JsVar *res = jsvMathsOpSkipNames(lhs,rhs,op);
+      jspReplaceWith(lhs, res);
+      jsvUnLock(res);
+    }
+  }
+}
+
 NO_INLINE JsVar *__jspeAssignmentExpression(JsVar *lhs) {
   if (lex->tk=='=' || lex->tk==LEX_PLUSEQUAL || lex->tk==LEX_MINUSEQUAL ||
       lex->tk==LEX_MULEQUAL || lex->tk==LEX_DIVEQUAL || lex->tk==LEX_MODEQUAL ||
@@ -1965,48 +2187,8 @@ NO_INLINE JsVar *__jspeAssignmentExpression(JsVar *lhs) {
     rhs = jspeAssignmentExpression();
     rhs = jsvSkipNameAndUnLock(rhs); // ensure we get rid of any references on the RHS
 
-    if (JSP_SHOULD_EXECUTE && lhs) {
-      if (op=='=') {
-        /* If we're assigning to this and we don't have a parent,
-         * add it to the symbol table root */
-        if (!jsvGetRefs(lhs) && jsvIsName(lhs)) {
-          if (!jsvIsArrayBufferName(lhs) && !jsvIsNewChild(lhs))
-            jsvAddName(execInfo.root, lhs);
-        }
-        jspReplaceWith(lhs, rhs);
-      } else {
-        if (op==LEX_PLUSEQUAL) op='+';
-        else if (op==LEX_MINUSEQUAL) op='-';
-        else if (op==LEX_MULEQUAL) op='*';
-        else if (op==LEX_DIVEQUAL) op='/';
-        else if (op==LEX_MODEQUAL) op='%';
-        else if (op==LEX_ANDEQUAL) op='&';
-        else if (op==LEX_OREQUAL) op='|';
-        else if (op==LEX_XOREQUAL) op='^';
-        else if (op==LEX_RSHIFTEQUAL) op=LEX_RSHIFT;
-        else if (op==LEX_LSHIFTEQUAL) op=LEX_LSHIFT;
-        else if (op==LEX_RSHIFTUNSIGNEDEQUAL) op=LEX_RSHIFTUNSIGNED;
-        if (op=='+' && jsvIsName(lhs)) {
-          JsVar *currentValue = jsvSkipName(lhs);
-          if (jsvIsString(currentValue) && !jsvIsFlatString(currentValue) && jsvGetRefs(currentValue)==1 && rhs!=currentValue) {
-            /* A special case for string += where this is the only use of the string
-             * and we're not appending to ourselves. In this case we can do a
-             * simple append (rather than clone + append)*/
-            JsVar *str = jsvAsString(rhs, false);
-            jsvAppendStringVarComplete(currentValue, str);
-            jsvUnLock(str);
-            op = 0;
-          }
-          jsvUnLock(currentValue);
-        }
-        if (op) {
-          /* Fallback which does a proper add */
-          JsVar *res = jsvMathsOpSkipNames(lhs,rhs,op);
-          jspReplaceWith(lhs, res);
-          jsvUnLock(res);
-        }
-      }
-    }
+    if (JSP_SHOULD_EXECUTE && lhs)
+      jspAssign(lhs, op, rhs);
     jsvUnLock(rhs);
   }
   return lhs;
@@ -2676,6 +2858,13 @@ NO_INLINE JsVar *jspeStatement() {
     return jspeStatementVar();
   } else if (lex->tk==LEX_R_IF) {
     return jspeStatementIf();
+#ifdef USE_BYTECODE
+  } else if ((lex->tk==LEX_R_DO || lex->tk==LEX_R_WHILE || lex->tk==LEX_R_FOR) &&
+             JSP_SHOULD_EXECUTE && execInfo.scopeCount==0 && jsbExecuteLoop()) {
+    /* Loops in functions are compiled along with the function, but top-level
+     * loops are only executed once so we compile them here */
+    return 0;
+#endif
   } else if (lex->tk==LEX_R_DO) {
     return jspeStatementDoOrWhile(false);
   } else if (lex->tk==LEX_R_WHILE) {
@@ -44,6 +44,8 @@ JsVar *jspNewObject(const char *name, const char *instanceOf);
 bool jspIsInterrupted();
 /// if interrupting execution, this is set
 void jspSetInterrupted(bool interrupt);
+/// Raise an exception and return false if we're about to run out of stack
+bool jspCheckStackPosition();
 /// Has there been an error during parsing
 bool jspHasError();
 /// Set the error flag - set lineReported if we've already output the line number
@@ -169,10 +171,41 @@ JsVar *jspParse();
  */
 JsVar *jspeFunctionCall(JsVar *function, JsVar *functionName, JsVar *thisArg, bool isParsing, int argCount, JsVar **argPtr);
 
+/** Construct a new object using the given function as a constructor (as with
+ * the 'new' keyword). If hasArgs, arguments are parsed, otherwise argCount/argPtr
+ * are used */
+JsVar *jspeConstruct(JsVar *func, JsVar *funcName, bool hasArgs, int argCount, JsVar **argPtr);
+
 
 // Find a variable (or built-in function) based on the current scopes
 JsVar *jspGetNamedVariable(const char *tokenName);
 
+/// Number of variables that can be remembered in a JspVarSlots
+#define JSP_MAX_VAR_SLOTS 16
+
+/** Variables that have already been found in the current scopes, so they don't
+ * have to be searched for again. Each variable gets a slot number (eg. when
+ * its code is compiled), and while the scopes stay the same the slot just
+ * holds a reference to the variable's name. */
+typedef struct {
+  uint32_t epoch;      ///< jsvShapeEpoch when the slots were filled
+  JsVarRef topShape;   ///< Shape of the top scope when the slots were filled (0 if it can't be cached)
+  JsVarRef rootShape;  ///< Shape of root when the slots were filled
+  JsVarRef name[JSP_MAX_VAR_SLOTS]; ///< The name found for each slot (or 0 if not found yet)
+} JspVarSlots;
+
+#ifndef SAVE_ON_FLASH
+/// Forget everything in the slots - this must be called before they're used in a new set of scopes
+void jspVarSlotsReset(JspVarSlots *slots);
+/** As jspGetNamedVariable, but remembering where the variable was found in
+ * the given slot. If nothing that could have affected the lookup has changed
+ * the remembered name is used. */
+JsVar *jspGetNamedVariableInSlot(const char *tokenName, JspVarSlots *slots, int slot);
+#else
+#define jspVarSlotsReset(SLOTS)
+#define jspGetNamedVariableInSlot(NAME, SLOTS, SLOT) jspGetNamedVariable(NAME)
+#endif
+
 /** Get the named function/variable on the object - whether it's built in, or predefined.
  * If !returnName, returns the function/variable itself or undefined, but
  * if returnName, return a name (could be fake) referencing the parent.
@@ -183,12 +216,38 @@ JsVar *jspGetNamedVariable(const char *tokenName);
 JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName);
 JsVar *jspGetVarNamedField(JsVar *object, JsVar *nameVar, bool returnName);
 
+/// Number of entries in the inline cache used by jspGetNamedFieldAtSite
+#ifndef JSP_INLINE_CACHE_SIZE
+#define JSP_INLINE_CACHE_SIZE 64
+#endif
+/// Names must be shorter than this to be cached by jspGetNamedFieldAtSite
+#define JSP_INLINE_CACHE_NAME_LEN 12
+
+#ifndef SAVE_ON_FLASH
+/** As jspGetNamedField(object, name, true), but for the property access at
+ * the given place in the code (eg. from jslGetTokenSite). Where the property
+ * was found is cached, so if the same object is used at the same site again
+ * (and hasn't changed) we don't have to search for it. */
+JsVar *jspGetNamedFieldAtSite(JsVar *object, const char* name, size_t site);
+#else
+#define jspGetNamedFieldAtSite(OBJECT, NAME, SITE) jspGetNamedField(OBJECT, NAME, true)
+#endif
+
 /** Call the function named on the given object. For example you might call:
  *
  *  JsVar *str = jspCallNamedFunction(var, "toString", 0, 0);
  */
 JsVar *jspCallNamedFunction(JsVar *object, char* name, int argCount, JsVar **argPtr);
 
+/** Assign rhs to the variable name lhs using the given assignment
+ * operator ('=', LEX_PLUSEQUAL, LEX_MINUSEQUAL, etc). rhs should
+ * already have had any name skipped. */
+void jspAssign(JsVar *lhs, int op, JsVar *rhs);
+/// Find the given variable in the topmost scope, optionally creating it
+JsVar *jspeiFindOnTop(const char *name, bool createIfNotFound);
+/// Add a string describing the current execution position to stackTrace
+void jspAppendStackTrace(JsVar *stackTrace);
+
 
 // These are exported for the Web IDE's compiler. See exportPtrs in jswrap_process.c
 JsVar *jspeiFindInScopes(const char *name);
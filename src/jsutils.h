@@ -237,6 +237,14 @@ typedef int64_t JsSysTime;
 #else
 #define JS_VARS_BEFORE_IDLE_GC 32
 #endif
+/* As JS_VARS_BEFORE_IDLE_GC, but for starting an incremental garbage
+ * collection (see E.setGCOptions) - which can start earlier as it doesn't
+ * stop execution for long */
+#ifdef JSVAR_CACHE_SIZE
+#define JS_VARS_BEFORE_INCREMENTAL_GC (JSVAR_CACHE_SIZE/4)
+#else
+#define JS_VARS_BEFORE_INCREMENTAL_GC 128
+#endif
 
 
 #define JSPARSE_MAX_SCOPES  8
@@ -258,6 +266,8 @@ typedef int64_t JsSysTime;
 #define JSPARSE_FUNCTION_THIS_NAME JS_HIDDEN_CHAR_STR"ths" // the 'this' variable - for bound functions
 #define JSPARSE_FUNCTION_NAME_NAME JS_HIDDEN_CHAR_STR"nam" // for named functions (a = function foo() { foo(); })
 #define JSPARSE_FUNCTION_LINENUMBER_NAME JS_HIDDEN_CHAR_STR"lin" // The line number offset of the function
+#define JSPARSE_FUNCTION_BYTECODE_NAME JS_HIDDEN_CHAR_STR"byc" // The function's compiled bytecode (see jsbytecode.c)
+#define JSV_HASH_INDEX_NAME JS_HIDDEN_CHAR_STR"hsh" // Hash index of a large object's children (see jsvar.c) - MUST be 4 chars
 #define JS_EVENT_PREFIX "#on"
 #define JS_TIMEZONE_VAR "tz"
 
@@ -21,6 +21,7 @@
 #include "jswrap_object.h" // for jswrap_object_toString
 #include "jswrap_arraybuffer.h" // for jsvNewTypedArray
 #include "jswrap_dataview.h" // for jsvNewDataViewWithData
+#include "jstimer.h" // for jstUtilTimerIsRunning
 
 #ifdef DEBUG
   /** When freeing, clear the references (nextChild/etc) in the JsVar.
@@ -55,6 +56,33 @@ typedef enum {
 volatile bool touchedFreeList = false;
 volatile JsVarRef jsVarFirstEmpty; ///< reference of first unused variable (variables are in a linked list)
 volatile MemBusyType isMemoryBusy; ///< Are we doing garbage collection or similar, so can't access memory?
+#ifndef SAVE_ON_FLASH
+/** The most free variables that could be next to each other (in memory
+ * AND in the free list) - so what jsvNewFlatStringOfLength could find.
+ * It's worked out exactly whenever the free list is put in order, and
+ * every time a variable is freed it could grow by at most one. */
+static volatile unsigned int jsVarLargestFreeRun;
+#define jsvMayHaveFreeRun(BLOCKS) ((BLOCKS) <= jsVarLargestFreeRun)
+static void jsvUpdateLargestFreeRun();
+#else
+#define jsvMayHaveFreeRun(BLOCKS) true
+#define jsvUpdateLargestFreeRun()
+#endif
+#ifndef SAVE_ON_FLASH
+/* To append to a string we have to find its last block. So that appending
+ * to the same string over and over doesn't mean walking all of it each time,
+ * we remember a block near the end of the last string appended to, and the
+ * index of its first character. This is forgotten if either var is freed (or
+ * moved by jsvDefragment). Blocks in a string never change length once
+ * another block has been added after them, so it's always safe to continue
+ * walking the string from the remembered block. */
+static JsVarRef jsvStringTailStr;   ///< The string we last appended to
+static JsVarRef jsvStringTailBlock; ///< A block in jsvStringTailStr (usually the last)
+static size_t jsvStringTailIndex;   ///< Index of the first character in jsvStringTailBlock
+#define jsvStringTailForget(REF) if ((REF)==jsvStringTailStr || (REF)==jsvStringTailBlock) jsvStringTailStr = 0;
+#else
+#define jsvStringTailForget(REF)
+#endif
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -172,6 +200,9 @@ void jsvSetMaxVarsUsed(unsigned int size) {
 void jsvCreateEmptyVarList() {
   assert(!isMemoryBusy);
   isMemoryBusy = MEMBUSY_SYSTEM;
+#ifndef SAVE_ON_FLASH
+  jsvStringTailStr = 0;
+#endif
   jsVarFirstEmpty = 0;
   JsVar firstVar; // temporary var to simplify code in the loop below
   jsvSetNextSibling(&firstVar, 0);
@@ -190,6 +221,7 @@ void jsvCreateEmptyVarList() {
   }
   jsvSetNextSibling(lastEmpty, 0);
   jsVarFirstEmpty = jsvGetNextSibling(&firstVar);
+  jsvUpdateLargestFreeRun();
   isMemoryBusy = MEM_NOT_BUSY;
 }
 
@@ -214,8 +246,128 @@ void jsvClearEmptyVarList() {
   isMemoryBusy = MEM_NOT_BUSY;
 }
 
+#ifndef SAVE_ON_FLASH
+/* Object shapes.
+ *
+ * The parser caches where it found the results of property lookups (see
+ * jspGetNamedFieldAtSite), so it needs a cheap way to tell whether an
+ * object's list of children has changed since. Objects, the root and
+ * non-native functions don't use prevSibling, so once the cache has seen an
+ * object it stores a 'shape' there - a serial number shifted left by one -
+ * and jsvAddName/jsvRemoveChild give it a new one whenever its children
+ * change. Objects with a shape of 0 aren't in the cache, so we don't bother
+ * updating them.
+ *
+ * The bottom bit is set for objects that have been used as prototypes (see
+ * jsvSetShapeIsPrototype), and changing those increments jsvShapeEpoch
+ * instead, which invalidates every cached lookup. Native functions have no
+ * room for a shape, so any change to their children does the same. */
+
+uint32_t jsvShapeEpoch;
+/// The last serial number we used for a shape
+static JsVarRef jsvShapeLast;
+
+static bool jsvHasShape(const JsVar *v) {
+  return jsvIsObject(v) || (jsvIsFunction(v) && !jsvIsNativeFunction(v));
+}
+
+void jsvResetShapes() {
+  JsVarRef i;
+  for (i=1;i<=jsVarsSize;i++) {
+    JsVar *var = jsvGetAddressOf(i);
+    if (jsvHasShape(var)) {
+      jsvSetPrevSibling(var, 0);
+    } else if (jsvIsFlatString(var)) {
+      // skip over used blocks for flat strings
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+    }
+  }
+  jsvShapeLast = 0;
+  jsvShapeEpoch++;
+}
+
+/// Give the variable a new shape, with the given prototype bit
+static void jsvNewShape(JsVar *v, JsVarRef isPrototype) {
+  // If we run out of serial numbers, start again (old ones could get reused)
+  if (jsvShapeLast >= (JSVARREF_MAX>>1))
+    jsvResetShapes();
+  jsvShapeLast++;
+  jsvSetPrevSibling(v, (JsVarRef)((jsvShapeLast<<1) | isPrototype));
+}
+
+/// Called when children have been added to or removed from parent
+static void jsvShapeChanged(JsVar *parent) {
+  if (jsvHasShape(parent)) {
+    JsVarRef shape = jsvGetPrevSibling(parent);
+    if (!shape) return; // not cached, so no need to change
+    if (shape&1) jsvShapeEpoch++;
+    jsvNewShape(parent, shape&1);
+  } else if (jsvIsNativeFunction(parent)) {
+    jsvShapeEpoch++;
+  }
+}
+
+/// Called when the value of name is about to be set to src
+static void jsvShapeValueChanged(JsVar *name, JsVar *src) {
+  JsVarRef ref = jsvGetFirstChild(name);
+  if (!ref) return;
+  JsVar *v = jsvGetAddressOf(ref);
+  if (jsvHasShape(v)) {
+    // eg. `a.__proto__ = b` or `Object.prototype = c`
+    if (jsvGetPrevSibling(v)&1) jsvShapeEpoch++;
+  } else if (jsvIsNativeFunction(v)) {
+    // eg. `Foo.prototype.constructor = Bar` or `Object = Foo`
+    if (!jsvIsNativeFunction(src) || src->varData.native.ptr!=v->varData.native.ptr)
+      jsvShapeEpoch++;
+  }
+}
+
+JsVarRef jsvGetShape(JsVar *v) {
+  if (!jsvHasShape(v)) return 0;
+  if (!jsvGetPrevSibling(v)) jsvNewShape(v, 0);
+  return (JsVarRef)(jsvGetPrevSibling(v)>>1);
+}
+
+void jsvSetShapeIsPrototype(JsVar *v) {
+  if (!jsvHasShape(v)) return;
+  JsVarRef shape = jsvGetPrevSibling(v);
+  if (!shape) jsvNewShape(v, 1);
+  else jsvSetPrevSibling(v, shape|1);
+}
+#else
+#define jsvHasShape(V) false
+#define jsvShapeChanged(PARENT)
+#define jsvShapeValueChanged(NAME, SRC)
+#endif
+
+#ifndef SAVE_ON_FLASH
+/// What the incremental garbage collector is doing (see jsvGarbageCollectSlice)
+typedef enum {
+  JSVGC_IDLE,  ///< Not collecting
+  JSVGC_MARK,  ///< Scanning used variables (at jsvGCCursor) and marking what they link to
+  JSVGC_UNLINK,///< Removing references from anything that wasn't marked to things that were
+  JSVGC_SWEEP, ///< Freeing anything that wasn't marked (at jsvGCCursor)
+} PACKED_FLAGS JsvGCPhase;
+
+static JsvGCPhase jsvGCPhase = JSVGC_IDLE;
+/// The next variable the incremental garbage collector will look at
+static JsVarRef jsvGCCursor;
+bool jsvGCIncremental = false;
+unsigned int jsvGCSliceSize = JSV_GC_DEFAULT_SLICE_SIZE;
+JsvGCStats jsvGCStats;
+
+static void jsvGarbageCollectRemovedRef(JsVar *var);
+static void jsvGarbageCollectFlatStringAllocated(JsVarRef first, JsVarRef last);
+static void jsvGarbageCollectSweep(unsigned int budget);
+#endif
+
 void jsvSoftInit() {
   jsvCreateEmptyVarList();
+#ifndef SAVE_ON_FLASH
+  jsvGCPhase = JSVGC_IDLE;
+  // shapes may have been loaded from flash, and may clash with new ones
+  jsvResetShapes();
+#endif
 }
 
 void jsvSoftKill() {
@@ -314,6 +466,9 @@ void jsvSetMemoryTotal(unsigned int jsNewVarCount) {
    * is 0 (because jsiFreeMoreMemory returned 0) so we can just assign it.  */
   assert(!jsVarFirstEmpty);
   jsVarFirstEmpty = jsvInitJsVars(oldSize+1, jsVarsSize-oldSize);
+#ifndef SAVE_ON_FLASH
+  jsVarLargestFreeRun = jsVarsSize-oldSize;
+#endif
   // jsiConsolePrintf("Resized memory from %d blocks to %d\n", oldBlockCount, newBlockCount);
   touchedFreeList = true;
   isMemoryBusy = MEM_NOT_BUSY;
@@ -503,11 +658,16 @@ JsVar *jsvNewWithFlags(JsVarFlags flags) {
 static NO_INLINE void jsvFreePtrInternal(JsVar *var) {
   assert(jsvGetLocks(var)==0);
   var->flags = JSV_UNUSED;
+  jsvStringTailForget(jsvGetRef(var));
   // add this to our free list
   jshInterruptOff(); // to allow this to be used from an IRQ
   jsvSetNextSibling(var, jsVarFirstEmpty);
   jsVarFirstEmpty = jsvGetRef(var);
   touchedFreeList = true;
+#ifndef SAVE_ON_FLASH
+  // this may join on to the run of free variables at the start of the list
+  if (jsVarLargestFreeRun < jsVarsSize) jsVarLargestFreeRun++;
+#endif
   jshInterruptOn();
 }
 
@@ -516,6 +676,8 @@ ALWAYS_INLINE void jsvFreePtr(JsVar *var) {
    * we were, we'd have been freed by jsvGarbageCollect */
   assert((!jsvGetNextSibling(var) && !jsvGetPrevSibling(var)) || // check that next/prevSibling are not set
       jsvIsRefUsedForData(var) ||  // UNLESS we're part of a string and nextSibling/prevSibling are used for string data
+      (jsvIsArray(var) && !jsvGetPrevSibling(var)) || // UNLESS we're an array with an index (see jsvArrayIndexGet)
+      (jsvHasShape(var) && !jsvGetNextSibling(var)) || // UNLESS we're an object with a shape (see jsvGetShape)
       (jsvIsName(var) && (jsvGetNextSibling(var)==jsvGetPrevSibling(var)))); // UNLESS we're signalling that we're jsvIsNewChild
 
   // Names that Link to other things
@@ -572,6 +734,17 @@ ALWAYS_INLINE void jsvFreePtr(JsVar *var) {
 
   if (jsvHasChildren(var)) {
     JsVarRef childref = jsvGetFirstChild(var);
+#ifndef SAVE_ON_FLASH
+    if (jsvIsArray(var) && jsvGetNextSibling(var)) {
+      // free the array's index (see jsvArrayIndexGet)
+      JsVarRef indexRef = jsvGetNextSibling(var);
+      jsvSetNextSibling(var, 0);
+      jsvUnRefRef(indexRef);
+    }
+    // cached lookups could refer to this function's children (see jsvShapeChanged)
+    if (childref && jsvIsNativeFunction(var))
+      jsvShapeEpoch++;
+#endif
 #ifdef CLEAR_MEMORY_ON_FREE
     jsvSetFirstChild(var, 0);
     jsvSetLastChild(var, 0);
@@ -714,6 +887,9 @@ JsVar *jsvRef(JsVar *var) {
 void jsvUnRef(JsVar *var) {
   assert(var && jsvGetRefs(var)>0 && jsvHasRef(var));
   jsvSetRefs(var, (JsVarRefCounter)(jsvGetRefs(var)-1));
+#ifndef SAVE_ON_FLASH
+  jsvGarbageCollectRemovedRef(var);
+#endif
 }
 
 /// Helper fn, Reference - set this variable as used by something
@@ -752,7 +928,7 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
   searching the free list. This can be done as long as nobody's
   messed with the free list in the mean time (which we check for with
   touchedFreeList). If someone has messed with it, we restart.*/
-  bool memoryTouched = true;
+  bool memoryTouched = jsvMayHaveFreeRun(requiredBlocks); // don't search if we know we won't find it
   while (memoryTouched) {
     memoryTouched = false;
     touchedFreeList = false;
@@ -784,6 +960,9 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
             // Set up the header block (including one lock)
             jsvResetVariable(flatString, JSV_FLAT_STRING);
             flatString->varData.integer = (JsVarInt)byteLength;
+#ifndef SAVE_ON_FLASH
+            jsvGarbageCollectFlatStringAllocated(startBlock, (JsVarRef)(startBlock+requiredBlocks-1));
+#endif
           }
           jshInterruptOn();
           // if success, break out!
@@ -808,7 +987,7 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
    * the free list is fragmented, so GCing might well fix it - which
    * we'll try. */
   if (!flatString) {
-    if (jsvGarbageCollect())
+    if (jsvGarbageCollect() && jsvMayHaveFreeRun(requiredBlocks))
       return jsvNewFlatStringOfLength(byteLength);
     return 0;
   }
@@ -1409,6 +1588,21 @@ size_t jsvGetFlatStringBlocks(const JsVar *v) {
   return ((size_t)v->varData.integer+sizeof(JsVar)-1) / sizeof(JsVar);
 }
 
+void jsvTruncateFlatString(JsVar *v, size_t byteLength) {
+  assert(jsvIsFlatString(v));
+  size_t oldBlocks = jsvGetFlatStringBlocks(v);
+  if (byteLength >= (size_t)v->varData.integer) return;
+  v->varData.integer = (JsVarInt)byteLength;
+  size_t count = oldBlocks - jsvGetFlatStringBlocks(v);
+  JsVarRef i = (JsVarRef)(jsvGetRef(v)+oldBlocks);
+  // free the blocks we don't need any more, last first (like jsvFreePtr)
+  while (count--) {
+    JsVar *p = jsvGetAddressOf(i--);
+    p->flags = JSV_UNUSED; // set locks to 0 so the assert in jsvFreePtrInternal doesn't get fed up
+    jsvFreePtrInternal(p);
+  }
+}
+
 char *jsvGetFlatStringPointer(JsVar *v) {
   assert(jsvIsFlatString(v));
   if (!jsvIsFlatString(v)) return 0;
@@ -1533,6 +1727,29 @@ size_t jsvGetIndexFromLineAndCol(JsVar *v, size_t line, size_t col) {
   return n;
 }
 
+#ifndef SAVE_ON_FLASH
+void jsvStringTailRemember(JsVar *str, JsvStringIterator *it) {
+  if (it->var && !jsvIsFlatString(str)) {
+    jsvStringTailStr = jsvGetRef(str);
+    jsvStringTailBlock = jsvGetRef(it->var);
+    jsvStringTailIndex = it->varIndex;
+  } else if (jsvGetRef(str)==jsvStringTailStr)
+    jsvStringTailStr = 0;
+}
+
+void jsvStringTailRecall(JsvStringIterator *it) {
+  if (it->varIndex==0 && jsvStringTailStr && jsvGetRef(it->var)==jsvStringTailStr &&
+      jsvStringTailBlock!=jsvStringTailStr) {
+    JsVar *block = jsvLock(jsvStringTailBlock);
+    assert(jsvIsStringExt(block));
+    jsvUnLock(it->var);
+    it->var = block;
+    it->varIndex = jsvStringTailIndex;
+    it->charsInVar = jsvGetCharactersInVar(block);
+  }
+}
+#endif
+
 void jsvAppendString(JsVar *var, const char *str) {
   assert(jsvIsString(var));
   JsvStringIterator dst;
@@ -1543,6 +1760,7 @@ void jsvAppendString(JsVar *var, const char *str) {
    * and is less likely to break :) */
   while (*str)
     jsvStringIteratorAppend(&dst, *(str++));
+  jsvStringTailRemember(var, &dst);
   jsvStringIteratorFree(&dst);
 }
 
@@ -1553,12 +1771,24 @@ void jsvAppendStringBuf(JsVar *var, const char *str, size_t length) {
   jsvStringIteratorNew(&dst, var, 0);
   jsvStringIteratorGotoEnd(&dst);
   // now start appending
-  /* This isn't as fast as something single-purpose, but it's not that bad,
-   * and is less likely to break :) */
   while (length) {
     jsvStringIteratorAppend(&dst, *(str++));
     length--;
+    // We're now in a block with data - copy as much as will fit in one go
+    if (length && dst.var && !jsvIsFlatString(dst.var)) {
+      size_t n = jsvGetMaxCharactersInVar(dst.var) - dst.charsInVar;
+      if (n > length) n = length;
+      if (n) {
+        memcpy(&dst.ptr[dst.charsInVar], str, n);
+        dst.charsInVar += n;
+        dst.charIdx += n;
+        jsvSetCharactersInVar(dst.var, dst.charsInVar);
+        str += n;
+        length -= n;
+      }
+    }
   }
+  jsvStringTailRemember(var, &dst);
   jsvStringIteratorFree(&dst);
 }
 
@@ -1578,6 +1808,7 @@ void jsvAppendPrintf(JsVar *var, const char *fmt, ...) {
   vcbprintf((vcbprintf_callback)jsvStringIteratorPrintfCallback,&it, fmt, argp);
   va_end(argp);
 
+  jsvStringTailRemember(var, &it);
   jsvStringIteratorFree(&it);
 }
 
@@ -1600,6 +1831,15 @@ JsVar *jsvVarPrintf( const char *fmt, ...) {
 /** Append str to var. Both must be strings. stridx = start char or str, maxLength = max number of characters (can be JSVAPPENDSTRINGVAR_MAXLENGTH) */
 void jsvAppendStringVar(JsVar *var, const JsVar *str, size_t stridx, size_t maxLength) {
   assert(jsvIsString(var));
+  if (jsvIsFlatString(str)) {
+    // all the data is in one place, so append it in one go
+    size_t len = jsvGetStringLength(str);
+    if (stridx >= len) return;
+    len -= stridx;
+    if (len > maxLength) len = maxLength;
+    jsvAppendStringBuf(var, jsvGetFlatStringPointer((JsVar*)str)+stridx, len);
+    return;
+  }
 
   JsvStringIterator dst;
   jsvStringIteratorNew(&dst, var, 0);
@@ -1615,6 +1855,7 @@ void jsvAppendStringVar(JsVar *var, const JsVar *str, size_t stridx, size_t maxL
     jsvStringIteratorNext(&it);
   }
   jsvStringIteratorFree(&it);
+  jsvStringTailRemember(var, &dst);
   jsvStringIteratorFree(&dst);
 }
 
@@ -2122,6 +2363,384 @@ int jsvCompareInteger(JsVar *va, JsVar *vb) {
     return 0;
 }
 
+#ifndef SAVE_ON_FLASH
+/* Hash index for objects with lots of children.
+ *
+ * Normally finding a child means walking the linked list of names. If an
+ * object has more than JSV_HASH_INDEX_THRESHOLD children and we have to walk
+ * over them all, we add a hidden child (JSV_HASH_INDEX_NAME) right at the
+ * start of the object, containing a flat string. This is an open addressing
+ * hash table of JsVarRefs to the object's names, preceded by the number of
+ * entries in it. Because the index is always the first child we can check
+ * for it quickly, and because it's just a normal variable it gets saved and
+ * garbage collected along with the object.
+ *
+ * The index is kept up to date by jsvAddName/jsvRemoveChild. If we can't
+ * allocate memory for it, it's removed and we go back to walking the list. */
+
+/// Number of children we must walk over before we decide to create a hash index
+#define JSV_HASH_INDEX_THRESHOLD 32
+
+static uint32_t jsvHashInteger(JsVarInt v) {
+  uint32_t h = (uint32_t)v * 2654435761U;
+  return h ^ (h>>16);
+}
+
+static uint32_t jsvHashCharacter(uint32_t h, char ch) {
+  return (h ^ (unsigned char)ch) * 16777619U; // FNV-1a
+}
+
+static uint32_t jsvHashCString(const char *str) {
+  uint32_t h = 2166136261U;
+  while (*str) h = jsvHashCharacter(h, *(str++));
+  return h ^ (h>>16);
+}
+
+/** Get the hash of the given name or key. Returns false if the key can't
+ * be hashed, in which case the list of children must be searched */
+static bool jsvGetHashOfVar(JsVar *v, uint32_t *hash) {
+  if (jsvIsString(v)) {
+    uint32_t h = 2166136261U;
+    JsvStringIterator it;
+    jsvStringIteratorNew(&it, v, 0);
+    while (jsvStringIteratorHasChar(&it)) {
+      h = jsvHashCharacter(h, jsvStringIteratorGetChar(&it));
+      jsvStringIteratorNext(&it);
+    }
+    jsvStringIteratorFree(&it);
+    *hash = h ^ (h>>16);
+    return true;
+  }
+  // see jsvIsBasicVarEqual
+  if (jsvIsIntegerish(v)) {
+    *hash = jsvHashInteger(v->varData.integer);
+    return true;
+  }
+  if (jsvIsFloat(v) && v->varData.floating == (JsVarFloat)(JsVarInt)v->varData.floating) {
+    *hash = jsvHashInteger((JsVarInt)v->varData.floating);
+    return true;
+  }
+  return false;
+}
+
+/// Is this variable the name of an object's hash index?
+static bool jsvIsHashIndexName(JsVar *v) {
+  return (v->flags&JSV_VARTYPEMASK)==JSV_NAME_STRING_0+4 &&
+         !memcmp(v->varData.str, JSV_HASH_INDEX_NAME, 4) &&
+         !jsvGetLastChild(v);
+}
+
+/// Get the (unlocked) flat string containing the object's hash index, or 0
+static JsVar *jsvGetHashIndex(JsVar *parent) {
+  if (!jsvIsObject(parent)) return 0;
+  JsVarRef first = jsvGetFirstChild(parent);
+  if (!first) return 0;
+  JsVar *name = jsvGetAddressOf(first);
+  if (!jsvIsHashIndexName(name)) return 0;
+  return jsvGetAddressOf(jsvGetFirstChild(name));
+}
+
+/// Get the number of slots in the hash index (always a power of 2)
+static unsigned int jsvHashIndexGetSize(JsVar *index) {
+  return (unsigned int)(jsvGetCharactersInVar(index)/sizeof(JsVarRef)) - 1;
+}
+
+/// Get the slots in the hash index. slots[-1] contains the number of used slots
+static JsVarRef *jsvHashIndexGetSlots(JsVar *index) {
+  return ((JsVarRef*)jsvGetFlatStringPointer(index)) + 1;
+}
+
+/// Add a name to the hash index. The index must have space for it
+static void jsvHashIndexInsert(JsVar *index, JsVarRef ref, uint32_t hash) {
+  JsVarRef *slots = jsvHashIndexGetSlots(index);
+  unsigned int mask = jsvHashIndexGetSize(index)-1;
+  unsigned int i = hash & mask;
+  while (slots[i]) i = (i+1) & mask;
+  slots[i] = ref;
+  slots[-1]++;
+}
+
+/** Create a new hash index for the given object with enough space for 'count'
+ * children, and fill it in. Any existing index is replaced. Returns false if
+ * there wasn't enough memory (in which case there is no index at all) */
+static bool jsvHashIndexBuild(JsVar *parent, unsigned int count) {
+  unsigned int size = 16;
+  while (size < count*2) size <<= 1;
+  JsVar *index = jsvNewFlatStringOfLength((unsigned int)((size+1)*sizeof(JsVarRef)));
+  JsVar *name = jsvGetFirstChild(parent) ? jsvLock(jsvGetFirstChild(parent)) : 0;
+  if (name && !jsvIsHashIndexName(name)) {
+    jsvUnLock(name);
+    name = 0;
+  }
+  if (!index) {
+    // not enough memory - just remove the index and search the slow way
+    if (name) jsvRemoveChild(parent, name);
+    jsvUnLock(name);
+    return false;
+  }
+  if (!name) {
+    name = jsvMakeIntoVariableName(jsvNewFromString(JSV_HASH_INDEX_NAME), 0);
+    if (!name) {
+      jsvUnLock(index);
+      return false;
+    }
+    // Add it right at the start (jsvAddName would put it on the end)
+    jsvRef(name);
+    JsVarRef first = jsvGetFirstChild(parent);
+    JsVar *firstVar = jsvLock(first);
+    jsvSetPrevSibling(firstVar, jsvGetRef(name));
+    jsvUnLock(firstVar);
+    jsvSetNextSibling(name, first);
+    jsvSetFirstChild(parent, jsvGetRef(name));
+  }
+  JsVarRef childref = jsvGetNextSibling(name);
+  while (childref) {
+    JsVar *child = jsvLock(childref);
+    uint32_t hash = 0;
+    jsvGetHashOfVar(child, &hash); // names are always strings or ints
+    jsvHashIndexInsert(index, childref, hash);
+    childref = jsvGetNextSibling(child);
+    jsvUnLock(child);
+  }
+  jsvSetValueOfName(name, index);
+  jsvUnLock2(name, index);
+  return true;
+}
+
+/// Called when a name has been added to an object, to update its hash index
+static void jsvHashIndexAdd(JsVar *parent, JsVar *namedChild) {
+  JsVar *index = jsvGetHashIndex(parent);
+  if (!index) return;
+  uint32_t hash = 0;
+  jsvGetHashOfVar(namedChild, &hash);
+  unsigned int size = jsvHashIndexGetSize(index);
+  unsigned int count = jsvHashIndexGetSlots(index)[-1];
+  if ((count+1)*4 > size*3) {
+    // too full - make a bigger index (this includes namedChild)
+    jsvHashIndexBuild(parent, size);
+  } else {
+    jsvHashIndexInsert(index, jsvGetRef(namedChild), hash);
+  }
+}
+
+/// Called when a name is about to be removed from an object, to update its hash index
+static void jsvHashIndexRemove(JsVar *parent, JsVar *child) {
+  if (jsvIsHashIndexName(child)) return;
+  JsVar *index = jsvGetHashIndex(parent);
+  if (!index) return;
+  JsVarRef *slots = jsvHashIndexGetSlots(index);
+  unsigned int mask = jsvHashIndexGetSize(index)-1;
+  JsVarRef ref = jsvGetRef(child);
+  uint32_t hash = 0;
+  jsvGetHashOfVar(child, &hash);
+  unsigned int i = hash & mask;
+  while (slots[i] && slots[i]!=ref) i = (i+1) & mask;
+  if (!slots[i]) return; // not found - should never happen
+  /* Remove it, then move back any following entries that
+   * would no longer be found because of the gap */
+  unsigned int j = i;
+  while (true) {
+    j = (j+1) & mask;
+    if (!slots[j]) break;
+    jsvGetHashOfVar(jsvGetAddressOf(slots[j]), &hash);
+    unsigned int k = hash & mask;
+    // If k is cyclically in (i,j], the entry at j is fine where it is
+    if ((i<j) ? (i<k && k<=j) : (i<k || k<=j)) continue;
+    slots[i] = slots[j];
+    i = j;
+  }
+  slots[i] = 0;
+  slots[-1]--;
+}
+
+/** Search the hash index for a name, setting 'result' to the (locked) name
+ * or 0 if it isn't found. Returns false if the name can't be searched for
+ * with the index, and the list of children must be searched instead */
+static bool jsvHashIndexFindVar(JsVar *index, JsVar *childName, JsVar **result) {
+  uint32_t hash;
+  if (!jsvGetHashOfVar(childName, &hash)) return false;
+  JsVarRef *slots = jsvHashIndexGetSlots(index);
+  unsigned int mask = jsvHashIndexGetSize(index)-1;
+  unsigned int i = hash & mask;
+  *result = 0;
+  while (slots[i]) {
+    JsVar *child = jsvGetAddressOf(slots[i]);
+    if (jsvIsBasicVarEqual(child, childName)) {
+      *result = jsvLockAgain(child);
+      break;
+    }
+    i = (i+1) & mask;
+  }
+  return true;
+}
+
+/// Search the hash index for a name. Returns 0 if it isn't found
+static JsVar *jsvHashIndexFindString(JsVar *index, const char *name) {
+  JsVarRef *slots = jsvHashIndexGetSlots(index);
+  unsigned int mask = jsvHashIndexGetSize(index)-1;
+  unsigned int i = jsvHashCString(name) & mask;
+  while (slots[i]) {
+    JsVar *child = jsvGetAddressOf(slots[i]);
+    if (jsvIsStringEqual(child, name))
+      return jsvLockAgain(child);
+    i = (i+1) & mask;
+  }
+  return 0;
+}
+
+/// Called after a search of the list of children, to create an index if the list was long
+static void jsvHashIndexCheckNeeded(JsVar *parent, unsigned int childrenSearched) {
+  if (childrenSearched > JSV_HASH_INDEX_THRESHOLD && !isMemoryBusy && jsvIsObject(parent))
+    jsvHashIndexBuild(parent, (unsigned int)jsvGetChildren(parent));
+}
+#else
+#define jsvIsHashIndexName(V) false
+#define jsvGetHashIndex(PARENT) ((JsVar*)0)
+#define jsvHashIndexFindString(INDEX, NAME) ((JsVar*)0)
+#define jsvHashIndexFindVar(INDEX, NAME, RESULT) false
+#define jsvHashIndexCheckNeeded(PARENT, COUNT) NOT_USED(COUNT)
+#define jsvHashIndexAdd(PARENT, CHILD)
+#define jsvHashIndexRemove(PARENT, CHILD)
+#endif
+
+#ifndef SAVE_ON_FLASH
+/* Dense index for arrays.
+ *
+ * Array elements are stored as a sorted linked list of names, so finding
+ * element 'n' means walking the list. If an array's elements are numbered
+ * contiguously from 0 (with no holes or non-integer keys) and we have to walk
+ * more than JSV_ARRAY_INDEX_THRESHOLD elements, we create a flat string of
+ * JsVarRefs where slot n refers to the name of element n, preceded by the
+ * number of elements. This is referenced from the array's nextSibling, which
+ * is otherwise unused for arrays.
+ *
+ * Pushing and popping at the end of the array keep the index up to date. Any
+ * other change to the array's structure just removes it, and it'll be
+ * recreated later if the array is dense again. Every lookup also checks that
+ * the name it finds has the right index, so renumbering the array's keys in
+ * place (eg. Array.reverse) just means the index gets removed. */
+
+/// Number of elements we must walk over before we decide to create an index
+#define JSV_ARRAY_INDEX_THRESHOLD 16
+
+/// Get the (unlocked) flat string containing the array's index, or 0
+static JsVar *jsvArrayIndexGet(const JsVar *arr) {
+  JsVarRef ref = jsvGetNextSibling(arr);
+  return ref ? jsvGetAddressOf(ref) : 0;
+}
+
+/// Remove the array's index (if it has one)
+static void jsvArrayIndexRemove(JsVar *arr) {
+  JsVarRef ref = jsvGetNextSibling(arr);
+  if (!ref) return;
+  jsvSetNextSibling(arr, 0);
+  jsvUnRefRef(ref);
+}
+
+/** Replace the array's index with a new one with space for 'size' elements.
+ * The first 'count' elements are copied from 'old' if it is nonzero. Returns
+ * the new index (unlocked) or 0 if there wasn't enough memory */
+static JsVar *jsvArrayIndexNew(JsVar *arr, JsVar *old, JsVarRef count, unsigned int size) {
+  JsVar *index = jsvNewFlatStringOfLength((unsigned int)((size+1)*sizeof(JsVarRef)));
+  if (index && old)
+    memcpy(jsvGetFlatStringPointer(index), jsvGetFlatStringPointer(old), (count+1)*sizeof(JsVarRef));
+  jsvArrayIndexRemove(arr);
+  if (!index) return 0;
+  jsvSetNextSibling(arr, jsvGetRef(jsvRef(index)));
+  jsvUnLock(index);
+  return index;
+}
+
+/// Called after walking 'elementsSearched' elements of an array, to create an index if needed
+static void jsvArrayIndexCheckNeeded(JsVar *arr, unsigned int elementsSearched) {
+  if (elementsSearched <= JSV_ARRAY_INDEX_THRESHOLD || isMemoryBusy ||
+      !jsvIsArray(arr) || jsvGetNextSibling(arr))
+    return;
+  JsVarInt length = jsvGetArrayLength(arr);
+  if ((JsVarInt)(JsVarRef)length != length) return;
+  // Check that the array is dense
+  JsVarInt i = 0;
+  JsVarRef childref = jsvGetFirstChild(arr);
+  while (childref) {
+    JsVar *child = jsvGetAddressOf(childref);
+    if (!jsvIsInt(child) || child->varData.integer!=i) return;
+    i++;
+    childref = jsvGetNextSibling(child);
+  }
+  if (i != length) return;
+  unsigned int size = 16;
+  while (size < (unsigned int)length) size <<= 1;
+  JsVar *index = jsvArrayIndexNew(arr, 0, 0, size);
+  if (!index) return;
+  JsVarRef *slots = (JsVarRef*)jsvGetFlatStringPointer(index);
+  slots[0] = (JsVarRef)length;
+  childref = jsvGetFirstChild(arr);
+  while (childref) {
+    *(++slots) = childref;
+    childref = jsvGetNextSibling(jsvGetAddressOf(childref));
+  }
+}
+
+/// Called when a name has been added to an array, to update its index
+static void jsvArrayIndexAdd(JsVar *arr, JsVar *namedChild) {
+  JsVar *index = jsvArrayIndexGet(arr);
+  if (!index) return;
+  JsVarRef *slots = (JsVarRef*)jsvGetFlatStringPointer(index);
+  JsVarRef count = slots[0];
+  if (!jsvIsInt(namedChild) || namedChild->varData.integer != (JsVarInt)count) {
+    // not added on the end, so the array may not be dense any more
+    jsvArrayIndexRemove(arr);
+    return;
+  }
+  unsigned int size = (unsigned int)(jsvGetCharactersInVar(index)/sizeof(JsVarRef)) - 1;
+  if (count >= size) {
+    index = jsvArrayIndexNew(arr, index, count, size*2);
+    if (!index) return;
+    slots = (JsVarRef*)jsvGetFlatStringPointer(index);
+  }
+  slots[count+1] = jsvGetRef(namedChild);
+  slots[0] = (JsVarRef)(count+1);
+}
+
+/// Called when a name is about to be removed from an array, to update its index
+static void jsvArrayIndexRemoveChild(JsVar *arr, JsVar *child) {
+  JsVar *index = jsvArrayIndexGet(arr);
+  if (!index) return;
+  JsVarRef *slots = (JsVarRef*)jsvGetFlatStringPointer(index);
+  JsVarRef count = slots[0];
+  if (count && slots[count]==jsvGetRef(child)) {
+    slots[0] = (JsVarRef)(count-1); // removed from the end, so still dense
+  } else {
+    jsvArrayIndexRemove(arr);
+  }
+}
+
+/** Look up an element using the array's index, setting 'result' to the
+ * (locked) name or 0 if it isn't found. Returns false if the array has no
+ * index, and the list of elements must be searched instead */
+static bool jsvArrayIndexFind(JsVar *arr, JsVarInt i, JsVar **result) {
+  JsVar *index = jsvArrayIndexGet(arr);
+  if (!index) return false;
+  JsVarRef *slots = (JsVarRef*)jsvGetFlatStringPointer(index);
+  *result = 0;
+  if (i<0 || i>=(JsVarInt)slots[0]) return true; // not in the array
+  JsVar *child = jsvGetAddressOf(slots[i+1]);
+  if (!jsvIsName(child) || !jsvIsInt(child) || child->varData.integer!=i) {
+    // the array's keys have been changed - remove the index
+    jsvArrayIndexRemove(arr);
+    return false;
+  }
+  *result = jsvLockAgain(child);
+  return true;
+}
+#else
+#define jsvArrayIndexRemove(ARR)
+#define jsvArrayIndexCheckNeeded(ARR, COUNT) NOT_USED(COUNT)
+#define jsvArrayIndexAdd(ARR, CHILD)
+#define jsvArrayIndexRemoveChild(ARR, CHILD)
+#define jsvArrayIndexFind(ARR, I, RESULT) false
+#endif
+
 /** Copy only a name, not what it points to. ALTHOUGH the link to what it points to is maintained unless linkChildren=false
     If keepAsName==false, this will be converted into a normal variable */
 JsVar *jsvCopyNameOnly(JsVar *src, bool linkChildren, bool keepAsName) {
@@ -2244,7 +2863,8 @@ JsVar *jsvCopy(JsVar *src, bool copyChildren) {
       vr = jsvGetFirstChild(src);
       while (vr) {
         JsVar *name = jsvLock(vr);
-        JsVar *child = jsvCopyNameOnly(name, true/*link children*/, true/*keep as name*/); // NO DEEP COPY!
+        // the hash index refers to src's children, so don't copy it
+        JsVar *child = jsvIsHashIndexName(name) ? 0 : jsvCopyNameOnly(name, true/*link children*/, true/*keep as name*/); // NO DEEP COPY!
         if (child) { // could have been out of memory
           jsvAddName(dst, child);
           jsvUnLock(child);
@@ -2312,6 +2932,12 @@ void jsvAddName(JsVar *parent, JsVar *namedChild) {
     jsvSetFirstChild(parent, r);
     jsvSetLastChild(parent, r);
   }
+  if (jsvIsArray(parent))
+    jsvArrayIndexAdd(parent, namedChild);
+  else {
+    jsvHashIndexAdd(parent, namedChild);
+    jsvShapeChanged(parent);
+  }
 }
 
 JsVar *jsvAddNamedChild(JsVar *parent, JsVar *child, const char *name) {
@@ -2341,8 +2967,10 @@ JsVar *jsvSetValueOfName(JsVar *name, JsVar *src) {
     else
       name->flags = (name->flags & (JsVarFlags)~JSV_VARTYPEMASK) | JSV_NAME_INT;
     jsvSetFirstChild(name, 0);
-  } else if (jsvGetFirstChild(name))
+  } else if (jsvGetFirstChild(name)) {
+    jsvShapeValueChanged(name, src);
     jsvUnRefRef(jsvGetFirstChild(name)); // free existing
+  }
   if (src) {
     if (jsvIsInt(name)) {
       if ((jsvIsInt(src) || jsvIsBoolean(src)) && !jsvIsPin(src)) {
@@ -2396,6 +3024,13 @@ JsVar *jsvFindChildFromString(JsVar *parent, const char *name, bool addIfNotFoun
 
   assert(jsvHasChildren(parent));
   JsVarRef childref = jsvGetFirstChild(parent);
+  JsVar *index = jsvGetHashIndex(parent);
+  if (index) {
+    JsVar *child = jsvHashIndexFindString(index, name);
+    if (child) return child;
+    childref = 0; // not in the index, so no need to search
+  }
+  unsigned int childrenSearched = 0;
   while (childref) {
     // Don't Lock here, just use GetAddressOf - to try and speed up the finding
     // TODO: We can do this now, but when/if we move to cacheing vars, it'll break
@@ -2403,10 +3038,14 @@ JsVar *jsvFindChildFromString(JsVar *parent, const char *name, bool addIfNotFoun
     if (*(int*)fastCheck==*(int*)child->varData.str && // speedy check of first 4 bytes
         jsvIsStringEqual(child, name)) {
       // found it! unlock parent but leave child locked
-      return jsvLockAgain(child);
+      child = jsvLockAgain(child);
+      jsvHashIndexCheckNeeded(parent, childrenSearched);
+      return child;
     }
     childref = jsvGetNextSibling(child);
+    childrenSearched++;
   }
+  jsvHashIndexCheckNeeded(parent, childrenSearched);
 
   JsVar *child = 0;
   if (addIfNotFound) {
@@ -2450,16 +3089,31 @@ JsVar *jsvAsName(JsVar *var) {
 JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound) {
   JsVar *child;
   JsVarRef childref = jsvGetFirstChild(parent);
+  if (jsvIsArray(parent)) {
+    if (jsvIsInt(childName) && jsvArrayIndexFind(parent, childName->varData.integer, &child)) {
+      if (child) return child;
+      childref = 0; // not in the index, so no need to search
+    }
+  } else {
+    JsVar *index = jsvGetHashIndex(parent);
+    if (index && jsvHashIndexFindVar(index, childName, &child)) {
+      if (child) return child;
+      childref = 0; // not in the index, so no need to search
+    }
+  }
 
+  unsigned int childrenSearched = 0;
   while (childref) {
     child = jsvLock(childref);
-    if (jsvIsBasicVarEqual(child, childName)) {
-      // found it! unlock parent but leave child locked
-      return child;
-    }
+    if (jsvIsBasicVarEqual(child, childName))
+      break; // found it! unlock parent but leave child locked
     childref = jsvGetNextSibling(child);
     jsvUnLock(child);
+    childrenSearched++;
   }
+  jsvHashIndexCheckNeeded(parent, childrenSearched);
+  jsvArrayIndexCheckNeeded(parent, childrenSearched);
+  if (childref) return child;
 
   child = 0;
   if (addIfNotFound && childName) {
@@ -2472,6 +3126,12 @@ JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound)
 void jsvRemoveChild(JsVar *parent, JsVar *child) {
   assert(jsvHasChildren(parent));
   assert(jsvIsName(child));
+  if (jsvIsArray(parent))
+    jsvArrayIndexRemoveChild(parent, child);
+  else {
+    jsvHashIndexRemove(parent, child);
+    jsvShapeChanged(parent);
+  }
   JsVarRef childref = jsvGetRef(child);
   bool wasChild = false;
   // unlink from parent
@@ -2695,6 +3355,10 @@ static size_t _jsvCountJsVarsUsedRecursive(JsVar *v, bool resetRecursionFlag) {
     }
   } else if (jsvIsFlatString(v))
     count += jsvGetFlatStringBlocks(v);
+#ifndef SAVE_ON_FLASH
+  if (jsvIsArray(v) && jsvGetNextSibling(v)) // the array's index (see jsvArrayIndexGet)
+    count += 1 + jsvGetFlatStringBlocks(jsvGetAddressOf(jsvGetNextSibling(v)));
+#endif
   if (jsvHasCharacterData(v)) {
     JsVarRef childref = jsvGetLastChild(v);
     while (childref) {
@@ -2721,11 +3385,14 @@ size_t jsvCountJsVarsUsed(JsVar *v) {
 }
 
 JsVar *jsvGetArrayIndex(const JsVar *arr, JsVarInt index) {
+  JsVar *child;
+  if (jsvArrayIndexFind((JsVar*)arr, index, &child))
+    return child;
   JsVarRef childref = jsvGetLastChild(arr);
   JsVarInt lastArrayIndex = 0;
   // Look at last non-string element!
   while (childref) {
-    JsVar *child = jsvLock(childref);
+    child = jsvLock(childref);
     if (jsvIsInt(child)) {
       lastArrayIndex = child->varData.integer;
       // it was the last element... sorted!
@@ -2742,34 +3409,37 @@ JsVar *jsvGetArrayIndex(const JsVar *arr, JsVarInt index) {
   // it's not in this array - don't search the whole lot...
   if (index > lastArrayIndex)
     return 0;
+  unsigned int elementsSearched = 0;
   // otherwise is it more than halfway through?
   if (index > lastArrayIndex/2) {
     // it's in the final half of the array (probably) - search backwards
     while (childref) {
-      JsVar *child = jsvLock(childref);
+      child = jsvLock(childref);
 
       assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
+      if (child->varData.integer == index)
+        break;
       childref = jsvGetPrevSibling(child);
       jsvUnLock(child);
+      elementsSearched++;
     }
   } else {
     // it's in the first half of the array (probably) - search forwards
     childref = jsvGetFirstChild(arr);
     while (childref) {
-      JsVar *child = jsvLock(childref);
+      child = jsvLock(childref);
 
       assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
+      if (child->varData.integer == index)
+        break;
       childref = jsvGetNextSibling(child);
       jsvUnLock(child);
+      elementsSearched++;
     }
   }
-  return 0; // undefined
+  if (!childref) child = 0; // undefined
+  jsvArrayIndexCheckNeeded((JsVar*)arr, elementsSearched);
+  return child;
 }
 
 JsVar *jsvGetArrayItem(const JsVar *arr, JsVarInt index) {
@@ -2934,6 +3604,7 @@ JsVar *jsvArrayPop(JsVar *arr) {
 /// Removes the first element of an array, and returns that element (or 0 if empty). DOES NOT RENUMBER.
 JsVar *jsvArrayPopFirst(JsVar *arr) {
   assert(jsvIsArray(arr));
+  jsvArrayIndexRemove(arr); // elements will be renumbered
   if (jsvGetFirstChild(arr)) {
     JsVar *child = jsvLock(jsvGetFirstChild(arr));
     if (jsvGetFirstChild(arr) == jsvGetLastChild(arr))
@@ -2999,6 +3670,7 @@ JsVar *jsvArrayJoin(JsVar *arr, JsVar *filler) {
 /// Insert a new element before beforeIndex, DOES NOT UPDATE INDICES
 void jsvArrayInsertBefore(JsVar *arr, JsVar *beforeIndex, JsVar *element) {
   if (beforeIndex) {
+    jsvArrayIndexRemove(arr); // elements will be renumbered
     JsVar *idxVar = jsvMakeIntoVariableName(jsvNewFromInteger(0), element);
     if (!idxVar) return; // out of memory
 
@@ -3368,10 +4040,43 @@ void jsvTrace(JsVar *var, int indent) {
 }
 
 
+#ifndef SAVE_ON_FLASH
+/// Add the time since startTime to the GC stats
+static void jsvGarbageCollectAddStats(JsSysTime startTime, bool finished) {
+  JsSysTime pause = jshGetSystemTime() - startTime;
+  if (pause > jsvGCStats.maxPause) jsvGCStats.maxPause = pause;
+  if (finished) jsvGCStats.count++;
+  else jsvGCStats.slices++;
+}
+
+#endif
+
+static void jsvGarbageCollectMarkChildren(JsVar *var, bool incremental);
+
 /** Recursively mark the variable */
 static void jsvGarbageCollectMarkUsed(JsVar *var) {
   var->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
+  jsvGarbageCollectMarkChildren(var, false);
+}
+
+/** Mark a variable that is linked to from something that's used. If
+ * incremental and the variable is after jsvGCCursor, we just flag it -
+ * its children get marked when the cursor gets to it. */
+static void jsvGarbageCollectMarkChild(JsVar *var, bool incremental) {
+  if (!(var->flags & JSV_GARBAGE_COLLECT)) return; // already marked
+#ifndef SAVE_ON_FLASH
+  if (incremental && jsvGetRef(var) >= jsvGCCursor) {
+    var->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
+    return;
+  }
+#else
+  NOT_USED(incremental);
+#endif
+  jsvGarbageCollectMarkUsed(var);
+}
 
+/** Mark everything that the variable links to */
+static void jsvGarbageCollectMarkChildren(JsVar *var, bool incremental) {
   if (jsvHasCharacterData(var)) {
     // non-recursively scan strings
     JsVarRef child = jsvGetLastChild(var);
@@ -3384,18 +4089,21 @@ static void jsvGarbageCollectMarkUsed(JsVar *var) {
   }
   // intentionally no else
   if (jsvHasSingleChild(var)) {
-    if (jsvGetFirstChild(var)) {
-      JsVar *childVar = jsvGetAddressOf(jsvGetFirstChild(var));
-      if (childVar->flags & JSV_GARBAGE_COLLECT)
-        jsvGarbageCollectMarkUsed(childVar);
-    }
+    if (jsvGetFirstChild(var))
+      jsvGarbageCollectMarkChild(jsvGetAddressOf(jsvGetFirstChild(var)), incremental);
   } else if (jsvHasChildren(var)) {
+#ifndef SAVE_ON_FLASH
+    if (jsvIsArray(var) && jsvGetNextSibling(var)) {
+      // the array's index (see jsvArrayIndexGet)
+      JsVar *childVar = jsvGetAddressOf(jsvGetNextSibling(var));
+      childVar->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
+    }
+#endif
     JsVarRef child = jsvGetFirstChild(var);
     while (child) {
       JsVar *childVar;
       childVar = jsvGetAddressOf(child);
-      if (childVar->flags & JSV_GARBAGE_COLLECT)
-        jsvGarbageCollectMarkUsed(childVar);
+      jsvGarbageCollectMarkChild(childVar, incremental);
       child = jsvGetNextSibling(childVar);
     }
   }
@@ -3405,6 +4113,15 @@ static void jsvGarbageCollectMarkUsed(JsVar *var) {
 int jsvGarbageCollect() {
   if (isMemoryBusy) return false;
   isMemoryBusy = MEMBUSY_GC;
+#ifndef SAVE_ON_FLASH
+  JsSysTime startTime = jshGetSystemTime();
+  /* we're marking everything again, so any incremental collection can be
+   * abandoned - but if we were freeing, the rest of the garbage may link to
+   * variables that have already been freed and reused, so finish that first */
+  if (jsvGCPhase == JSVGC_SWEEP)
+    jsvGarbageCollectSweep(jsVarsSize);
+  jsvGCPhase = JSVGC_IDLE;
+#endif
   JsVarRef i;
   // Add GC flags to anything that is currently used
   for (i=1;i<=jsVarsSize;i++)  {
@@ -3441,6 +4158,7 @@ int jsvGarbageCollect() {
         unsigned int count = (unsigned int)jsvGetFlatStringBlocks(var);
         freedCount+=count;
         // Free the first block
+        jsvStringTailForget(i);
         var->flags = JSV_UNUSED;
         // add this to our free list
         if (lastEmpty) jsvSetNextSibling(lastEmpty, i);
@@ -3472,6 +4190,11 @@ int jsvGarbageCollect() {
               jsvUnRef(child);
           }
         }
+#ifndef SAVE_ON_FLASH
+        // cached lookups could refer to this function's children (see jsvShapeChanged)
+        if (jsvIsNativeFunction(var) && jsvGetFirstChild(var))
+          jsvShapeEpoch++;
+#endif
         /* Sanity checks here. We're making sure that any variables that are
          * linked from this one have either already been garbage collected or
          * are marked for GC */
@@ -3488,6 +4211,7 @@ int jsvGarbageCollect() {
             jsvGetAddressOf(jsvGetNextSibling(var))->flags==JSV_UNUSED ||
             (jsvGetAddressOf(jsvGetNextSibling(var))->flags&JSV_GARBAGE_COLLECT));
         // free!
+        jsvStringTailForget(i);
         var->flags = JSV_UNUSED;
         // add this to our free list
         if (lastEmpty) jsvSetNextSibling(lastEmpty, i);
@@ -3506,10 +4230,303 @@ int jsvGarbageCollect() {
     }
   }
   if (lastEmpty) jsvSetNextSibling(lastEmpty, 0);
+  jsvUpdateLargestFreeRun();
+#ifndef SAVE_ON_FLASH
+  jsvGarbageCollectAddStats(startTime, true);
+#endif
   isMemoryBusy = MEM_NOT_BUSY;
   return (int)freedCount;
 }
 
+#ifndef SAVE_ON_FLASH
+/* Incremental garbage collection is split into small slices, with
+ * JavaScript running in between. It works the same way as
+ * jsvGarbageCollect, except:
+ *
+ * * Variables are scanned in order by jsvGCCursor rather than recursively.
+ *   Anything linked to from a used variable that's after the cursor is
+ *   just marked, and scanned when the cursor reaches it.
+ * * Anything that was used when marking started must not be freed, so
+ *   when a reference is removed from a variable while we're marking
+ *   (jsvUnRef) it is marked too.
+ * * New variables are created without JSV_GARBAGE_COLLECT set, so are
+ *   never freed by the collection that was in progress when they were
+ *   created.
+ *
+ * Garbage can't become used again, so anything not marked when the cursor
+ * gets to the end can be freed (again a slice at a time). */
+
+bool jsvGarbageCollectInProgress() {
+  return jsvGCPhase != JSVGC_IDLE;
+}
+
+/// Called when a reference to var has been removed
+static void jsvGarbageCollectRemovedRef(JsVar *var) {
+  if (jsvGCPhase == JSVGC_MARK)
+    jsvGarbageCollectMarkChild(var, true);
+}
+
+/// Called when blocks first..last have been allocated for a flat string
+static void jsvGarbageCollectFlatStringAllocated(JsVarRef first, JsVarRef last) {
+  // Don't let the cursor end up in the middle of the string's data
+  if (jsvGCPhase != JSVGC_IDLE && jsvGCCursor > first && jsvGCCursor <= last)
+    jsvGCCursor = (JsVarRef)(last+1);
+}
+
+/// Free up to 'budget' variables that weren't marked, from jsvGCCursor onwards
+static void jsvGarbageCollectSweep(unsigned int budget) {
+  while (budget && jsvGCCursor <= jsVarsSize) {
+    JsVar *var = jsvGetAddressOf(jsvGCCursor++);
+    if (var->flags & JSV_GARBAGE_COLLECT) {
+      if (jsvIsFlatString(var)) {
+        unsigned int count = (unsigned int)jsvGetFlatStringBlocks(var);
+        while (count-- > 0) {
+          JsVar *block = jsvGetAddressOf(jsvGCCursor++);
+          block->flags = JSV_UNUSED; // the block is data, so make sure the lock count is 0
+          jsvFreePtrInternal(block);
+        }
+      } else if (jsvIsNativeFunction(var) && jsvGetFirstChild(var)) {
+        // cached lookups could refer to this function's children (see jsvShapeChanged)
+        jsvShapeEpoch++;
+      }
+      jsvFreePtrInternal(var);
+    } else if (jsvIsFlatString(var)) {
+      jsvGCCursor = (JsVarRef)(jsvGCCursor+jsvGetFlatStringBlocks(var));
+    }
+    budget--;
+  }
+  if (jsvGCCursor > jsVarsSize)
+    jsvGCPhase = JSVGC_IDLE;
+}
+
+bool jsvGarbageCollectSlice() {
+  if (isMemoryBusy) return jsvGarbageCollectInProgress();
+  isMemoryBusy = MEMBUSY_GC;
+  JsSysTime startTime = jshGetSystemTime();
+  unsigned int budget = jsvGCSliceSize;
+  JsVarRef i;
+  if (jsvGCPhase == JSVGC_IDLE) {
+    /* Start a new collection. Flag everything, and anything that is locked
+     * needs to be scanned. This isn't split up, but it's a lot faster than
+     * marking. */
+    for (i=1;i<=jsVarsSize;i++)  {
+      JsVar *var = jsvGetAddressOf(i);
+      if ((var->flags&JSV_VARTYPEMASK) != JSV_UNUSED) {
+        if (!jsvGetLocks(var))
+          var->flags |= (JsVarFlags)JSV_GARBAGE_COLLECT;
+        if (jsvIsFlatString(var))
+          i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+      }
+    }
+    jsvGCPhase = JSVGC_MARK;
+    jsvGCCursor = 1;
+  } else if (jsvGCPhase == JSVGC_MARK) {
+    while (budget && jsvGCCursor <= jsVarsSize) {
+      JsVar *var = jsvGetAddressOf(jsvGCCursor++);
+      if ((var->flags&JSV_VARTYPEMASK) != JSV_UNUSED) {
+        if (!(var->flags & JSV_GARBAGE_COLLECT))
+          jsvGarbageCollectMarkChildren(var, true);
+        if (jsvIsFlatString(var))
+          jsvGCCursor = (JsVarRef)(jsvGCCursor+jsvGetFlatStringBlocks(var));
+      }
+      budget--;
+    }
+    if (jsvGCCursor > jsVarsSize) {
+      jsvGCPhase = JSVGC_UNLINK;
+      jsvGCCursor = 1;
+    }
+  } else if (jsvGCPhase == JSVGC_UNLINK) {
+    /* As in jsvGarbageCollect - anything that was used needs unreffing.
+     * This must be done before anything is freed, as once it has been the
+     * child could be reused for something else. */
+    while (budget && jsvGCCursor <= jsVarsSize) {
+      JsVar *var = jsvGetAddressOf(jsvGCCursor++);
+      if ((var->flags & JSV_GARBAGE_COLLECT) && jsvHasSingleChild(var) && jsvGetFirstChild(var)) {
+        JsVar *child = jsvGetAddressOf(jsvGetFirstChild(var));
+        if (!(child->flags&JSV_GARBAGE_COLLECT)) {
+          jsvUnRef(child);
+          jsvSetFirstChild(var, 0);
+        }
+      } else if (jsvIsFlatString(var)) {
+        jsvGCCursor = (JsVarRef)(jsvGCCursor+jsvGetFlatStringBlocks(var));
+      }
+      budget--;
+    }
+    if (jsvGCCursor > jsVarsSize) {
+      jsvGCPhase = JSVGC_SWEEP;
+      jsvGCCursor = 1;
+    }
+  } else { // JSVGC_SWEEP
+    jsvGarbageCollectSweep(budget);
+  }
+  jsvGarbageCollectAddStats(startTime, jsvGCPhase == JSVGC_IDLE);
+  isMemoryBusy = MEM_NOT_BUSY;
+  return jsvGarbageCollectInProgress();
+}
+#endif
+
+#ifndef SAVE_ON_FLASH
+/// Work out jsVarLargestFreeRun from the free list
+static void jsvUpdateLargestFreeRun() {
+  unsigned int largest = 0, run = 0;
+  JsVarRef ref = jsVarFirstEmpty, last = 0;
+  while (ref) {
+    JsVar *var = jsvGetAddressOf(ref);
+#ifdef RESIZABLE_JSVARS
+    if (last && jsvGetAddressOf(last)+1==var) run++;
+#else
+    if (last && last+1==ref) run++;
+#endif
+    else run = 1;
+    if (run > largest) largest = run;
+    last = ref;
+    ref = jsvGetNextSibling(var);
+  }
+  jsVarLargestFreeRun = largest;
+}
+
+/* Defragmentation.
+ *
+ * Variables that aren't locked can be moved, as everything that refers to
+ * them is another variable. We do this in batches: find the last
+ * JSV_DEFRAG_BATCH movable variables in memory and move each one (starting
+ * at the end) to the first free variable, leaving behind a variable with
+ * just JSV_GARBAGE_COLLECT set and firstChild pointing to where it went.
+ * Then we go through all variables, updating any references to the ones
+ * that moved, and put the free list back in order. */
+
+/// How many variables to move before updating references
+#define JSV_DEFRAG_BATCH 128
+
+/// If ref is a variable that has been moved, return where it's moved to
+static JsVarRef jsvDefragmentGetRef(JsVarRef ref) {
+  if (!ref) return 0;
+  JsVar *var = jsvGetAddressOf(ref);
+  return (var->flags == JSV_GARBAGE_COLLECT) ? jsvGetFirstChild(var) : ref;
+}
+
+/// Can the variable be moved?
+static bool jsvDefragmentCanMove(JsVar *var, bool timerRunning) {
+  JsVarRef ref = jsvGetRef(var);
+  return (var->flags&JSV_VARTYPEMASK)!=JSV_UNUSED &&
+         !jsvGetLocks(var) &&
+         !jsvIsFlatString(var) &&
+         // referenced directly from jsinteractive.c
+         ref!=timerArray && ref!=watchArray &&
+         // the utility timer could be reading string data (eg. waveforms) in an IRQ
+         !(timerRunning && jsvHasCharacterData(var));
+}
+
+/// Update the references in var to anything that has been moved
+static void jsvDefragmentUpdateRefs(JsVar *var) {
+  if (jsvHasCharacterData(var) && !jsvIsFlatString(var) && !jsvIsNativeString(var))
+    jsvSetLastChild(var, jsvDefragmentGetRef(jsvGetLastChild(var)));
+  if (jsvIsName(var)) {
+    jsvSetNextSibling(var, jsvDefragmentGetRef(jsvGetNextSibling(var)));
+    jsvSetPrevSibling(var, jsvDefragmentGetRef(jsvGetPrevSibling(var)));
+  }
+  if (jsvHasSingleChild(var)) {
+    jsvSetFirstChild(var, jsvDefragmentGetRef(jsvGetFirstChild(var)));
+  } else if (jsvHasChildren(var)) {
+    jsvSetFirstChild(var, jsvDefragmentGetRef(jsvGetFirstChild(var)));
+    jsvSetLastChild(var, jsvDefragmentGetRef(jsvGetLastChild(var)));
+    // The indexes are flat strings (so never moved) that contain references
+    JsVarRef *slots = 0;
+    unsigned int i, count = 0;
+    if (jsvIsArray(var)) {
+      JsVar *index = jsvArrayIndexGet(var);
+      if (index) {
+        slots = (JsVarRef*)jsvGetFlatStringPointer(index) + 1;
+        count = slots[-1];
+      }
+    } else {
+      JsVar *index = jsvGetHashIndex(var);
+      if (index) {
+        slots = jsvHashIndexGetSlots(index);
+        count = jsvHashIndexGetSize(index);
+      }
+    }
+    for (i=0;i<count;i++)
+      slots[i] = jsvDefragmentGetRef(slots[i]);
+  }
+}
+
+/// Move one batch of variables - return how many were moved
+static unsigned int jsvDefragmentBatch() {
+  bool timerRunning = jstUtilTimerIsRunning();
+  JsVarRef candidates[JSV_DEFRAG_BATCH];
+  unsigned int count = 0;
+  JsVarRef i;
+  // Find the last JSV_DEFRAG_BATCH variables that we could move
+  for (i=1;i<=jsVarsSize;i++) {
+    JsVar *var = jsvGetAddressOf(i);
+    if (jsvDefragmentCanMove(var, timerRunning))
+      candidates[(count++) % JSV_DEFRAG_BATCH] = i;
+    if (jsvIsFlatString(var))
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+  }
+  unsigned int n = (count < JSV_DEFRAG_BATCH) ? count : JSV_DEFRAG_BATCH;
+  // Move them, last first, to the first free variables (the free list is in order)
+  unsigned int moved = 0;
+  while (moved < n) {
+    JsVarRef from = candidates[(count-1-moved) % JSV_DEFRAG_BATCH];
+    JsVarRef to = jsVarFirstEmpty;
+    if (!to || to > from) break; // nowhere earlier to put it
+    JsVar *toVar = jsvGetAddressOf(to);
+    JsVar *fromVar = jsvGetAddressOf(from);
+    jsVarFirstEmpty = jsvGetNextSibling(toVar);
+    *toVar = *fromVar;
+    fromVar->flags = JSV_GARBAGE_COLLECT;
+    jsvSetFirstChild(fromVar, to);
+    moved++;
+  }
+  if (!moved) return 0;
+  // Update references, then free what was left behind and rebuild the free list
+  for (i=1;i<=jsVarsSize;i++) {
+    JsVar *var = jsvGetAddressOf(i);
+    if ((var->flags&JSV_VARTYPEMASK) != JSV_UNUSED) {
+      jsvDefragmentUpdateRefs(var);
+      if (jsvIsFlatString(var))
+        i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+    }
+  }
+  JsVar *lastEmpty = 0;
+  jsVarFirstEmpty = 0;
+  for (i=1;i<=jsVarsSize;i++) {
+    JsVar *var = jsvGetAddressOf(i);
+    if ((var->flags&JSV_VARTYPEMASK) == JSV_UNUSED) {
+      var->flags = JSV_UNUSED;
+      if (lastEmpty) jsvSetNextSibling(lastEmpty, i);
+      else jsVarFirstEmpty = i;
+      lastEmpty = var;
+    } else if (jsvIsFlatString(var)) {
+      i = (JsVarRef)(i+jsvGetFlatStringBlocks(var));
+    }
+  }
+  if (lastEmpty) jsvSetNextSibling(lastEmpty, 0);
+  return moved;
+}
+
+unsigned int jsvDefragment() {
+  // Get rid of garbage first - this also puts the free list in order
+  jsvGarbageCollect();
+  if (isMemoryBusy) return 0;
+  isMemoryBusy = MEMBUSY_SYSTEM;
+  jshInterruptOff();
+  jsvStringTailStr = 0; // refs will change
+  unsigned int moved = 0, m;
+  while ((m = jsvDefragmentBatch()) > 0)
+    moved += m;
+  touchedFreeList = true;
+  jsvUpdateLargestFreeRun();
+  // cached lookups (see jspGetNamedFieldAtSite) contain references
+  if (moved) jsvShapeEpoch++;
+  jshInterruptOn();
+  isMemoryBusy = MEM_NOT_BUSY;
+  return moved;
+}
+#endif
+
 #ifndef RELEASE
 // Dump any locked variables that aren't referenced from `global` - for debugging memory leaks
 void jsvDumpLockedVars() {
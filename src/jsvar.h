@@ -464,6 +464,7 @@ JsVar *jsvAsFlatString(JsVar *var); ///< Create a flat string from the given var
 bool jsvIsEmptyString(JsVar *v); ///< Returns true if the string is empty - faster than jsvGetStringLength(v)==0
 size_t jsvGetStringLength(const JsVar *v); ///< Get the length of this string, IF it is a string
 size_t jsvGetFlatStringBlocks(const JsVar *v); ///< return the number of blocks used by the given flat string - EXCLUDING the first data block
+void jsvTruncateFlatString(JsVar *v, size_t byteLength); ///< Shrink a flat string to the given length, freeing the blocks it no longer needs
 char *jsvGetFlatStringPointer(JsVar *v); ///< Get a pointer to the data in this flat string
 JsVar *jsvGetFlatStringFromPointer(char *v); ///< Given a pointer to the first element of a flat string, return the flat string itself (DANGEROUS!)
 char *jsvGetDataPointer(JsVar *v, size_t *len); ///< If the variable points to a *flat* area of memory, return a pointer (and set length). Otherwise return 0.
@@ -601,6 +602,19 @@ JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound);
 void jsvRemoveChild(JsVar *parent, JsVar *child);
 void jsvRemoveAllChildren(JsVar *parent);
 
+#ifndef SAVE_ON_FLASH
+/// Incremented whenever something changes that could affect a lookup via a prototype (see jsvGetShape)
+extern uint32_t jsvShapeEpoch;
+/** Get the 'shape' of an object or non-native function - a number that changes
+ * whenever children are added to or removed from it. Returns 0 if we can't
+ * track the shape of this variable. */
+JsVarRef jsvGetShape(JsVar *v);
+/// Flag that this is used as a prototype, so changes to its children increment jsvShapeEpoch
+void jsvSetShapeIsPrototype(JsVar *v);
+/// Forget the shapes of all variables, and increment jsvShapeEpoch
+void jsvResetShapes();
+#endif
+
 /// Get the named child of an object. If createChild!=0 then create the child
 JsVar *jsvObjectGetChild(JsVar *obj, const char *name, JsVarFlags createChild);
 /// Set the named child of an object, and return the child (so you can choose to unlock it if you want)
@@ -650,6 +664,35 @@ void jsvTrace(JsVar *var, int indent);
 /** Run a garbage collection sweep - return nonzero if things have been freed */
 int jsvGarbageCollect();
 
+#ifndef SAVE_ON_FLASH
+/// Default number of variables checked by jsvGarbageCollectSlice
+#define JSV_GC_DEFAULT_SLICE_SIZE 256
+
+/// Statistics about garbage collection (since startup)
+typedef struct {
+  unsigned int count;  ///< Number of collections (full or incremental) that have finished
+  unsigned int slices; ///< Number of incremental slices that didn't finish a collection
+  JsSysTime maxPause;  ///< Longest time spent in a single collection or slice
+} JsvGCStats;
+extern JsvGCStats jsvGCStats;
+/// Should garbage collection be done a slice at a time from jsiIdle? (see E.setGCOptions)
+extern bool jsvGCIncremental;
+/// Number of variables to check in each slice of incremental garbage collection
+extern unsigned int jsvGCSliceSize;
+
+/** Do a small part of a garbage collection (starting a new collection if
+ * needed), so that it can be done while idle without long pauses. Returns
+ * true if there is more to do. */
+bool jsvGarbageCollectSlice();
+/// Are we part way through an incremental garbage collection?
+bool jsvGarbageCollectInProgress();
+
+/** Move variables that aren't locked towards the start of memory, so that
+ * free variables are contiguous and large flat strings can be allocated.
+ * Returns the number of variables that were moved. */
+unsigned int jsvDefragment();
+#endif
+
 #ifndef RELEASE
 // Dump any locked variables that aren't referenced from `global` - for debugging memory leaks
 void jsvDumpLockedVars();
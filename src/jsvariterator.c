@@ -204,6 +204,9 @@ void jsvStringIteratorNext(JsvStringIterator *it) {
 
 void jsvStringIteratorGotoEnd(JsvStringIterator *it) {
   assert(it->var);
+#ifndef SAVE_ON_FLASH
+  jsvStringTailRecall(it);
+#endif
   while (jsvGetLastChild(it->var)) {
     JsVar *next = jsvLock(jsvGetLastChild(it->var));
     jsvUnLock(it->var);
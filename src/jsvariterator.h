@@ -102,6 +102,15 @@ static ALWAYS_INLINE void jsvStringIteratorNextInline(JsvStringIterator *it) {
 /// Go to the end of the string iterator - for use with jsvStringIteratorAppend
 void jsvStringIteratorGotoEnd(JsvStringIterator *it);
 
+#ifndef SAVE_ON_FLASH
+/// Remember where the end of str is ('it' is at it) so the next jsvStringIteratorGotoEnd on str can jump straight there
+void jsvStringTailRemember(JsVar *str, JsvStringIterator *it);
+/// If 'it' is at the start of the string we last called jsvStringTailRemember on, move it to the remembered block
+void jsvStringTailRecall(JsvStringIterator *it);
+#else
+#define jsvStringTailRemember(STR, IT)
+#endif
+
 /// Append a character TO THE END of a string iterator
 void jsvStringIteratorAppend(JsvStringIterator *it, char ch);
 
@@ -611,87 +611,105 @@ Returns true if the provided object is an array
  */
 
 
-NO_INLINE static JsVarInt _jswrap_array_sort_compare(JsVar *a, JsVar *b, JsVar *compareFn) {
+/* How the elements being sorted can be compared. If there's no compare
+ * function but every element is a string (or every element is a number)
+ * we can compare them without allocating a new string each time. */
+typedef enum {
+  JSAS_GENERIC,
+  JSAS_STRINGS,
+  JSAS_NUMBERS,
+} JsArraySortMode;
+
+NO_INLINE static int _jswrap_array_sort_compare(JsVar *a, JsVar *b, JsVar *compareFn, JsArraySortMode mode) {
   if (compareFn) {
     JsVar *args[2] = {a,b};
-    return jsvGetIntegerAndUnLock(jspeFunctionCall(compareFn, 0, 0, false, 2, args));
+    // use floats, as a function like (a,b)=>a-b may return -0.5
+    JsVarFloat r = jsvGetFloatAndUnLock(jspeFunctionCall(compareFn, 0, 0, false, 2, args));
+    return (r<0) ? -1 : ((r>0) ? 1 : 0);
+  } else if (mode==JSAS_STRINGS) {
+    return jsvCompareString(a,b, 0, 0, false);
+  } else if (mode==JSAS_NUMBERS) {
+    // numbers are still sorted by their string representations
+    char sa[JS_NUMBER_BUFFER_SIZE], sb[JS_NUMBER_BUFFER_SIZE];
+    jsvGetString(a, sa, sizeof(sa));
+    jsvGetString(b, sb, sizeof(sb));
+    return strcmp(sa, sb);
   } else {
     JsVar *sa = jsvAsString(a, false);
     JsVar *sb = jsvAsString(b, false);
-    JsVarInt r = jsvCompareString(sa,sb, 0, 0, false);
+    int r = jsvCompareString(sa,sb, 0, 0, false);
     jsvUnLock2(sa, sb);
     return r;
   }
 }
 
-NO_INLINE static void _jswrap_array_sort(JsvIterator *head, int n, JsVar *compareFn) {
-  if (n < 2) return; // sort done!
-
-  JsvIterator pivot = jsvIteratorClone(head);
-  bool pivotLowest = true; // is the pivot the lowest value in here?
-  JsVar *pivotValue = jsvIteratorGetValue(&pivot);
-  /* We're just going to use the first entry (head) as the pivot...
-   * We'll move along with our iterator 'it', and if it < pivot then we'll
-   * swap the values over (hence moving pivot forwards)  */
-
-  int nlo = 0, nhigh = 0;
-  JsvIterator it = jsvIteratorClone(head); //
-  jsvIteratorNext(&it);
-
-
-  /* Partition and count sizes. */
-  while (--n && !jspIsInterrupted()) {
-    JsVar *itValue = jsvIteratorGetValue(&it);
-    JsVarInt cmp = _jswrap_array_sort_compare(itValue, pivotValue, compareFn);
-    if (cmp<=0) {
-      if (cmp<0) pivotLowest = false;
-      nlo++;
-      /* 'it' <= 'pivot', so we need to move it behind.
-         In this diagram, P=pivot, L=it
-
-               l l l l l P h h h h h L
-                         |  \       /
-                          \  \_____/_
-                          _\______/  \
-                         / |         |
-                         | |         |
-               l l l l l L P h h h h h
-
-         It makes perfect sense now...
-       */
-      // first, get the old pivot value and overwrite it with the iterator value
-      jsvIteratorSetValue(&pivot, itValue); // no unlock needed
-      // now move pivot forwards, and set 'it' to the value the new pivot has
-      jsvIteratorNext(&pivot);
-      jsvUnLock(jsvIteratorSetValue(&it, jsvIteratorGetValue(&pivot)));
-      // finally set the pivot iterator to the pivot's value again
-      jsvIteratorSetValue(&pivot, pivotValue); // no unlock needed
-    } else {
-      nhigh++;
-      // Great, 'it' > 'pivot' so it's in the right place
+/** Index of an element in the array of values being sorted. There can't be
+ * more elements than there are variables, so this is the size of a JsVarRef */
+typedef JsVarRef JsArraySortIndex;
+
+/// Compare two elements of the array of values being sorted
+static int _jswrap_array_sort_compare_items(JsVar *values, JsArraySortIndex a, JsArraySortIndex b, JsVar *compareFn, JsArraySortMode mode) {
+  JsVar *va = jsvGetArrayItem(values, (JsVarInt)a);
+  JsVar *vb = jsvGetArrayItem(values, (JsVarInt)b);
+  int r = _jswrap_array_sort_compare(va, vb, compareFn, mode);
+  jsvUnLock2(va, vb);
+  return r;
+}
+
+/// Number of elements that are insertion sorted before merging starts
+#define JSARRAY_SORT_RUN 8
+
+/** Sort the n indices in 'items' (of elements in 'values') with a bottom-up
+ * (non-recursive) stable merge sort, using 'tmp' (also n indices) as scratch
+ * space. Short runs are insertion sorted first, and runs that are already in
+ * order aren't merged, so sorted input only needs n comparisons. Returns the
+ * buffer that ended up holding the sorted indices. If we're interrupted that
+ * buffer still holds every index, just not in order. */
+static JsArraySortIndex *_jswrap_array_sort(JsVar *values, JsArraySortIndex *items, JsArraySortIndex *tmp, int n, JsVar *compareFn, JsArraySortMode mode) {
+  int i, j;
+  // Insertion sort each run
+  for (i=0;i<n;i+=JSARRAY_SORT_RUN) {
+    int end = min(i+JSARRAY_SORT_RUN, n);
+    for (j=i+1;j<end;j++) {
+      JsArraySortIndex v = items[j];
+      int k = j;
+      while (k>i && _jswrap_array_sort_compare_items(values, items[k-1], v, compareFn, mode)>0) {
+        items[k] = items[k-1];
+        k--;
+      }
+      items[k] = v;
     }
-    jsvUnLock(itValue);
-    jsvIteratorNext(&it);
+    if (jspIsInterrupted() || jspHasError()) return items;
   }
-  jsvIteratorFree(&it);
-  jsvUnLock(pivotValue);
-
-  if (jspIsInterrupted()) {
-    jsvIteratorFree(&pivot);
-    return;
+  // Now merge runs of doubling width, swapping between the two buffers
+  int width;
+  for (width=JSARRAY_SORT_RUN;width<n;width*=2) {
+    for (i=0;i<n;i+=width*2) {
+      int mid = min(i+width, n);
+      int end = min(i+width*2, n);
+      int l = i, r = mid, o = i;
+      if (mid<end && _jswrap_array_sort_compare_items(values, items[mid-1], items[mid], compareFn, mode)<=0) {
+        // already in order - no need to merge
+        memcpy(&tmp[i], &items[i], sizeof(JsArraySortIndex)*(size_t)(end-i));
+        continue;
+      }
+      while (l<mid && r<end) {
+        // '<=' takes from the left first, so the sort is stable
+        if (_jswrap_array_sort_compare_items(values, items[l], items[r], compareFn, mode)<=0)
+          tmp[o++] = items[l++];
+        else
+          tmp[o++] = items[r++];
+      }
+      while (l<mid) tmp[o++] = items[l++];
+      while (r<end) tmp[o++] = items[r++];
+      // 'items' is untouched until the pass is done
+      if (jspIsInterrupted() || jspHasError()) return items;
+    }
+    JsArraySortIndex *t = items;
+    items = tmp;
+    tmp = t;
   }
-
-  // now recurse. Do RHS first because we can
-  // free the pivot early if we do this
-  jsvIteratorNext(&pivot);
-  _jswrap_array_sort(&pivot, nhigh, compareFn);
-  jsvIteratorFree(&pivot);
-  // LHS
-  /* If the pivot is the lowest number in this chunk of numbers, then
-   * we know that anything to the left of it must be joint equal to it.
-   * In that casem there's no need to sort it. */
-  if (!pivotLowest)
-    _jswrap_array_sort(head, nlo, compareFn);
+  return items;
 }
 
 /*JSON{
@@ -705,7 +723,7 @@ NO_INLINE static void _jswrap_array_sort(JsvIterator *head, int n, JsVar *compar
   ],
   "return" : ["JsVar","This array object"]
 }
-Do an in-place quicksort of the array
+Do an in-place stable sort of the array
  */
 JsVar *jswrap_array_sort (JsVar *array, JsVar *compareFn) {
   if (!jsvIsUndefined(compareFn) && !jsvIsFunction(compareFn)) {
@@ -734,10 +752,52 @@ JsVar *jswrap_array_sort (JsVar *array, JsVar *compareFn) {
   } else {
     n = (int)jsvGetLength(array);
   }
-
+  if (n<2) return jsvLockAgain(array);
+
+  /* Copy the values into a new array, which keeps them from being freed or
+   * moved by E.defrag() if the compare function removes them from 'array'.
+   * We then sort the indices of the values in a flat buffer, twice as long
+   * as we need because the merge sort needs somewhere to merge into. */
+  JsVar *values = jsvNewEmptyArray();
+  JsVar *buffer = values ? jsvNewFlatStringOfLength((unsigned int)(sizeof(JsArraySortIndex)*(size_t)n*2)) : 0;
+  if (!buffer) {
+    jsvUnLock(values);
+    jsExceptionHere(JSET_ERROR, "Not enough memory to sort %d elements", n);
+    return 0;
+  }
+  JsArraySortIndex *items = (JsArraySortIndex*)jsvGetFlatStringPointer(buffer);
+  bool allStrings = true, allNumbers = true;
+  int i = 0;
   jsvIteratorNew(&it, array, JSIF_EVERY_ARRAY_ELEMENT);
-  _jswrap_array_sort(&it, n, compareFn);
+  while (jsvIteratorHasElement(&it) && i<n) {
+    JsVar *v = jsvIteratorGetValue(&it);
+    if (!jsvIsString(v)) allStrings = false;
+    if (!jsvIsInt(v) && !jsvIsFloat(v)) allNumbers = false;
+    jsvArrayPushAndUnLock(values, v);
+    items[i] = (JsArraySortIndex)i;
+    i++;
+    jsvIteratorNext(&it);
+  }
   jsvIteratorFree(&it);
+  n = i;
+
+  JsArraySortMode mode = JSAS_GENERIC;
+  if (allStrings) mode = JSAS_STRINGS;
+  else if (allNumbers) mode = JSAS_NUMBERS;
+  items = _jswrap_array_sort(values, items, &items[n], n, compareFn, mode);
+
+  // Write the values back (unless we were interrupted)
+  if (!jspIsInterrupted() && !jspHasError()) {
+    jsvIteratorNew(&it, array, JSIF_EVERY_ARRAY_ELEMENT);
+    for (i=0;i<n && jsvIteratorHasElement(&it);i++) {
+      JsVar *v = jsvGetArrayItem(values, (JsVarInt)items[i]);
+      jsvIteratorSetValue(&it, v);
+      jsvUnLock(v);
+      jsvIteratorNext(&it);
+    }
+    jsvIteratorFree(&it);
+  }
+  jsvUnLock2(buffer, values);
   return jsvLockAgain(array);
 }
 
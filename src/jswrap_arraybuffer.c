@@ -14,9 +14,12 @@
  * ----------------------------------------------------------------------------
  */
 #include "jswrap_arraybuffer.h"
+#include "jswrap_array.h"
 #include "jsparse.h"
 #include "jsinteractive.h"
 
+#define min(a,b) (((a)<(b))?(a):(b))
+
 /*JSON{
   "type" : "class",
   "class" : "ArrayBuffer",
@@ -348,7 +351,10 @@ JsVar *jswrap_typedarray_constructor(JsVarDataArrayBufferViewType type, JsVar *a
     typedArr->varData.arraybuffer.length = (unsigned short)length;
     jsvSetFirstChild(typedArr, jsvGetRef(jsvRef(arrayBuffer)));
 
-    if (copyData) {
+    if (copyData && jsvIsArrayBuffer(arr)) {
+      // copying from another typed array
+      jswrap_arraybufferview_set(typedArr, arr, 0);
+    } else if (copyData) {
       // if we were given an array, populate this ArrayBuffer
       JsvIterator it;
       jsvIteratorNew(&it, arr, JSIF_DEFINED_ARRAY_ElEMENTS);
@@ -399,6 +405,358 @@ The length, in bytes, of the view
 The offset, in bytes, to the first byte of the view within the ArrayBuffer
  */
 
+// -----------------------------------------------------------------------------------------------------
+//                                                        Native implementations working on the raw data
+// -----------------------------------------------------------------------------------------------------
+
+/** If this view's data is in one block of RAM (a flat string) and is aligned
+ * for its element type, return a pointer to it and set `count` to the number
+ * of elements. Otherwise return 0, and we fall back to the iterator-based
+ * Array implementations. */
+char *jswrap_arraybufferview_getData(JsVar *parent, size_t *count) {
+  if (!jsvIsArrayBuffer(parent) ||
+      (parent->varData.arraybuffer.type & ARRAYBUFFERVIEW_BIG_ENDIAN))
+    return 0;
+  JsVar *backing = jsvGetArrayBufferBackingString(parent);
+  char *data = 0;
+  if (jsvIsFlatString(backing)) {
+    size_t elementSize = JSV_ARRAYBUFFER_GET_SIZE(parent->varData.arraybuffer.type);
+    size_t byteOffset = parent->varData.arraybuffer.byteOffset;
+    size_t byteLength = jsvGetStringLength(backing);
+    data = jsvGetFlatStringPointer(backing) + byteOffset;
+    // a view may say it's longer than its buffer - only use what exists
+    *count = jsvGetArrayBufferLength(parent);
+    if (byteOffset > byteLength) *count = 0;
+    else if (*count > (byteLength-byteOffset)/elementSize)
+      *count = (byteLength-byteOffset)/elementSize;
+    if (((size_t)data) & (elementSize-1)) data = 0;
+  }
+  jsvUnLock(backing);
+  return data;
+}
+
+/// Get element i of a typed array's data as a float
+JsVarFloat jswrap_arraybufferview_getFloat(JsVarDataArrayBufferViewType type, char *data, size_t i) {
+#define JSWRAP_TYPEDARRAY_GET(T) return (JsVarFloat)((T*)data)[i]
+  JSWRAP_TYPEDARRAY_SWITCH(type, JSWRAP_TYPEDARRAY_GET);
+#undef JSWRAP_TYPEDARRAY_GET
+  return 0;
+}
+
+/// Set element i of a typed array's data from a float, converting like JsvArrayBufferIterator does
+void jswrap_arraybufferview_setFloat(JsVarDataArrayBufferViewType type, char *data, size_t i, JsVarFloat v) {
+  if (JSV_ARRAYBUFFER_IS_FLOAT(type)) {
+    if (type==ARRAYBUFFERVIEW_FLOAT32) ((float*)data)[i] = (float)v;
+    else ((double*)data)[i] = v;
+    return;
+  }
+  long long iv = isfinite(v) ? (long long)v : 0;
+  if (JSV_ARRAYBUFFER_IS_CLAMPED(type)) {
+    if (iv<0) iv=0;
+    if (iv>255) iv=255;
+  }
+  switch (JSV_ARRAYBUFFER_GET_SIZE(type)) {
+    case 1: ((uint8_t*)data)[i] = (uint8_t)iv; break;
+    case 2: ((uint16_t*)data)[i] = (uint16_t)iv; break;
+    case 4: ((uint32_t*)data)[i] = (uint32_t)iv; break;
+  }
+}
+
+/* Non-recursive quicksort with a median of 3 pivot. The smaller side is
+ * always sorted first, so the stack never needs more than log2(65536)
+ * entries. Short sections are left for an insertion sort at the end. */
+#define JSWRAP_TYPEDARRAY_SORT_FN(T) \
+static void jswrap_arraybufferview_sort_##T(T *a, int n) { \
+  int stack[32], sp = 0; \
+  int lo = 0, hi = n-1; \
+  T t; \
+  while (true) { \
+    while (hi-lo > 12) { \
+      int mid = lo + (hi-lo)/2; \
+      if (a[mid]<a[lo]) { t=a[mid];a[mid]=a[lo];a[lo]=t; } \
+      if (a[hi]<a[lo]) { t=a[hi];a[hi]=a[lo];a[lo]=t; } \
+      if (a[hi]<a[mid]) { t=a[hi];a[hi]=a[mid];a[mid]=t; } \
+      T pivot = a[mid]; \
+      int i = lo, j = hi; \
+      while (i<=j) { \
+        while (a[i]<pivot) i++; \
+        while (a[j]>pivot) j--; \
+        if (i<=j) { t=a[i];a[i]=a[j];a[j]=t; i++; j--; } \
+      } \
+      if (j-lo > hi-i) { \
+        stack[sp++] = lo; stack[sp++] = j; lo = i; \
+      } else { \
+        stack[sp++] = i; stack[sp++] = hi; hi = j; \
+      } \
+    } \
+    if (!sp) break; \
+    hi = stack[--sp]; lo = stack[--sp]; \
+  } \
+  int i, j; \
+  for (i=1;i<n;i++) { \
+    t = a[i]; \
+    for (j=i;j>0 && a[j-1]>t;j--) a[j] = a[j-1]; \
+    a[j] = t; \
+  } \
+}
+JSWRAP_TYPEDARRAY_SORT_FN(uint8_t)
+JSWRAP_TYPEDARRAY_SORT_FN(int8_t)
+JSWRAP_TYPEDARRAY_SORT_FN(uint16_t)
+JSWRAP_TYPEDARRAY_SORT_FN(int16_t)
+JSWRAP_TYPEDARRAY_SORT_FN(uint32_t)
+JSWRAP_TYPEDARRAY_SORT_FN(int32_t)
+JSWRAP_TYPEDARRAY_SORT_FN(float)
+JSWRAP_TYPEDARRAY_SORT_FN(double)
+
+/// Move any NaNs to the end, and return how many numbers come before them
+#define JSWRAP_TYPEDARRAY_NAN_TO_END(T) { \
+  T *a = (T*)data; \
+  size_t i; \
+  for (i=0;i<count;i++) \
+    if (!isnan(a[i])) a[n++] = a[i]; \
+  for (i=n;i<count;i++) a[i] = (T)NAN; \
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "ArrayBufferView",
+  "name" : "sort",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_arraybufferview_sort",
+  "params" : [
+    ["var","JsVar","A function to use to compare array elements (or undefined)"]
+  ],
+  "return" : ["JsVar","This array object"],
+  "return_object" : "ArrayBufferView"
+}
+Do an in-place sort of the array. With no compare function, elements are
+sorted numerically (not as strings, as they would be for an `Array`).
+ */
+JsVar *jswrap_arraybufferview_sort(JsVar *parent, JsVar *compareFn) {
+  if (!jsvIsUndefined(compareFn) || !jsvIsArrayBuffer(parent) ||
+      (parent->varData.arraybuffer.type & ARRAYBUFFERVIEW_BIG_ENDIAN))
+    return jswrap_array_sort(parent, compareFn);
+  JsVarDataArrayBufferViewType type = parent->varData.arraybuffer.type;
+  size_t count;
+  char *data = jswrap_arraybufferview_getData(parent, &count);
+  /* If the data isn't flat (small arrays aren't), sort a flat copy of it
+   * so that we still sort numerically */
+  JsVar *copy = 0;
+  JsvStringIterator it;
+  if (!data) {
+    count = jsvGetArrayBufferLength(parent);
+    size_t i, byteLength = count*JSV_ARRAYBUFFER_GET_SIZE(type);
+    copy = jsvNewFlatStringOfLength((unsigned int)byteLength);
+    if (!copy) return jswrap_array_sort(parent, compareFn);
+    data = jsvGetFlatStringPointer(copy);
+    JsVar *backing = jsvGetArrayBufferBackingString(parent);
+    jsvStringIteratorNew(&it, backing, parent->varData.arraybuffer.byteOffset);
+    jsvUnLock(backing);
+    for (i=0;i<byteLength;i++) {
+      data[i] = jsvStringIteratorGetChar(&it);
+      jsvStringIteratorNext(&it);
+    }
+    jsvStringIteratorFree(&it);
+  }
+  size_t n = count;
+  if (type==ARRAYBUFFERVIEW_FLOAT32) {
+    n = 0;
+    JSWRAP_TYPEDARRAY_NAN_TO_END(float);
+  } else if (type==ARRAYBUFFERVIEW_FLOAT64) {
+    n = 0;
+    JSWRAP_TYPEDARRAY_NAN_TO_END(double);
+  }
+#define JSWRAP_TYPEDARRAY_SORT(T) jswrap_arraybufferview_sort_##T((T*)data, (int)n)
+  JSWRAP_TYPEDARRAY_SWITCH(type, JSWRAP_TYPEDARRAY_SORT);
+#undef JSWRAP_TYPEDARRAY_SORT
+  if (copy) {
+    size_t i, byteLength = jsvGetStringLength(copy);
+    JsVar *backing = jsvGetArrayBufferBackingString(parent);
+    jsvStringIteratorNew(&it, backing, parent->varData.arraybuffer.byteOffset);
+    jsvUnLock(backing);
+    for (i=0;i<byteLength;i++)
+      jsvStringIteratorSetCharAndNext(&it, data[i]);
+    jsvStringIteratorFree(&it);
+    jsvUnLock(copy);
+  }
+  return jsvLockAgain(parent);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "ArrayBufferView",
+  "name" : "fill",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_arraybufferview_fill",
+  "params" : [
+    ["value","JsVar","The value to fill the array with"],
+    ["start","int","Optional. The index to start from (or 0). If start is negative, it is treated as length+start where length is the length of the array"],
+    ["end","JsVar","Optional. The index to end at (or the array length). If end is negative, it is treated as length+end."]
+  ],
+  "return" : ["JsVar","This array"],
+  "return_object" : "ArrayBufferView"
+}
+Fill this array with the given value, for every index `>= start` and `< end`
+ */
+JsVar *jswrap_arraybufferview_fill(JsVar *parent, JsVar *value, JsVarInt start, JsVar *endVar) {
+  size_t count;
+  char *data = jswrap_arraybufferview_getData(parent, &count);
+  if (!data) return jswrap_array_fill(parent, value, start, endVar);
+
+  JsVarInt length = (JsVarInt)count;
+  if (start < 0) start = start + length;
+  if (start < 0) return 0;
+  JsVarInt end = jsvIsNumeric(endVar) ? jsvGetInteger(endVar) : length;
+  if (end < 0) end = end + length;
+  if (end < 0) return 0;
+  if (end > length) end = length;
+  if (start >= end) return jsvLockAgain(parent);
+
+  // Write the first element normally, then copy its bytes over the rest
+  JsvArrayBufferIterator it;
+  jsvArrayBufferIteratorNew(&it, parent, (size_t)start);
+  jsvArrayBufferIteratorSetValue(&it, value);
+  jsvArrayBufferIteratorFree(&it);
+  size_t elementSize = JSV_ARRAYBUFFER_GET_SIZE(parent->varData.arraybuffer.type);
+  char *p = &data[(size_t)start*elementSize];
+  size_t done = elementSize, total = (size_t)(end-start)*elementSize;
+  while (done < total) {
+    size_t l = min(done, total-done);
+    memcpy(&p[done], p, l);
+    done += l;
+  }
+  return jsvLockAgain(parent);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "ArrayBufferView",
+  "name" : "reverse",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_arraybufferview_reverse",
+  "return" : ["JsVar","This array"],
+  "return_object" : "ArrayBufferView"
+}
+Reverse the contents of this arraybuffer in-place
+ */
+JsVar *jswrap_arraybufferview_reverse(JsVar *parent) {
+  size_t count;
+  char *data = jswrap_arraybufferview_getData(parent, &count);
+  if (!data) return jswrap_array_reverse(parent);
+  // only the size matters, so just swap integers of the right size
+#define JSWRAP_TYPEDARRAY_REVERSE(T) { \
+    T *a = (T*)data, t; \
+    size_t i, j; \
+    for (i=0, j=count-1; i<j; i++, j--) { t=a[i]; a[i]=a[j]; a[j]=t; } \
+  }
+  if (count) switch (JSV_ARRAYBUFFER_GET_SIZE(parent->varData.arraybuffer.type)) {
+    case 1: JSWRAP_TYPEDARRAY_REVERSE(uint8_t); break;
+    case 2: JSWRAP_TYPEDARRAY_REVERSE(uint16_t); break;
+    case 4: JSWRAP_TYPEDARRAY_REVERSE(uint32_t); break;
+    case 8: JSWRAP_TYPEDARRAY_REVERSE(uint64_t); break;
+  }
+#undef JSWRAP_TYPEDARRAY_REVERSE
+  return jsvLockAgain(parent);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "ArrayBufferView",
+  "name" : "indexOf",
+  "generate" : "jswrap_arraybufferview_indexOf",
+  "params" : [
+    ["value","JsVar","The value to check for"],
+    ["startIndex","int","(optional) the index to search from, or 0 if not specified"]
+  ],
+  "return" : ["JsVar","the index of the value in the array, or -1"]
+}
+Return the index of the value in the array, or -1
+ */
+JsVar *jswrap_arraybufferview_indexOf(JsVar *parent, JsVar *value, JsVarInt startIdx) {
+  // typed arrays only contain numbers, and we're checking with ===
+  if (!jsvIsArrayBuffer(parent) || !(jsvIsInt(value) || jsvIsFloat(value)))
+    return jsvNewFromInteger(-1);
+  JsVarDataArrayBufferViewType type = parent->varData.arraybuffer.type;
+  JsVarFloat f = jsvGetFloat(value);
+  if (startIdx < 0) startIdx = 0;
+  size_t count;
+  char *data = jswrap_arraybufferview_getData(parent, &count);
+  if (!data) {
+    JsvArrayBufferIterator it;
+    jsvArrayBufferIteratorNew(&it, parent, (size_t)startIdx);
+    while (jsvArrayBufferIteratorHasElement(&it)) {
+      if (jsvArrayBufferIteratorGetFloatValue(&it) == f) {
+        JsVar *idx = jsvArrayBufferIteratorGetIndex(&it);
+        jsvArrayBufferIteratorFree(&it);
+        return idx;
+      }
+      jsvArrayBufferIteratorNext(&it);
+    }
+    jsvArrayBufferIteratorFree(&it);
+    return jsvNewFromInteger(-1);
+  }
+  // Only search if the value could actually be stored in this array
+  bool possible;
+  if (type==ARRAYBUFFERVIEW_FLOAT32) {
+    possible = (JsVarFloat)(float)f == f;
+  } else if (JSV_ARRAYBUFFER_IS_FLOAT(type)) {
+    possible = !isnan(f);
+  } else {
+    int bits = 8*(int)JSV_ARRAYBUFFER_GET_SIZE(type);
+    JsVarFloat lo = JSV_ARRAYBUFFER_IS_SIGNED(type) ? -ldexp(1, bits-1) : 0;
+    JsVarFloat hi = JSV_ARRAYBUFFER_IS_SIGNED(type) ? ldexp(1, bits-1) : ldexp(1, bits);
+    possible = f>=lo && f<hi && f==floor(f);
+  }
+  if (possible) {
+#define JSWRAP_TYPEDARRAY_INDEXOF(T) { \
+      T *a = (T*)data, v = (T)f; \
+      size_t i; \
+      for (i=(size_t)startIdx;i<count;i++) \
+        if (a[i]==v) return jsvNewFromInteger((JsVarInt)i); \
+    }
+    JSWRAP_TYPEDARRAY_SWITCH(type, JSWRAP_TYPEDARRAY_INDEXOF);
+#undef JSWRAP_TYPEDARRAY_INDEXOF
+  }
+  return jsvNewFromInteger(-1);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "ArrayBufferView",
+  "name" : "subarray",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_arraybufferview_subarray",
+  "params" : [
+    ["begin","int","Element to begin at, inclusive. If negative, this is from the end of the array. The entire array is included if this isn't specified"],
+    ["end","JsVar","Element to end at, exclusive. If negative, it is relative to the end of the array. If not specified the whole array is included"]
+  ],
+  "return" : ["JsVar","A new array of the same type that uses the same ArrayBuffer"],
+  "return_object" : "ArrayBufferView"
+}
+Returns a smaller part of this array, without copying its data.
+
+Both arrays use the same `ArrayBuffer`, so writing to one changes the other. Use `slice` to make a copy.
+ */
+JsVar *jswrap_arraybufferview_subarray(JsVar *parent, JsVarInt begin, JsVar *endVar) {
+  if (!jsvIsArrayBuffer(parent)) return 0;
+  JsVarInt length = (JsVarInt)jsvGetArrayBufferLength(parent);
+  JsVarInt end = jsvIsNumeric(endVar) ? jsvGetInteger(endVar) : length;
+  if (begin < 0) begin += length;
+  if (end < 0) end += length;
+  if (begin < 0) begin = 0;
+  if (end > length) end = length;
+  if (end < begin) end = begin;
+
+  JsVarDataArrayBufferViewType type = parent->varData.arraybuffer.type;
+  JsVar *typedArr = jsvNewWithFlags(JSV_ARRAYBUFFER);
+  if (!typedArr) return 0;
+  typedArr->varData.arraybuffer.type = type;
+  typedArr->varData.arraybuffer.byteOffset = (unsigned short)(parent->varData.arraybuffer.byteOffset + (size_t)begin*JSV_ARRAYBUFFER_GET_SIZE(type));
+  typedArr->varData.arraybuffer.length = (unsigned short)(end-begin);
+  jsvSetFirstChild(typedArr, jsvRefRef(jsvGetFirstChild(parent)));
+  return typedArr;
+}
+
 /*JSON{
   "type" : "method",
   "class" : "ArrayBufferView",
@@ -416,6 +774,51 @@ void jswrap_arraybufferview_set(JsVar *parent, JsVar *arr, int offset) {
     jsExceptionHere(JSET_ERROR, "Expecting first argument to be an array, not %t", arr);
     return;
   }
+  size_t srcCount, dstCount;
+  char *dst = jswrap_arraybufferview_getData(parent, &dstCount);
+  char *src = (dst && jsvIsArrayBuffer(arr)) ? jswrap_arraybufferview_getData(arr, &srcCount) : 0;
+  JsVarDataArrayBufferViewType dstType = parent->varData.arraybuffer.type;
+  if (src && offset>=0 && (size_t)offset<=dstCount) {
+    JsVarDataArrayBufferViewType srcType = arr->varData.arraybuffer.type;
+    size_t elementSize = JSV_ARRAYBUFFER_GET_SIZE(dstType);
+    size_t n = min(srcCount, dstCount-(size_t)offset);
+    /* Integers of the same size have the same bytes after truncation, so
+     * just copy (unless a negative number could get clamped) */
+    if (srcType==dstType || (
+        JSV_ARRAYBUFFER_GET_SIZE(srcType)==elementSize &&
+        !JSV_ARRAYBUFFER_IS_FLOAT(srcType) && !JSV_ARRAYBUFFER_IS_FLOAT(dstType) &&
+        !(JSV_ARRAYBUFFER_IS_CLAMPED(dstType) && JSV_ARRAYBUFFER_IS_SIGNED(srcType)))) {
+      memmove(&dst[(size_t)offset*elementSize], src, n*elementSize);
+      return;
+    }
+  }
+  /* If both arrays share the same data then writing could overwrite elements
+   * we haven't read yet, so work from a copy */
+  JsVar *copy = 0;
+  if (jsvIsArrayBuffer(arr)) {
+    JsVar *srcBacking = jsvGetArrayBufferBackingString(arr);
+    JsVar *dstBacking = jsvGetArrayBufferBackingString(parent);
+    if (srcBacking==dstBacking) {
+      copy = jswrap_typedarray_constructor(arr->varData.arraybuffer.type, arr, 0, 0);
+      if (!copy) {
+        jsvUnLock2(srcBacking, dstBacking);
+        return;
+      }
+      arr = copy;
+      src = dst ? jswrap_arraybufferview_getData(arr, &srcCount) : 0;
+    }
+    jsvUnLock2(srcBacking, dstBacking);
+  }
+  if (src && offset>=0 && (size_t)offset<=dstCount) {
+    JsVarDataArrayBufferViewType srcType = arr->varData.arraybuffer.type;
+    size_t i, n = min(srcCount, dstCount-(size_t)offset);
+    dst += (size_t)offset*JSV_ARRAYBUFFER_GET_SIZE(dstType);
+    for (i=0;i<n;i++)
+      jswrap_arraybufferview_setFloat(dstType, dst, i, jswrap_arraybufferview_getFloat(srcType, src, i));
+    jsvUnLock(copy);
+    return;
+  }
+
   JsvIterator itsrc;
   jsvIteratorNew(&itsrc, arr, JSIF_EVERY_ARRAY_ELEMENT);
   JsvArrayBufferIterator itdst;
@@ -436,6 +839,7 @@ void jswrap_arraybufferview_set(JsVar *parent, JsVar *arr, int offset) {
   }
   jsvArrayBufferIteratorFree(&itdst);
   jsvIteratorFree(&itsrc);
+  jsvUnLock(copy);
 }
 
 
@@ -512,18 +916,6 @@ JsVar *jswrap_arraybufferview_map(JsVar *parent, JsVar *funcVar, JsVar *thisVar)
 //                                                                      Steal Array's methods for this
 // -----------------------------------------------------------------------------------------------------
 
-/*JSON{
-  "type" : "method",
-  "class" : "ArrayBufferView",
-  "name" : "indexOf",
-  "generate" : "jswrap_array_indexOf",
-  "params" : [
-    ["value","JsVar","The value to check for"]
-  ],
-  "return" : ["JsVar","the index of the value in the array, or -1"]
-}
-Return the index of the value in the array, or -1
- */
 /*JSON{
   "type" : "method",
   "class" : "ArrayBufferView",
@@ -536,20 +928,6 @@ Return the index of the value in the array, or -1
 }
 Join all elements of this array together into one string, using 'separator' between them. eg. ```[1,2,3].join(' ')=='1 2 3'```
  */
-/*JSON{
-  "type" : "method",
-  "class" : "ArrayBufferView",
-  "name" : "sort",
-  "ifndef" : "SAVE_ON_FLASH",
-  "generate" : "jswrap_array_sort",
-  "params" : [
-    ["var","JsVar","A function to use to compare array elements (or undefined)"]
-  ],
-  "return" : ["JsVar","This array object"],
-  "return_object" : "ArrayBufferView"
-}
-Do an in-place quicksort of the array
- */
 /*JSON{
   "type" : "method",
   "class" : "ArrayBufferView",
@@ -576,33 +954,6 @@ Executes a provided function once per array element.
 }
 Execute `previousValue=initialValue` and then `previousValue = callback(previousValue, currentValue, index, array)` for each element in the array, and finally return previousValue.
  */
-/*JSON{
-  "type" : "method",
-  "class" : "ArrayBufferView",
-  "name" : "fill",
-  "ifndef" : "SAVE_ON_FLASH",
-  "generate" : "jswrap_array_fill",
-  "params" : [
-    ["value","JsVar","The value to fill the array with"],
-    ["start","int","Optional. The index to start from (or 0). If start is negative, it is treated as length+start where length is the length of the array"],
-    ["end","JsVar","Optional. The index to end at (or the array length). If end is negative, it is treated as length+end."]
-  ],
-  "return" : ["JsVar","This array"],
-  "return_object" : "ArrayBufferView"
-}
-Fill this array with the given value, for every index `>= start` and `< end`
- */
-/*JSON{
-  "type" : "method",
-  "class" : "ArrayBufferView",
-  "name" : "reverse",
-  "ifndef" : "SAVE_ON_FLASH",
-  "generate" : "jswrap_array_reverse",
-  "return" : ["JsVar","This array"],
-  "return_object" : "ArrayBufferView"
-}
-Reverse the contents of this arraybuffer in-place
- */
 /*JSON{
   "type" : "method",
   "class" : "ArrayBufferView",
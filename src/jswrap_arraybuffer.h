@@ -17,3 +17,33 @@ JsVar *jswrap_arraybuffer_constructor(JsVarInt byteLength);
 JsVar *jswrap_typedarray_constructor(JsVarDataArrayBufferViewType type, JsVar *arr, JsVarInt byteOffset, JsVarInt length);
 void jswrap_arraybufferview_set(JsVar *parent, JsVar *arr, int offset);
 JsVar *jswrap_arraybufferview_map(JsVar *parent, JsVar *funcVar, JsVar *thisVar);
+JsVar *jswrap_arraybufferview_sort(JsVar *parent, JsVar *compareFn);
+JsVar *jswrap_arraybufferview_fill(JsVar *parent, JsVar *value, JsVarInt start, JsVar *endVar);
+JsVar *jswrap_arraybufferview_reverse(JsVar *parent);
+JsVar *jswrap_arraybufferview_indexOf(JsVar *parent, JsVar *value, JsVarInt startIdx);
+JsVar *jswrap_arraybufferview_subarray(JsVar *parent, JsVarInt begin, JsVar *endVar);
+
+/** If this view's data is in one block of RAM (a flat string) and is aligned
+ * for its element type, return a pointer to it and set `count` to the number
+ * of elements. Otherwise return 0. */
+char *jswrap_arraybufferview_getData(JsVar *parent, size_t *count);
+/// Get element i of a typed array's data as a float
+JsVarFloat jswrap_arraybufferview_getFloat(JsVarDataArrayBufferViewType type, char *data, size_t i);
+/// Set element i of a typed array's data from a float, converting like JsvArrayBufferIterator does
+void jswrap_arraybufferview_setFloat(JsVarDataArrayBufferViewType type, char *data, size_t i, JsVarFloat v);
+
+/// Call MACRO with the C type that's used for each typed array element type
+#define JSWRAP_TYPEDARRAY_SWITCH(TYPE, MACRO) \
+  switch ((TYPE) & ~ARRAYBUFFERVIEW_CLAMPED) { \
+    case ARRAYBUFFERVIEW_ARRAYBUFFER: \
+    case ARRAYBUFFERVIEW_UINT8: MACRO(uint8_t); break; \
+    case ARRAYBUFFERVIEW_INT8: MACRO(int8_t); break; \
+    case ARRAYBUFFERVIEW_UINT16: MACRO(uint16_t); break; \
+    case ARRAYBUFFERVIEW_INT16: MACRO(int16_t); break; \
+    case ARRAYBUFFERVIEW_UINT32: MACRO(uint32_t); break; \
+    case ARRAYBUFFERVIEW_INT32: MACRO(int32_t); break; \
+    case ARRAYBUFFERVIEW_FLOAT32: MACRO(float); break; \
+    case ARRAYBUFFERVIEW_FLOAT64: MACRO(double); break; \
+    default: assert(0); break; \
+  }
+
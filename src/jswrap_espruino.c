@@ -210,6 +210,65 @@ JsVarFloat jswrap_espruino_clip(JsVarFloat x, JsVarFloat min, JsVarFloat max) {
 }
 
 
+/* Kernels for flat typed arrays of the types most used for sampled data.
+ * Keeping 4 separate totals lets the compiler use SIMD instructions (or
+ * just keep the FPU busy) without needing -ffast-math to reorder sums. */
+#define JSWRAP_ESPRUINO_KERNELS(T) \
+static JsVarFloat jswrap_espruino_sum_##T(const T *a, size_t n) { \
+  JsVarFloat s0=0, s1=0, s2=0, s3=0; \
+  size_t i; \
+  for (i=0;i+4<=n;i+=4) { \
+    s0 += a[i]; s1 += a[i+1]; s2 += a[i+2]; s3 += a[i+3]; \
+  } \
+  for (;i<n;i++) s0 += a[i]; \
+  return (s0+s1)+(s2+s3); \
+} \
+static JsVarFloat jswrap_espruino_variance_##T(const T *a, size_t n, JsVarFloat mean) { \
+  JsVarFloat s0=0, s1=0, s2=0, s3=0, d0, d1, d2, d3; \
+  size_t i; \
+  for (i=0;i+4<=n;i+=4) { \
+    d0 = a[i]-mean; d1 = a[i+1]-mean; d2 = a[i+2]-mean; d3 = a[i+3]-mean; \
+    s0 += d0*d0; s1 += d1*d1; s2 += d2*d2; s3 += d3*d3; \
+  } \
+  for (;i<n;i++) { d0 = a[i]-mean; s0 += d0*d0; } \
+  return (s0+s1)+(s2+s3); \
+} \
+static JsVarFloat jswrap_espruino_dot_##T(const T *a, const T *b, size_t n) { \
+  JsVarFloat s0=0, s1=0, s2=0, s3=0; \
+  size_t i; \
+  for (i=0;i+4<=n;i+=4) { \
+    s0 += (JsVarFloat)a[i]*b[i]; s1 += (JsVarFloat)a[i+1]*b[i+1]; \
+    s2 += (JsVarFloat)a[i+2]*b[i+2]; s3 += (JsVarFloat)a[i+3]*b[i+3]; \
+  } \
+  for (;i<n;i++) s0 += (JsVarFloat)a[i]*b[i]; \
+  return (s0+s1)+(s2+s3); \
+}
+JSWRAP_ESPRUINO_KERNELS(float)
+JSWRAP_ESPRUINO_KERNELS(int16_t)
+JSWRAP_ESPRUINO_KERNELS(uint8_t)
+
+/// The element types that have their own kernels
+typedef enum {
+  JSWEK_NONE,     ///< not flat - use iterators
+  JSWEK_GENERIC,  ///< flat, but use jswrap_arraybufferview_getFloat
+  JSWEK_FLOAT32,
+  JSWEK_INT16,
+  JSWEK_UINT8,
+} JswEspruinoKernelType;
+
+/// Work out whether we can use a kernel on arr, and if so get its data
+static JswEspruinoKernelType jswrap_espruino_getKernelData(JsVar *arr, char **data, size_t *count) {
+  *data = jswrap_arraybufferview_getData(arr, count);
+  if (!*data) return JSWEK_NONE;
+  switch (arr->varData.arraybuffer.type & ~ARRAYBUFFERVIEW_CLAMPED) {
+    case ARRAYBUFFERVIEW_FLOAT32: return JSWEK_FLOAT32;
+    case ARRAYBUFFERVIEW_INT16: return JSWEK_INT16;
+    case ARRAYBUFFERVIEW_ARRAYBUFFER:
+    case ARRAYBUFFERVIEW_UINT8: return JSWEK_UINT8;
+    default: return JSWEK_GENERIC;
+  }
+}
+
 /*JSON{
   "type" : "staticmethod",
   "ifndef" : "SAVE_ON_FLASH",
@@ -230,6 +289,19 @@ JsVarFloat jswrap_espruino_sum(JsVar *arr) {
   }
   JsVarFloat sum = 0;
 
+  char *data;
+  size_t i, count;
+  switch (jswrap_espruino_getKernelData(arr, &data, &count)) {
+    case JSWEK_FLOAT32: return jswrap_espruino_sum_float((float*)data, count);
+    case JSWEK_INT16: return jswrap_espruino_sum_int16_t((int16_t*)data, count);
+    case JSWEK_UINT8: return jswrap_espruino_sum_uint8_t((uint8_t*)data, count);
+    case JSWEK_GENERIC:
+      for (i=0;i<count;i++)
+        sum += jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i);
+      return sum;
+    case JSWEK_NONE: break;
+  }
+
   JsvIterator itsrc;
   jsvIteratorNew(&itsrc, arr, JSIF_DEFINED_ARRAY_ElEMENTS);
   while (jsvIteratorHasElement(&itsrc)) {
@@ -261,6 +333,21 @@ JsVarFloat jswrap_espruino_variance(JsVar *arr, JsVarFloat mean) {
   }
   JsVarFloat variance = 0;
 
+  char *data;
+  size_t i, count;
+  switch (jswrap_espruino_getKernelData(arr, &data, &count)) {
+    case JSWEK_FLOAT32: return jswrap_espruino_variance_float((float*)data, count, mean);
+    case JSWEK_INT16: return jswrap_espruino_variance_int16_t((int16_t*)data, count, mean);
+    case JSWEK_UINT8: return jswrap_espruino_variance_uint8_t((uint8_t*)data, count, mean);
+    case JSWEK_GENERIC:
+      for (i=0;i<count;i++) {
+        JsVarFloat val = jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i) - mean;
+        variance += val*val;
+      }
+      return variance;
+    case JSWEK_NONE: break;
+  }
+
   JsvIterator itsrc;
   jsvIteratorNew(&itsrc, arr, JSIF_EVERY_ARRAY_ELEMENT);
   while (jsvIteratorHasElement(&itsrc)) {
@@ -296,6 +383,37 @@ JsVarFloat jswrap_espruino_convolve(JsVar *arr1, JsVar *arr2, int offset) {
   }
   JsVarFloat conv = 0;
 
+  char *data1, *data2;
+  size_t count1, count2;
+  JswEspruinoKernelType k1 = jswrap_espruino_getKernelData(arr1, &data1, &count1);
+  JswEspruinoKernelType k2 = jswrap_espruino_getKernelData(arr2, &data2, &count2);
+  if (k1!=JSWEK_NONE && k2!=JSWEK_NONE) {
+    if (!count2) return 0;
+    int o = offset % (int)count2;
+    if (o<0) o += (int)count2;
+    size_t i = 0, j = (size_t)o;
+    // work through arr1 in chunks, so arr2 never needs to wrap mid-kernel
+    while (i<count1) {
+      size_t n = count1-i;
+      if (n > count2-j) n = count2-j;
+      if (k1==k2 && k1==JSWEK_FLOAT32)
+        conv += jswrap_espruino_dot_float(&((float*)data1)[i], &((float*)data2)[j], n);
+      else if (k1==k2 && k1==JSWEK_INT16)
+        conv += jswrap_espruino_dot_int16_t(&((int16_t*)data1)[i], &((int16_t*)data2)[j], n);
+      else if (k1==k2 && k1==JSWEK_UINT8)
+        conv += jswrap_espruino_dot_uint8_t(&((uint8_t*)data1)[i], &((uint8_t*)data2)[j], n);
+      else {
+        size_t x;
+        for (x=0;x<n;x++)
+          conv += jswrap_arraybufferview_getFloat(arr1->varData.arraybuffer.type, data1, i+x) *
+                  jswrap_arraybufferview_getFloat(arr2->varData.arraybuffer.type, data2, j+x);
+      }
+      i += n;
+      j = 0;
+    }
+    return conv;
+  }
+
   JsvIterator it1;
   jsvIteratorNew(&it1, arr1, JSIF_EVERY_ARRAY_ELEMENT);
   JsvIterator it2;
@@ -415,6 +533,96 @@ short FFT(short int dir,long m,double *x,double *y)
 }
 Performs a Fast Fourier Transform (fft) on the supplied data and writes it back into the original arrays. Note that if only one array is supplied, the data written back is the modulus of the complex result `sqrt(r*r+i*i)`.
  */
+/** Load arr into the FFT's buffer of n doubles, padding with zeros. If
+ * interleave is set, even elements go into a and odd ones into b (each n/2
+ * long), which is how a real FFT packs its input. */
+static void jswrap_espruino_FFT_load(JsVar *arr, double *a, double *b, size_t n, bool interleave) {
+  char *data;
+  size_t i = 0, count;
+  JsvIterator it;
+  if (jswrap_espruino_getKernelData(arr, &data, &count)!=JSWEK_NONE) {
+    if (count>n) count = n;
+    if (interleave) {
+      for (;i+1<count;i+=2) {
+        a[i>>1] = jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i);
+        b[i>>1] = jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i+1);
+      }
+      if (i<count) { a[i>>1] = jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i); b[i>>1] = 0; i+=2; }
+    } else {
+      for (;i<count;i++)
+        a[i] = jswrap_arraybufferview_getFloat(arr->varData.arraybuffer.type, data, i);
+    }
+  } else {
+    jsvIteratorNew(&it, arr, JSIF_EVERY_ARRAY_ELEMENT);
+    while (i<n && jsvIteratorHasElement(&it)) {
+      double f = jsvIteratorGetFloatValue(&it);
+      if (!interleave) a[i] = f;
+      else if (i&1) b[i>>1] = f;
+      else { a[i>>1] = f; b[i>>1] = 0; }
+      i++;
+      jsvIteratorNext(&it);
+    }
+    jsvIteratorFree(&it);
+    if (interleave) i = (i+1)&~(size_t)1;
+  }
+  if (interleave) {
+    for (;i<n;i+=2) a[i>>1] = b[i>>1] = 0;
+  } else {
+    for (;i<n;i++) a[i] = 0;
+  }
+}
+
+/// Write the FFT's results back into arr. Element i comes from a[i] if i<split, or b[i-split]
+static void jswrap_espruino_FFT_store(JsVar *arr, double *a, double *b, size_t split) {
+  char *data;
+  size_t i, count;
+  if (jswrap_espruino_getKernelData(arr, &data, &count)!=JSWEK_NONE) {
+    for (i=0;i<count;i++)
+      jswrap_arraybufferview_setFloat(arr->varData.arraybuffer.type, data, i, (i<split) ? a[i] : b[i-split]);
+    return;
+  }
+  JsvIterator it;
+  jsvIteratorNew(&it, arr, JSIF_EVERY_ARRAY_ELEMENT);
+  i=0;
+  while (jsvIteratorHasElement(&it)) {
+    jsvUnLock(jsvIteratorSetValue(&it, jsvNewFromFloat((i<split) ? a[i] : b[i-split])));
+    i++;
+    jsvIteratorNext(&it);
+  }
+  jsvIteratorFree(&it);
+}
+
+/** Turn the (scaled) FFT of n/2 complex points z = x[2m] + i*x[2m+1] into
+ * the magnitudes of the FFT of the n real points x. Magnitudes 0..n/2-1 are
+ * left in re, and n/2..n-1 in im - the second half mirrors the first. */
+static void jswrap_espruino_FFT_realToMagnitude(double *re, double *im, size_t n) {
+  size_t m = n/2, k;
+  // bin 0 and bin m only depend on z[0]
+  double dc = fabs(re[0]+im[0]), nyquist = fabs(re[0]-im[0]);
+  /* twiddle factor w = e^(-2*pi*i*k/n), stepped with a rotation like FFT() */
+  double wr = 1, wi = 0, t;
+  double sr = jswrap_math_sin(PI/2 + 2*PI/(double)n), si = -jswrap_math_sin(2*PI/(double)n);
+  for (k=1;k<=m/2;k++) {
+    t = wr*sr - wi*si;
+    wi = wr*si + wi*sr;
+    wr = t;
+    // X[k] = E + w*O, where E=(z[k]+conj(z[m-k]))/2, O=(z[k]-conj(z[m-k]))/2i
+    double er = (re[k]+re[m-k])/2, ei = (im[k]-im[m-k])/2;
+    double or = (im[k]+im[m-k])/2, oi = (re[m-k]-re[k])/2;
+    // X[m-k] = conj(E - w*O), which has the same magnitude as E - w*O
+    double pr = wr*or - wi*oi, pi = wr*oi + wi*or;
+    double xr = er + pr, xi = ei + pi;
+    double yr = er - pr, yi = ei - pi;
+    // FFT() divided by m, but we want to divide by n
+    re[k] = jswrap_math_sqrt(xr*xr + xi*xi)/2;
+    re[m-k] = jswrap_math_sqrt(yr*yr + yi*yi)/2;
+  }
+  re[0] = dc/2;
+  im[0] = nyquist/2;
+  for (k=1;k<m;k++)
+    im[k] = re[m-k];
+}
+
 void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, bool inverse) {
   if (!(jsvIsIterable(arrReal)) ||
       !(jsvIsUndefined(arrImag) || jsvIsIterable(arrImag))) {
@@ -431,69 +639,47 @@ void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, bool inverse) {
     order++;
   }
 
-  if (jsuGetFreeStack() < 256+sizeof(double)*pow2*2) {
+  // If we had imaginary data then DON'T modulus the result
+  bool useModulus = !jsvIsIterable(arrImag);
+  /* With only real data we can do a complex FFT of half the size, and
+   * work out the magnitudes from that */
+  bool realFFT = useModulus && !inverse && order>=2;
+  size_t n = realFFT ? pow2/2 : pow2;
+
+  if (jsuGetFreeStack() < 256+sizeof(double)*n*2) {
     jsExceptionHere(JSET_ERROR, "Insufficient stack for computing FFT");
     return;
   }
 
-  double *vReal = (double*)alloca(sizeof(double)*pow2);
-  double *vImag = (double*)alloca(sizeof(double)*pow2);
+  double *vReal = (double*)alloca(sizeof(double)*n);
+  double *vImag = (double*)alloca(sizeof(double)*n);
+  size_t i;
 
-  unsigned int i;
-  // load data
-  JsvIterator it;
-  jsvIteratorNew(&it, arrReal, JSIF_EVERY_ARRAY_ELEMENT);
-  i=0;
-  while (jsvIteratorHasElement(&it)) {
-    vReal[i++] = jsvIteratorGetFloatValue(&it);
-    jsvIteratorNext(&it);
+  if (realFFT) {
+    jswrap_espruino_FFT_load(arrReal, vReal, vImag, pow2, true);
+    FFT(1, order-1, vReal, vImag);
+    jswrap_espruino_FFT_realToMagnitude(vReal, vImag, pow2);
+    jswrap_espruino_FFT_store(arrReal, vReal, vImag, n);
+    return;
   }
-  jsvIteratorFree(&it);
-  while (i<pow2)
-    vReal[i++]=0;
 
-  i=0;
-  if (jsvIsIterable(arrImag)) {
-    jsvIteratorNew(&it, arrImag, JSIF_EVERY_ARRAY_ELEMENT);
-    while (i<pow2 && jsvIteratorHasElement(&it)) {
-      vImag[i++] = jsvIteratorGetFloatValue(&it);
-      jsvIteratorNext(&it);
-    }
-    jsvIteratorFree(&it);
-  }
-  while (i<pow2)
-    vImag[i++]=0;
+  // load data
+  jswrap_espruino_FFT_load(arrReal, vReal, 0, pow2, false);
+  if (jsvIsIterable(arrImag))
+    jswrap_espruino_FFT_load(arrImag, vImag, 0, pow2, false);
+  else
+    for (i=0;i<pow2;i++) vImag[i]=0;
 
   // do FFT
   FFT(inverse ? -1 : 1, order, vReal, vImag);
 
   // Put the results back
-  // If we had imaginary data then DON'T modulus the result
-  bool useModulus = !jsvIsIterable(arrImag);
-
-  jsvIteratorNew(&it, arrReal, JSIF_EVERY_ARRAY_ELEMENT);
-  i=0;
-  while (jsvIteratorHasElement(&it)) {
-    JsVarFloat f;
-    if (useModulus)
-      f = jswrap_math_sqrt(vReal[i]*vReal[i] + vImag[i]*vImag[i]);
-    else
-      f = vReal[i];
-
-    jsvUnLock(jsvIteratorSetValue(&it, jsvNewFromFloat(f)));
-    i++;
-    jsvIteratorNext(&it);
-  }
-  jsvIteratorFree(&it);
-  if (jsvIsIterable(arrImag)) {
-    jsvIteratorNew(&it, arrImag, JSIF_EVERY_ARRAY_ELEMENT);
-    i=0;
-    while (jsvIteratorHasElement(&it)) {
-      jsvUnLock(jsvIteratorSetValue(&it, jsvNewFromFloat(vImag[i++])));
-      jsvIteratorNext(&it);
-    }
-    jsvIteratorFree(&it);
-  }
+  if (useModulus)
+    for (i=0;i<pow2;i++)
+      vReal[i] = jswrap_math_sqrt(vReal[i]*vReal[i] + vImag[i]*vImag[i]);
+  jswrap_espruino_FFT_store(arrReal, vReal, 0, pow2);
+  if (jsvIsIterable(arrImag))
+    jswrap_espruino_FFT_store(arrImag, vImag, 0, pow2);
 }
 
 /*JSON{
@@ -702,6 +888,7 @@ Get Espruino's interpreter flags that control the way it handles your JavaScript
 * `pretokenise` - When adding functions, pre-minify them and tokenise reserved words
 * `unsafeFlash` - Some platforms stop writes/erases to interpreter memory to stop you bricking the device accidentally - this removes that protection
 * `unsyncFiles` - When writing files, *don't* flush all data to the SD card after each command (the default is *to* flush). This is much faster, but can cause filesystem damage if power is lost without the filesystem unmounted.
+* `noBytecode` - On builds with bytecode support, don't compile functions to bytecode when they are first called - always execute them from their source code. Individual functions can also opt out by starting with the string `"nobytecode"`
 */
 /*JSON{
   "type" : "staticmethod",
@@ -717,6 +904,46 @@ Set the Espruino interpreter flags that control the way it handles your JavaScri
 Run `E.getFlags()` and check its description for a list of available flags and their values.
 */
 
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "E",
+  "name" : "setGCOptions",
+  "generate" : "jswrap_espruino_setGCOptions",
+  "params" : [
+    ["options","JsVar","An object containing GC options. You need only specify the options that you want to change."]
+  ]
+}
+Set how Espruino's garbage collector works. `options` can contain:
+
+* `incremental` - If true, rather than doing a full garbage collection
+  when idle (which stops everything while all of memory is checked),
+  Espruino does a small slice of it each time it is idle. This keeps delays
+  for timers and `setWatch` short, at the expense of using slightly more
+  time overall.
+* `sliceSize` - The number of variables to check in each slice of
+  incremental garbage collection (default 256).
+
+Espruino may still need to do a full garbage collection if it runs out of memory.
+`process.memory()` reports how long garbage collection has stopped execution for.
+*/
+void jswrap_espruino_setGCOptions(JsVar *options) {
+  if (!jsvIsObject(options)) {
+    jsExceptionHere(JSET_TYPEERROR, "Expecting an object, got %t", options);
+    return;
+  }
+  JsVar *v = jsvObjectGetChild(options, "incremental", 0);
+  if (v) jsvGCIncremental = jsvGetBool(v);
+  jsvUnLock(v);
+  v = jsvObjectGetChild(options, "sliceSize", 0);
+  if (v) {
+    JsVarInt sliceSize = jsvGetInteger(v);
+    if (sliceSize>0) jsvGCSliceSize = (unsigned int)sliceSize;
+    else jsExceptionHere(JSET_ERROR, "sliceSize must be greater than 0");
+  }
+  jsvUnLock(v);
+}
+
 /*JSON{
   "type" : "staticmethod",
   "class" : "E",
@@ -1085,6 +1312,32 @@ JsVar *jswrap_espruino_getSizeOf(JsVar *v, int depth) {
   return jsvNewFromInteger((JsVarInt)jsvCountJsVarsUsed(v));
 }
 
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "E",
+  "name" : "defrag",
+  "generate" : "jswrap_espruino_defrag",
+  "return" : ["int","The number of variables that were moved"]
+}
+Run a garbage collection, and then move variables towards the start of
+memory so that the free memory is all together.
+
+Large `ArrayBuffer`s (and so `Graphics` buffers) need contiguous free memory,
+so after a lot of allocation they may not be allocated in one block (or may
+not be allocated at all) even when `process.memory()` reports plenty of free
+memory. Calling `E.defrag()` first should fix this.
+
+Only variables that aren't in use by Espruino's internals are moved, and
+existing `ArrayBuffer` data is never moved - so the result isn't perfect.
+
+**Note:** This can take a while with a lot of memory used, as every
+variable has to be checked for each batch of variables that are moved.
+*/
+int jswrap_espruino_defrag() {
+  return (int)jsvDefragment();
+}
+
 
 /*JSON{
   "type" : "staticmethod",
@@ -31,6 +31,7 @@ void jswrap_espruino_kickWatchdog();
 /// Return an array of errors based on the current flags
 JsVar *jswrap_espruino_getErrorFlagArray(JsErrorFlags flags);
 JsVar *jswrap_espruino_getErrorFlags();
+void jswrap_espruino_setGCOptions(JsVar *options);
 JsVar *jswrap_espruino_toArrayBuffer(JsVar *str);
 JsVar *jswrap_espruino_toUint8Array(JsVar *args);
 JsVar *jswrap_espruino_toString(JsVar *args);
@@ -43,6 +44,7 @@ void jswrap_espruino_dumpTimers();
 void jswrap_espruino_dumpLockedVars();
 void jswrap_espruino_dumpFreeList();
 JsVar *jswrap_espruino_getSizeOf(JsVar *v, int depth);
+int jswrap_espruino_defrag();
 JsVarInt jswrap_espruino_getAddressOf(JsVar *v, bool flatAddress);
 void jswrap_espruino_mapInPlace(JsVar *from, JsVar *to, JsVar *map, JsVarInt bits);
 JsVar *jswrap_e_dumpStr();
@@ -106,6 +106,7 @@ void jswrap_flash_erasePage(JsVar *addr) {
     return;
   }
   jshFlashErasePage((uint32_t)jsvGetInteger(addr));
+  jsfResetIndex(); // we may have erased Storage files
 }
 
 /*JSON{
@@ -138,8 +139,10 @@ void jswrap_flash_write(JsVar *data, int addr) {
     return;
   }
 
-  if (flashData && flashDataLen)
+  if (flashData && flashDataLen) {
     jshFlashWrite(flashData, (unsigned int)addr, (unsigned int)flashDataLen);
+    jsfResetIndex(); // we may have written over Storage files
+  }
 }
 
 /*JSON{
@@ -363,8 +363,13 @@ To set the timezone for all new Dates, use `E.setTimeZone(hours)`.
  */
 void jswrap_interactive_setTime(JsVarFloat time) {
   JsSysTime stime = jshGetTimeFromMilliseconds(time*1000);
-  jsiLastIdleTime = stime;
+  JsSysTime oldTime = jshGetSystemTime();
   jshSetSystemTime(stime);
+  /* Timers are stored as a time from jshGetSystemTime, so move them by
+   * however much that changed to keep them running at the same time */
+  JsSysTime diff = jshGetSystemTime() - oldTime;
+  jsiTimersAdjust(diff);
+  jsiLastIdleTime += diff;
 }
 
 
@@ -482,7 +487,7 @@ JsVar *_jswrap_interface_setTimeoutOrInterval(JsVar *func, JsVarFloat interval,
   // Create a new timer
   JsVar *timerPtr = jsvNewObject();
   JsSysTime intervalInt = jshGetTimeFromMilliseconds(interval);
-  jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger((jshGetSystemTime() - jsiLastIdleTime) + intervalInt));
+  jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(jshGetSystemTime() + intervalInt));
   if (!isTimeout) {
     jsvObjectSetChildAndUnLock(timerPtr, "interval", jsvNewFromLongInteger(intervalInt));
   }
@@ -552,12 +557,12 @@ void _jswrap_interface_clearTimeoutOrInterval(JsVar *idVar, bool isTimeout) {
       jsvUnLock2(watchPtr, timerPtr);
     }
     jsvObjectIteratorFree(&it);
+    jsiTimersRebuildQueue();
   } else {
     JsVar *child = jsvIsBasic(idVar) ? jsvFindChildFromVar(timerArrayPtr, idVar, false) : 0;
     if (child) {
-      JsVar *timerArrayPtr = jsvLock(timerArray);
-      jsvRemoveChild(timerArrayPtr, child);
-      jsvUnLock2(child, timerArrayPtr);
+      jsiTimerRemove(child);
+      jsvUnLock(child);
     } else {
       if (isTimeout)
         jsExceptionHere(JSET_ERROR, "Unknown Timeout");
@@ -604,8 +609,8 @@ void jswrap_interface_changeInterval(JsVar *idVar, JsVarFloat interval) {
     JsVarInt intervalInt = (JsVarInt)jshGetTimeFromMilliseconds(interval);
     v = jsvNewFromInteger(intervalInt);
     jsvUnLock2(jsvSetNamedChild(timer, v, "interval"), v);
-    v = jsvNewFromInteger((JsVarInt)(jshGetSystemTime()-jsiLastIdleTime) + intervalInt);
-    jsvUnLock3(jsvSetNamedChild(timer, v, "time"), v, timer);
+    jsiTimerSetTime(timer, jshGetSystemTime() + intervalInt);
+    jsvUnLock(timer);
     // timerName already unlocked
     jsiTimersChanged(); // mark timers as changed
   } else {
@@ -726,6 +726,7 @@ JsVar *jswrap_interface_setWatch(
     JsVar *watchArrayPtr = jsvLock(watchArray);
     itemIndex = jsvArrayAddToEnd(watchArrayPtr, watchPtr, 1) - 1;
     jsvUnLock2(watchArrayPtr, watchPtr);
+    jsiWatchesChanged();
 
 
   }
@@ -759,6 +760,7 @@ void jswrap_interface_clearWatch(JsVar *idVar) {
     // remove all items
     jsvRemoveAllChildren(watchArrayPtr);
     jsvUnLock(watchArrayPtr);
+    jsiWatchesChanged();
   } else {
     JsVar *watchArrayPtr = jsvLock(watchArray);
     JsVar *watchNamePtr = jsvFindChildFromVar(watchArrayPtr, idVar, false);
@@ -771,6 +773,7 @@ void jswrap_interface_clearWatch(JsVar *idVar) {
       JsVar *watchArrayPtr = jsvLock(watchArray);
       jsvRemoveChild(watchArrayPtr, watchNamePtr);
       jsvUnLock2(watchNamePtr, watchArrayPtr);
+      jsiWatchesChanged();
 
       // Now check if this pin is still being watched
       if (!jsiIsWatchingPin(pin))
@@ -17,6 +17,7 @@
 #include "jsparse.h"
 #include "jsinteractive.h"
 #include "jswrapper.h"
+#include "jswrap_pipe.h"
 
 const unsigned int JSON_LIMIT_AMOUNT = 15; // how big does an array get before we start to limit what we show
 const unsigned int JSON_LIMITED_AMOUNT = 5; // When limited, how many items do we show at the beginning and end
@@ -75,83 +76,720 @@ JsVar *jswrap_json_stringify(JsVar *v, JsVar *replacer, JsVar *space) {
 }
 
 
-JsVar *jswrap_json_parse_internal() {
-  switch (lex->tk) {
-  case LEX_R_TRUE:  jslGetNextToken(lex); return jsvNewFromBool(true);
-  case LEX_R_FALSE: jslGetNextToken(lex); return jsvNewFromBool(false);
-  case LEX_R_NULL:  jslGetNextToken(lex); return jsvNewWithFlags(JSV_NULL);
-  case '-': {
-    jslGetNextToken(lex);
-    if (lex->tk!=LEX_INT && lex->tk!=LEX_FLOAT) return 0;
-    JsVar *v = jswrap_json_parse_internal(lex);
-    JsVar *zero = jsvNewFromInteger(0);
-    JsVar *r = jsvMathsOp(zero, v, '-');
-    jsvUnLock2(v, zero);
-    return r;
-  }
-  case LEX_INT: {
-    long long v = stringToInt(jslGetTokenValueAsString(lex));
-    jslGetNextToken(lex);
-    return jsvNewFromLongInteger(v);
-  }
-  case LEX_FLOAT: {
-    JsVarFloat v = stringToFloat(jslGetTokenValueAsString(lex));
-    jslGetNextToken(lex);
-    return jsvNewFromFloat(v);
-  }
-  case LEX_STR: {
-    JsVar *a = jslGetTokenValueAsVar(lex);
-    jslGetNextToken(lex);
-    return a;
-  }
-  case '[': {
-    JsVar *arr = jsvNewEmptyArray(); if (!arr) return 0;
-    jslGetNextToken(lex); // [
-    while (lex->tk != ']' && !jspHasError()) {
-      JsVar *value = jswrap_json_parse_internal(lex);
-      if (!value ||
-          (lex->tk!=']' && !jslMatch(','))) {
-        jsvUnLock2(value, arr);
-        return 0;
+#ifndef SAVE_ON_FLASH
+#define JSON_STRINGIFIER_DATA_NAME JS_HIDDEN_CHAR_STR"dat"
+#define JSON_STRINGIFIER_STACK_NAME JS_HIDDEN_CHAR_STR"stk"
+
+/*JSON{
+  "type" : "class",
+  "class" : "JSONStringifier",
+  "ifndef" : "SAVE_ON_FLASH"
+}
+A stream that JSON can be read from a bit at a time, created by `JSON.stringifyTo`
+ */
+
+/*JSON{
+  "type" : "staticmethod",
+  "class" : "JSON",
+  "name" : "stringifyTo",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_json_stringifyTo",
+  "params" : [
+    ["data","JsVar","The data to be converted to JSON"],
+    ["destination","JsVar","A stream to write the JSON to - anything with a `write` method (eg. `Serial1`, a Socket, or a File from `E.openFile`)"],
+    ["options","JsVar",["An optional object `{ chunkSize : int=64, end : bool=true, complete : function }`","chunkSize : The amount of JSON to write at a time","complete : a function to call when all the JSON has been written","end : call the 'end' function on the destination when finished"]]
+  ]
+}
+Write the given data to a stream as JSON (the same as `JSON.stringify(data)`
+without `space`), without ever creating the whole JSON string. This uses the
+same mechanism as `pipe`, so the JSON is written `chunkSize` characters at a time
+while Espruino is idle, and if `write` returns `false` (as a Socket's does)
+nothing more is written until the destination emits `drain`.
+
+```
+require("net").createServer(function(socket) {
+  JSON.stringifyTo(bigObject, socket);
+}).listen(8080);
+```
+
+**Note:** The data is read as it is written, so changes made to it before
+`complete` is called may end up in the output.
+ */
+void jswrap_json_stringifyTo(JsVar *data, JsVar *destination, JsVar *options) {
+  JsVar *stringifier = jspNewObject(0, "JSONStringifier");
+  if (!stringifier) return;
+  jsvObjectSetChild(stringifier, JSON_STRINGIFIER_DATA_NAME, data);
+  jswrap_pipe(stringifier, destination, options);
+  jsvUnLock(stringifier);
+}
+
+#define JSON_STRINGIFIER_FRAMES 8 ///< How many levels of array/object we keep track of in C during a read
+
+/// An array/object we're outputting
+typedef struct {
+  JsVar *container;
+  JsVar *position; ///< the index we're up to in an array, or the key we last output in an object (or 0 if none yet)
+  JsVar *cursor;   ///< the next child of container to look at (only if hasCursor)
+  bool hasCursor;
+} JsonStringifierFrame;
+
+typedef struct {
+  JsVar *stack; ///< frames below the ones in 'frames', as container,position,container,position,...
+  JsonStringifierFrame frames[JSON_STRINGIFIER_FRAMES];
+  int depth; ///< how many items in 'frames'
+  JsvStringIterator it; ///< where we're outputting to
+} JsonStringifier;
+
+static JsVar *jsonStringifierLock(JsVarRef ref) {
+  return ref ? jsvLock(ref) : 0;
+}
+
+static void jsonStringifierFrameFree(JsonStringifierFrame *f) {
+  if (f->hasCursor) jsvUnLock(f->cursor);
+  jsvUnLock2(f->container, f->position);
+}
+
+/// Move the bottom frame to the JsVar stack (so we can't use its cursor any more)
+static void jsonStringifierSpillFrame(JsonStringifier *s) {
+  JsonStringifierFrame *f = &s->frames[0];
+  if (f->hasCursor) jsvUnLock(f->cursor);
+  jsvArrayPushAndUnLock(s->stack, f->container);
+  jsvArrayPushAndUnLock(s->stack, f->position);
+  s->depth--;
+  memmove(&s->frames[0], &s->frames[1], sizeof(JsonStringifierFrame)*(size_t)s->depth);
+}
+
+/// Are we already outputting this array/object?
+static bool jsonStringifierIsOutputting(JsonStringifier *s, JsVar *var) {
+  int i;
+  for (i=0;i<s->depth;i++)
+    if (s->frames[i].container == var) return true;
+  JsVar *idx = jsvGetIndexOf(s->stack, var, true);
+  jsvUnLock(idx);
+  return idx!=0;
+}
+
+/// Output a value - if it's an array/object, add a frame so we output its contents next
+static void jsonStringifierValue(JsonStringifier *s, JsVar *var) {
+  if (jsvIsArray(var) || jsvIsArrayBuffer(var) || jsvIsObject(var)) {
+    // we can't use JSV_IS_RECURSING as other code can run between calls to 'read'
+    if (jsonStringifierIsOutputting(s, var)) {
+      jsvStringIteratorPrintfCallback(" ... ", &s->it);
+      return;
+    }
+    jsvStringIteratorAppend(&s->it, jsvIsObject(var) ? '{' : '[');
+    if (s->depth == JSON_STRINGIFIER_FRAMES) jsonStringifierSpillFrame(s);
+    JsonStringifierFrame *f = &s->frames[s->depth++];
+    f->container = jsvLockAgain(var);
+    f->position = jsvNewFromInteger(0);
+    f->cursor = jsvIsArrayBuffer(var) ? 0 : jsonStringifierLock(jsvGetFirstChild(var));
+    f->hasCursor = true;
+    return;
+  }
+  jsfGetJSONWithCallback(var, JSON_IGNORE_FUNCTIONS|JSON_NO_UNDEFINED|JSON_ARRAYBUFFER_AS_ARRAY, 0, jsvStringIteratorPrintfCallback, &s->it);
+}
+
+static void jsonStringifierNextCursor(JsonStringifierFrame *f) {
+  JsVarRef next = jsvGetNextSibling(f->cursor);
+  jsvUnLock(f->cursor);
+  f->cursor = jsonStringifierLock(next);
+}
+
+/// Find the cursor again for a frame that came from the JsVar stack
+static void jsonStringifierFindCursor(JsonStringifierFrame *f) {
+  f->hasCursor = true;
+  f->cursor = 0;
+  if (jsvIsArrayBuffer(f->container)) return;
+  if (jsvIsObject(f->container)) {
+    if (jsvIsString(f->position)) {
+      JsVar *index = jsvAsArrayIndex(f->position);
+      JsVar *key = jsvFindChildFromVar(f->container, index, false);
+      jsvUnLock(index);
+      if (key) { // (if it has been removed, we can't tell where we were so just stop)
+        f->cursor = key;
+        jsonStringifierNextCursor(f);
+      }
+    } else
+      f->cursor = jsonStringifierLock(jsvGetFirstChild(f->container));
+  } else { // array - find the first element at or after the index we're at
+    JsVarInt index = jsvGetInteger(f->position);
+    f->cursor = jsonStringifierLock(jsvGetFirstChild(f->container));
+    while (f->cursor && !(jsvIsInt(f->cursor) && jsvGetInteger(f->cursor)>=index))
+      jsonStringifierNextCursor(f);
+  }
+}
+
+/// Output the next item from the array/object in the top frame, or its end
+static void jsonStringifierNext(JsonStringifier *s) {
+  JsonStringifierFrame *f = &s->frames[s->depth-1];
+  if (!f->hasCursor) jsonStringifierFindCursor(f);
+  JsVar *item = 0;
+  bool gotItem = false;
+  if (jsvIsObject(f->container)) {
+    // skip over keys that we don't output
+    while (f->cursor) {
+      JsVar *value = jsvSkipName(f->cursor);
+      if (!(jsvIsInternalObjectKey(f->cursor) || jsvIsFunction(value) || jsvIsUndefined(value))) {
+        if (jsvIsString(f->position)) jsvStringIteratorAppend(&s->it, ',');
+        cbprintf(jsvStringIteratorPrintfCallback, &s->it, "%q:", f->cursor);
+        jsvUnLock(f->position);
+        f->position = jsvAsString(f->cursor, false);
+        jsonStringifierNextCursor(f);
+        item = value;
+        gotItem = true;
+        break;
       }
-      jsvArrayPush(arr, value);
       jsvUnLock(value);
+      jsonStringifierNextCursor(f);
     }
-    if (!jslMatch(']')) {
-      jsvUnLock(arr);
-      return 0;
+  } else {
+    JsVarInt index = jsvGetInteger(f->position);
+    bool isArray = jsvIsArray(f->container);
+    if (index < (isArray ? jsvGetArrayLength(f->container) : (JsVarInt)jsvGetArrayBufferLength(f->container))) {
+      if (index) jsvStringIteratorAppend(&s->it, ',');
+      jsvSetInteger(f->position, index+1);
+      gotItem = true;
+      if (isArray) {
+        // skip over non-numeric keys
+        while (f->cursor && !jsvIsInt(f->cursor))
+          jsonStringifierNextCursor(f);
+        if (f->cursor && jsvGetInteger(f->cursor)==index) {
+          item = jsvSkipName(f->cursor);
+          jsonStringifierNextCursor(f);
+        } else {
+          jsvStringIteratorPrintfCallback("null", &s->it); // not defined at all
+          return;
+        }
+      } else
+        item = jsvArrayBufferGet(f->container, (size_t)index);
     }
-    return arr;
-  }
-  case '{': {
-    JsVar *obj = jsvNewObject(); if (!obj) return 0;
-    jslGetNextToken(lex); // {
-    while (lex->tk == LEX_STR && !jspHasError()) {
-      JsVar *key = jsvAsArrayIndexAndUnLock(jslGetTokenValueAsVar(lex));
-      jslGetNextToken(lex);
-      JsVar *value = 0;
-      if (!jslMatch(':') ||
-          !(value=jswrap_json_parse_internal(lex)) ||
-          (lex->tk!='}' && !jslMatch(','))) {
-        jsvUnLock3(key, value, obj);
-        return 0;
+  }
+  if (gotItem) {
+    jsonStringifierValue(s, item);
+    jsvUnLock(item);
+    return;
+  }
+  // we got to the end of this array/object - go back to the one it was in
+  jsvStringIteratorAppend(&s->it, jsvIsObject(f->container) ? '}' : ']');
+  jsonStringifierFrameFree(f);
+  s->depth--;
+  if (!s->depth && jsvGetArrayLength(s->stack)) {
+    f = &s->frames[s->depth++];
+    f->position = jsvSkipNameAndUnLock(jsvArrayPop(s->stack));
+    f->container = jsvSkipNameAndUnLock(jsvArrayPop(s->stack));
+    f->hasCursor = false;
+  }
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "JSONStringifier",
+  "name" : "read",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_json_stringifier_read",
+  "params" : [
+    ["chars","int","The number of characters to read"]
+  ],
+  "return" : ["JsVar","A string of at least `chars` characters of JSON (unless the end has been reached), or undefined when all of it has been read"]
+}
+Read the next part of the JSON
+ */
+JsVar *jswrap_json_stringifier_read(JsVar *parent, int chars) {
+  JsVar *dataName = jsvFindChildFromString(parent, JSON_STRINGIFIER_DATA_NAME, false);
+  JsonStringifier s;
+  s.depth = 0;
+  s.stack = jsvObjectGetChild(parent, JSON_STRINGIFIER_STACK_NAME, 0);
+  if (!dataName && !s.stack) return 0; // finished
+  if (!s.stack) s.stack = jsvNewEmptyArray();
+  JsVar *result = jsvNewFromEmptyString();
+  if (!result || !s.stack) {
+    jsvUnLock3(dataName, s.stack, result);
+    return 0;
+  }
+  jsvStringIteratorNew(&s.it, result, 0);
+  if (dataName) {
+    // first read - output the data itself
+    JsVar *data = jsvSkipNameAndUnLock(dataName);
+    jsvObjectRemoveChild(parent, JSON_STRINGIFIER_DATA_NAME);
+    jsonStringifierValue(&s, data);
+    jsvUnLock(data);
+  } else if (jsvGetArrayLength(s.stack)) {
+    JsonStringifierFrame *f = &s.frames[s.depth++];
+    f->position = jsvSkipNameAndUnLock(jsvArrayPop(s.stack));
+    f->container = jsvSkipNameAndUnLock(jsvArrayPop(s.stack));
+    f->hasCursor = false;
+  }
+  while (s.depth && jsvStringIteratorGetIndex(&s.it)<(size_t)chars && !jspIsInterrupted())
+    jsonStringifierNext(&s);
+  jsvStringIteratorFree(&s.it);
+  if (s.depth) {
+    while (s.depth) jsonStringifierSpillFrame(&s);
+    jsvObjectSetChild(parent, JSON_STRINGIFIER_STACK_NAME, s.stack);
+  } else
+    jsvObjectRemoveChild(parent, JSON_STRINGIFIER_STACK_NAME);
+  jsvUnLock(s.stack);
+  return result;
+}
+#endif
+
+/* JSON parser. This works directly on characters rather than using the JS
+ * lexer (so there's no limit on the length of strings), and it keeps the
+ * arrays/objects it is inside on a JsVar stack rather than recursing. That
+ * means it can stop at the end of one chunk of data and carry on where it left
+ * off when the next one arrives - see JSON.parser() */
+
+typedef enum {
+  JSONP_VALUE,          ///< Expecting a value
+  JSONP_VALUE_OR_END,   ///< Just after '[' - expecting a value or ']'
+  JSONP_KEY,            ///< Just after ',' in an object - expecting a key
+  JSONP_KEY_OR_END,     ///< Just after '{' - expecting a key or '}'
+  JSONP_COLON,          ///< Just after a key - expecting ':'
+  JSONP_NEXT,           ///< Just after a value in an array/object - expecting ',' or the end
+  JSONP_STRING,         ///< Inside a string
+  JSONP_STRING_ESCAPE,  ///< Inside a string, just after '\'
+  JSONP_STRING_HEX,     ///< Inside a string, in the digits of '\x' or '\u'
+  JSONP_NUMBER,         ///< Inside a number
+  JSONP_LITERAL,        ///< Inside true/false/null
+  JSONP_DONE,           ///< Got a whole value (only when parsing just one value)
+  JSONP_ERROR,          ///< Got an error - we won't parse any more
+} PACKED_FLAGS JsonParseState;
+
+/// Which part of a number we're in: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+typedef enum {
+  JSONP_NUM_NONE,       ///< The character can't be part of the number
+  JSONP_NUM_SIGN,       ///< After the leading '-'
+  JSONP_NUM_ZERO,       ///< After a leading '0'
+  JSONP_NUM_INT,        ///< In the digits before the decimal point
+  JSONP_NUM_POINT,      ///< After the decimal point
+  JSONP_NUM_FRACTION,   ///< In the digits after the decimal point
+  JSONP_NUM_E,          ///< After 'e' or 'E'
+  JSONP_NUM_EXP_SIGN,   ///< After the sign of the exponent
+  JSONP_NUM_EXP,        ///< In the digits of the exponent
+} PACKED_FLAGS JsonNumberState;
+
+#define JSONP_MAX_NUMBER 32
+#define JSONP_MAX_MANTISSA (JSONP_MAX_NUMBER-8) ///< digits we store before the exponent - any more are dropped
+#define JSONP_MAX_EXPONENT 999 ///< any bigger exponent makes every number we can store 0 or Infinity
+#define JSONP_STACK_CACHE 16 ///< How many stack entries we keep in C rather than in a JsVar array
+
+/// The part of the parser's state that doesn't contain JsVars (so can be saved as a string)
+typedef struct {
+  JsonParseState state;
+  bool isKey;             ///< is the string we're in an object's key?
+  bool isFloat;           ///< is the number we're in not a plain integer?
+  char delim;             ///< quote character of the string we're in
+  JsonNumberState numberState; ///< the part of the number we're in
+  unsigned char literal;  ///< the literal we're in (index into jsonpLiterals)
+  unsigned char length;   ///< characters of the number/literal so far, or hex digits left
+  unsigned char charCode; ///< character from '\x' or '\u' so far
+  long long intValue;     ///< value of the (integer) number so far
+  int position;           ///< how many characters we've parsed
+  int exponentAdjust;     ///< power of 10 to multiply the number we're in by, for digits we dropped
+  char number[JSONP_MAX_NUMBER+1]; ///< text of the number we're in
+} JsonParserData;
+
+typedef struct {
+  JsonParserData d;
+  JsVar *stack;     ///< arrays and objects we're inside (apart from 'container'), each object followed by the key it'll be stored under. Only the ones that aren't in stackCache
+  JsVar *stackCache[JSONP_STACK_CACHE]; ///< the top of the stack (JsVar arrays are slow to push and pop)
+  unsigned char stackCached; ///< how many items are in stackCache
+  JsVar *container; ///< array or object that values get added to (0 at the top level)
+  JsVar *key;       ///< key in 'container' the next value will be stored under
+  JsVar *token;     ///< the string we're in
+  JsvStringIterator tokenIt; ///< iterator at the end of 'token'
+  JsVar *values;    ///< array of top-level values, or 0 if we only want one (in 'value')
+  JsVar *value;     ///< the first top-level value, if 'values' is 0
+} JsonParser;
+
+static const char *jsonpLiterals[] = {"true","false","null"};
+
+static void jsonpInitData(JsonParserData *d) {
+  memset(d, 0, sizeof(JsonParserData));
+  d->state = JSONP_VALUE;
+}
+
+static void jsonpInit(JsonParser *p) {
+  memset(p, 0, sizeof(JsonParser));
+  jsonpInitData(&p->d);
+}
+
+static void jsonpStackPush(JsonParser *p, JsVar *v) {
+  if (p->stackCached == JSONP_STACK_CACHE) {
+    // full - move the bottom of the cache into the JsVar stack
+    if (!p->stack) p->stack = jsvNewEmptyArray();
+    jsvArrayPushAndUnLock(p->stack, p->stackCache[0]);
+    memmove(&p->stackCache[0], &p->stackCache[1], sizeof(JsVar*)*(JSONP_STACK_CACHE-1));
+    p->stackCached--;
+  }
+  p->stackCache[p->stackCached++] = v;
+}
+
+static JsVar *jsonpStackPop(JsonParser *p) {
+  if (p->stackCached) return p->stackCache[--p->stackCached];
+  if (!p->stack) return 0;
+  return jsvSkipNameAndUnLock(jsvArrayPop(p->stack));
+}
+
+/// Put everything in the JsVar stack, so it can be stored
+static void jsonpStackFlush(JsonParser *p) {
+  if (!p->stackCached) return;
+  if (!p->stack) p->stack = jsvNewEmptyArray();
+  unsigned char i;
+  for (i=0;i<p->stackCached;i++)
+    jsvArrayPushAndUnLock(p->stack, p->stackCache[i]);
+  p->stackCached = 0;
+}
+
+static void jsonpKill(JsonParser *p) {
+  while (p->stackCached) jsvUnLock(p->stackCache[--p->stackCached]);
+  jsvUnLock4(p->stack, p->container, p->key, p->token);
+  jsvUnLock2(p->values, p->value);
+}
+
+static void jsonpError(JsonParser *p, char ch) {
+  if (p->d.state == JSONP_ERROR) return;
+  p->d.state = JSONP_ERROR;
+  if (ch) jsExceptionHere(JSET_SYNTAXERROR, "Unexpected '%c' in JSON at position %d", ch, p->d.position);
+  else jsExceptionHere(JSET_SYNTAXERROR, "Unexpected end of JSON input");
+}
+
+/// We have a whole value (which we unlock) - store it in the current array/object
+static void jsonpGotValue(JsonParser *p, JsVar *value) {
+  if (!value) { // out of memory
+    p->d.state = JSONP_ERROR;
+    return;
+  }
+  if (!p->container) {
+    if (p->values) {
+      jsvArrayPush(p->values, value);
+      p->d.state = JSONP_VALUE;
+    } else {
+      p->value = jsvLockAgain(value);
+      p->d.state = JSONP_DONE;
+    }
+  } else if (p->key) {
+    JsVar *key = jsvAsArrayIndexAndUnLock(p->key);
+    p->key = 0;
+    jsvAddName(p->container, jsvMakeIntoVariableName(key, value));
+    jsvUnLock(key);
+    p->d.state = JSONP_NEXT;
+  } else {
+    jsvArrayPush(p->container, value);
+    p->d.state = JSONP_NEXT;
+  }
+  jsvUnLock(value);
+}
+
+/// Start adding values to a new array/object
+static void jsonpOpen(JsonParser *p, JsVar *container, JsonParseState state) {
+  if (!container) { // out of memory
+    p->d.state = JSONP_ERROR;
+    return;
+  }
+  if (p->container) {
+    jsonpStackPush(p, p->container);
+    if (p->key) jsonpStackPush(p, p->key);
+  }
+  p->container = container;
+  p->key = 0;
+  p->d.state = state;
+}
+
+/// The current array/object has finished - go back to adding to the one it's in
+static void jsonpClose(JsonParser *p) {
+  JsVar *value = p->container;
+  p->container = jsonpStackPop(p);
+  if (p->container && !jsvIsArray(p->container) && !jsvIsObject(p->container)) {
+    p->key = p->container;
+    p->container = jsonpStackPop(p);
+  }
+  jsonpGotValue(p, value);
+}
+
+static void jsonpStartString(JsonParser *p, char delim, bool isKey) {
+  p->token = jsvNewFromEmptyString();
+  if (!p->token) { // out of memory
+    p->d.state = JSONP_ERROR;
+    return;
+  }
+  jsvStringIteratorNew(&p->tokenIt, p->token, 0);
+  p->d.delim = delim;
+  p->d.isKey = isKey;
+  p->d.state = JSONP_STRING;
+}
+
+static void jsonpEndString(JsonParser *p) {
+  jsvStringIteratorFree(&p->tokenIt);
+  JsVar *str = p->token;
+  p->token = 0;
+  if (p->d.isKey) {
+    p->key = str;
+    p->d.state = JSONP_COLON;
+  } else
+    jsonpGotValue(p, str);
+}
+
+/// Get the part of the number we'll be in after 'ch', or JSONP_NUM_NONE if it can't come next
+static JsonNumberState jsonpNumberNext(JsonNumberState state, char ch) {
+  bool digit = isNumeric(ch);
+  bool exponent = ch=='e' || ch=='E';
+  switch (state) {
+  case JSONP_NUM_SIGN:
+    if (ch=='0') return JSONP_NUM_ZERO;
+    return digit ? JSONP_NUM_INT : JSONP_NUM_NONE;
+  case JSONP_NUM_ZERO:
+  case JSONP_NUM_INT:
+    if (digit && state==JSONP_NUM_INT) return JSONP_NUM_INT;
+    if (ch=='.') return JSONP_NUM_POINT;
+    return exponent ? JSONP_NUM_E : JSONP_NUM_NONE;
+  case JSONP_NUM_POINT:
+  case JSONP_NUM_FRACTION:
+    if (digit) return JSONP_NUM_FRACTION;
+    return (exponent && state==JSONP_NUM_FRACTION) ? JSONP_NUM_E : JSONP_NUM_NONE;
+  case JSONP_NUM_E:
+    if (ch=='+' || ch=='-') return JSONP_NUM_EXP_SIGN;
+    return digit ? JSONP_NUM_EXP : JSONP_NUM_NONE;
+  case JSONP_NUM_EXP_SIGN:
+  case JSONP_NUM_EXP:
+    return digit ? JSONP_NUM_EXP : JSONP_NUM_NONE;
+  default:
+    return JSONP_NUM_NONE;
+  }
+}
+
+/// Is the number we're in complete, if it ends here?
+static bool jsonpNumberCanEnd(JsonNumberState state) {
+  return state==JSONP_NUM_ZERO || state==JSONP_NUM_INT ||
+         state==JSONP_NUM_FRACTION || state==JSONP_NUM_EXP;
+}
+
+static void jsonpEndNumber(JsonParser *p) {
+  JsonParserData *d = &p->d;
+  d->number[d->length] = 0;
+  if (d->exponentAdjust) {
+    // fold the digits we dropped into the number's exponent
+    char *e = strchr(d->number, 'e');
+    if (!e) e = strchr(d->number, 'E');
+    int exponent = d->exponentAdjust;
+    if (e) exponent += (int)stringToInt(e+1);
+    else e = &d->number[d->length];
+    if (exponent > JSONP_MAX_EXPONENT) exponent = JSONP_MAX_EXPONENT;
+    if (exponent < -JSONP_MAX_EXPONENT) exponent = -JSONP_MAX_EXPONENT;
+    *(e++) = 'e';
+    itostr(exponent, e, 10);
+  }
+  if (d->isFloat)
+    jsonpGotValue(p, jsvNewFromFloat(stringToFloat(d->number)));
+  else
+    jsonpGotValue(p, jsvNewFromLongInteger((d->number[0]=='-') ? -d->intValue : d->intValue));
+}
+
+/** We've got more digits than we can store. Digits after those we have make no difference
+ * to the value, so drop them (keeping track of where the decimal point should be).
+ * Returns false if it's a digit of the exponent, which must be stored */
+static bool jsonpNumberDropDigit(JsonParserData *d) {
+  if (d->numberState>=JSONP_NUM_E) // JSONP_NUM_E, JSONP_NUM_EXP_SIGN or JSONP_NUM_EXP
+    return false;
+  d->number[d->length] = 0;
+  d->isFloat = true;
+  char *point = strchr(d->number, '.');
+  if (!point) { // before the decimal point - the number gets 10x bigger
+    d->exponentAdjust++;
+    return true;
+  }
+  const char *c = d->number;
+  while (*c=='-' || *c=='0' || *c=='.') c++;
+  if (!*c) {
+    /* Only zeros so far, eg. 0.0000... - remove the zeros after the point
+     * so we have room for the digits that matter */
+    int zeros = (int)(&d->number[d->length] - (point+1));
+    d->exponentAdjust -= zeros;
+    d->length = (unsigned char)(d->length - zeros);
+    return false; // now store this digit
+  }
+  return true;
+}
+
+static bool jsonpIsWhitespace(char ch) {
+  return ch==' ' || ch=='\n' || ch=='\r' || ch=='\t';
+}
+
+/// Handle the first character of a value
+static void jsonpStartValue(JsonParser *p, char ch) {
+  JsonParserData *d = &p->d;
+  if (ch=='"' || ch=='\'') {
+    jsonpStartString(p, ch, false);
+  } else if (ch=='[') {
+    jsonpOpen(p, jsvNewEmptyArray(), JSONP_VALUE_OR_END);
+  } else if (ch=='{') {
+    jsonpOpen(p, jsvNewObject(), JSONP_KEY_OR_END);
+  } else if (ch=='-' || isNumeric(ch)) {
+    d->state = JSONP_NUMBER;
+    d->isFloat = false;
+    d->intValue = (ch=='-') ? 0 : (ch-'0');
+    d->numberState = (ch=='-') ? JSONP_NUM_SIGN : ((ch=='0') ? JSONP_NUM_ZERO : JSONP_NUM_INT);
+    d->exponentAdjust = 0;
+    d->number[0] = ch;
+    d->length = 1;
+  } else if (ch=='t' || ch=='f' || ch=='n') {
+    d->state = JSONP_LITERAL;
+    d->literal = (unsigned char)((ch=='t') ? 0 : ((ch=='f') ? 1 : 2));
+    d->length = 1;
+  } else
+    jsonpError(p, ch);
+}
+
+/// Handle one character. Returns false if it ended a number but wasn't used
+static bool jsonpChar(JsonParser *p, char ch) {
+  JsonParserData *d = &p->d;
+  switch (d->state) {
+  case JSONP_VALUE_OR_END:
+    if (ch==']') {
+      jsonpClose(p);
+      return true;
+    } // else fall through
+  case JSONP_VALUE:
+    if (!jsonpIsWhitespace(ch)) jsonpStartValue(p, ch);
+    return true;
+  case JSONP_KEY_OR_END:
+    if (ch=='}') {
+      jsonpClose(p);
+      return true;
+    } // else fall through
+  case JSONP_KEY:
+    if (ch=='"' || ch=='\'') jsonpStartString(p, ch, true);
+    else if (!jsonpIsWhitespace(ch)) jsonpError(p, ch);
+    return true;
+  case JSONP_COLON:
+    if (ch==':') d->state = JSONP_VALUE;
+    else if (!jsonpIsWhitespace(ch)) jsonpError(p, ch);
+    return true;
+  case JSONP_NEXT: {
+    bool isArray = jsvIsArray(p->container);
+    if (ch==',') d->state = isArray ? JSONP_VALUE : JSONP_KEY;
+    else if (ch==(isArray?']':'}')) jsonpClose(p);
+    else if (!jsonpIsWhitespace(ch)) jsonpError(p, ch);
+    return true;
+  }
+  case JSONP_STRING:
+    if (ch==d->delim) jsonpEndString(p);
+    else if (ch=='\\') d->state = JSONP_STRING_ESCAPE;
+    else jsvStringIteratorAppend(&p->tokenIt, ch);
+    return true;
+  case JSONP_STRING_ESCAPE:
+    d->state = JSONP_STRING;
+    switch (ch) {
+    case 'n': ch = 0x0A; break;
+    case 'b': ch = 0x08; break;
+    case 'f': ch = 0x0C; break;
+    case 'r': ch = 0x0D; break;
+    case 't': ch = 0x09; break;
+    case 'v': ch = 0x0B; break;
+    case 'a': ch = 0x07; break;
+    case 'x':
+    case 'u':
+      // We don't support unicode, so we just take the bottom 8 bits (like the lexer)
+      d->state = JSONP_STRING_HEX;
+      d->length = (ch=='u') ? 4 : 2;
+      d->charCode = 0;
+      return true;
+    }
+    jsvStringIteratorAppend(&p->tokenIt, ch);
+    return true;
+  case JSONP_STRING_HEX: {
+    int n = chtod(ch);
+    if (n<0 || n>15) {
+      jsonpError(p, ch);
+      return true;
+    }
+    d->charCode = (unsigned char)((d->charCode<<4) | n);
+    if (--d->length == 0) {
+      jsvStringIteratorAppend(&p->tokenIt, (char)d->charCode);
+      d->state = JSONP_STRING;
+    }
+    return true;
+  }
+  case JSONP_NUMBER: {
+    JsonNumberState next = jsonpNumberNext(d->numberState, ch);
+    if (next==JSONP_NUM_NONE) {
+      if (!jsonpNumberCanEnd(d->numberState)) {
+        jsonpError(p, ch);
+        return true;
       }
-      jsvAddName(obj, jsvMakeIntoVariableName(key, value));
-      jsvUnLock2(value, key);
+      jsonpEndNumber(p);
+      return false;
+    }
+    if (isNumeric(ch) && d->length >= JSONP_MAX_MANTISSA && jsonpNumberDropDigit(d)) {
+      d->numberState = next;
+      return true;
     }
-    if (!jslMatch('}')) {
-      jsvUnLock(obj);
-      return 0;
+    if (d->length >= JSONP_MAX_NUMBER) { // a really long exponent
+      jsonpError(p, ch);
+      return true;
     }
-    return obj;
+    d->numberState = next;
+    d->number[d->length++] = ch;
+    // 18 digits always fits in a long long - past that let stringToFloat sort it out
+    if (!isNumeric(ch) || d->length>18) d->isFloat = true;
+    else d->intValue = d->intValue*10 + (ch-'0');
+    return true;
+  }
+  case JSONP_LITERAL: {
+    const char *literal = jsonpLiterals[d->literal];
+    if (ch != literal[d->length]) {
+      jsonpError(p, ch);
+      return true;
+    }
+    if (!literal[++d->length]) {
+      if (d->literal==2) jsonpGotValue(p, jsvNewWithFlags(JSV_NULL));
+      else jsonpGotValue(p, jsvNewFromBool(d->literal==0));
+    }
+    return true;
+  }
+  case JSONP_DONE:
+    // only whitespace is allowed after the value
+    if (!jsonpIsWhitespace(ch)) jsonpError(p, ch);
+    break;
+  case JSONP_ERROR:
+    break;
+  }
+  return true;
+}
+
+/// Parse all the characters in str
+static void jsonpWrite(JsonParser *p, JsVar *str) {
+  if (p->token) {
+    jsvStringIteratorNew(&p->tokenIt, p->token, 0);
+    jsvStringIteratorGotoEnd(&p->tokenIt);
   }
-  default: {
-    char buf[32];
-    jslTokenAsString(lex->tk, buf, 32);
-    jsExceptionHere(JSET_SYNTAXERROR, "Expecting a valid value, got %s", buf);
-    return 0; // undefined = error
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  while (jsvStringIteratorHasChar(&it) && p->d.state!=JSONP_ERROR) {
+    char ch = jsvStringIteratorGetChar(&it);
+    if (p->d.state==JSONP_STRING && ch!=p->d.delim && ch!='\\') {
+      // most characters are in strings - don't go through jsonpChar for them
+      jsvStringIteratorAppend(&p->tokenIt, ch);
+    } else if (!jsonpChar(p, ch))
+      jsonpChar(p, ch); // a number ended - deal with what came after it
+    p->d.position++;
+    jsvStringIteratorNext(&it);
   }
+  jsvStringIteratorFree(&it);
+  if (p->token) jsvStringIteratorFree(&p->tokenIt);
+}
+
+/// There's no more data - finish any number we were in, and make sure we're not part way through a value
+static void jsonpEnd(JsonParser *p) {
+  if (p->d.state==JSONP_NUMBER) {
+    if (!jsonpNumberCanEnd(p->d.numberState)) {
+      jsonpError(p, 0);
+      return;
+    }
+    jsonpEndNumber(p);
   }
+  if (p->d.state==JSONP_DONE || p->d.state==JSONP_ERROR) return;
+  if (p->d.state!=JSONP_VALUE || p->container || p->values==0)
+    jsonpError(p, 0);
 }
 
 /*JSON{
@@ -166,20 +804,177 @@ JsVar *jswrap_json_parse_internal() {
 }
 Parse the given JSON string into a JavaScript object
 
-NOTE: This implementation uses eval() internally, and as such it is unsafe as it can allow arbitrary JS commands to be executed.
+**Note:** As well as standard JSON, this will also parse strings in single
+quotes and `\x` escape codes (which `JSON.stringify` may produce). Anything
+but whitespace after the value is an error.
  */
 JsVar *jswrap_json_parse(JsVar *v) {
-  JsLex lex;
   JsVar *str = jsvAsString(v, false);
-  JsLex *oldLex = jslSetLex(&lex);
-  jslInit(str);
+  if (!str) return 0;
+  JsonParser p;
+  jsonpInit(&p);
+  jsonpWrite(&p, str);
+  jsonpEnd(&p);
   jsvUnLock(str);
-  JsVar *res = jswrap_json_parse_internal();
-  jslKill();
-  jslSetLex(oldLex);
+  JsVar *res = (p.d.state==JSONP_DONE) ? jsvLockAgain(p.value) : 0;
+  jsonpKill(&p);
   return res;
 }
 
+#ifndef SAVE_ON_FLASH
+#define JSONP_STATE_NAME JS_HIDDEN_CHAR_STR"sta"
+#define JSONP_STACK_NAME JS_HIDDEN_CHAR_STR"stk"
+#define JSONP_CONTAINER_NAME JS_HIDDEN_CHAR_STR"con"
+#define JSONP_KEY_NAME JS_HIDDEN_CHAR_STR"key"
+#define JSONP_TOKEN_NAME JS_HIDDEN_CHAR_STR"tok"
+
+/*JSON{
+  "type" : "class",
+  "class" : "JSONParser",
+  "ifndef" : "SAVE_ON_FLASH"
+}
+A parser for a stream of JSON values, created with `JSON.parser()`
+ */
+/*JSON{
+  "type" : "event",
+  "class" : "JSONParser",
+  "name" : "data",
+  "params" : [
+    ["value","JsVar","A value that has been parsed"]
+  ]
+}
+Called each time a complete top-level value has been parsed
+ */
+
+/*JSON{
+  "type" : "staticmethod",
+  "class" : "JSON",
+  "name" : "parser",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_json_parser",
+  "return" : ["JsVar","A JSONParser object"]
+}
+Create a parser that JSON can be written to a bit at a time, for instance as it
+arrives from a socket. A `data` event is emitted each time a complete value has
+been parsed, so the whole of the data never has to be stored as a string:
+
+```
+var p = JSON.parser();
+p.on('data', function(v) { print(v); });
+p.write('{"a":1}\n{"b":');
+p.write('[1,2,3]}');
+// prints { "a": 1 } then { "b": [ 1, 2, 3 ] }
+```
+
+As the parser has `write` and `end` methods you can also `pipe` into it.
+ */
+JsVar *jswrap_json_parser() {
+  return jspNewObject(0, "JSONParser");
+}
+
+static JsVar *jswrap_json_parser_take(JsVar *parser, const char *name) {
+  JsVar *v = jsvObjectGetChild(parser, name, 0);
+  if (v) jsvObjectRemoveChild(parser, name);
+  return v;
+}
+
+/// Get the parser's state back from the JSONParser object
+static void jswrap_json_parser_load(JsVar *parser, JsonParser *p) {
+  jsonpInit(p);
+  JsVar *state = jsvObjectGetChild(parser, JSONP_STATE_NAME, 0);
+  if (state) {
+    jsvGetStringChars(state, 0, (char*)&p->d, sizeof(JsonParserData));
+    jsvUnLock(state);
+  }
+  p->stack = jswrap_json_parser_take(parser, JSONP_STACK_NAME);
+  /* Take these out of the parser object - the key gets turned into a variable
+   * name, which it can't be if something else references it */
+  p->container = jswrap_json_parser_take(parser, JSONP_CONTAINER_NAME);
+  p->key = jswrap_json_parser_take(parser, JSONP_KEY_NAME);
+  p->token = jswrap_json_parser_take(parser, JSONP_TOKEN_NAME);
+  p->values = jsvNewEmptyArray();
+}
+
+/// Store the parser's state in the JSONParser object (or clear it if there was an error)
+static void jswrap_json_parser_save(JsVar *parser, JsonParser *p) {
+  bool reset = p->d.state == JSONP_ERROR;
+  if (reset) jsonpInitData(&p->d);
+  jsvObjectSetChildAndUnLock(parser, JSONP_STATE_NAME, jsvNewStringOfLength(sizeof(JsonParserData), (char*)&p->d));
+  jsvObjectSetOrRemoveChild(parser, JSONP_CONTAINER_NAME, reset ? 0 : p->container);
+  jsvObjectSetOrRemoveChild(parser, JSONP_KEY_NAME, reset ? 0 : p->key);
+  jsvObjectSetOrRemoveChild(parser, JSONP_TOKEN_NAME, reset ? 0 : p->token);
+  if (!reset) jsonpStackFlush(p);
+  jsvObjectSetOrRemoveChild(parser, JSONP_STACK_NAME, (reset || !p->container) ? 0 : p->stack);
+}
+
+/// Emit a 'data' event for each value we parsed
+static void jswrap_json_parser_emit(JsVar *parser, JsVar *values) {
+  if (!values || jspHasError()) return;
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, values);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *value = jsvObjectIteratorGetValue(&it);
+    jsiExecuteObjectCallbacks(parser, JS_EVENT_PREFIX"data", &value, 1);
+    jsvUnLock(value);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "JSONParser",
+  "name" : "write",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_json_parser_write",
+  "params" : [
+    ["data","JsVar","The next part of the JSON"]
+  ]
+}
+Parse some more JSON, emitting a `data` event for each complete value. Values
+may be split between calls to `write` in any way, and several values in a row
+(for instance separated by newlines) are allowed.
+
+If the JSON is invalid, an exception is thrown and the parser is reset.
+ */
+void jswrap_json_parser_write(JsVar *parser, JsVar *data) {
+  JsVar *str = jsvAsString(data, false);
+  if (!str) return;
+  JsonParser p;
+  jswrap_json_parser_load(parser, &p);
+  if (p.values) jsonpWrite(&p, str);
+  jsvUnLock(str);
+  jswrap_json_parser_save(parser, &p);
+  JsVar *values = jsvLockAgainSafe(p.values);
+  jsonpKill(&p);
+  jswrap_json_parser_emit(parser, values);
+  jsvUnLock(values);
+}
+
+/*JSON{
+  "type" : "method",
+  "class" : "JSONParser",
+  "name" : "end",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_json_parser_end"
+}
+Tell the parser there is no more data. This emits a `data` event if the data
+ended with a number, and throws an exception if it ended part way through a value.
+The parser can then be used again.
+ */
+void jswrap_json_parser_end(JsVar *parser) {
+  JsonParser p;
+  jswrap_json_parser_load(parser, &p);
+  jsonpEnd(&p);
+  p.d.state = JSONP_ERROR; // always start again afterwards
+  jswrap_json_parser_save(parser, &p);
+  JsVar *values = jsvLockAgainSafe(p.values);
+  jsonpKill(&p);
+  jswrap_json_parser_emit(parser, values);
+  jsvUnLock(values);
+}
+#endif
+
 /* This is like jsfGetJSONWithCallback, but handles ONLY functions (and does not print the initial 'function' text) */
 void jsfGetJSONForFunctionWithCallback(JsVar *var, JSONFlags flags, vcbprintf_callback user_callback, void *user_data) {
   assert(jsvIsFunction(var));
@@ -15,6 +15,11 @@
 
 JsVar *jswrap_json_stringify(JsVar *v, JsVar *replacer, JsVar *space);
 JsVar *jswrap_json_parse(JsVar *v);
+void jswrap_json_stringifyTo(JsVar *data, JsVar *destination, JsVar *options);
+JsVar *jswrap_json_stringifier_read(JsVar *parent, int chars);
+JsVar *jswrap_json_parser();
+void jswrap_json_parser_write(JsVar *parser, JsVar *data);
+void jswrap_json_parser_end(JsVar *parser);
 
 typedef enum {
   JSON_NONE,
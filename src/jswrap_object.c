@@ -178,16 +178,19 @@ void _jswrap_object_keys_or_property_names_iterator(
   if (!symbols) return;
   unsigned int i;
   unsigned char symbolCount = READ_FLASH_UINT8(&symbols->symbolCount);
+  // symbols are in hash order, but their names are stored one after the other in alphabetical order
+  const char *symName = symbols->symbolChars;
   for (i=0;i<symbolCount;i++) {
-    unsigned short strOffset = READ_FLASH_UINT16(&symbols->symbols[i].strOffset);
 #ifndef USE_FLASH_MEMORY
-    JsVar *name = jsvNewFromString(&symbols->symbolChars[strOffset]);
+    JsVar *name = jsvNewFromString(symName);
+    symName += strlen(symName)+1;
 #else
     // On the esp8266 the string is in flash, so we have to copy it to RAM first
     // We can't use flash_strncpy here because it assumes that strings start on a word
     // boundary and that's not the case here.
-    char buf[64], *b = buf, c; const char *s = &symbols->symbolChars[strOffset];
-    do { c = READ_FLASH_UINT8(s++); *b++ = c; } while (c && b != buf+64);
+    char buf[64], *b = buf, c;
+    do { c = READ_FLASH_UINT8(symName++); if (b != buf+63) *b++ = c; } while (c);
+    *b = 0;
     JsVar *name = jsvNewFromString(buf);
 #endif
     //os_printf_plus("OBJ cb %s\n", buf);
@@ -406,7 +409,7 @@ bool jswrap_object_hasOwnProperty(JsVar *parent, JsVar *name) {
       char str[32];
       jsvGetString(propName, str, sizeof(str));
 
-      JsVar *v = jswBinarySearch(symbols, parent, str);
+      JsVar *v = jswSymbolListFind(symbols, parent, str);
       if (v) contains = true;
       jsvUnLock(v);
     }
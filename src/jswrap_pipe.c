@@ -23,12 +23,50 @@
  *    * When the pipe closes, unless 'end=false' on initialisation, we call
  *      'end' on destination, and 'close' on source.
  *
+ * If both ends are builtin streams (File, Serial or Socket) we don't call
+ * 'read' and 'write' at all, but move the data in C through a buffer on the
+ * stack. Rather than waiting for 'drain', we just stop while a Socket still
+ * has plenty of data waiting to be sent.
+ *
  * ----------------------------------------------------------------------------
  */
 
 #include "jswrap_pipe.h"
 #include "jswrap_object.h"
 #include "jswrap_stream.h"
+#ifdef USE_FILESYSTEM
+#include "jswrap_file.h"
+#endif
+#ifdef USE_NET
+#include "socketserver.h"
+#endif
+
+/// Streams that we can read and write without calling their JS methods
+typedef enum {
+  PIPE_JS,     ///< Anything else - call 'read' and 'write'
+  PIPE_FILE,   ///< File from E.openFile
+  PIPE_SERIAL, ///< Serial port - read what's been received, write directly
+  PIPE_SOCKET, ///< Socket - read what's been received, write to its send buffer
+} PipeStreamType;
+
+#ifdef LINUX
+#define PIPE_BUFFER_SIZE 4096 ///< Most data a native pipe moves at once (it's on the stack)
+#else
+#define PIPE_BUFFER_SIZE 128
+#endif
+#define PIPE_MAX_PER_IDLE (PIPE_BUFFER_SIZE*8) ///< Most data a native pipe moves each time around the idle loop
+#define PIPE_SOCKET_WAITING (PIPE_BUFFER_SIZE*2) ///< Stop writing while a Socket has this much waiting to send
+
+static PipeStreamType pipeGetStreamType(JsVar *stream) {
+#ifdef USE_FILESYSTEM
+  if (jsvIsInstanceOf(stream, "File")) return PIPE_FILE;
+#endif
+  if (jsvIsInstanceOf(stream, "Serial") && DEVICE_IS_USART(jsiGetDeviceFromClass(stream))) return PIPE_SERIAL;
+#ifdef USE_NET
+  if (jsvIsInstanceOf(stream, "Socket")) return PIPE_SOCKET;
+#endif
+  return PIPE_JS;
+}
 
 static JsVar* pipeGetArray(bool create) {
   return jsvObjectGetChild(execInfo.hiddenRoot, "pipes", create ? JSV_ARRAY : 0);
@@ -100,9 +138,87 @@ static void handlePipeClose(JsVar *arr, JsvObjectIterator *it, JsVar* pipe) {
   jsvUnLock(idx);
 }
 
+/** Read into 'buf' from a builtin stream. Returns the amount read, and sets
+ * 'finished' if there will never be any more */
+static size_t pipeReadNative(JsVar *source, PipeStreamType type, char *buf, size_t len, bool *finished) {
+  size_t n = 0;
+#ifdef USE_FILESYSTEM
+  if (type==PIPE_FILE) {
+    n = jswrap_file_readBuf(source, buf, len);
+    if (!n) *finished = true;
+  } else
+#endif
+  if (type==PIPE_SERIAL || type==PIPE_SOCKET) {
+    // We get told when these close
+    n = jswrap_stream_readBuf(source, buf, len);
+  }
+  return n;
+}
+
+/// Write from 'buf' to a builtin stream
+static void pipeWriteNative(JsVar *destination, PipeStreamType type, const char *buf, size_t len) {
+#ifdef USE_FILESYSTEM
+  if (type==PIPE_FILE) jswrap_file_writeBuf(destination, buf, len);
+#endif
+  if (type==PIPE_SERIAL) {
+    IOEventFlags device = jsiGetDeviceFromClass(destination);
+    size_t i;
+    for (i=0;i<len;i++) jshTransmit(device, (unsigned char)buf[i]);
+  }
+#ifdef USE_NET
+  if (type==PIPE_SOCKET) socketWriteBuf(destination, buf, len);
+#endif
+}
+
+/// Can we write to this builtin stream right now? (are we waiting for it to send data?)
+static bool pipeCanWriteNative(JsVar *destination, PipeStreamType type) {
+#ifdef USE_NET
+  if (type==PIPE_SOCKET) {
+    int waiting = socketWriteBuf(destination, 0, 0);
+    return waiting>=0 && waiting<PIPE_SOCKET_WAITING;
+  }
+#else
+  NOT_USED(destination);
+  NOT_USED(type);
+#endif
+  return true;
+}
+
+/// Move data between two builtin streams without calling into JS. Returns true if data was moved
+static bool handlePipeNative(JsVar *arr, JsvObjectIterator *it, JsVar* pipe, JsVar *source, JsVar *destination, JsVarInt chunkSize) {
+  PipeStreamType sourceType = (PipeStreamType)jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"srcType",0));
+  PipeStreamType destinationType = (PipeStreamType)jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"dstType",0));
+  char buf[PIPE_BUFFER_SIZE];
+  size_t len = (chunkSize>0 && chunkSize<PIPE_BUFFER_SIZE) ? (size_t)chunkSize : PIPE_BUFFER_SIZE;
+  size_t total = 0;
+  bool finished = false;
+  while (total<PIPE_MAX_PER_IDLE && !finished && pipeCanWriteNative(destination, destinationType)) {
+    size_t n = pipeReadNative(source, sourceType, buf, len, &finished);
+    if (!n) break;
+    pipeWriteNative(destination, destinationType, buf, n);
+    total += n;
+  }
+  if (total) {
+    JsVar *position = jsvObjectGetChild(pipe,"position",0);
+    jsvSetInteger(position, jsvGetInteger(position) + (JsVarInt)total);
+    jsvUnLock(position);
+  }
+  if (finished)
+    handlePipeClose(arr, it, pipe);
+  return total>0;
+}
+
 static bool handlePipe(JsVar *arr, JsvObjectIterator *it, JsVar* pipe) {
   bool paused = jsvGetBoolAndUnLock(jsvObjectGetChild(pipe,"drainWait",0));
   if (paused) return false;
+  if (jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"srcType",0))!=PIPE_JS) {
+    JsVar *source = jsvObjectGetChild(pipe,"source",0);
+    JsVar *destination = jsvObjectGetChild(pipe,"destination",0);
+    JsVarInt chunkSize = jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"chunkSize",0));
+    bool dataTransferred = handlePipeNative(arr, it, pipe, source, destination, chunkSize);
+    jsvUnLock2(source, destination);
+    return dataTransferred;
+  }
 
   JsVar *position = jsvObjectGetChild(pipe,"position",0);
   JsVar *chunkSize = jsvObjectGetChild(pipe,"chunkSize",0);
@@ -245,7 +361,7 @@ static void jswrap_pipe_dst_close_listener(JsVar *destination) {
   "params" : [
     ["source","JsVar","The source file/stream that will send content."],
     ["destination","JsVar","The destination file/stream that will receive content from the source."],
-    ["options","JsVar",["An optional object `{ chunkSize : int=64, end : bool=true, complete : function }`","chunkSize : The amount of data to pipe from source to destination at a time","complete : a function to call when the pipe activity is complete","end : call the 'end' function on the destination when the source is finished"]]
+    ["options","JsVar",["An optional object `{ chunkSize : int=64, end : bool=true, complete : function }`","chunkSize : The amount of data to pipe from source to destination at a time (by default more if both are Files, Serial ports or Sockets)","complete : a function to call when the pipe activity is complete","end : call the 'end' function on the destination when the source is finished"]]
   ]
 }*/
 void jswrap_pipe(JsVar* source, JsVar* dest, JsVar* options) {
@@ -258,7 +374,10 @@ void jswrap_pipe(JsVar* source, JsVar* dest, JsVar* options) {
     JsVar *writeFunc = jspGetNamedField(dest, "write", false);
     if(jsvIsFunction(readFunc)) {
       if(jsvIsFunction(writeFunc)) {
-        JsVarInt chunkSize = 64;
+        PipeStreamType sourceType = pipeGetStreamType(source);
+        PipeStreamType destinationType = pipeGetStreamType(dest);
+        bool isNative = sourceType!=PIPE_JS && destinationType!=PIPE_JS;
+        JsVarInt chunkSize = isNative ? PIPE_BUFFER_SIZE : 64;
         bool callEnd = true;
         // parse Options Object
         if (jsvIsObject(options)) {
@@ -283,11 +402,15 @@ void jswrap_pipe(JsVar* source, JsVar* dest, JsVar* options) {
         }
         // set up our event listeners
         jswrap_object_addEventListener(source, "close", jswrap_pipe_src_close_listener, JSWAT_THIS_ARG);
-        jswrap_object_addEventListener(dest, "drain", jswrap_pipe_drain_listener, JSWAT_VOID | (JSWAT_JSVAR << (JSWAT_BITS*1)));
+        jswrap_object_addEventListener(dest, "drain", jswrap_pipe_drain_listener, JSWAT_THIS_ARG);
         jswrap_object_addEventListener(dest, "close", jswrap_pipe_dst_close_listener, JSWAT_THIS_ARG);
         // set up the rest of the pipe
         jsvObjectSetChildAndUnLock(pipe, "chunkSize", jsvNewFromInteger(chunkSize));
         jsvObjectSetChildAndUnLock(pipe, "end", jsvNewFromBool(callEnd));
+        if (isNative) {
+          jsvObjectSetChildAndUnLock(pipe, "srcType", jsvNewFromInteger(sourceType));
+          jsvObjectSetChildAndUnLock(pipe, "dstType", jsvNewFromInteger(destinationType));
+        }
         jsvUnLock3(jsvAddNamedChild(pipe, position, "position"), 
                    jsvAddNamedChild(pipe, source, "source"), 
                    jsvAddNamedChild(pipe, dest, "destination"));
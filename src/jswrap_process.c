@@ -119,6 +119,9 @@ Run a Garbage Collection pass, and return an object containing information on me
 * `history` : Memory used for command history - that is freed if memory is low. Note that this is INCLUDED in the figure for 'free'
 * `gc`      : Memory freed during the GC pass
 * `gctime`  : Time taken for GC pass (in milliseconds)
+* `gccount` : (not on devices with low flash) Number of garbage collections that have finished since startup
+* `gcslices` : (not on devices with low flash) Number of slices of incremental garbage collection that have been done (see `E.setGCOptions`)
+* `gcmax`   : (not on devices with low flash) Longest time that garbage collection has stopped execution for - either a full collection or an incremental slice (in milliseconds)
 * `stackEndAddress` : (on ARM) the address (that can be used with peek/poke/etc) of the END of the stack. The stack grows down, so unless you do a lot of recursion the bytes above this can be used.
 * `flash_start`      : (on ARM) the address of the start of flash memory (usually `0x8000000`)
 * `flash_binary_end` : (on ARM) the address in flash memory of the end of Espruino's firmware.
@@ -149,6 +152,11 @@ JsVar *jswrap_process_memory() {
     jsvObjectSetChildAndUnLock(obj, "history", jsvNewFromInteger((JsVarInt)history));
     jsvObjectSetChildAndUnLock(obj, "gc", jsvNewFromInteger((JsVarInt)gc));
     jsvObjectSetChildAndUnLock(obj, "gctime", jsvNewFromFloat(jshGetMillisecondsFromTime(time2-time1)));
+#ifndef SAVE_ON_FLASH
+    jsvObjectSetChildAndUnLock(obj, "gccount", jsvNewFromInteger((JsVarInt)jsvGCStats.count));
+    jsvObjectSetChildAndUnLock(obj, "gcslices", jsvNewFromInteger((JsVarInt)jsvGCStats.slices));
+    jsvObjectSetChildAndUnLock(obj, "gcmax", jsvNewFromFloat(jshGetMillisecondsFromTime(jsvGCStats.maxPause)));
+#endif
 
 #ifdef ARM
     extern int LINKER_END_VAR; // end of ram used (variables) - should be 'void', but 'int' avoids warnings
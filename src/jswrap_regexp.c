@@ -19,174 +19,723 @@
 #include "jslex.h"
 #include "jsinteractive.h"
 
-/* TODO:
+/* Regular expressions are compiled once (when the RegExp is created) into a
+ * small program that is stored in a hidden string on the RegExp object. It
+ * is then run with a Pike VM: every possible match is advanced in lock-step
+ * one character at a time, so the string is only iterated over once and
+ * the time taken is linear in the length of the input, however nasty the
+ * pattern.
  *
- * Handling of 'global' flag especially
- * lastIndex support?
+ * TODO:
+ *
+ * lookahead and backreferences
  */
 
 #define MAX_GROUPS 9
+/// Max size of a compiled program (jumps are 16 bit relative offsets)
+#define RE_MAX_CODE 2048
+#define RE_CODE_NAME JS_HIDDEN_CHAR_STR"cde"
+
+/* Header of a compiled program */
+#define RE_HDR_FLAGS 0   ///< RE_FLAG_*
+#define RE_HDR_GROUPS 1  ///< number of capturing groups
+#define RE_HDR_THREADS 2 ///< (2 bytes) max number of threads we can have alive at once
+#define RE_HDR_SIZE 4
+
+#define RE_FLAG_IGNORECASE 1
+#define RE_FLAG_MULTILINE 2
+
+typedef enum {
+  RE_MATCH,     ///< the regex has matched
+  RE_CHAR,      ///< [char] match a single character
+  RE_ANY,       ///< match any character except newlines
+  RE_CLASS,     ///< [32 byte bitmap] match any character in the set
+  RE_BOL,       ///< assert start of string (or line)
+  RE_EOL,       ///< assert end of string (or line)
+  RE_WORDB,     ///< assert word boundary
+  RE_NWORDB,    ///< assert not word boundary
+  RE_SAVE,      ///< [slot] save the current position in a capture slot
+  RE_JMP,       ///< [offset16] continue at the given offset from this instruction
+  RE_SPLIT,     ///< [offset16,offset16] continue at both offsets, preferring the first
+} PACKED_FLAGS RegExOp;
+
+#define RE_CLASS_SIZE 32
+#define RE_JMP_SIZE 3
+#define RE_SPLIT_SIZE 5
+#define RE_REPEAT_INFINITE 0xFFFF
+
+// ----------------------------------------------------------------------------
 
 typedef struct {
-  JsVar *sourceStr;
-  size_t startIndex;
-  int groups;
-  size_t groupStart[MAX_GROUPS];
-  size_t groupEnd[MAX_GROUPS];
-} matchInfo;
+  const char *p;        ///< current position in the regex source
+  unsigned char *code;  ///< the program, or 0 if we're just working out how big it'll be
+  size_t len;           ///< length of the program so far
+  int groups;           ///< capturing groups so far
+  int threads;          ///< consuming instructions so far
+  bool ignoreCase;
+  bool error;
+} RegExCompiler;
 
-JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info);
+static void recError(RegExCompiler *c, const char *msg) {
+  if (!c->error)
+    jsExceptionHere(JSET_SYNTAXERROR, "%s in RegEx", msg);
+  c->error = true;
+}
 
-JsVar *matchfound(JsvStringIterator *txtIt, matchInfo info) {
-  JsVar *rmatch = jsvNewEmptyArray();
-  size_t endIndex = jsvStringIteratorGetIndex(txtIt);
-  JsVar *matchStr = jsvNewFromStringVar(info.sourceStr, info.startIndex, endIndex-info.startIndex);
-  jsvSetArrayItem(rmatch, 0, matchStr);
-  jsvUnLock(matchStr);
+static void recEmit(RegExCompiler *c, int byte) {
+  if (c->len >= RE_MAX_CODE) {
+    recError(c, "Too complex");
+    return;
+  }
+  if (c->code) c->code[c->len] = (unsigned char)byte;
+  c->len++;
+}
+
+/// Write a jump offset (relative to the instruction at 'from') at 'at'
+static void recSetOffset(RegExCompiler *c, size_t at, size_t from, size_t to) {
+  if (!c->code || c->error) return;
+  int offset = (int)to - (int)from;
+  c->code[at] = (unsigned char)(offset&255);
+  c->code[at+1] = (unsigned char)((offset>>8)&255);
+}
+
+static void recEmitJump(RegExCompiler *c, size_t to) {
+  size_t from = c->len;
+  recEmit(c, RE_JMP);
+  recEmit(c, 0);
+  recEmit(c, 0);
+  recSetOffset(c, from+1, from, to);
+}
+
+/// Insert a split at 'at', moving everything after it along
+static void recInsertSplit(RegExCompiler *c, size_t at, size_t to1, size_t to2) {
+  if (c->len+RE_SPLIT_SIZE > RE_MAX_CODE) {
+    recError(c, "Too complex");
+    return;
+  }
+  if (c->code) {
+    memmove(&c->code[at+RE_SPLIT_SIZE], &c->code[at], c->len-at);
+    c->code[at] = RE_SPLIT;
+  }
+  c->len += RE_SPLIT_SIZE;
+  recSetOffset(c, at+1, at, to1);
+  recSetOffset(c, at+3, at, to2);
+}
+
+static void recEmitSplit(RegExCompiler *c, size_t to1, size_t to2) {
+  recInsertSplit(c, c->len, to1, to2);
+}
+
+/// Append a copy of part of the program (which contains 'threads' consuming instructions)
+static void recCopy(RegExCompiler *c, size_t from, size_t len, int threads) {
+  if (c->len+len > RE_MAX_CODE) {
+    recError(c, "Too complex");
+    return;
+  }
+  if (c->code) memcpy(&c->code[c->len], &c->code[from], len);
+  c->len += len;
+  c->threads += threads;
+}
+
+static char recToLower(char ch) {
+  if (ch>='A' && ch<='Z') return (char)(ch+'a'-'A');
+  return ch;
+}
+
+static bool recIsWordChar(int ch) {
+  return ch>=0 && (isAlpha((char)ch) || isNumeric((char)ch));
+}
+
+static void recClassSet(unsigned char *cls, int from, int to) {
+  int i;
+  for (i=from;i<=to;i++)
+    cls[i>>3] |= (unsigned char)(1<<(i&7));
+}
+
+/// Add characters matching \d, \w or \s (or their inverses) to a class. Return false if not a class escape
+static bool recClassEscape(unsigned char *cls, char esc) {
+  unsigned char set[RE_CLASS_SIZE];
+  memset(set, 0, sizeof(set));
+  char lower = recToLower(esc);
+  if (lower=='d') {
+    recClassSet(set, '0', '9');
+  } else if (lower=='w') {
+    recClassSet(set, '0', '9');
+    recClassSet(set, 'a', 'z');
+    recClassSet(set, 'A', 'Z');
+    recClassSet(set, '_', '_');
+  } else if (lower=='s') {
+    recClassSet(set, 0x09, 0x0D); // \t \n \v \f \r
+    recClassSet(set, ' ', ' ');
+  } else
+    return false;
   int i;
-  for (i=0;i<info.groups;i++) {
-    matchStr = jsvNewFromStringVar(info.sourceStr, info.groupStart[i], info.groupEnd[i]-info.groupStart[i]);
-    jsvSetArrayItem(rmatch, i+1, matchStr);
-    jsvUnLock(matchStr);
+  bool inverted = esc!=lower;
+  for (i=0;i<RE_CLASS_SIZE;i++)
+    cls[i] |= inverted ? (unsigned char)~set[i] : set[i];
+  return true;
+}
+
+/// Parse a single (possibly escaped) literal character
+static char recLiteral(RegExCompiler *c) {
+  char ch = *(c->p++);
+  if (ch!='\\') return ch;
+  ch = *(c->p++);
+  switch (ch) {
+    case 0: c->p--; recError(c, "Unfinished escape"); return 0;
+    case 'f': return 0x0C;
+    case 'n': return 0x0A;
+    case 'r': return 0x0D;
+    case 't': return 0x09;
+    case 'v': return 0x0B;
+    case '0': return 0x00;
+    case 'x':
+    case 'u': {
+      int digits = ch=='x' ? 2 : 4;
+      int code = 0;
+      while (digits--) {
+        if (!isHexadecimal(*c->p)) {
+          recError(c, "Invalid escape");
+          return 0;
+        }
+        code = (code<<4) | chtod(*(c->p++));
+      }
+      return (char)code;
+    }
+  }
+  if (isAlpha(ch) || isNumeric(ch)) {
+    if (!c->error)
+      jsExceptionHere(JSET_ERROR, "Unknown escape character %d in RegEx", (int)ch);
+    c->error = true;
+    return 0;
   }
-  jsvObjectSetChildAndUnLock(rmatch, "index", jsvNewFromInteger((JsVarInt)info.startIndex));
-  jsvObjectSetChild(rmatch, "input", info.sourceStr);
+  return ch; // \\, \/, \., \( etc
+}
 
-  return rmatch;
+/// If the next thing is a class escape like \d, return its letter
+static char recPeekClassEscape(RegExCompiler *c) {
+  if (c->p[0]!='\\') return 0;
+  char lower = recToLower(c->p[1]);
+  return (lower=='d' || lower=='w' || lower=='s') ? c->p[1] : 0;
 }
 
-/* match: search for regexp anywhere in text */
-JsVar *match(char *regexp, JsVar *str, size_t startIndex) {
-  matchInfo info;
-  info.sourceStr = str;
-  info.startIndex = startIndex;
-  info.groups = 0;
-
-  JsvStringIterator txtIt;
-  jsvStringIteratorNew(&txtIt, str, startIndex);
-  if (regexp[0] == '^')
-    return matchhere(regexp+1, &txtIt, info);
-  /* must look even if string is empty */
-  JsVar *rmatch = matchhere(regexp, &txtIt, info);
-  while (!rmatch && jsvStringIteratorHasChar(&txtIt)) {
-    jsvStringIteratorNext(&txtIt);
-    info.startIndex++;
-    JsvStringIterator txtIt2 = jsvStringIteratorClone(&txtIt);
-    rmatch = matchhere(regexp, &txtIt2, info);
-    jsvStringIteratorFree(&txtIt2);
-  }
-  jsvStringIteratorFree(&txtIt);
-  return rmatch;
+static void recEmitClass(RegExCompiler *c, unsigned char *cls, bool inverted) {
+  int i;
+  if (c->ignoreCase) {
+    for (i='a';i<='z';i++) {
+      int upper = i+'A'-'a';
+      if ((cls[i>>3]&(1<<(i&7))) || (cls[upper>>3]&(1<<(upper&7)))) {
+        recClassSet(cls, i, i);
+        recClassSet(cls, upper, upper);
+      }
+    }
+  }
+  recEmit(c, RE_CLASS);
+  for (i=0;i<RE_CLASS_SIZE;i++)
+    recEmit(c, inverted ? (unsigned char)~cls[i] : cls[i]);
+  c->threads++;
 }
 
-bool matchcharacter(char *regexp, JsvStringIterator *txtIt, int *length) {
-  *length = 1;
-  char ch = jsvStringIteratorGetChar(txtIt);
-  if (regexp[0]=='.') return true;
-  if (regexp[0]=='[') { // Character set (any char inside '[]')
-    bool inverted = regexp[1]=='^';
-    if (inverted) (*length)++;
-    bool matchAny = false;
-    while (regexp[*length] && regexp[*length]!=']') {
-      int matchLen;
-      matchAny |= matchcharacter(&regexp[*length], txtIt, &matchLen);
-      (*length) += matchLen;
+/// Parse '[...]' - c->p is just after the '['
+static void recCharacterSet(RegExCompiler *c) {
+  unsigned char cls[RE_CLASS_SIZE];
+  memset(cls, 0, sizeof(cls));
+  bool inverted = *c->p=='^';
+  if (inverted) c->p++;
+  while (*c->p && *c->p!=']' && !c->error) {
+    char esc = recPeekClassEscape(c);
+    if (esc) {
+      recClassEscape(cls, esc);
+      c->p += 2;
+      continue;
     }
-    if (regexp[*length]==']') {
-      (*length)++;
-    } else {
-      jsExceptionHere(JSET_ERROR, "Unfinished character set in RegEx");
-      return false;
+    char from = (c->p[0]=='\\' && c->p[1]=='b') ? 0x08 : 0;
+    if (from) c->p += 2; // \b is backspace in a set
+    else from = recLiteral(c);
+    char to = from;
+    if (c->p[0]=='-' && c->p[1] && c->p[1]!=']') {
+      c->p++;
+      if (recPeekClassEscape(c)) {
+        c->p--; // something like [a-\d] - the '-' is just a character
+      } else {
+        to = recLiteral(c);
+        if ((unsigned char)to < (unsigned char)from) recError(c, "Range out of order");
+      }
     }
-    return matchAny != inverted;
-  }
-  if (regexp[0]=='\\') { // escape character
-    *length = 2;
-    // missing quite a few here
-    // https://developer.mozilla.org/en-US/docs/Web/JavaScript/Guide/Regular_Expressions
-    if (regexp[1]=='\\') return ch=='\\';
-    if (regexp[1]=='/') return ch=='/';
-    if (regexp[1]=='d') return isNumeric(ch);
-    if (regexp[1]=='D') return !isNumeric(ch);
-    if (regexp[1]=='f') return ch==0x0C;
-    if (regexp[1]=='n') return ch==0x0A;
-    if (regexp[1]=='r') return ch==0x0D;
-    if (regexp[1]=='s') return isWhitespace(ch);
-    if (regexp[1]=='S') return !isWhitespace(ch);
-    if (regexp[1]=='t') return ch==0x09;
-    if (regexp[1]=='v') return ch==0x0B;
-    if (regexp[1]=='w') return isNumeric(ch) || isAlpha(ch) || ch=='_';
-    if (regexp[1]=='W') return !(isNumeric(ch) || isAlpha(ch) || ch=='_');
-    if (regexp[1]=='0') return ch==0x00;
-    if (regexp[1]=='x' && regexp[2] && regexp[3]) {
-      *length = 4;
-      char code = (char)((chtod(regexp[2])<<4) | chtod(regexp[3]));
-      return ch==code;
+    recClassSet(cls, (unsigned char)from, (unsigned char)to);
+  }
+  if (*c->p!=']') {
+    if (!c->error)
+      jsExceptionHere(JSET_ERROR, "Unfinished character set in RegEx");
+    c->error = true;
+    return;
+  }
+  c->p++;
+  recEmitClass(c, cls, inverted);
+}
+
+/// Parse '{n}', '{n,}' or '{n,m}'. Returns false (and consumes nothing) if it's not a valid quantifier
+static bool recRange(RegExCompiler *c, int *min, int *max) {
+  const char *p = c->p+1;
+  if (!isNumeric(*p)) return false;
+  *min = 0;
+  while (isNumeric(*p)) { if (*min<RE_REPEAT_INFINITE) *min = *min*10 + *p-'0'; p++; }
+  *max = *min;
+  if (*p==',') {
+    p++;
+    *max = RE_REPEAT_INFINITE;
+    if (isNumeric(*p)) {
+      *max = 0;
+      while (isNumeric(*p)) { if (*max<RE_REPEAT_INFINITE) *max = *max*10 + *p-'0'; p++; }
     }
-    jsExceptionHere(JSET_ERROR, "Unknown escape character %d in RegEx", (int)regexp[1]);
+  }
+  if (*p!='}') return false;
+  c->p = p+1;
+  return true;
+}
+
+static void recAlternation(RegExCompiler *c);
+
+/// Parse a single item, return false if there was nothing to parse
+static bool recAtom(RegExCompiler *c) {
+  char ch = *c->p;
+  if (!ch || ch=='|' || ch==')') return false;
+  if (ch=='*' || ch=='+' || ch=='?') {
+    recError(c, "Nothing to repeat");
     return false;
   }
-  return regexp[0]==ch;
-}
-
-/* matchhere: search for regexp at beginning of text */
-JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info) {
-  if (jspIsInterrupted()) return 0;
-  if (regexp[0] == '\0')
-    return matchfound(txtIt, info);
-  if (regexp[0] == '(') {
-    info.groupStart[info.groups] = jsvStringIteratorGetIndex(txtIt);
-    info.groupEnd[info.groups] = info.groupStart[info.groups];
-    if (info.groups<MAX_GROUPS) info.groups++;
-    return matchhere(regexp+1, txtIt, info);
-  }
-  if (regexp[0] == ')') {
-    info.groupEnd[info.groups-1] = jsvStringIteratorGetIndex(txtIt);
-    return matchhere(regexp+1, txtIt, info);
-  }
-  int charLength;
-  bool charMatched = matchcharacter(regexp, txtIt, &charLength);
-  if (regexp[charLength] == '*' || regexp[charLength] == '+') {
-    bool starOperator = regexp[charLength] == '*';
-    char *regexpAfterStar = regexp+charLength+1;
-    JsvStringIterator txtIt2;
-    // Try and match everything after right now
-    txtIt2 = jsvStringIteratorClone(txtIt);
-    JsVar *lastrmatch = matchhere(regexpAfterStar, &txtIt2, info);
-    jsvStringIteratorFree(&txtIt2);
-    // For star - nothing matched - so push straight through with whatever we had
-    if (starOperator && !charMatched)
-      return lastrmatch;
-    // Otherwise try and match more than one
-    while (jsvStringIteratorHasChar(txtIt) && charMatched) {
-      // We had this character matched, so move on and see if we can match with the new one
-      jsvStringIteratorNext(txtIt);
-      charMatched = matchcharacter(regexp, txtIt, &charLength);
-      // See if we can match after the character...
-      txtIt2 = jsvStringIteratorClone(txtIt);
-      JsVar *rmatch = matchhere(regexpAfterStar, &txtIt2, info);
-      jsvStringIteratorFree(&txtIt2);
-      // can't match with this - use the last one
-      if (rmatch) {
-        jsvUnLock(lastrmatch);
-        lastrmatch = rmatch;
+  if (ch=='(') {
+    c->p++;
+    int group = -1;
+    if (c->p[0]=='?') {
+      if (c->p[1]!=':') {
+        recError(c, "Unsupported group");
+        return false;
       }
+      c->p += 2;
+    } else {
+      if (c->groups>=MAX_GROUPS) {
+        recError(c, "Too many groups");
+        return false;
+      }
+      group = ++c->groups;
+      recEmit(c, RE_SAVE);
+      recEmit(c, group*2);
+    }
+    recAlternation(c);
+    if (*c->p!=')') {
+      recError(c, "Unterminated group");
+      return false;
     }
-    return lastrmatch;
+    c->p++;
+    if (group>=0) {
+      recEmit(c, RE_SAVE);
+      recEmit(c, group*2+1);
+    }
+  } else if (ch=='[') {
+    c->p++;
+    recCharacterSet(c);
+  } else if (ch=='.') {
+    c->p++;
+    recEmit(c, RE_ANY);
+    c->threads++;
+  } else if (ch=='^') {
+    c->p++;
+    recEmit(c, RE_BOL);
+  } else if (ch=='$') {
+    c->p++;
+    recEmit(c, RE_EOL);
+  } else if (ch=='\\' && (c->p[1]=='b' || c->p[1]=='B')) {
+    recEmit(c, c->p[1]=='b' ? RE_WORDB : RE_NWORDB);
+    c->p += 2;
+  } else if (recPeekClassEscape(c)) {
+    unsigned char cls[RE_CLASS_SIZE];
+    memset(cls, 0, sizeof(cls));
+    recClassEscape(cls, c->p[1]);
+    c->p += 2;
+    recEmitClass(c, cls, false);
+  } else {
+    ch = recLiteral(c);
+    recEmit(c, RE_CHAR);
+    recEmit(c, c->ignoreCase ? recToLower(ch) : ch);
+    c->threads++;
   }
-  // End of regex
-  if (regexp[0] == '$' && regexp[1] == '\0') {
-    if (!jsvStringIteratorHasChar(txtIt))
-      return matchfound(txtIt, info);
-    else
+  return true;
+}
+
+/// Parse an item followed by an optional quantifier
+static bool recRepeat(RegExCompiler *c) {
+  size_t start = c->len;
+  int startThreads = c->threads;
+  if (!recAtom(c)) return false;
+  int min, max;
+  char q = *c->p;
+  if (q=='*') { min = 0; max = RE_REPEAT_INFINITE; c->p++; }
+  else if (q=='+') { min = 1; max = RE_REPEAT_INFINITE; c->p++; }
+  else if (q=='?') { min = 0; max = 1; c->p++; }
+  else if (q=='{' && recRange(c, &min, &max)) {
+    if (max<min) recError(c, "Numbers out of order in quantifier");
+  } else return true;
+  bool lazy = *c->p=='?';
+  if (lazy) c->p++;
+  if (c->error) return false;
+
+  if (max==0) { // x{0} - just remove it
+    c->len = start;
+    c->threads = startThreads;
+    return true;
+  }
+  size_t atomLen = c->len - start;
+  int atomThreads = c->threads - startThreads;
+  size_t atom = start; // where the original copy of the atom is
+  int count;
+  if (min==0) {
+    // make the atom we already have optional
+    if (max==RE_REPEAT_INFINITE) {
+      recInsertSplit(c, start, start+RE_SPLIT_SIZE, c->len+RE_SPLIT_SIZE+RE_JMP_SIZE);
+      if (lazy) recSetOffset(c, start+1, start, c->len+RE_JMP_SIZE);
+      if (lazy) recSetOffset(c, start+3, start, start+RE_SPLIT_SIZE);
+      recEmitJump(c, start);
+      return !c->error;
+    }
+    recInsertSplit(c, start, start+RE_SPLIT_SIZE, c->len+RE_SPLIT_SIZE);
+    if (lazy) {
+      recSetOffset(c, start+1, start, c->len);
+      recSetOffset(c, start+3, start, start+RE_SPLIT_SIZE);
+    }
+    atom = start+RE_SPLIT_SIZE;
+    count = 1;
+  } else {
+    for (count=1; count<min && !c->error; count++)
+      recCopy(c, atom, atomLen, atomThreads);
+  }
+  if (max==RE_REPEAT_INFINITE) {
+    // x+ : atom then split back to it
+    size_t split = c->len;
+    size_t loop = c->len - atomLen;
+    recEmitSplit(c, loop, split+RE_SPLIT_SIZE);
+    if (lazy) {
+      recSetOffset(c, split+1, split, split+RE_SPLIT_SIZE);
+      recSetOffset(c, split+3, split, loop);
+    }
+  } else {
+    // x{n,m} : n copies followed by m-n optional copies
+    for (; count<max && !c->error; count++) {
+      size_t split = c->len;
+      size_t end = split+RE_SPLIT_SIZE+atomLen;
+      recEmitSplit(c, lazy ? end : split+RE_SPLIT_SIZE, lazy ? split+RE_SPLIT_SIZE : end);
+      recCopy(c, atom, atomLen, atomThreads);
+    }
+  }
+  return !c->error;
+}
+
+/// Parse alternatives separated by '|'
+static void recAlternation(RegExCompiler *c) {
+  size_t start = c->len;
+  while (recRepeat(c));
+  while (*c->p=='|' && !c->error) {
+    c->p++;
+    // SPLIT(previous alternatives, this one) ... JMP(end)
+    recInsertSplit(c, start, start+RE_SPLIT_SIZE, c->len+RE_SPLIT_SIZE+RE_JMP_SIZE);
+    size_t jmp = c->len;
+    recEmitJump(c, jmp);
+    while (recRepeat(c));
+    recSetOffset(c, jmp+1, jmp, c->len);
+  }
+}
+
+/// Compile the regex (code=0 to just work out the length). Returns false on error
+static bool recCompile(RegExCompiler *c, const char *regex, unsigned char *code, bool ignoreCase, bool multiline) {
+  c->p = regex;
+  c->code = code;
+  c->len = 0;
+  c->groups = 0;
+  c->threads = 1; // RE_MATCH
+  c->ignoreCase = ignoreCase;
+  c->error = false;
+  recEmit(c, (ignoreCase?RE_FLAG_IGNORECASE:0) | (multiline?RE_FLAG_MULTILINE:0));
+  recEmit(c, 0); // groups
+  recEmit(c, 0); // threads
+  recEmit(c, 0);
+  recAlternation(c);
+  if (*c->p && !c->error) recError(c, "Unmatched ')'");
+  recEmit(c, RE_MATCH);
+  if (code && !c->error) {
+    code[RE_HDR_GROUPS] = (unsigned char)c->groups;
+    code[RE_HDR_THREADS] = (unsigned char)(c->threads&255);
+    code[RE_HDR_THREADS+1] = (unsigned char)(c->threads>>8);
+  }
+  return !c->error;
+}
+
+/// Compile the given RegExp object's source into a program. Returns a string, or 0 on error
+static JsVar *regexCompile(JsVar *regex) {
+  JsVar *source = jsvObjectGetChild(regex, "source", 0);
+  if (!jsvIsString(source)) {
+    jsvUnLock(source);
+    return 0;
+  }
+  size_t sourceLen = jsvGetStringLength(source);
+  char *sourcePtr = (char *)alloca(sourceLen+1);
+  if (!sourcePtr) {
+    jsvUnLock(source);
+    return 0;
+  }
+  jsvGetString(source, sourcePtr, sourceLen+1);
+  jsvUnLock(source);
+  bool ignoreCase = jswrap_regexp_hasFlag(regex,'i');
+  bool multiline = jswrap_regexp_hasFlag(regex,'m');
+
+  RegExCompiler c;
+  if (!recCompile(&c, sourcePtr, 0, ignoreCase, multiline)) return 0;
+  unsigned char *code = (unsigned char *)alloca(c.len);
+  if (!code) return 0;
+  size_t len = c.len;
+  if (!recCompile(&c, sourcePtr, code, ignoreCase, multiline)) return 0;
+  assert(c.len == len);
+  return jsvNewStringOfLength((unsigned int)len, (const char*)code);
+}
+
+// ----------------------------------------------------------------------------
+
+typedef struct {
+  int count;
+  uint16_t *pc;           ///< program position of each thread
+  int *caps;              ///< capture slots for each thread
+  unsigned char *visited; ///< bitmap of program positions already added to this list
+} RegExThreadList;
+
+typedef struct {
+  const unsigned char *code;
+  int slots;    ///< number of capture slots per thread
+  bool multiline;
+  int pos;      ///< index in the string that threads are being added for
+  int prevCh;   ///< character before pos (or -1)
+  int ch;       ///< character at pos (or -1)
+} RegExVM;
+
+static int revOffset(const unsigned char *p) {
+  return (int16_t)(p[0] | (p[1]<<8));
+}
+
+static bool revIsNewLine(int ch) {
+  return ch=='\n' || ch=='\r';
+}
+
+/// Add a thread at 'pc', following jumps and zero-width assertions until we get to something that consumes a character
+static void revAddThread(RegExVM *vm, RegExThreadList *l, int pc, int *caps) {
+  if (l->visited[pc>>3] & (1<<(pc&7))) return;
+  l->visited[pc>>3] |= (unsigned char)(1<<(pc&7));
+  const unsigned char *op = &vm->code[pc];
+  switch ((RegExOp)*op) {
+    case RE_JMP:
+      revAddThread(vm, l, pc+revOffset(op+1), caps);
+      return;
+    case RE_SPLIT:
+      if (!jspCheckStackPosition()) return;
+      revAddThread(vm, l, pc+revOffset(op+1), caps);
+      revAddThread(vm, l, pc+revOffset(op+3), caps);
+      return;
+    case RE_SAVE: {
+      int old = caps[op[1]];
+      caps[op[1]] = vm->pos;
+      revAddThread(vm, l, pc+2, caps);
+      caps[op[1]] = old;
+      return;
+    }
+    case RE_BOL:
+      if (vm->prevCh<0 || (vm->multiline && revIsNewLine(vm->prevCh)))
+        revAddThread(vm, l, pc+1, caps);
+      return;
+    case RE_EOL:
+      if (vm->ch<0 || (vm->multiline && revIsNewLine(vm->ch)))
+        revAddThread(vm, l, pc+1, caps);
+      return;
+    case RE_WORDB:
+    case RE_NWORDB:
+      if ((recIsWordChar(vm->prevCh) != recIsWordChar(vm->ch)) == (*op==RE_WORDB))
+        revAddThread(vm, l, pc+1, caps);
+      return;
+    default: // something that consumes a character, or RE_MATCH
+      l->pc[l->count] = (uint16_t)pc;
+      memcpy(&l->caps[l->count*vm->slots], caps, sizeof(int)*(size_t)vm->slots);
+      l->count++;
+      return;
+  }
+}
+
+/* Work out the set of characters a match could start with, so we can skip
+ * quickly over parts of the string where nothing could match. Returns false
+ * if a match could start with anything (or could be empty) */
+static bool revFirstChars(const unsigned char *code, int pc, unsigned char *set, bool ignoreCase, int depth) {
+  if (depth>8) return false; // give up
+  const unsigned char *op = &code[pc];
+  int i;
+  switch ((RegExOp)*op) {
+    case RE_CHAR:
+      recClassSet(set, op[1], op[1]);
+      if (ignoreCase && op[1]>='a' && op[1]<='z')
+        recClassSet(set, op[1]+'A'-'a', op[1]+'A'-'a');
+      return true;
+    case RE_CLASS:
+      for (i=0;i<RE_CLASS_SIZE;i++) set[i] |= op[1+i];
+      return true;
+    case RE_JMP:
+      return revFirstChars(code, pc+revOffset(op+1), set, ignoreCase, depth+1);
+    case RE_SPLIT:
+      return revFirstChars(code, pc+revOffset(op+1), set, ignoreCase, depth+1) &&
+             revFirstChars(code, pc+revOffset(op+3), set, ignoreCase, depth+1);
+    case RE_SAVE:
+      return revFirstChars(code, pc+2, set, ignoreCase, depth+1);
+    case RE_BOL:
+    case RE_EOL:
+    case RE_WORDB:
+    case RE_NWORDB: // zero width - what comes after still has to match
+      return revFirstChars(code, pc+1, set, ignoreCase, depth+1);
+    default: // RE_ANY, RE_MATCH
+      return false;
+  }
+}
+
+/* Search for the regex in 'str' starting at 'startIndex'. Returns a result
+ * array (like RegExp.exec) or 0 if no match */
+static JsVar *regexMatch(const unsigned char *code, size_t codeLen, JsVar *str, size_t startIndex) {
+  int groups = code[RE_HDR_GROUPS];
+  int maxThreads = code[RE_HDR_THREADS] | (code[RE_HDR_THREADS+1]<<8);
+  bool ignoreCase = (code[RE_HDR_FLAGS]&RE_FLAG_IGNORECASE)!=0;
+  size_t visitedSize = (codeLen+7)>>3;
+  RegExVM vm;
+  vm.code = code;
+  vm.slots = (groups+1)*2;
+  vm.multiline = (code[RE_HDR_FLAGS]&RE_FLAG_MULTILINE)!=0;
+  // We know the max number of threads, so can allocate everything up front
+  size_t listSize = (sizeof(uint16_t) + sizeof(int)*(size_t)vm.slots)*(size_t)maxThreads + visitedSize;
+  size_t scratchSize = listSize*2 + sizeof(int)*(size_t)vm.slots*2;
+  if (scratchSize+512 > jsuGetFreeStack()) {
+    jsExceptionHere(JSET_ERROR, "RegEx too complex");
+    return 0;
+  }
+  RegExThreadList lists[2];
+  int i;
+  for (i=0;i<2;i++) {
+    lists[i].count = 0;
+    lists[i].caps = (int*)alloca(sizeof(int)*(size_t)vm.slots*(size_t)maxThreads);
+    lists[i].pc = (uint16_t*)alloca(sizeof(uint16_t)*(size_t)maxThreads);
+    lists[i].visited = (unsigned char*)alloca(visitedSize);
+    memset(lists[i].visited, 0, visitedSize);
+  }
+  RegExThreadList *clist = &lists[0], *nlist = &lists[1];
+  int *caps = (int*)alloca(sizeof(int)*(size_t)vm.slots);
+  int *matchCaps = (int*)alloca(sizeof(int)*(size_t)vm.slots);
+  bool matched = false;
+  // if we must match at the start of the string, don't bother trying anywhere else
+  bool anchored = code[RE_HDR_SIZE]==RE_BOL && !vm.multiline;
+  unsigned char firstChars[RE_CLASS_SIZE];
+  memset(firstChars, 0, sizeof(firstChars));
+  bool useFirstChars = !anchored && revFirstChars(code, RE_HDR_SIZE, firstChars, ignoreCase, 0);
+
+  JsvStringIterator it;
+  vm.pos = (int)startIndex;
+  vm.prevCh = -1;
+  if (startIndex) {
+    // we need the character before for \b and ^
+    jsvStringIteratorNew(&it, str, startIndex-1);
+    if (!jsvStringIteratorHasChar(&it)) { // past the end of the string
+      jsvStringIteratorFree(&it);
       return 0;
+    }
+    vm.prevCh = (unsigned char)jsvStringIteratorGetChar(&it);
+    jsvStringIteratorNext(&it);
+  } else
+    jsvStringIteratorNew(&it, str, 0);
+  vm.ch = jsvStringIteratorHasChar(&it) ? (unsigned char)jsvStringIteratorGetChar(&it) : -1;
+  while (!jspIsInterrupted()) {
+    if (useFirstChars && !clist->count && !matched) {
+      // skip over characters that no match could start with
+      while (vm.ch>=0 && !(firstChars[vm.ch>>3]&(1<<(vm.ch&7)))) {
+        vm.prevCh = vm.ch;
+        vm.pos++;
+        jsvStringIteratorNext(&it);
+        vm.ch = jsvStringIteratorHasChar(&it) ? (unsigned char)jsvStringIteratorGetChar(&it) : -1;
+      }
+      if (vm.ch<0) break;
+    }
+    // start a new (lowest priority) match attempt at this position
+    if (!matched && (!anchored || vm.prevCh<0)) {
+      for (i=0;i<vm.slots;i++) caps[i] = -1;
+      caps[0] = vm.pos;
+      revAddThread(&vm, clist, RE_HDR_SIZE, caps);
+    }
+    // nothing left that could match
+    if (!clist->count && (matched || anchored)) break;
+    // find out what's after this character
+    int ch = vm.ch;
+    int nextCh = -1;
+    if (ch>=0) {
+      jsvStringIteratorNext(&it);
+      if (jsvStringIteratorHasChar(&it))
+        nextCh = (unsigned char)jsvStringIteratorGetChar(&it);
+    }
+    int lowerCh = (ignoreCase && ch>=0) ? (unsigned char)recToLower((char)ch) : ch;
+    // now step every thread over this character
+    int pos = vm.pos++;
+    vm.prevCh = ch;
+    vm.ch = nextCh;
+    nlist->count = 0;
+    memset(nlist->visited, 0, visitedSize);
+    int t;
+    for (t=0;t<clist->count;t++) {
+      int pc = clist->pc[t];
+      int *tcaps = &clist->caps[t*vm.slots];
+      const unsigned char *op = &code[pc];
+      bool ok = false;
+      switch ((RegExOp)*op) {
+        case RE_MATCH:
+          memcpy(matchCaps, tcaps, sizeof(int)*(size_t)vm.slots);
+          matchCaps[1] = pos;
+          matched = true;
+          t = clist->count; // lower priority threads can't win now
+          break;
+        case RE_CHAR:
+          ok = lowerCh>=0 && lowerCh==op[1];
+          pc += 2;
+          break;
+        case RE_ANY:
+          ok = ch>=0 && !revIsNewLine(ch);
+          pc += 1;
+          break;
+        case RE_CLASS:
+          ok = ch>=0 && (op[1+(ch>>3)]&(1<<(ch&7)));
+          pc += 1+RE_CLASS_SIZE;
+          break;
+        default:
+          assert(0);
+          break;
+      }
+      if (ok) {
+        memcpy(caps, tcaps, sizeof(int)*(size_t)vm.slots);
+        revAddThread(&vm, nlist, pc, caps);
+      }
+    }
+    RegExThreadList *tmp = clist;
+    clist = nlist;
+    nlist = tmp;
+    if (ch<0) break; // end of string
   }
-  //
-  if (jsvStringIteratorHasChar(txtIt) && charMatched) {
-    jsvStringIteratorNext(txtIt);
-    return matchhere(regexp+charLength, txtIt, info);
+  jsvStringIteratorFree(&it);
+  if (!matched) return 0;
+
+  JsVar *rmatch = jsvNewEmptyArray();
+  if (!rmatch) return 0;
+  for (i=0;i<=groups;i++) {
+    int start = matchCaps[i*2], end = matchCaps[i*2+1];
+    jsvArrayPushAndUnLock(rmatch, (start>=0 && end>=start) ?
+        jsvNewFromStringVar(str, (size_t)start, (size_t)(end-start)) : 0);
   }
-  return 0;
+  jsvObjectSetChildAndUnLock(rmatch, "index", jsvNewFromInteger((JsVarInt)matchCaps[0]));
+  jsvObjectSetChild(rmatch, "input", str);
+  return rmatch;
 }
 
 /*JSON{
@@ -197,7 +746,13 @@ JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info) {
 The built-in class for handling Regular Expressions
 
 **Note:** Espruino's regular expression parser does not contain all the features
-present in a full ES6 JS engine. However it does contain support for the all the basics.
+present in a full ES6 JS engine. However it does contain support for the all the basics:
+character sets, groups (capturing and `(?:...)`), alternation with `|`, the
+quantifiers `*`, `+`, `?` and `{n,m}` (and their lazy `?` versions), `^`, `$`,
+`\b`, and the `g`, `i` and `m` flags. Lookahead and backreferences are not supported.
+
+Regular expressions are compiled when they are created, and matching takes time
+proportional to the length of the string being searched.
 */
 
 /*JSON{
@@ -229,6 +784,12 @@ JsVar *jswrap_regexp_constructor(JsVar *str, JsVar *flags) {
       jsvObjectSetChild(r, "flags", flags);
   }
   jsvObjectSetChildAndUnLock(r, "lastIndex", jsvNewFromInteger(0));
+  JsVar *code = regexCompile(r);
+  if (!code) {
+    jsvUnLock(r);
+    return 0;
+  }
+  jsvObjectSetChildAndUnLock(r, RE_CODE_NAME, code);
   return r;
 }
 
@@ -269,20 +830,24 @@ Or with groups `/W(o)rld/.exec("Hello World")` returns:
  */
 JsVar *jswrap_regexp_exec(JsVar *parent, JsVar *str) {
   JsVarInt lastIndex = jsvGetIntegerAndUnLock(jsvObjectGetChild(parent, "lastIndex", 0));
-  JsVar *regex = jsvObjectGetChild(parent, "source", 0);
-  if (!jsvIsString(regex)) {
-    jsvUnLock(regex);
-    return 0;
+  JsVar *code = jsvObjectGetChild(parent, RE_CODE_NAME, 0);
+  if (!jsvIsString(code)) {
+    jsvUnLock(code);
+    code = regexCompile(parent);
+    if (!code) return 0;
+    jsvObjectSetChild(parent, RE_CODE_NAME, code);
   }
-  size_t regexLen = jsvGetStringLength(regex);
-  char *regexPtr = (char *)alloca(regexLen+1);
-  if (!regexPtr) {
-    jsvUnLock(regex);
+  size_t codeLen = jsvGetStringLength(code);
+  unsigned char *codePtr = (unsigned char *)alloca(codeLen+1);
+  if (!codePtr) {
+    jsvUnLock(code);
     return 0;
   }
-  jsvGetString(regex, regexPtr, regexLen+1);
-  jsvUnLock(regex);
-  JsVar *rmatch = match(regexPtr, str, (size_t)lastIndex);
+  jsvGetString(code, (char*)codePtr, codeLen+1);
+  jsvUnLock(code);
+  JsVar *rmatch = 0;
+  if (lastIndex>=0)
+    rmatch = regexMatch(codePtr, codeLen, str, (size_t)lastIndex);
   if (!rmatch) {
     rmatch = jsvNewWithFlags(JSV_NULL);
     lastIndex = 0;
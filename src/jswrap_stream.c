@@ -61,6 +61,24 @@ JsVar *jswrap_stream_read(JsVar *parent, JsVarInt chars) {
   return data;
 }
 
+/** Read up to 'len' bytes of buffered data straight into 'buf' (eg. for
+ * pipes), returning how many bytes were read */
+size_t jswrap_stream_readBuf(JsVar *parent, char *buf, size_t len) {
+  JsVar *data = jswrap_stream_read(parent, (JsVarInt)len);
+  size_t n = 0;
+  if (data) {
+    JsvStringIterator it;
+    jsvStringIteratorNew(&it, data, 0);
+    while (n<len && jsvStringIteratorHasChar(&it)) {
+      buf[n++] = jsvStringIteratorGetChar(&it);
+      jsvStringIteratorNext(&it);
+    }
+    jsvStringIteratorFree(&it);
+    jsvUnLock(data);
+  }
+  return n;
+}
+
 /** Push data into a stream. To be used by Espruino (not a user).
  * This either calls the on('data') handler if it exists, or it
  * puts the data in a buffer. This MAY CLAIM the string that is
@@ -98,8 +116,16 @@ bool jswrap_stream_pushData(JsVar *parent, JsVar *dataString, bool force) {
         // jsWarn("String buffer overflowed maximum size (%d)", STREAM_MAX_BUFFER_SIZE);
         ok = false;
       }
-      if ((ok || force) && (bufLen < STREAM_MAX_BUFFER_SIZE))
-        jsvAppendStringVar(buf, dataString, 0, STREAM_MAX_BUFFER_SIZE-bufLen);
+      if ((ok || force) && (bufLen < STREAM_MAX_BUFFER_SIZE)) {
+        if (jsvIsFlatString(buf)) {
+          // flat strings (eg. straight from a socket) can't grow, so copy into a normal one
+          JsVar *newBuf = jsvNewFromStringVar(buf, 0, JSVAPPENDSTRINGVAR_MAXLENGTH);
+          jsvUnLock(buf);
+          buf = newBuf;
+          jsvObjectSetChild(parent, STREAM_BUFFER_NAME, buf);
+        }
+        if (buf) jsvAppendStringVar(buf, dataString, 0, STREAM_MAX_BUFFER_SIZE-bufLen);
+      }
       jsvUnLock(buf);
     }
   }
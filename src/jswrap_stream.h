@@ -20,6 +20,7 @@
 
 JsVarInt jswrap_stream_available(JsVar *parent);
 JsVar *jswrap_stream_read(JsVar *parent, JsVarInt chars);
+size_t jswrap_stream_readBuf(JsVar *parent, char *buf, size_t len);
 
 /** Push data into a stream. To be used by Espruino (not a user).
  * This either calls the on('data') handler if it exists, or it
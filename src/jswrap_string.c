@@ -228,30 +228,33 @@ JsVar *jswrap_string_replace(JsVar *parent, JsVar *subStr, JsVar *newSubStr) {
       replace = jsvAsString(newSubStr, false);
     jsvObjectSetChildAndUnLock(subStr, "lastIndex", jsvNewFromInteger(0));
     bool global = jswrap_regexp_hasFlag(subStr,'g');
+    // Build up a new string from the bits in between matches - the original is never modified
+    JsVar *newStr = jsvNewFromEmptyString();
+    size_t strLen = jsvGetStringLength(str);
+    size_t last = 0;
     JsVar *match;
     match = jswrap_regexp_exec(subStr, str);
-    while (match && !jsvIsNull(match) && !jspIsInterrupted()) {
+    while (newStr && match && !jsvIsNull(match) && !jspIsInterrupted()) {
       // get info about match
       JsVar *matchStr = jsvGetArrayItem(match,0);
       JsVarInt idx = jsvGetIntegerAndUnLock(jsvObjectGetChild(match,"index",0));
       JsVarInt len = (JsVarInt)jsvGetStringLength(matchStr);
-      // do the replacement
-      JsVar *newStr = jsvNewFromStringVar(str, 0, (size_t)idx);
-      JsvStringIterator dst;
-      jsvStringIteratorNew(&dst, newStr, 0);
-      jsvStringIteratorGotoEnd(&dst);
+      // copy what was before the match, then do the replacement
+      jsvAppendStringVar(newStr, str, last, (size_t)idx-last);
+      JsVarInt groups = jsvGetArrayLength(match);
       if (jsvIsFunction(replace)) {
         unsigned int argCount = 0;
         JsVar *args[13];
         args[argCount++] = jsvLockAgain(matchStr);
-        JsVar *v;
-        while ((v = jsvGetArrayItem(match, (JsVarInt)argCount)))
-          args[argCount++] = v;
+        while ((JsVarInt)argCount<groups && argCount<11) {
+          args[argCount] = jsvGetArrayItem(match, (JsVarInt)argCount);
+          argCount++;
+        }
         args[argCount++] = jsvObjectGetChild(match,"index",0);
         args[argCount++] = jsvObjectGetChild(match,"input",0);
         JsVar *result = jsvAsString(jspeFunctionCall(replace, 0, 0, false, (JsVarInt)argCount, args), true);
         jsvUnLockMany(argCount, args);
-        jsvStringIteratorAppendString(&dst, result, 0);
+        jsvAppendStringVarComplete(newStr, result);
         jsvUnLock(result);
       } else {
         JsvStringIterator src;
@@ -261,36 +264,38 @@ JsVar *jswrap_string_replace(JsVar *parent, JsVar *subStr, JsVar *newSubStr) {
           if (ch=='$') {
             jsvStringIteratorNext(&src);
             ch = jsvStringIteratorGetChar(&src);
-            JsVar *group = 0;
-            if (ch>'0' && ch<='9')
-              group = jsvGetArrayItem(match, ch-'0');
-            if (group) {
-              jsvStringIteratorAppendString(&dst, group, 0);
+            if (ch>'0' && ch<='9' && ch-'0'<groups) {
+              JsVar *group = jsvGetArrayItem(match, ch-'0');
+              if (group) jsvAppendStringVarComplete(newStr, group);
               jsvUnLock(group);
             } else {
-              jsvStringIteratorAppend(&dst, '$');
-              jsvStringIteratorAppend(&dst, ch);
+              jsvAppendCharacter(newStr, '$');
+              jsvAppendCharacter(newStr, ch);
             }
           } else {
-            jsvStringIteratorAppend(&dst, ch);
+            jsvAppendCharacter(newStr, ch);
           }
           jsvStringIteratorNext(&src);
         }
         jsvStringIteratorFree(&src);
       }
-      JsVarInt lastIndex = 1+(JsVarInt)jsvStringIteratorGetIndex(&dst);
-      jsvStringIteratorAppendString(&dst, str, (size_t)(idx+len));
-      jsvStringIteratorFree(&dst);
-      jsvUnLock2(str,matchStr);
-      str = newStr;
+      jsvUnLock(matchStr);
+      last = (size_t)(idx+len);
       // search again if global
       jsvUnLock(match);
       match = 0;
       if (global) {
+        // if we matched nothing, move on a character so we don't keep matching the same thing
+        JsVarInt lastIndex = idx+len+(len?0:1);
+        if ((size_t)lastIndex > strLen) break;
         jsvObjectSetChildAndUnLock(subStr, "lastIndex", jsvNewFromInteger(lastIndex));
         match = jswrap_regexp_exec(subStr, str);
       }
     }
+    if (newStr && last<strLen)
+      jsvAppendStringVar(newStr, str, last, JSVAPPENDSTRINGVAR_MAXLENGTH);
+    jsvUnLock(str);
+    str = newStr;
     jsvUnLock(match);
     jsvUnLock(replace);
     // reset lastIndex if global
@@ -420,7 +425,8 @@ JsVar *jswrap_string_split(JsVar *parent, JsVar *split) {
 #ifndef SAVE_ON_FLASH
   // Use RegExp if one is passed in
   if (jsvIsInstanceOf(split, "RegExp")) {
-    int last = 0;
+    JsVarInt last = 0;
+    JsVarInt strLen = (JsVarInt)jsvGetStringLength(parent);
     JsVar *match;
     jsvObjectSetChildAndUnLock(split, "lastIndex", jsvNewFromInteger(0));
     match = jswrap_regexp_exec(split, parent);
@@ -430,15 +436,23 @@ JsVar *jswrap_string_split(JsVar *parent, JsVar *split) {
       JsVarInt idx = jsvGetIntegerAndUnLock(jsvObjectGetChild(match,"index",0));
       JsVarInt len = (JsVarInt)jsvGetStringLength(matchStr);
       jsvUnLock(matchStr);
-      // do the replacement
-      jsvArrayPushAndUnLock(array, jsvNewFromStringVar(parent, (size_t)last, (size_t)(idx-last)));
-      last = idx+len;
-      // search again
       jsvUnLock(match);
-      jsvObjectSetChildAndUnLock(split, "lastIndex", jsvNewFromInteger(last));
+      match = 0;
+      // an empty match at the end of the string (or where the last match ended) doesn't split
+      if (idx >= strLen) break;
+      JsVarInt lastIndex = idx+len;
+      if (idx+len > last) {
+        // do the replacement
+        jsvArrayPushAndUnLock(array, jsvNewFromStringVar(parent, (size_t)last, (size_t)(idx-last)));
+        last = idx+len;
+      }
+      if (!len) lastIndex++;
+      // search again
+      jsvObjectSetChildAndUnLock(split, "lastIndex", jsvNewFromInteger(lastIndex));
       match = jswrap_regexp_exec(split, parent);
     }
     jsvUnLock(match);
+    jsvArrayPushAndUnLock(array, jsvNewFromStringVar(parent, (size_t)last, JSVAPPENDSTRINGVAR_MAXLENGTH));
     jsvObjectSetChildAndUnLock(split, "lastIndex", jsvNewFromInteger(0));
     return array;
   }
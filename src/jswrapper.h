@@ -75,13 +75,15 @@ typedef struct {
 
 /// Information for each list of built-in symbols
 typedef struct {
-  const JswSymPtr *symbols;
-  const char *symbolChars;
+  const JswSymPtr *symbols; ///< Symbols, in the order given by the perfect hash
+  const char *symbolChars; ///< Null-terminated symbol names, in alphabetical order
+  const unsigned char *symbolHash; ///< Perfect hash of the symbols (see jswSymbolListFind)
   unsigned char symbolCount;
+  unsigned char hashSeed;
 } PACKED_JSW_SYM JswSymList;
 
-/// Do a binary search of the symbol table list
-JsVar *jswBinarySearch(const JswSymList *symbolsPtr, JsVar *parent, const char *name);
+/// Find a symbol in the symbol table list (using its perfect hash)
+JsVar *jswSymbolListFind(const JswSymList *symbolsPtr, JsVar *parent, const char *name);
 
 /** If 'name' is something that belongs to an internal function, execute it.  */
 JsVar *jswFindBuiltInFunction(JsVar *parent, const char *name);
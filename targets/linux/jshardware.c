@@ -25,6 +25,10 @@
 #endif//__MINGW32__
  #include <signal.h>
  #include <inttypes.h>
+#ifdef __linux__
+ #include <sys/epoll.h>
+ #include <sys/eventfd.h>
+#endif
 
 #include "platform_config.h"
 #include "jshardware.h"
@@ -58,6 +62,12 @@
 // ----------------------------------------------------------------------------
 int ioDevices[EV_DEVICE_MAX+1]; // list of open IO devices (or 0)
 JshPinState gpioState[JSH_PIN_COUNT]; // will be set to UNDEFINED if it isn't exported
+#ifndef USE_WIRINGPI
+/* If there's no GPIO we can use, just remember what was written to each pin
+ * and trigger watches when it changes - so setWatch can be tested */
+bool gpioVirtual;
+bool gpioValue[JSH_PIN_COUNT];
+#endif
 
 #ifdef SYSFS_GPIO_DIR
 
@@ -232,8 +242,8 @@ int getch()
 {
     int r;
     unsigned char c;
-    if ((r = (int)read(STDIN_FILENO, &c, sizeof(c))) < 0) {
-        return r;
+    if ((r = (int)read(STDIN_FILENO, &c, sizeof(c))) <= 0) {
+        return -1; // error, or end of file (stdin closed)
     } else {
         return c;
     }
@@ -242,20 +252,64 @@ int getch()
 
 pthread_t inputThread;
 bool isInitialised;
+#ifndef __MINGW32__
+bool stdinClosed; ///< Set once we get EOF on stdin, so we stop waiting on it
+#endif
+
+#ifdef __linux__
+/* jshSleep waits on this, so the idle loop wakes up when the input thread
+ * (via sleepWakeFd) or anything added with jshSetWakeOnFd has data */
+int sleepEpollFd = -1;
+int sleepWakeFd = -1;
+#endif
+
+void jshSetWakeOnFd(int fd, bool wake) {
+#ifdef __linux__
+  if (sleepEpollFd<0) return;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  epoll_ctl(sleepEpollFd, wake ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &ev);
+#else
+  NOT_USED(fd);
+  NOT_USED(wake);
+#endif
+}
+
+/// Wake the idle loop up from jshSleep (called from the input thread)
+static void jshWakeIdleLoop() {
+#ifdef __linux__
+  if (sleepWakeFd<0) return;
+  uint64_t n = 1;
+  if (write(sleepWakeFd, &n, sizeof(n))) {};
+#endif
+}
 
 void jshInputThread() {
   while (isInitialised) {
     bool shortSleep = false;
+    bool hadInput = false;
     /* Handle the delayed Ctrl-C -> interrupt behaviour (see description by EXEC_CTRL_C's definition)  */
     if (execInfo.execute & EXEC_CTRL_C_WAIT)
       execInfo.execute = (execInfo.execute & ~EXEC_CTRL_C_WAIT) | EXEC_INTERRUPTED;
     if (execInfo.execute & EXEC_CTRL_C)
       execInfo.execute = (execInfo.execute & ~EXEC_CTRL_C) | EXEC_CTRL_C_WAIT;
     // Read from the console
+#ifndef __MINGW32__
+    while (!stdinClosed && kbhit()) {
+      int ch = getch();
+      if (ch<0) {
+        stdinClosed = true;
+        break;
+      }
+#else
     while (kbhit()) {
       int ch = getch();
       if (ch<0) break;
+#endif
       jshPushIOCharEvent(EV_USBSERIAL, (char)ch);
+      hadInput = true;
     }
     // Read from any open devices - if we have space
     if (jshGetEventsUsed() < IOBUFFERMASK/2) {
@@ -269,6 +323,7 @@ void jshInputThread() {
             //int j; for (j=0;j<bytes;j++) printf("]] '%c'\r\n", buf[j]);
             jshPushIOCharEvents(i, buf, (unsigned int)bytes);
             shortSleep = true;
+            hadInput = true;
           }
         }
       }
@@ -289,17 +344,28 @@ void jshInputThread() {
 #ifdef SYSFS_GPIO_DIR
     Pin pin;
     for (pin=0;pin<JSH_PIN_COUNT;pin++)
-      if (gpioShouldWatch[pin]) {
+      if (gpioShouldWatch[pin] && !gpioVirtual) {
         shortSleep = true;
         bool state = jshPinGetValue(pin);
         if (state != gpioLastState[pin]) {
           jshPushIOEvent(pinToEVEXTI(pin) | (state?EV_EXTI_IS_HIGH:0), jshGetSystemTime());
           gpioLastState[pin] = state;
+          hadInput = true;
         }
       }
 #endif
 
+    if (hadInput) jshWakeIdleLoop();
+#ifndef __MINGW32__
+    // Sleep, but wake up as soon as there's console input
+    struct timeval tv = { 0L, shortSleep ? 1000 : 50000 };
+    fd_set fds;
+    FD_ZERO(&fds);
+    if (!stdinClosed) FD_SET(STDIN_FILENO, &fds);
+    select(stdinClosed ? 0 : STDIN_FILENO+1, &fds, NULL, NULL, &tv);
+#else
     usleep(shortSleep ? 1000 : 50000);
+#endif
   }
 }
 
@@ -345,6 +411,17 @@ void jshInit() {
   for (i=0;i<JSH_PIN_COUNT;i++) {
     gpioShouldWatch[i] = false;    
   }
+  gpioVirtual = access(SYSFS_GPIO_DIR, F_OK)!=0;
+#elif !defined(USE_WIRINGPI)
+  gpioVirtual = true;
+#endif
+
+#ifdef __linux__
+  if (sleepEpollFd<0) {
+    sleepEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    sleepWakeFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if (sleepWakeFd>=0) jshSetWakeOnFd(sleepWakeFd, true);
+  }
 #endif
 
   isInitialised = true;
@@ -473,6 +550,15 @@ JshPinState jshPinGetState(Pin pin) {
 }
 
 void jshPinSetValue(Pin pin, bool value) {
+#ifndef USE_WIRINGPI
+  if (gpioVirtual) {
+    if (gpioValue[pin] != value) {
+      gpioValue[pin] = value;
+      if (gpioEventFlags[pin]) jshPushIOWatchEvent(gpioEventFlags[pin]);
+    }
+    return;
+  }
+#endif
 #ifdef SYSFS_GPIO_DIR
   char path[64] = SYSFS_GPIO_DIR"/gpio";
   itostr(pin, &path[strlen(path)], 10);
@@ -485,6 +571,9 @@ void jshPinSetValue(Pin pin, bool value) {
 }
 
 bool jshPinGetValue(Pin pin) {
+#ifndef USE_WIRINGPI
+  if (gpioVirtual) return gpioValue[pin];
+#endif
 #ifdef SYSFS_GPIO_DIR
   char path[64] = SYSFS_GPIO_DIR"/gpio";
   itostr(pin, &path[strlen(path)], 10);
@@ -777,6 +866,12 @@ void jshI2CRead(IOEventFlags device, unsigned char address, int nBytes, unsigned
 
 /// Enter simple sleep mode (can be woken up by interrupts). Returns true on success
 bool jshSleep(JsSysTime timeUntilWake) {
+  // With epoll, anything that'd need handling wakes us, so we don't have to poll as often
+#ifdef __linux__
+  bool canWake = sleepEpollFd>=0 && sleepWakeFd>=0;
+#else
+  bool canWake = false;
+#endif
   bool hasWatches = false;
 #ifdef SYSFS_GPIO_DIR
   Pin pin;
@@ -788,10 +883,22 @@ bool jshSleep(JsSysTime timeUntilWake) {
   unsigned int usecs = (usecfloat < 0xFFFFFFFF) ? (unsigned int)usecfloat : 0xFFFFFFFF;
   if (hasWatches && usecs>1000) 
     usecs=1000; // don't sleep much if we have watches - we need to keep polling them
-  if (usecs > 50000)
+  if (usecs > 50000 && !canWake)
     usecs = 50000; // don't want to sleep too much (user input/HTTP/etc)
-  if (usecs >= 1000)  
-    usleep(usecs); 
+  if (usecs > 1000000)
+    usecs = 1000000;
+  if (usecs < 1000) return true;
+#ifdef __linux__
+  if (canWake) {
+    struct epoll_event ev;
+    if (epoll_wait(sleepEpollFd, &ev, 1, (int)(usecs/1000)) > 0 && ev.data.fd == sleepWakeFd) {
+      uint64_t n;
+      if (read(sleepWakeFd, &n, sizeof(n))) {};
+    }
+    return true;
+  }
+#endif
+  usleep(usecs);
   return true;
 }
 
@@ -13,6 +13,9 @@
 #include "jsinteractive.h"
 #include "jshardware.h"
 #include "jswrapper.h"
+#ifdef USE_NET
+#include "socketserver.h"
+#endif
 
 
 #define TEST_DIR "tests/"
@@ -32,6 +35,17 @@ void nativeInterrupt() {
   jspSetInterrupted(true);
 }
 
+/// When running a script, should we keep going? (have timers, or are doing something)
+bool shouldKeepRunning(bool isBusy) {
+  if (!isRunning) return false;
+  if (jsiHasTimers() || isBusy) return true;
+#ifdef USE_NET
+  // the idle loop doesn't report being busy if sockets are just waiting for data
+  if (socketHasOpenSockets()) return true;
+#endif
+  return false;
+}
+
 char *read_file(const char *filename) {
   struct stat results;
   if (!stat(filename, &results) == 0) {
@@ -70,7 +84,7 @@ bool run_test(const char *filename) {
 
   isRunning = true;
   bool isBusy = true;
-  while (isRunning && (jsiHasTimers() || isBusy))
+  while (shouldKeepRunning(isBusy))
     isBusy = jsiLoop();
 
   JsVar *result = jsvObjectGetChild(execInfo.root, "result", 0/*no create*/);
@@ -271,7 +285,7 @@ int main(int argc, char **argv) {
         int errCode = handleErrors();
         isRunning = !errCode;
         bool isBusy = true;
-        while (isRunning && (jsiHasTimers() || isBusy))
+        while (shouldKeepRunning(isBusy))
           isBusy = jsiLoop();
         jsiKill();
         jsvKill();
@@ -332,7 +346,7 @@ int main(int argc, char **argv) {
     free(buffer);
     isRunning = !errCode;
     bool isBusy = true;
-    while (isRunning && (jsiHasTimers() || isBusy))
+    while (shouldKeepRunning(isBusy))
       isBusy = jsiLoop();
     jsiKill();
     jsvKill();
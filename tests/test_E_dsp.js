@@ -0,0 +1,48 @@
+// E.sum/variance/convolve/FFT give the same results for flat typed arrays
+// (which use native kernels) as for normal arrays
+var ok = true;
+function check(name, a, b) {
+  if (Math.abs(a-b) > 0.0001*(1+Math.abs(b))) { console.log("FAIL: "+name+" "+a+" != "+b); ok = false; }
+}
+
+var n = 100, i;
+var arr = [];
+for (i=0;i<n;i++) arr.push(Math.round(Math.sin(i)*100));
+var kinds = {
+  Float32Array : new Float32Array(arr),
+  Int16Array : new Int16Array(arr),
+  Uint8Array : new Uint8Array(arr.map(function(x){return x+100;})),
+  Int32Array : new Int32Array(arr)
+};
+for (var k in kinds) {
+  var t = kinds[k];
+  var plain = [].slice.call(t);
+  check(k+" sum", E.sum(t), E.sum(plain));
+  check(k+" variance", E.variance(t, 3), E.variance(plain, 3));
+  [0, 7, -3, 250].forEach(function(o) {
+    check(k+" convolve "+o, E.convolve(t, t.subarray(0,37), o), E.convolve(plain, plain.slice(0,37), o));
+  });
+  check(k+" convolve mixed", E.convolve(t, kinds.Float32Array, 5), E.convolve(plain, arr, 5));
+}
+
+// FFT of real data only (the real FFT) matches the modulus of a complex FFT
+[4, 16, 100].forEach(function(len) {
+  var re = new Float32Array(len), im = new Float32Array(len), mag = new Float32Array(len);
+  for (i=0;i<len;i++) re[i] = mag[i] = Math.sin(i*0.7)*10 + (i%3);
+  var arrMag = [].slice.call(mag);
+  E.FFT(re, im);
+  E.FFT(mag);
+  E.FFT(arrMag);
+  for (i=0;i<len;i++) {
+    check("FFT "+len+" "+i, mag[i], Math.sqrt(re[i]*re[i]+im[i]*im[i]));
+    check("FFT array "+len+" "+i, arrMag[i], mag[i]);
+  }
+});
+
+// inverse FFT gets us back where we started
+var re = new Float64Array([1,2,3,4,5,6,7,8]), im = new Float64Array(8);
+E.FFT(re, im);
+E.FFT(re, im, true);
+for (i=0;i<8;i++) check("inverse "+i, re[i], i+1);
+
+result = ok;
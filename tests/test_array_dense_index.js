@@ -0,0 +1,67 @@
+// Dense arrays get an index of their elements - lookups must still agree with
+// iterating over the array after every kind of change to it
+var ok = true;
+function check(a, what) {
+  // looking up the last element walks the whole list, so makes sure there's an index
+  a[a.length-1];
+  // forEach walks the list of elements rather than looking each one up
+  var iterated = {}, last = a.length;
+  a.forEach(function(v,i) { iterated[i] = v; if (i>last) last = i; });
+  for (var i=-1;i<=last+1;i++) {
+    if (a[i]!==iterated[i] || a[""+i]!==iterated[i]) {
+      console.log(what+": a["+i+"] = "+a[i]+", expected "+iterated[i]);
+      ok = false;
+    }
+  }
+}
+function make(n) {
+  var a = [];
+  for (var i=0;i<n;i++) a.push(i*10);
+  check(a, "push");
+  return a;
+}
+
+var a = make(40);
+var size = E.getSizeOf(a);
+for (var i=0;i<40;i++) if (a[i]!==i*10) ok = false;
+ok = ok && E.getSizeOf(make(40).slice(0,10))<size; // the index takes up space
+a.push(400, 410);
+check(a, "push 2");
+a.pop();
+check(a, "pop");
+while (a.length>20) a.pop();
+a.push(1,2,3);
+check(a, "pop and push");
+a.shift();
+check(a, "shift");
+a.unshift(-1, -2);
+check(a, "unshift");
+a.splice(5, 3);
+check(a, "splice remove");
+a.splice(2, 0, "x", "y", "z");
+check(a, "splice insert");
+a.reverse();
+check(a, "reverse");
+a.sort();
+check(a, "sort");
+a.length = 10;
+check(a, "length=");
+a.push(5);
+check(a, "push after length=");
+a = make(40);
+a[100] = "sparse";
+check(a, "sparse write");
+a[45] = "hole";
+check(a, "hole");
+a.length = 30;
+check(a, "truncate sparse");
+a = make(40);
+a[5] = "changed";
+a["5"] = "changed again";
+check(a, "overwrite");
+delete a[10];
+check(a, "delete");
+a.foo = "bar";
+check(a, "non-integer key");
+
+result = ok;
@@ -0,0 +1,74 @@
+// Array.sort on larger arrays, stability, and the non-function fast paths
+var ok = true;
+function check(name, v) { if (!v) { console.log("FAIL: "+name); ok = false; } }
+
+var n = 200, i;
+var sorted = [], reversed = [], random = [];
+for (i=0;i<n;i++) {
+  sorted.push(i);
+  reversed.push(n-i);
+  random.push((i*7919)%n);
+}
+function isSorted(a) {
+  for (var i=1;i<a.length;i++) if (a[i-1]>a[i]) return false;
+  return true;
+}
+var cmp = function(a,b) { return a-b; };
+check("sorted", isSorted(sorted.slice().sort(cmp)));
+check("reversed", isSorted(reversed.slice().sort(cmp)));
+check("random", isSorted(random.slice().sort(cmp)));
+check("random length", random.slice().sort(cmp).length==n);
+
+// compare functions returning fractions
+check("fractions", [0.3,0.1,0.2].sort(cmp).toString()=="0.1,0.2,0.3");
+
+// default sort is by string, even for numbers
+check("numbers", [10,9,1,-1,2.5].sort().toString()=="-1,1,10,2.5,9");
+check("strings", ["b","ab","a","c"].sort().toString()=="a,ab,b,c");
+check("mixed", [10,"9",1].sort().toString()=="1,10,9");
+
+// stable
+var objs = [];
+for (i=0;i<50;i++) objs.push({k:i%3, i:i});
+objs.sort(function(a,b) { return a.k-b.k; });
+var stable = true;
+for (i=1;i<objs.length;i++)
+  if (objs[i-1].k==objs[i].k && objs[i-1].i>objs[i].i) stable = false;
+check("stable", stable);
+
+// an exception in the compare function leaves the array as it was
+var a = [3,2,1];
+try {
+  a.sort(function() { throw "Oops"; });
+} catch (e) {}
+check("exception", a.toString()=="3,2,1");
+
+// values removed by the compare function are still valid
+var b = [{v:3},{v:1},{v:2}];
+b.sort(function(x,y) { b.length=0; return x.v-y.v; });
+check("modified", b.length==0);
+
+// ... even if they're garbage collected or moved by E.defrag()
+b = [];
+for (i=0;i<40;i++) b.push({v:40-i});
+b.sort(function(x,y) {
+  while (b.length) b.pop();
+  process.memory();
+  return x.v-y.v;
+});
+check("gc", b.length==0);
+b = [];
+for (i=0;i<40;i++) b.push({v:40-i});
+var junk = [], calls = 0;
+for (i=0;i<50;i++) junk.push({j:i});
+b.sort(function(x,y) {
+  if (calls++==3) {
+    junk = undefined;
+    b.splice(0,10);
+    E.defrag();
+  }
+  return x.v-y.v;
+});
+check("defrag", b.map(function(o) { return o.v; }).join(",")=="1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30");
+
+result = ok;
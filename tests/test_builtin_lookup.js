@@ -0,0 +1,26 @@
+// Check that every built-in name can be found via the symbol tables' hashes
+
+var objs = [
+  [global, global], [Math, Math], [E, E], [JSON, JSON], [String, String], [Object, Object],
+  [String.prototype, "str"], [Array.prototype, []], [Date.prototype, new Date()],
+  [Object.prototype, {}], [Number.prototype, 1], [Graphics.prototype, Graphics.createArrayBuffer(8,8,1)]
+];
+// some prototypes list Function.prototype's names too, even though they don't have them
+var fnNames = Object.getOwnPropertyNames(Function.prototype);
+var missing = [], count = 0;
+objs.forEach(function(x) {
+  Object.getOwnPropertyNames(x[0]).forEach(function(n) {
+    if (fnNames.indexOf(n)>=0 && x[0]!==Function.prototype) return;
+    count++;
+    if (x[1][n]===undefined) missing.push(n);
+  });
+});
+fnNames.forEach(function(n) {
+  count++;
+  if ((function(){})[n]===undefined) missing.push(n);
+});
+// names that aren't builtins shouldn't be found
+var notFound = [Math.sinx, Math.si, Math.Sin, E.getTemperaturee, [].pus, global.digitalWrit];
+
+result = count>100 && missing.length==0 && notFound.every(function(x) { return x===undefined; });
+if (!result) console.log(count, missing, notFound);
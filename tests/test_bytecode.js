@@ -0,0 +1,69 @@
+// Functions and loops are compiled to bytecode - check the results match the parser's
+
+function loops(n) {
+  var s = 0;
+  for (var i=0;i<n;i++) {
+    if (i==3) continue;
+    if (i>6) break;
+    s += i;
+  }
+  var j = 0;
+  while (j<n) j += 3;
+  do { j--; } while (j>5);
+  return s+","+j;
+}
+
+function P(x) { this.x = x; }
+P.prototype.get = function(a) { return this.x + a; };
+
+function objects() {
+  var p = new P(4);
+  var o = { a : 1, "b" : [1,2,3], c : { d : p.get(2) } };
+  o.e = o.b.length;
+  o["f"] = o.c.d * 2;
+  o.b[1] += 10;
+  return JSON.stringify(o);
+}
+
+function operators(a) {
+  var i = 5;
+  return [i++ + ++i, -i, ~i, !i, typeof a, typeof nonexistent, a&&a.b||"def", a?"y":"n", void 0, 7%3, 1<<4, -16>>>28];
+}
+
+function closure() {
+  var n = 0;
+  return function() { return ++n; };
+}
+
+function thrower() {
+  throw "oops";
+}
+
+function notCompiled() {
+  "nobytecode";
+  var r = 0;
+  for (var i=0;i<5;i++) r+=i;
+  return r;
+}
+
+function check() {
+  var c = closure();
+  c(); c();
+  var caught;
+  try { thrower(); } catch (e) { caught = e; }
+  return [loops(10), objects(), JSON.stringify(operators({b:3})), JSON.stringify(operators(0)), c(), caught, notCompiled()].join("|");
+}
+
+// top-level loop
+var total = 0;
+for (var k=0;k<10;k++) { total += k; if (k==7) break; }
+
+var compiled = check();
+E.setFlags({noBytecode:1});
+var parsed = check();
+E.setFlags({noBytecode:0});
+
+result = compiled==parsed && total==28 &&
+         compiled.split("|")[0]=="18,5" &&
+         compiled.split("|")[1]=='{"a":1,"b":[1,12,3],"c":{"d":6},"e":3,"f":12}' &&
+         compiled.split("|").slice(4).join()=="3,oops,10";
@@ -0,0 +1,45 @@
+// E.defrag - moving variables so that large flat strings can be allocated
+
+// objects and arrays with indexes (which contain references to variables)
+var obj = {}, arr = [];
+for (var i=0;i<100;i++) {
+  obj["k"+i] = i;
+  arr.push("v"+i);
+}
+obj.k50; arr[50]; // make sure indexes are created
+
+// fill up memory, and then free a little from all over it
+var l = null, k = 0;
+var free = process.memory().free;
+while (free > 30) {
+  for (var i=0;i<(free-25)/5;i++) l = {n:l, v:k++, x:{}};
+  free = process.memory().free;
+}
+for (var n=l;n;n=n.n) delete n.x;
+
+var before = E.getAddressOf(new Uint8Array(2000),true)!=0;
+var moved = E.defrag();
+var after = E.getAddressOf(new Uint8Array(2000),true)!=0;
+
+var listOk = true, j = k;
+for (var n=l;n;n=n.n) if (n.v!=--j) listOk = false;
+l = undefined;
+
+// allocate and free lots of different sized buffers
+var bufs = [], bufsOk = true;
+for (var i=0;i<2000;i++) {
+  var b = 0|(Math.random()*16);
+  if (bufs[b] && bufs[b][bufs[b].length-1]!=(b+1)) bufsOk = false;
+  bufs[b] = new Uint8Array(50+(0|(Math.random()*800)));
+  bufs[b].fill(b+1);
+  if (!(i%200)) moved += E.defrag();
+}
+bufs.forEach(function(b,i) {
+  for (var j=0;j<b.length;j++) if (b[j]!=i+1) bufsOk = false;
+});
+
+var indexOk = true;
+for (var i=0;i<100;i++)
+  if (obj["k"+i]!=i || arr[i]!="v"+i) indexOk = false;
+
+result = !before && after && moved>0 && listOk && bufsOk && indexOk;
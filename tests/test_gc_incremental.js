@@ -0,0 +1,31 @@
+// Incremental garbage collection while code is changing what's referenced
+
+E.setGCOptions({incremental:true, sliceSize:50});
+// fill up memory so an incremental collection starts when we're idle
+var fill = null;
+var free = process.memory().free;
+while (free > 300) {
+  for (var i=0;i<(free-290)/2;i++) fill = {n:fill};
+  free = process.memory().free;
+}
+var slices = process.memory().gcslices;
+
+var keep = [];
+var n = 0;
+var iv = setInterval(function() {
+  // garbage that can only be freed by the GC
+  var a = {}; a.a = a;
+  // move references around while the collector is marking
+  var x = {v:n}; x.self = x;
+  keep.push(x);
+  if (keep.length>3) keep.other = keep.shift();
+  n++;
+  if (n==100) {
+    clearInterval(iv);
+    var m = process.memory();
+    fill = undefined;
+    E.setGCOptions({incremental:false});
+    result = m.gcslices > slices && keep.other.v==96 &&
+             keep.map(e=>e.self.v).join()=="97,98,99";
+  }
+}, 5);
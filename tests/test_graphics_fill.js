@@ -0,0 +1,63 @@
+// Check the fast fill/line/image paths for flat ArrayBuffers against drawing a pixel at a time
+var W = 37, H = 23;
+var ok = true;
+var seed = 1;
+function rnd(n) { seed = (seed*1103515245 + 12345) & 0x7FFFFFFF; return seed % n; }
+function same(a, b, what) {
+  var sa = new Uint8Array(a.buffer), sb = new Uint8Array(b.buffer);
+  for (var i=0;i<sa.length;i++)
+    if (sa[i]!=sb[i]) { print(what+" differs at byte "+i+": "+sa[i]+" vs "+sb[i]); ok = false; return; }
+}
+
+[1,2,4,8,16,24,32].forEach(function(bpp) {
+  [{}, {msb:true}].forEach(function(opts) {
+    var fast = Graphics.createArrayBuffer(W,H,bpp,opts);
+    var slow = Graphics.createArrayBuffer(W,H,bpp,opts);
+    var mask = bpp==32 ? 0xFFFFFFFF : ((1<<bpp)-1);
+    for (var n=0;n<30;n++) {
+      var col = rnd(0x7FFFFFFF) & mask;
+      var x1 = rnd(W+4)-2, y1 = rnd(H+4)-2, x2 = rnd(W+4)-2, y2 = rnd(H+4)-2;
+      var type = n%4;
+      if (type==1) y2 = y1; // horizontal line
+      if (type==2) x2 = x1; // vertical line
+      if (type==3) { x1 = 0; x2 = W-1; } // full width
+      fast.setColor(col);
+      if (type==0 || type==3) fast.fillRect(x1,y1,x2,y2);
+      else fast.drawLine(x1,y1,x2,y2);
+      for (var y=Math.max(0,Math.min(y1,y2));y<=Math.min(H-1,Math.max(y1,y2));y++)
+        for (var x=Math.max(0,Math.min(x1,x2));x<=Math.min(W-1,Math.max(x1,x2));x++)
+          slow.setPixel(x,y,col);
+    }
+    same(fast, slow, "fill "+bpp+"bpp "+JSON.stringify(opts));
+    if (fast.getModified && JSON.stringify(fast.getModified())!=JSON.stringify(slow.getModified())) {
+      print("modified area differs at "+bpp+"bpp"); ok = false;
+    }
+  });
+});
+
+// drawImage - the same image drawn with and without the fast path (transparency forces the slow one)
+[1,8,16,24].forEach(function(bpp) {
+  var opts = {msb:true};
+  var fast = Graphics.createArrayBuffer(W,H,bpp,opts);
+  var slow = Graphics.createArrayBuffer(W,H,bpp,opts);
+  var iw = 16, ih = 9;
+  var img = { width:iw, height:ih, bpp:bpp, buffer:new Uint8Array(iw*ih*bpp/8).buffer };
+  var d = new Uint8Array(img.buffer);
+  for (var i=0;i<d.length;i++) d[i] = rnd(256);
+  var mask = (bpp==32) ? 0xFFFFFFFF : ((1<<bpp)-1);
+  var positions = [[0,0],[8,3],[-5,-4],[W-7,H-5],[30,20],[-20,0]];
+  positions.forEach(function(p) {
+    fast.drawImage(img, p[0], p[1]);
+    // draw by hand with setPixel
+    var bit = 0;
+    for (var y=0;y<ih;y++) for (var x=0;x<iw;x++) {
+      var c = 0;
+      for (var b=0;b<bpp;b++) { c = c*2 + ((d[bit>>3]>>(7-(bit&7)))&1); bit++; }
+      if (bpp==1) c = c ? 1 : 0;
+      slow.setPixel(x+p[0], y+p[1], c);
+    }
+  });
+  same(fast, slow, "drawImage "+bpp+"bpp");
+});
+
+result = ok;
@@ -0,0 +1,61 @@
+// Scanline polygon/circle rasteriser - concave shapes, fill rules and antialiasing
+var ok = true;
+function check(name, cond) { if (!cond) { print("FAIL: "+name); ok = false; } }
+function count(g) {
+  var n = 0, b = new Uint8Array(g.buffer);
+  for (var i=0;i<b.length;i++) if (b[i]) n++;
+  return n;
+}
+
+var a = Graphics.createArrayBuffer(32,32,8);
+var b = Graphics.createArrayBuffer(32,32,8);
+// a polygon rectangle covers the same pixels as fillRect
+a.fillPoly([3,4,20,4,20,30,3,30]);
+b.fillRect(3,4,20,30);
+check("rect", a.buffer.toString()==b.buffer.toString());
+
+// concave 'U' shape - the gap in the middle must stay empty
+a.clear();
+a.fillPoly([2,2,8,2,8,20,22,20,22,2,28,2,28,28,2,28]);
+check("concave inside", a.getPixel(5,10) && a.getPixel(25,10) && a.getPixel(15,25));
+check("concave gap", !a.getPixel(15,10));
+
+// a square drawn twice in the same direction: non-zero fills it, even-odd leaves it empty
+var twice = [4,4,20,4,20,20,4,20, 4,4,20,4,20,20,4,20];
+a.clear(); a.fillPoly(twice);
+check("non-zero", a.getPixel(12,12));
+a.clear(); a.fillPoly(twice, true);
+check("even-odd", !a.getPixel(12,12));
+
+// circles are symmetrical
+a.clear(); a.fillCircle(15,15,9);
+var sym = true;
+for (var y=0;y<32;y++) for (var x=0;x<32;x++)
+  if (a.getPixel(x,y)!=a.getPixel(30-x,y) || a.getPixel(x,y)!=a.getPixel(y,x)) sym = false;
+check("circle symmetry", sym);
+check("circle size", a.getPixel(6,15) && !a.getPixel(5,15) && a.getPixel(15,24) && !a.getPixel(15,25));
+
+// antialiasing blends the edges, but leaves the inside solid
+a.clear(); a.setColor(255); a.setAntiAlias(true);
+a.fillPoly([4,4,20,4,20,20,4,20]);
+check("aa solid", a.getPixel(12,12)==255);
+var edge = a.getPixel(4,12);
+check("aa edge "+edge, edge>64 && edge<192);
+a.clear(); a.fillCircle(15,15,9);
+var partial = 0;
+for (var y=0;y<32;y++) for (var x=0;x<32;x++) { var p=a.getPixel(x,y); if (p>0 && p<255) partial++; }
+check("aa circle "+partial, partial>10 && a.getPixel(15,15)==255);
+
+// antialiasing is ignored for less than 8 bits per pixel
+var c = Graphics.createArrayBuffer(32,32,1);
+c.setAntiAlias(true);
+c.fillPoly([4.5,4,20,4,20,20,4.5,20]);
+check("1bpp", count(c)>0);
+
+// offscreen shapes don't draw
+a.setAntiAlias(false); a.clear();
+a.fillPoly([-50,-50,-10,-50,-30,-10]);
+a.fillCircle(100,100,20);
+check("offscreen", count(a)==0);
+
+result = ok;
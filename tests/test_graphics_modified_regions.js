@@ -0,0 +1,29 @@
+// Modified regions are tracked as a 16x16 grid of tiles
+var g = Graphics.createArrayBuffer(160,120,8);
+var r = [];
+r.push(JSON.stringify(g.getModifiedRegions(true))); // clear from creation
+r.push(JSON.stringify(g.getModifiedRegions()));
+g.setPixel(0,0);
+g.setPixel(159,119);
+r.push(JSON.stringify(g.getModifiedRegions()));
+// getModified still gives the bounding box
+r.push(JSON.stringify(g.getModified(true)));
+r.push(JSON.stringify(g.getModifiedRegions()));
+// neighbouring tiles get merged
+g.fillRect(10,8,39,22);
+r.push(JSON.stringify(g.getModifiedRegions(true)));
+g.drawLine(0,60,159,60);
+r.push(JSON.stringify(g.getModifiedRegions(true)));
+
+var expected = [
+  null, // don't care what creating the Graphics did
+  '[]',
+  '[{"x1":0,"y1":0,"x2":9,"y2":7},{"x1":150,"y1":112,"x2":159,"y2":119}]',
+  '{"x1":0,"y1":0,"x2":159,"y2":119}',
+  '[]',
+  '[{"x1":10,"y1":8,"x2":39,"y2":23}]',
+  '[{"x1":0,"y1":56,"x2":159,"y2":63}]'
+];
+result = 1;
+for (var i=1;i<r.length;i++)
+  if (r[i]!=expected[i]) { print(i, r[i], "!=", expected[i]); result = 0; }
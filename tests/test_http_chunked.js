@@ -0,0 +1,34 @@
+// HTTP client and server sending and receiving with chunked transfer encoding
+
+var result = 0;
+var http = require("http");
+
+var server = http.createServer(function (req, res) {
+  req.on('data', function(data) {
+    res.writeHead(200, {'Transfer-Encoding': 'chunked'});
+    res.write(data);
+    res.write(" World");
+    res.end();
+  });
+});
+server.listen(8084);
+
+var options = {
+  host: 'localhost',
+  port: 8084,
+  path: '/',
+  method: 'POST',
+  headers: { 'Transfer-Encoding': 'chunked' }
+};
+var req = http.request(options, function(res) {
+  var received = "";
+  res.on('data', function(data) { received += data; });
+  res.on('close', function() {
+    console.log(JSON.stringify(received));
+    result = received=="Hello World";
+    server.close();
+  });
+});
+req.write("Hel");
+req.write("lo");
+req.end();
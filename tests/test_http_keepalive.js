@@ -0,0 +1,41 @@
+// HTTP server with several requests pipelined on one persistent connection
+
+var result = 0;
+var http = require("http");
+var net = require("net");
+
+var server = http.createServer(function (req, res) {
+  if (req.url=="/stream") {
+    res.write(req.method); // no Content-Length, so this is sent chunked
+    res.end(":");
+  } else if (req.method=="GET") {
+    res.end(req.method+" "+req.url+":");
+  } else req.on('data', function(data) {
+    res.end(req.method+" "+req.url+":"+data);
+  });
+});
+server.listen(8083);
+
+var client = net.connect({port: 8083}, function() {
+  var received = "";
+  client.on('data', function(data) {
+    received += data;
+    if (received.indexOf("\r\n0\r\n\r\n")<0) return; // not all here yet
+    console.log(JSON.stringify(received));
+    var responses = received.split("HTTP/1.1 200");
+    result = responses.length==5 &&
+             responses[1].indexOf("Content-Length: 7\r\n\r\nGET /a:")>0 &&
+             responses[2].indexOf("\r\n\r\nPOST /b:Hello")>0 &&
+             responses[3].indexOf("\r\n\r\nPUT /c:World")>0 &&
+             responses[4].indexOf("Transfer-Encoding: chunked\r\n\r\n3\r\nGET\r\n1\r\n:\r\n0\r\n\r\n")>0;
+    client.end();
+    server.close();
+  });
+  client.write("GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n"+
+               "POST /b HTTP/1.1\r\nHost: localhost\r\ncontent-length: 5\r\n\r\nHello"+
+               "PUT /c HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nWor\r\n2;x=y\r\nld\r\n0\r\n\r\n");
+  // the last request arrives later, on its own
+  setTimeout(function() {
+    client.write("GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  }, 100);
+});
@@ -0,0 +1,35 @@
+// A persistent HTTP server connection is closed if the next request doesn't
+// arrive within the server's keepAliveTimeout, but not while requests keep coming
+
+var result = 0;
+var http = require("http");
+var net = require("net");
+/* The server closes first, so its port is in TIME_WAIT for a minute or so
+ * afterwards - use a different one each time so we can be run again straight away */
+var port = 4460 + Math.floor(getTime())%100;
+
+var server = http.createServer(function (req, res) {
+  res.end(req.url);
+});
+server.keepAliveTimeout = 200;
+server.listen(port);
+
+var client = net.connect({port: port}, function() {
+  var received = "", lastRequest;
+  function request(url) {
+    lastRequest = getTime();
+    client.write("GET "+url+" HTTP/1.1\r\nHost: localhost\r\n\r\n");
+  }
+  client.on('data', function(data) { received += data; });
+  client.on('close', function() {
+    var idle = getTime() - lastRequest;
+    console.log(JSON.stringify(received), idle);
+    server.close();
+    // both responses arrived, the second request wasn't timed out, and the idle one was
+    result = received.indexOf("\r\n\r\n/a")>0 && received.indexOf("\r\n\r\n/b")>0 &&
+             idle>0.15 && idle<2;
+  });
+  request("/a");
+  // less than keepAliveTimeout, so the connection is still there
+  setTimeout(function() { request("/b"); }, 150);
+});
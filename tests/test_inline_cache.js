@@ -0,0 +1,49 @@
+// Property lookups are cached per site - check the cache notices changes
+
+function test() {
+  function P(x) { this.x = x; }
+  P.prototype.get = function() { return "proto"+this.x; };
+
+  function get(o) { return o.get(); }
+  function x(o) { return o.x; }
+  function sin(o) { return o.sin(0); }
+
+  var r = [];
+  var a = new P(1);
+  r.push(get(a), get(a)); // prototype
+  a.get = function() { return "own"; };
+  r.push(get(a)); // shadowed by the object itself
+  delete a.get;
+  r.push(get(a)); // back to the prototype
+  P.prototype.get = function() { return "new"+this.x; };
+  r.push(get(a)); // prototype changed
+  var b = new P(2);
+  r.push(get(b), get(a)); // different objects at the same site
+  a.__proto__ = { get : function() { return "other"; } };
+  r.push(get(a)); // prototype replaced
+  Object.prototype.toString = function() { return "str"; };
+  r.push(a.toString()); // builtin replaced in Object.prototype
+  delete Object.prototype.toString;
+  r.push(x(b));
+  b.x = 5;
+  r.push(x(b)); // value changed
+  delete b.x;
+  r.push(x(b)); // removed
+  var origSin = Math.sin;
+  r.push(sin(Math), sin(Math));
+  Math.sin = function() { return "mine"; };
+  r.push(sin(Math)); // builtin replaced on a native object
+  Math.sin = function() { return "again"; };
+  r.push(sin(Math));
+  Math.sin = origSin;
+
+  var expected = ["proto1","proto1","own","proto1","new1","new2","new1","other",
+                  "str",2,5,undefined,0,0,"mine","again"];
+  if (JSON.stringify(r)!=JSON.stringify(expected)) console.log(JSON.stringify(r));
+  return JSON.stringify(r)==JSON.stringify(expected);
+}
+
+var withBytecode = test();
+E.setFlags({noBytecode:1});
+result = withBytecode && test();
+E.setFlags({noBytecode:0});
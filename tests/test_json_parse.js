@@ -0,0 +1,59 @@
+// JSON.parse, and JSON.parser() with the data split up in every possible way
+var ok = true;
+var obj = {a:[1,-2,3.5,1e3,true,false,null,"x\ny\"z\x07\xFF"],b:{c:{}, "d e":"\\"},"7":[[],[[1]]],big:12345678901,neg:-0.25};
+var str = JSON.stringify(obj);
+if (JSON.stringify(JSON.parse(str))!=str) ok = false;
+if (JSON.parse(' "\\u0041\\x42" ')!="AB" || JSON.parse("'single'")!="single") ok = false;
+if (JSON.parse("[ 1 , 2 ]\n").length!=2 || JSON.parse("1e2")!=100) ok = false;
+
+var errors = 0;
+var bad = ['{"a":}', '[1,2', '', '{"a" 1}', 'tru', '[1,,2]', '"unterminated', '{a:1}', '[1,2,]', '{"a":1,}', '[0x10]',
+  // numbers that don't match -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+  '[1-2]', '[--1]', '[1.2.3]', '[1e]', '[01]', '[1.]', '[.5]', '[1e+]', '-', '1E',
+  // anything after the value
+  '0x10', '1 2', '[1] x', 'true x', '"a"b'];
+bad.forEach(function(s) {
+  try { JSON.parse(s); } catch (e) { if (e instanceof SyntaxError) errors++; }
+});
+if (errors!=bad.length) ok = false;
+if (JSON.parse("[0,-0.5e-3,1E2,12.25,-17,1e+2]").join()!="0,-0.0005,100,12.25,-17,100" || JSON.parse(" 42 \n")!=42) ok = false;
+
+// Numbers with more digits than the parser stores
+function near(a, b) { return Math.abs(a/b-1) < 1e-9; }
+if (JSON.parse("0.12345678901234567890123456789012345678")!=0.12345678901234567890123456789012345678) ok = false;
+if (!near(JSON.parse("-123456789012345678901234567890123456789012345678901234567890"), -1.2345678901234567e59)) ok = false;
+if (!near(JSON.parse("0.000000000000000000000000000000000000000000000000001234"), 1.234e-51)) ok = false;
+if (!near(JSON.parse("1234567890123456789012345678901234567890.5e-30"), 1234567890.1234567)) ok = false;
+var zeros = "0.";
+for (i=0;i<400;i++) zeros+="0";
+if (JSON.parse(zeros+"1e400")!=0.1 || JSON.parse("1"+zeros.substr(2))!=Infinity) ok = false;
+
+// Deep nesting doesn't use up the stack
+var deep = "";
+for (var i=0;i<200;i++) deep+="[";
+for (i=0;i<200;i++) deep+="]";
+if (JSON.stringify(JSON.parse(deep))!=deep) ok = false;
+
+// Streaming - several values, split into chunks of every size
+var stream = str+"\n"+str+" 42 \"s\" [] 17";
+var expected = [str,str,"42",'"s"',"[]","17"];
+for (var chunk=1;chunk<=stream.length;chunk+=7) {
+  var got = [];
+  var p = JSON.parser();
+  p.on('data', function(v) { got.push(JSON.stringify(v)); });
+  for (i=0;i<stream.length;i+=chunk) p.write(stream.substr(i,chunk));
+  p.end();
+  if (got.join("|")!=expected.join("|")) ok = false;
+}
+
+// errors reset the parser
+var p = JSON.parser(), got = [];
+p.on('data', function(v) { got.push(v); });
+try { p.write('{"a":1]'); ok = false; } catch (e) {}
+p.write('[1]');
+try { p.write('{"a"'); p.end(); ok = false; } catch (e) {}
+p.write('2');
+p.end();
+if (JSON.stringify(got)!="[[1],2]") ok = false;
+
+result = ok;
@@ -0,0 +1,66 @@
+// JSON.stringifyTo - output should match JSON.stringify however it is split up
+var a = [1,,3]; a.foo = 5;
+var o = {a:[1,2,[],{}],b:{c:{d:"x\n\"y"}},u:undefined,f:function(){},n:null,t:true,5:"five",
+         ab:new Uint8Array([1,2,3]),holes:a,s:"str",e:[undefined]};
+o.self = o;
+var deep = o;
+for (var i=0;i<20;i++) deep = {v:i, next:[deep]}; // more levels than are tracked in C
+var expected = JSON.stringify(deep);
+
+function W(pause) { this.s=""; this.pause=pause; }
+W.prototype.write = function(d) {
+  this.s+=d;
+  if (this.pause) { // return false and only emit 'drain' later
+    var w = this;
+    this.waiting = true;
+    setTimeout(function() { w.waiting = false; w.emit("drain"); }, 1);
+    return false;
+  }
+};
+W.prototype.end = function() { this.ended=true; };
+
+var results = {}, drainOk = true;
+function go(name, chunkSize, pause) {
+  var w = new W(pause);
+  if (pause) {
+    var write = w.write;
+    w.write = function(d) { if (w.waiting) drainOk = false; return write.call(w, d); };
+  }
+  JSON.stringifyTo(deep, w, {chunkSize:chunkSize, complete:function() {
+    results[name] = w.s==expected && w.ended;
+  }});
+}
+go("c1", 1);
+go("c7", 7);
+go("c64", 64);
+go("drain", 16, true);
+
+// things changing part way through - once 'after' has been written. Keys that
+// are still to come are output as they are then, and if the key we're in the
+// middle of has gone we can't tell where we were so the object just ends
+function change(name, after, expected) {
+  var changing = {a:1,b:2,c:{d:3},e:4};
+  var w = new W();
+  w.write = function(d) {
+    this.s += d;
+    if (!this.changed && this.s.indexOf(after)>=0) {
+      this.changed = true;
+      delete changing.c;
+      changing.z = 5;
+      E.defrag();
+    }
+  };
+  JSON.stringifyTo(changing, w, {chunkSize:4, complete:function() {
+    var ok = w.s==expected;
+    try { JSON.parse(w.s); } catch (e) { ok = false; }
+    if (!ok) console.log(name, JSON.stringify(w.s), "expected", JSON.stringify(expected));
+    results[name] = ok;
+  }});
+}
+change("changeBefore", '"a":1', '{"a":1,"b":2,"e":4,"z":5}');
+change("changeInside", '"c":{', '{"a":1,"b":2,"c":{"d":3}}');
+
+setTimeout(function() {
+  result = drainOk && results.c1 && results.c7 && results.c64 && results.drain &&
+           results.changeBefore && results.changeInside;
+}, 500);
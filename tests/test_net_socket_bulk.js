@@ -0,0 +1,25 @@
+// Socket server and client test - lots of data, received in many chunks
+
+var result = 0;
+var net = require("net");
+
+var expected = "";
+for (var i=0;i<2000;i++) expected += i+",";
+
+var server = net.createServer(function(c) {
+  c.write(expected);
+  c.end();
+});
+server.listen(4445);
+
+var client = net.connect({port: 4445}, function() {
+  var received = "";
+  client.on('data', function(data) {
+    received += data;
+  });
+  client.on('close', function() {
+    console.log("Received "+received.length+" bytes, expected "+expected.length);
+    result = received==expected;
+    server.close();
+  });
+});
@@ -0,0 +1,64 @@
+// Sockets on Linux are only read when epoll says they're ready - check that
+// idle servers let us exit, and that lots of ready sockets all get serviced.
+// Clients always close first so the servers' ports don't end up in TIME_WAIT
+
+var result = 0;
+var net = require("net");
+var CLIENTS = 100; // more than net_linux_idle gets from epoll in one go
+
+// a server with no connections doesn't stop us finishing once it's closed
+var idle = net.createServer(function(c) {});
+idle.listen(4450);
+setTimeout(function() {
+  idle.close();
+  step2();
+}, 10);
+
+// a client connects and gets a response
+function step2() {
+  var server = net.createServer(function(c) {
+    c.write("42");
+  });
+  server.listen(4451);
+  net.connect({port: 4451}, function(client) {
+    var got = "";
+    client.on('data', function(data) {
+      got += data;
+      client.end();
+    });
+    client.on('close', function() {
+      server.close();
+      if (got=="42") step3();
+    });
+  });
+}
+
+// lots of sockets have data at once
+function step3() {
+  var conns = [], closed = 0, data = [];
+  var server = net.createServer(function(c) {
+    conns.push(c);
+    // once everyone's connected, send to all of them at once
+    if (conns.length == CLIENTS)
+      conns.forEach(function(c) { c.write("go"); });
+  });
+  server.listen(4452);
+  /* Connect one at a time - connect() blocks on Linux, so if the server's
+   * listen backlog filled up we'd never get to accept the connections */
+  function connect(i) {
+    data[i] = "";
+    net.connect({port: 4452}, function(client) {
+      client.on('data', function(d) {
+        data[i] += d;
+        if (data[i]=="go") client.end();
+      });
+      client.on('close', function() {
+        if (++closed < CLIENTS) return;
+        server.close();
+        result = data.every(function(d) { return d=="go"; });
+      });
+      if (i+1 < CLIENTS) connect(i+1);
+    });
+  }
+  connect(0);
+}
@@ -0,0 +1,16 @@
+// Built-in properties are listed in alphabetical order, whatever order they're stored in
+function sorted(a) {
+  a = a.filter(function(n) { return n!="constructor"; }); // not a built-in symbol
+  return a.join(",")==a.slice().sort().join(",");
+}
+
+var r = [
+  Object.getOwnPropertyNames(Math).slice(0,4).join(",")=="E,LN10,LN2,LOG10E",
+  sorted(Object.getOwnPropertyNames(Math)),
+  sorted(Object.getOwnPropertyNames(Array.prototype)),
+  sorted(Object.getOwnPropertyNames(String.prototype)),
+  sorted(Object.getOwnPropertyNames(Object)),
+  Object.getOwnPropertyNames(Math).indexOf("random")>=0,
+];
+
+result = r.every(function(x) { return x; });
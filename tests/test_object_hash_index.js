@@ -0,0 +1,69 @@
+// Objects with lots of children get a hidden hash index - lookups still work as
+// it's built, grown and updated, and the index itself never shows up
+var ok = true;
+function hasIndex(obj) {
+  return E.getSizeOf(obj,1).some(function(e) { return e.name=="\xFFhsh"; });
+}
+function indexSize(obj) {
+  return E.getSizeOf(obj,1).filter(function(e) { return e.name=="\xFFhsh"; })[0].size;
+}
+function check(obj, count, deleted) {
+  for (var i=0;i<count;i++) {
+    var v = (deleted && (i&1)) ? undefined : i;
+    if (obj["k"+i]!==v || obj[i]!==v || obj[""+i]!==v) {
+      console.log("Wrong value for "+i+" ("+count+")");
+      ok = false;
+    }
+  }
+  if (obj.missing!==undefined || obj[count]!==undefined) ok = false;
+}
+function add(obj, from, to) {
+  for (var i=from;i<to;i++) {
+    obj["k"+i] = i;
+    obj[i] = i;
+  }
+}
+
+// small objects don't need an index
+var o = {};
+add(o, 0, 10);
+check(o, 10);
+ok = ok && !hasIndex(o);
+// built once we pass the threshold
+add(o, 10, 40);
+check(o, 40);
+ok = ok && hasIndex(o);
+// grown and rehashed as we add more
+var size = indexSize(o);
+add(o, 40, 300);
+check(o, 300);
+ok = ok && indexSize(o)>size;
+// delete
+for (var i=1;i<300;i+=2) {
+  delete o["k"+i];
+  delete o[i];
+}
+check(o, 300, true);
+add(o, 0, 300);
+check(o, 300);
+
+// the index is hidden
+var keys = Object.keys(o);
+var forIn = 0;
+for (var k in o) forIn++;
+ok = ok && keys.length==600 && forIn==600 && Object.getOwnPropertyNames(o).length==600;
+ok = ok && keys.every(function(k) { return (""+k)[0]!="\xFF"; });
+ok = ok && JSON.stringify(o).indexOf("hsh")<0;
+bigObject = o;
+
+// root gets an index too when there are lots of globals
+for (i=0;i<50;i++) global["g"+i] = i;
+for (i=0;i<50;i++) if (global["g"+i]!==i || eval("g"+i)!==i) ok = false;
+ok = ok && hasIndex(global) && typeof gmissing=="undefined";
+delete global.g10;
+ok = ok && typeof g10=="undefined" && g11===11;
+ok = ok && Object.keys(global).every(function(k) { return (""+k)[0]!="\xFF"; });
+ok = ok && E.dumpStr().indexOf("\xFF")<0;
+delete bigObject;
+
+result = ok;
@@ -0,0 +1,19 @@
+// Pipe data received on a Serial port to a file
+
+var result = 0;
+var fn = "tests/test_pipe_serial.tmp";
+
+var expected = "";
+for (var i=0;i<200;i++) expected += i+",";
+
+var f = E.openFile(fn, "w");
+LoopbackB.pipe(f, { end:false });
+LoopbackA.write(expected);
+
+setTimeout(function() {
+  f.close();
+  var contents = require("fs").readFileSync(fn);
+  console.log(JSON.stringify(contents));
+  result = contents==expected;
+  require("fs").unlink(fn);
+}, 100);
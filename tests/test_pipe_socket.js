@@ -0,0 +1,27 @@
+// Pipe a file to a socket, checking that everything arrives
+
+var result = 0;
+var net = require("net");
+var fn = "tests/test_pipe_socket.tmp";
+
+var expected = "";
+for (var i=0;i<3000;i++) expected += i+",";
+require("fs").writeFileSync(fn, expected);
+
+var server = net.createServer(function(c) {
+  E.openFile(fn, "r").pipe(c, { chunkSize:100 });
+});
+server.listen(4446);
+
+var client = net.connect({port: 4446}, function() {
+  var received = "";
+  client.on('data', function(data) {
+    received += data;
+  });
+  client.on('close', function() {
+    console.log("Received "+received.length+" bytes, expected "+expected.length);
+    result = received==expected;
+    server.close();
+    require("fs").unlink(fn);
+  });
+});
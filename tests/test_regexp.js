@@ -37,7 +37,7 @@ testreg(re.exec(names)," ;",49);
 test(re.lastIndex, 51);
 testreg(re.exec(names),null);
 test(re.lastIndex, 0);
-test(names.split(re), "Harry Trump,Fred Barney,Helen Rigby,Bill Abel");
+test(names.split(re), "Harry Trump,Fred Barney,Helen Rigby,Bill Abel,Chris Hand ");
 
 
 test("Hellowa worldssaaa a a a".replace(/a/,""),"Hellow worldssaaa a a a");
@@ -0,0 +1,90 @@
+// RegExps are compiled once and run with a Pike VM - check the extra features that gives us
+tests=0;
+testPass=0;
+
+function test(a, b) {
+  tests++;
+  if (a==b) {
+    return testPass++;
+  }
+  console.log("Test "+tests+" failed - ",a,"vs",b);
+}
+function testThrows(f) {
+  tests++;
+  try { f(); } catch (e) { return testPass++; }
+  console.log("Test "+tests+" didn't throw");
+}
+
+// alternation
+test(/cat|dog/.exec("hotdog"), "dog");
+test(/cat|dog/.exec("hotdog").index, 3);
+test(/a(b|c|d)e/.exec("xxacex"), "ace,c");
+test("one two three".replace(/one|three/g, "X"), "X two X");
+// quantifier ranges
+test(/a{3}/.exec("aaaaa"), "aaa");
+test(/a{2,}/.exec("baaaaa"), "aaaaa");
+test(/a{2,3}/.exec("baaaaa"), "aaa");
+test(/^\d{2,4}$/.test("123"), true);
+test(/^\d{2,4}$/.test("12345"), false);
+test(/x{0}y/.exec("xy"), "y");
+test(/a{,2}/.exec("a{,2}"), "a{,2}"); // not a quantifier
+// lazy quantifiers
+test(/<.+>/.exec("<a><b>"), "<a><b>");
+test(/<.+?>/.exec("<a><b>"), "<a>");
+test(/a*?b/.exec("aaab"), "aaab");
+test(/a??/.exec("aa"), "");
+// optional
+test(/colou?r/.exec("color"), "color");
+test(/colou?r/.exec("colour"), "colour");
+// groups
+test(/(?:ab)+/.exec("xababx"), "abab");
+var m = /(a)|(b)/.exec("b");
+test(m[1], undefined);
+test(m[2], "b");
+test(/((a)(b))c/.exec("abc"), "abc,ab,a,b");
+test(/(a+)+b/.test("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"), false); // would take forever with backtracking
+// character sets
+test(/[a-c]+/.exec("xxabcabd"), "abcab");
+test(/[^a-c]+/.exec("abxyz"), "xyz");
+test(/[\d.]+/.exec("v1.25a"), "1.25");
+test(/[a\-z]+/.exec("b-az"), "-az");
+test(/[-a]+/.exec("b-a"), "-a");
+// escapes
+test(/\./.exec("a.b").index, 1);
+test(/\(\d+\)/.exec("f(123)"), "(123)");
+test(/\x41/.exec("zA"), "A");
+test(/B/.exec("zB"), "B");
+// anchors and word boundaries
+test(/^a/.exec("ba"), null);
+test(/a$/.exec("ab"), null);
+test(/a$/.exec("ba").index, 1);
+test(/\bcat\b/.exec("concat cat").index, 7);
+test(/\Bcat/.exec("cat concat").index, 7);
+test(/^b/m.exec("a\nb").index, 2);
+test(/a$/m.exec("a\nb").index, 0);
+// . doesn't match newlines
+test(/a.b/.exec("a\nb"), null);
+// flags
+test(/hello/i.exec("Say HeLLo"), "HeLLo");
+test(/[a-c]+/i.exec("xABCx"), "ABC");
+// empty matches
+test("abc".replace(/x*/g, "-"), "-a-b-c-");
+test("a,b,,c".split(/,/), "a,b,,c");
+test("abc".split(/x*/).length, 3);
+test("a1b22c".split(/\d+/).join(" "), "a b c");
+// replace with groups that didn't match
+test("b".replace(/(a)|(b)/, "[$1$2]"), "[b]");
+test("b".replace(/(a)|(b)/, (m,a,b,idx)=>typeof a+b+idx), "undefinedb0");
+// errors
+testThrows(function() { new RegExp("(a"); });
+testThrows(function() { new RegExp("a)"); });
+testThrows(function() { new RegExp("*a"); });
+testThrows(function() { new RegExp("[a"); });
+testThrows(function() { new RegExp("a{3,2}"); });
+// the same regex can be used more than once
+var r = /(\w+)@(\w+)\.com/;
+test(r.exec("mail fred@example.com now"), "fred@example.com,fred,example");
+test(r.exec("bob@test.com"), "bob@test.com,bob,test");
+
+result = tests==testPass;
+console.log(result?"Pass":"Fail",":",tests,"tests total");
@@ -0,0 +1,51 @@
+// Variable lookups in bytecode remember where the variable was found - check they notice changes
+
+var g = 5;
+
+function sum(n) { var s=0; for (var i=0;i<n;i++) s += i+g; return s; }
+
+function counter() {
+  var c = 1;
+  return function() { var t=0; for (var i=0;i<3;i++) { t+=c; c++; } return t; };
+}
+
+function shadow() {
+  var a = [];
+  for (var i=0;i<2;i++) {
+    a.push(g);
+    if (i==0) { var g = 100; } // new local hides the global
+  }
+  return a.join(",");
+}
+
+function create() {
+  var a = [];
+  for (var i=0;i<3;i++) {
+    a.push(typeof zz);
+    if (i==0) zz = 3;
+    if (i==1) delete zz; // global removed
+  }
+  return a.join(",");
+}
+
+function replace() {
+  var a = [];
+  for (var i=0;i<2;i++) { a.push(g); g = 7; }
+  return a.join(",");
+}
+
+function recurse(n) { var x = n; if (n>0) recurse(n-1); return x; }
+
+function test() {
+  g = 5;
+  var cnt = counter();
+  var r = [sum(10), cnt(), cnt(), shadow(), create(), replace(), g, recurse(3)];
+  var expected = [95,6,15,"5,100","undefined,number,undefined","5,7",7,3];
+  if (JSON.stringify(r)!=JSON.stringify(expected)) console.log(JSON.stringify(r));
+  return JSON.stringify(r)==JSON.stringify(expected);
+}
+
+var withBytecode = test();
+E.setFlags({noBytecode:1});
+result = withBytecode && test();
+E.setFlags({noBytecode:0});
@@ -0,0 +1,33 @@
+// Storage - files are found after being created, replaced, erased and compacted
+
+var s = require("Storage");
+var ok = true;
+function check(name, expected) {
+  var d = s.read(name);
+  if (d!==expected) {
+    console.log("read("+JSON.stringify(name)+") = "+JSON.stringify(d)+", expected "+JSON.stringify(expected));
+    ok = false;
+  }
+}
+
+s.eraseAll();
+for (var i=0;i<20;i++) s.write("f"+i, "data "+i);
+s.write("f3", "replaced");
+s.erase("f5");
+check("f3", "replaced");
+check("f5", undefined);
+check("f19", "data 19");
+ok = ok && s.list().length==19 && s.list().indexOf("f5")<0;
+s.compact();
+check("f3", "replaced");
+check("f5", undefined);
+check("f0", "data 0");
+ok = ok && s.list().length==19;
+s.eraseAll();
+check("f0", undefined);
+s.write("f0", "new");
+check("f0", "new");
+ok = ok && s.list().length==1;
+s.eraseAll();
+
+result = ok;
@@ -0,0 +1,31 @@
+// Appending to strings remembers where the end of the last string was - make
+// sure that's forgotten when the garbage collector frees the string
+var keep = [], strs, a = "", i, j, k, n, o, addr, ok = true;
+for (i=0;i<1000;i++) keep.push(i); // fill up any gaps in memory
+for (i=0;i<50;i++) a += "a";
+// code to make lots of new strings without appending to any of them
+var newStrs = "[String.fromCharCode()";
+for (i=1;i<400;i++) newStrs += ",String.fromCharCode()";
+newStrs += "]";
+for (j=0;j<4;j++) {
+  // a string in a cycle can only be freed by the garbage collector
+  o = {};
+  o.self = o;
+  for (i=0;i<300;i++) o["p"+i] = i;
+  o.s = String.fromCharCode();
+  for (i=0;i<1000;i++) o.s += "o";
+  addr = E.getAddressOf(o.s);
+  o = undefined;
+  process.memory(); // runs a garbage collection
+  n = (j&1) ? 1.5 : undefined; // move where the new strings end up
+  // new strings are likely to reuse the memory the old one was in
+  strs = eval(newStrs);
+  // append to the string that reused the old one's memory first
+  for (k=0;k<strs.length-1;k++)
+    if (E.getAddressOf(strs[k])==addr) break;
+  for (i=0;i<50;i++) strs[k] += "a";
+  for (i=0;i<strs.length;i++)
+    if (strs[i] != ((i==k) ? a : "")) ok = false;
+}
+
+result = ok;
@@ -0,0 +1,44 @@
+// Appending to strings remembers where the end of the last string was - make
+// sure that's right when switching between strings, freeing them and moving them
+function pad(s, n) { var r = ""; while (r.length<n) r += s; return r; }
+var ok = true;
+function check(s, c, n) {
+  if (s.length!=n) ok = false;
+  for (var i=0;i<n;i+=7) if (s[i]!=c) ok = false;
+  if (s[n-1]!=c) ok = false;
+}
+
+// interleaved appends to two strings
+var a = "", b = "";
+for (var i=0;i<500;i++) { a += "a"; b += "bb"; }
+check(a, "a", 500);
+check(b, "b", 1000);
+
+// appends mixed with other string operations
+var s = pad("x", 300);
+var t = s.substr(10) + "y";
+s += "z";
+if (s.length!=301 || s[300]!="z" || t.length!=291 || t[290]!="y") ok = false;
+
+// free the string we were appending to, then build another
+s = undefined;
+var c = "";
+for (var i=0;i<300;i++) c += "c";
+check(c, "c", 300);
+
+// move things around while building a string
+var d = "";
+for (var i=0;i<200;i++) d += "d";
+var junk = []; for (i=0;i<100;i++) junk.push(pad("j",i)); junk = undefined;
+E.defrag();
+for (var i=0;i<200;i++) d += "d";
+check(d, "d", 400);
+
+// a long string used as a name
+var o = {};
+var e = pad("e", 50);
+o[e] = 1;
+e += "E";
+if (e.length!=51 || e[50]!="E" || o[pad("e",50)]!==1) ok = false;
+
+result = ok;
@@ -0,0 +1,29 @@
+// Timers are run from a time-ordered queue - check the order they run in,
+// and that clearing/changing timers updates the queue
+var log = [];
+var t = [];
+for (var i=0;i<20;i++) {
+  var ms = ((i*7)%20)*5; // added out of order
+  t[i] = setTimeout(function(ms) { log.push(ms); }, ms, ms);
+}
+setTimeout(function() { log.push("a"); }, 50); // same time - should run in order
+setTimeout(function() { log.push("b"); }, 50);
+// clear some timers
+clearTimeout(t[3]); // 5ms
+clearTimeout(t[10]); // 50ms
+// move a timeout using changeInterval
+var moved = setTimeout(function() { log.push("moved"); clearInterval(moved); }, 5);
+changeInterval(moved, 120); // this also makes it an interval
+
+var intervalCount = 0;
+var iv = setInterval(function() {
+  intervalCount++;
+  if (intervalCount==3) changeInterval(iv, 30); // change from inside the callback
+  if (intervalCount==5) clearInterval(iv);
+}, 10);
+
+setTimeout(function() {
+  var expected = [0,10,15,20,25,30,35,40,45,"a","b",55,60,65,70,75,80,85,90,95,"moved"];
+  result = JSON.stringify(log)==JSON.stringify(expected) && intervalCount==5;
+  if (!result) print(JSON.stringify(log), intervalCount);
+}, 200);
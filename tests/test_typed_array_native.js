@@ -0,0 +1,73 @@
+// Typed array methods that work directly on the data
+var ok = true;
+function check(name, v) { if (!v) { console.log("FAIL: "+name); ok = false; } }
+
+// sort is numeric, not by string
+check("sort u16", new Uint16Array([100,9,1000,5,20]).sort()=="5,9,20,100,1000");
+check("sort i8", new Int8Array([3,-5,0,-128,127]).sort()=="-128,-5,0,3,127");
+check("sort u32", new Uint32Array([4000000000,1,3000000000]).sort()=="1,3000000000,4000000000");
+check("sort f32", new Float32Array([2.5,-1,NaN,0.5]).sort()=="-1,0.5,2.5,NaN");
+check("sort f64", new Float64Array([NaN,3,NaN,-2]).sort()=="-2,3,NaN,NaN");
+check("sort fn", new Uint8Array([1,3,2]).sort(function(a,b){return b-a;})=="3,2,1");
+var big = new Int16Array(1000), i;
+for (i=0;i<big.length;i++) big[i] = (i*7919)%1000 - 500;
+big.sort();
+var sorted = true;
+for (i=1;i<big.length;i++) if (big[i-1]>big[i]) sorted = false;
+check("sort big", sorted && big[0]==-500 && big[999]==499);
+
+// fill
+check("fill", new Uint16Array(5).fill(300)=="300,300,300,300,300");
+check("fill range", new Int8Array(5).fill(-2,1,-1)=="0,-2,-2,-2,0");
+check("fill f32", new Float32Array(3).fill(0.5)=="0.5,0.5,0.5");
+check("fill clamped", new Uint8ClampedArray(2).fill(1000)=="255,255");
+
+// reverse
+check("reverse u8", new Uint8Array([1,2,3]).reverse()=="3,2,1");
+check("reverse f64", new Float64Array([1.5,2,3,4]).reverse()=="4,3,2,1.5");
+
+// indexOf
+var a = new Int16Array([5,-7,9,-7]);
+check("indexOf", a.indexOf(-7)==1);
+check("indexOf start", a.indexOf(-7,2)==3);
+check("indexOf none", a.indexOf(70000)==-1 && a.indexOf(9.5)==-1 && a.indexOf("9")==-1);
+check("indexOf f32", new Float32Array([0.1,0.5]).indexOf(0.5)==1);
+
+// subarray shares the data
+var buf = new Uint8Array([0,1,2,3,4,5]);
+var sub = buf.subarray(2,-1);
+check("subarray", sub=="2,3,4" && sub.length==3 && sub.byteOffset==2);
+sub[0] = 42;
+check("subarray shared", buf[2]==42);
+check("subarray reverse", buf.subarray(1,4).reverse() && buf=="0,3,42,1,4,5");
+check("subarray empty", buf.subarray(4,2).length==0);
+
+// set, including between types and into the same buffer
+var d = new Int16Array(4);
+d.set(new Uint8Array([1,2,255]), 1);
+check("set convert", d=="0,1,2,255");
+d.set(new Float32Array([-1.5]));
+check("set float", d[0]==-1);
+var c = new Uint8ClampedArray(2);
+c.set(new Int8Array([-5,5]));
+check("set clamped", c=="0,5");
+var e = new Uint8Array([1,2,3,4,5]);
+e.set(e.subarray(0,3), 2);
+check("set overlap", e=="1,2,1,2,3");
+check("copy", new Uint32Array(new Uint8Array([1,2,3]))=="1,2,3");
+
+// larger arrays, whose data is stored flat
+var f = new Int32Array(100).fill(-3, 10, 90);
+check("flat fill", f[9]==0 && f[10]==-3 && f[89]==-3 && f[90]==0);
+check("flat indexOf", f.indexOf(-3)==10 && f.indexOf(-3,50)==50 && f.indexOf(0,11)==90);
+f[0] = 1;
+check("flat reverse", f.reverse()[99]==1 && f[0]==0);
+var g = new Int16Array(100);
+for (i=0;i<100;i++) g[i] = i;
+g.set(g.subarray(0,50), 10);
+check("flat set overlap", g[10]==0 && g[59]==49 && g[60]==60);
+var h = new Float32Array(100);
+h.set(g);
+check("flat set convert", h[10]==0 && h[59]==49);
+
+result = ok;
@@ -0,0 +1,60 @@
+// Lots of watches on lots of pins, with events injected by toggling pins
+// (on Linux, writes to pins without real GPIO push watch events)
+var pins = [D0,D1,D2,D3,D4,D5,D6,D7];
+var counts = {}, edgeOk = true;
+pins.forEach(function(p, i) {
+  counts[i] = {both:0, rising:0, falling:0};
+  setWatch(function(e) { counts[i].both++; }, p, {repeat:true});
+  setWatch(function(e) { counts[i].rising++; if (!e.state) edgeOk=false; }, p, {repeat:true, edge:"rising"});
+  setWatch(function(e) { counts[i].falling++; if (e.state) edgeOk=false; }, p, {repeat:true, edge:"falling"});
+});
+// a watch that removes the next watch for the same pin from inside its callback
+var victim, victimCount = 0;
+setWatch(function() { clearWatch(victim); }, D8, {repeat:false});
+victim = setWatch(function() { victimCount++; }, D8, {repeat:true});
+
+var TOGGLES = 100, batch = 0;
+function toggle() {
+  // 8 pins x 2 writes = 16 events per loop - keep well under the event buffer size
+  for (var n=0;n<5;n++) {
+    pins.forEach(function(p) { digitalWrite(p,1); digitalWrite(p,0); });
+  }
+  digitalWrite(D8, batch&1);
+  if (++batch < TOGGLES/5) setTimeout(toggle, 5);
+  else setTimeout(check, 100);
+}
+function check() {
+  var ok = edgeOk && victimCount==0;
+  pins.forEach(function(p, i) {
+    var c = counts[i];
+    if (c.both!=TOGGLES*2 || c.rising!=TOGGLES || c.falling!=TOGGLES) {
+      print(p, JSON.stringify(c));
+      ok = false;
+    }
+  });
+  clearWatch();
+  setTimeout(function() { checkFreed(ok); }, 5);
+}
+// a watch that's been cleared doesn't stop its callback (and what it references) being freed
+function checkFreed(ok) {
+  var size;
+  (function() {
+    var big = new Uint8Array(2000);
+    size = E.getSizeOf(big);
+    setWatch(function() { big[0]++; }, D9, {repeat:true});
+  })();
+  digitalWrite(D9, 1); // the watch is put in the table when the event is handled
+  setTimeout(function() {
+    var before = process.memory().usage;
+    clearWatch();
+    setTimeout(function() {
+      var after = process.memory().usage;
+      if (before-after < size) {
+        print("Cleared watch not freed", before, after);
+        ok = false;
+      }
+      result = ok;
+    }, 5);
+  }, 5);
+}
+setTimeout(toggle, 5);